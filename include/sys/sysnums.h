@@ -25,6 +25,49 @@
 #define SYS_CHANNEL_TRY_RECV 44  //non-blocking channel receive
 #define SYS_CHANNEL_RECV_MSG 45  //receive with handles
 #define SYS_CHANNEL_TRY_RECV_MSG 46 //non-blocking recv_msg
+#define SYS_CHANNEL_SEND_LOAN 85 //send with a zero-copy VMO page loan
+#define SYS_CHANNEL_RECV_LOAN 86 //receive and map a page loan
+
+//ipc: shared-memory rings
+#define SYS_RING_CREATE     87  //create ring VMO + doorbell
+#define SYS_DOORBELL_CREATE 88
+#define SYS_DOORBELL_RING   89  //wake threads sleeping on a doorbell
+#define SYS_DOORBELL_WAIT   90  //sleep while a shared word holds a value
+
+//ipc: ports
+#define SYS_PORT_CREATE     91
+#define SYS_PORT_BIND       92  //watch a handle for signals under a key
+#define SYS_PORT_UNBIND     93
+#define SYS_PORT_SET_TIMER  94  //one-shot timer packet after N ms
+#define SYS_PORT_WAIT       95  //collect a batch of ready packets
+
+//ipc: synchronous calls
+#define SYS_CHANNEL_CALL    96  //send then block for the reply with direct handoff
+#define SYS_CHANNEL_REPLY   116 //answer a channel_call request by its transaction id
+
+//ipc: flow control
+#define SYS_CHANNEL_SEND_TIMEOUT 97 //send, sleeping while the peer queue is full
+#define SYS_CHANNEL_SET_DEPTH 98    //resize an endpoint's receive queue
+
+//ipc: batched channel transfers
+#define SYS_CHANNEL_SEND_BATCH 99   //queue up to 64 messages under one lock
+#define SYS_CHANNEL_RECV_BATCH 100  //drain up to 64 messages under one lock
+
+//threads
+#define SYS_THREAD_CREATE   101 //start another thread in the calling process
+#define SYS_THREAD_EXIT     102 //exit the calling thread, clearing and waking a word
+#define SYS_SET_TLS         103 //set the calling thread's FS base
+#define SYS_FUTEX_WAIT      104 //sleep while a user word holds a value
+#define SYS_FUTEX_WAKE      105 //wake threads sleeping on a user word
+
+//ipc: pipes
+#define SYS_PIPE_CREATE     106 //create a pipe, returns read and write handles
+#define SYS_SPLICE          107 //move bytes between a pipe and another handle
+#define SYS_TEE             108 //copy queued bytes between pipes without consuming
+
+//ipc: asynchronous I/O rings
+#define SYS_IORING_CREATE   111 //create an SQ/CQ ring VMO and its ring handle
+#define SYS_IORING_ENTER    112 //submit queued entries and/or wait for completions
 
 //memory: vmos
 #define SYS_VMO_CREATE      37
@@ -53,11 +96,16 @@
 #define SYS_PROC_GET_PENDING_EVENTS 82 //read current process pending event mask
 #define SYS_PROC_EVENT_RETURN 83 //return from a userspace event handler
 #define SYS_PROC_SET_CONSOLE_FOREGROUND 84 //set process receiving ctrl+c interrupts
+#define SYS_SYSCALL_TRACE   113 //start/stop syscall counters and the record stream of a process
+#define SYS_SYSCALL_STATS   114 //read a process's per-syscall counts and latency histograms
+#define SYS_SYNC            115 //write back every dirty cached disk block
 #define SYS_MKNODE          58  //create fs node
 #define SYS_REMOVE          59  //remove file or directory
 #define SYS_HANDLE_READ     6   //read from handle
 #define SYS_HANDLE_WRITE    7   //write to handle
 #define SYS_HANDLE_SEEK     8   //seek to an offset in a handle
+#define SYS_HANDLE_READV    109 //scatter read, optionally at an explicit offset
+#define SYS_HANDLE_WRITEV   110 //gather write, optionally at an explicit offset
 
 //misc/system
 #define SYS_DEBUG_WRITE     3
@@ -6,6 +6,9 @@
 //kernel stack for ring transitions (wraps TSS RSP0)
 void arch_set_kernel_stack(void *stack_top);
 
+//user thread pointer (FS base), the kernel itself never uses FS
+void arch_set_user_tls(uint64 base);
+
 
 //MI interface implementations
 uint32 arch_cpu_index(void);
@@ -23,6 +26,19 @@ static inline void arch_pause(void) {
     __asm__ volatile ("pause");
 }
 
+//idle doorbell (MONITOR/MWAIT), see power.c
+void arch_idle_init(void);
+bool arch_idle_has_doorbell(void);
+
+//arm the address monitor on the cache line holding addr
+static inline void arch_idle_arm(const volatile void *addr) {
+    __asm__ volatile ("monitor" :: "a"(addr), "c"(0), "d"(0) : "memory");
+}
+
+//sleep until the armed line is written or an interrupt arrives, choosing a
+//C-state from the expected idle time in TSC cycles
+void arch_idle_sleep(uint64 predicted_cycles);
+
 //memory barriers
 
 static inline void arch_mb(void) {
@@ -64,6 +80,10 @@ static inline void arch_irq_restore(irq_state_t flags) {
     __asm__ volatile ("push %0; popfq" :: "r"(flags) : "memory");
 }
 
+static inline bool arch_irq_state_enabled(irq_state_t flags) {
+    return (flags & (1ULL << 9)) != 0;  //RFLAGS.IF
+}
+
 void arch_string_init(void);
 
 #endif
@@ -30,6 +30,7 @@ void arch_init(struct db_boot_info *boot_info) {
     set_outmode(SERIAL);
 
     arch_string_init();
+    arch_idle_init();
 
     puts("\x1b[2J\x1b[H");
     puts("[amd64] initializing...\n");
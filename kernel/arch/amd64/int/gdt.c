@@ -9,6 +9,7 @@
 
 #define IA32_GS_BASE        0xC0000101
 #define IA32_KERNEL_GS_BASE 0xC0000102
+#define IA32_FS_BASE        0xC0000100
 
 //GDT entry (8 bytes)
 struct gdt_entry {
@@ -240,3 +241,7 @@ void arch_set_kernel_stack(void *stack_top) {
     percpu_set_kernel_stack(stack_top);
 }
 
+void arch_set_user_tls(uint64 base) {
+    wrmsr(IA32_FS_BASE, base);
+}
+
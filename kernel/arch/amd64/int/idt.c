@@ -17,6 +17,7 @@
 #include <arch/smp.h>
 #include <arch/fpu.h>
 #include <mm/kheap.h>
+#include <mm/ksm.h>
 #include <proc/sched.h>
 #include <proc/process.h>
 #include <proc/thread.h>
@@ -188,6 +189,11 @@ void interrupt_handler(uint64 vector, uint64 error_code, uint64 rip, interrupt_f
             return;
         }
 
+        //write to a merged page, hand out a private copy and retry
+        if (vector == PAGE_FAULT_VECTOR && ksm_handle_fault(arch_read_cr2(), error_code, frame->rflags)) {
+            return;
+        }
+
         //check for safe-copy recovery
         if (vector == PAGE_FAULT_VECTOR) {
             percpu_t *cpu = percpu_get();
@@ -240,6 +246,16 @@ void interrupt_handler(uint64 vector, uint64 error_code, uint64 rip, interrupt_f
             goto interrupt_epilogue_no_eoi;
         }
 
+        if (vector == IPI_TLB_SHOOTDOWN) {
+            arch_smp_tlb_shootdown_ipi();
+            if (apic_is_enabled() && ioapic_is_enabled()) {
+                apic_send_eoi();
+            } else {
+                pic_send_eoi(irq);
+            }
+            goto interrupt_epilogue_no_eoi;
+        }
+
         bool handled = false;
         switch (irq) {
             case 0:
@@ -1,4 +1,5 @@
 #include <arch/amd64/mmu.h>
+#include <arch/amd64/smp/smp.h>
 #include <mm/pmm.h>
 #include <mm/mm.h>
 #include <lib/string.h>
@@ -63,8 +64,28 @@ static void mmu_init_pat(void) {
     mmu_write_msr(MSR_IA32_PAT, pat);
 }
 
+//supervisor writes honour read-only PTEs once something needs it, until
+//then a kernel write to a read-only user page just goes through
+static volatile bool mmu_wp_wanted = false;
+
+void mmu_sync_wp(void) {
+    if (!__atomic_load_n(&mmu_wp_wanted, __ATOMIC_ACQUIRE)) return;
+    uint64 cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    if (cr0 & AMD64_CR0_WP) return;
+    cr0 |= AMD64_CR0_WP;
+    __asm__ volatile ("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+void mmu_enable_wp(void) {
+    __atomic_store_n(&mmu_wp_wanted, true, __ATOMIC_RELEASE);
+    //every CPU picks it up with its part of the shootdown
+    arch_smp_tlb_shootdown();
+}
+
 void mmu_init(void) {
     mmu_init_pat();
+    mmu_sync_wp();
     
     pagemap_t *map = mmu_get_kernel_pagemap();
     uint64 *pml4 = (uint64 *)P2V(map->top_level);
@@ -74,6 +95,16 @@ void mmu_init(void) {
     }
 }
 
+void mmu_init_ap(void) {
+    //the trampoline only sets PE/PG so mirror the BSP configuration here
+    mmu_init_pat();
+    mmu_sync_wp();
+}
+
+void mmu_flush_tlb(void) {
+    mmu_flush_current_tlb();
+}
+
 static uint64 *get_next_level(uint64 *current_table, uint32 index, bool allocate, bool user) {
     uint64 entry = current_table[index];
     if (entry & AMD64_PTE_PRESENT) {
@@ -156,6 +187,7 @@ void mmu_map_range(pagemap_t *map, uintptr virt, uintptr phys, size pages, uint6
     if (flags & MMU_FLAG_USER)  pte_flags |= AMD64_PTE_USER;
     if (flags & MMU_FLAG_NOCACHE) pte_flags |= (AMD64_PTE_PCD | AMD64_PTE_PWT);
     if (!(flags & MMU_FLAG_EXEC)) pte_flags |= AMD64_PTE_NX;
+    if (flags & MMU_FLAG_COW) pte_flags |= AMD64_PTE_COW;
 
     //check for write combining
     bool is_wc = (flags & MMU_FLAG_WC) != 0;
@@ -349,6 +381,32 @@ uintptr mmu_virt_to_phys(pagemap_t *map, uintptr virt) {
     return (pt_entry & AMD64_PTE_ADDR_MASK) + (virt & 0xFFF);
 }
 
+uint64 mmu_get_page_flags(pagemap_t *map, uintptr virt) {
+    uint64 *pml4 = (uint64 *)P2V(map->top_level);
+
+    uint64 *pdp = get_next_level(pml4, PML4_IDX(virt), false, false);
+    if (!pdp) return 0;
+
+    //huge mappings are reported as absent since callers operate on 4K leaves
+    uint64 *pd = get_next_level(pdp, PDP_IDX(virt), false, false);
+    if (!pd) return 0;
+
+    uint64 *pt = get_next_level(pd, PD_IDX(virt), false, false);
+    if (!pt) return 0;
+
+    uint64 pt_entry = pt[PT_IDX(virt)];
+    if (!(pt_entry & AMD64_PTE_PRESENT)) return 0;
+
+    uint64 flags = MMU_FLAG_PRESENT;
+    if (pt_entry & AMD64_PTE_WRITE) flags |= MMU_FLAG_WRITE;
+    if (pt_entry & AMD64_PTE_USER) flags |= MMU_FLAG_USER;
+    if (pt_entry & AMD64_PTE_PCD) flags |= MMU_FLAG_NOCACHE;
+    if (pt_entry & AMD64_PTE_PAT) flags |= MMU_FLAG_WC;
+    if (!(pt_entry & AMD64_PTE_NX)) flags |= MMU_FLAG_EXEC;
+    if (pt_entry & AMD64_PTE_COW) flags |= MMU_FLAG_COW;
+    return flags;
+}
+
 void mmu_switch(pagemap_t *map) {
     __asm__ volatile ("mov %0, %%cr3" :: "r"(map->top_level) : "memory");
 }
@@ -10,6 +10,7 @@
 #define MMU_FLAG_NOCACHE    (1ULL << 3)
 #define MMU_FLAG_EXEC       (1ULL << 4)
 #define MMU_FLAG_WC         (1ULL << 5)
+#define MMU_FLAG_COW        (1ULL << 6)  //write-protected copy-on-write page
 
 //amd64 page table entry bits
 #define AMD64_PTE_PRESENT   (1ULL << 0)
@@ -22,8 +23,12 @@
 #define AMD64_PTE_PAT       (1ULL << 7) //PAT bit for 4KB pages
 #define AMD64_PTE_HUGE      (1ULL << 7)
 #define AMD64_PTE_GLOBAL    (1ULL << 8)
+#define AMD64_PTE_COW       (1ULL << 9) //software-available: copy-on-write marker
 #define AMD64_PTE_NX        (1ULL << 63)
 
+//control register bits
+#define AMD64_CR0_WP        (1ULL << 16)
+
 //MSRs
 #define MSR_IA32_PAT        0x277
 
@@ -47,9 +52,17 @@ typedef struct pagemap {
 
 //MI mmu interface
 void mmu_init(void);
+void mmu_init_ap(void);
 void mmu_map_range(pagemap_t *map, uintptr virt, uintptr phys, size pages, uint64 flags);
 void mmu_unmap_range(pagemap_t *map, uintptr virt, size pages);
 uintptr mmu_virt_to_phys(pagemap_t *map, uintptr virt);
+uint64 mmu_get_page_flags(pagemap_t *map, uintptr virt);
+void mmu_flush_tlb(void);
+//make supervisor writes fault on read-only pages on every CPU (CR0.WP), for
+//copy-on-write pages kernel copies must not overwrite. must be called with
+//interrupts enabled, mmu_sync_wp applies it on the calling CPU
+void mmu_enable_wp(void);
+void mmu_sync_wp(void);
 void mmu_switch(pagemap_t *map);
 pagemap_t *mmu_get_kernel_pagemap(void);
 uint64 mmu_get_kernel_cr3(void);
@@ -72,6 +72,14 @@ typedef struct percpu {
     
     //136+: synchronisation
     spinlock_irq_t sched_lock;
+    volatile uint64 rcu_qs_seq;      //last RCU grace period this CPU has passed
+
+    //idle doorbell, kept on its own cache line so MWAIT only wakes for it
+    volatile uint32 idle_doorbell __attribute__((aligned(64)));
+
+    //the rest starts on the next line, away from the monitored one
+    volatile uint32 idle_waiting __attribute__((aligned(64))); //1 while the idle thread sleeps on the doorbell
+    uint64 idle_predict;             //moving average of recent idle periods in TSC cycles
 } percpu_t;
 
 //get pointer to current CPU's per-CPU data
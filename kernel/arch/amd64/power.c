@@ -1,6 +1,7 @@
 #include <arch/amd64/power.h>
 #include <lib/io.h>
 #include <arch/amd64/acpi/acpi.h>
+#include <arch/amd64/cpu.h>
 
 void arch_power_reboot(void) {
     acpi_reboot();
@@ -9,3 +10,50 @@ void arch_power_reboot(void) {
 void arch_power_shutdown(void) {
     acpi_shutdown();
 }
+
+//deeper C-states save more power but take longer to leave, only ask for
+//them when the last few idle periods suggest we will sleep long enough
+#define IDLE_C2_MIN_CYCLES  50000ULL
+#define IDLE_C3_MIN_CYCLES  500000ULL
+
+static bool idle_mwait = false;
+static bool idle_has_c2 = false;
+static bool idle_has_c3 = false;
+
+void arch_idle_init(void) {
+    uint32 eax, ebx, ecx, edx;
+    arch_cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32 max_leaf = eax;
+    if (max_leaf < 1) return;
+
+    arch_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(ecx & (1 << 3))) return;
+    idle_mwait = true;
+
+    //leaf 5 enumerates the MWAIT sub-states per C-state when ECX bit 0 is set
+    if (max_leaf >= 5) {
+        arch_cpuid(5, 0, &eax, &ebx, &ecx, &edx);
+        if (ecx & 1) {
+            idle_has_c2 = ((edx >> 8) & 0xF) != 0;
+            idle_has_c3 = ((edx >> 12) & 0xF) != 0;
+        }
+    }
+
+    printf("[amd64] MWAIT idle enabled (C2 %s, C3 %s)\n",
+           idle_has_c2 ? "yes" : "no", idle_has_c3 ? "yes" : "no");
+}
+
+bool arch_idle_has_doorbell(void) {
+    return idle_mwait;
+}
+
+void arch_idle_sleep(uint64 predicted_cycles) {
+    //hint is (C-state - 1) << 4 with sub-state 0
+    uint32 hint = 0x00;
+    if (idle_has_c3 && predicted_cycles >= IDLE_C3_MIN_CYCLES) {
+        hint = 0x20;
+    } else if (idle_has_c2 && predicted_cycles >= IDLE_C2_MIN_CYCLES) {
+        hint = 0x10;
+    }
+    __asm__ volatile ("mwait" :: "a"(hint), "c"(0) : "memory");
+}
@@ -45,6 +45,10 @@ typedef struct {
 //atomic counter for started APs
 static volatile uint32 ap_started_count = 0;
 
+//TLB shootdown state - one initiator at a time, targets count down on ack
+static spinlock_t tlb_shootdown_lock = SPINLOCK_INIT;
+static volatile uint32 tlb_shootdown_pending = 0;
+
 //delay using APIC timer or busy loop
 static void delay_us(uint32 us) {
     //simple busy loop - not accurate but sufficient for INIT-SIPI timing
@@ -189,6 +193,9 @@ void ap_entry(uint32 cpu_index) {
     
     //initialize per-CPU data
     percpu_init_ap(cpu_index, apic_id);
+
+    //paging controls (PAT, CR0.WP) are per-CPU state
+    mmu_init_ap();
     
     //initialize this AP's GDT and TSS
     gdt_init_ap(cpu_index);
@@ -229,3 +236,41 @@ void arch_smp_send_resched(uint32 cpu_index) {
     
     apic_send_ipi(cpu->apic_id, IPI_RESCHEDULE);
 }
+
+void arch_smp_tlb_shootdown(void) {
+    spinlock_acquire(&tlb_shootdown_lock);
+
+    irq_state_t flags = arch_irq_save();
+    uint32 self = percpu_get()->cpu_index;
+    uint32 count = smp_cpu_count();
+
+    uint32 targets = 0;
+    for (uint32 i = 0; i < count && i < MAX_CPUS; i++) {
+        percpu_t *cpu = percpu_get_by_index(i);
+        if (i != self && cpu && cpu->started) targets++;
+    }
+    __atomic_store_n(&tlb_shootdown_pending, targets, __ATOMIC_RELEASE);
+
+    for (uint32 i = 0; i < count && i < MAX_CPUS; i++) {
+        percpu_t *cpu = percpu_get_by_index(i);
+        if (i == self || !cpu || !cpu->started) continue;
+        apic_send_ipi(cpu->apic_id, IPI_TLB_SHOOTDOWN);
+    }
+    mmu_sync_wp();
+    mmu_flush_tlb();
+    arch_irq_restore(flags);
+
+    //targets may be spinning with interrupts off on a lock we don't hold
+    //so wait with our own interrupts restored
+    while (__atomic_load_n(&tlb_shootdown_pending, __ATOMIC_ACQUIRE) != 0) {
+        arch_pause();
+    }
+
+    spinlock_release(&tlb_shootdown_lock);
+}
+
+void arch_smp_tlb_shootdown_ipi(void) {
+    mmu_sync_wp();
+    mmu_flush_tlb();
+    __atomic_fetch_sub(&tlb_shootdown_pending, 1, __ATOMIC_RELEASE);
+}
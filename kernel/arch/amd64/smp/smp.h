@@ -18,4 +18,12 @@ void ap_entry(uint32 cpu_index);
 //send rescheduling IPI to a specific CPU
 void arch_smp_send_resched(uint32 cpu_index);
 
+//flush non-global TLB entries on every online CPU and wait for all of them
+//must be called with interrupts enabled and no spinlocks held that an
+//interrupts-off CPU could be waiting on
+void arch_smp_tlb_shootdown(void);
+
+//IPI_TLB_SHOOTDOWN handler body
+void arch_smp_tlb_shootdown_ipi(void);
+
 #endif
@@ -6,21 +6,190 @@
 static int cpu_features_detected = 0;
 static int has_erms = 0;
 static int has_fsrm = 0;
+static int has_sse2 = 0;
+
+//copies at least this large bypass the cache with non-temporal stores
+//so a single framebuffer or VMO copy cannot evict everything else
+#define STRING_NT_DEFAULT_THRESHOLD (1024 * 1024)
+#define STRING_NT_MIN_THRESHOLD     (256 * 1024)
+static size nt_threshold = (size)-1;
+
+//largest data/unified cache reported by CPUID, 0 if unknown
+static size string_detect_llc_size(uint32 max_leaf) {
+    uint32 eax, ebx, ecx, edx;
+    size best = 0;
+
+    //intel deterministic cache parameters
+    if (max_leaf >= 4) {
+        for (uint32 i = 0; i < 16; i++) {
+            arch_cpuid(4, i, &eax, &ebx, &ecx, &edx);
+            uint32 type = eax & 0x1F;
+            if (type == 0) break;
+            if (type == 2) continue; //instruction cache
+            size ways = ((ebx >> 22) & 0x3FF) + 1;
+            size parts = ((ebx >> 12) & 0x3FF) + 1;
+            size line = (ebx & 0xFFF) + 1;
+            size sets = (size)ecx + 1;
+            size bytes = ways * parts * line * sets;
+            if (bytes > best) best = bytes;
+        }
+    }
+    if (best) return best;
+
+    //amd extended leaf: L2 in KB in ECX[31:16], L3 in 512KB units in EDX[31:18]
+    arch_cpuid(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000006) {
+        arch_cpuid(0x80000006, 0, &eax, &ebx, &ecx, &edx);
+        size l2 = (size)(ecx >> 16) * 1024;
+        size l3 = (size)(edx >> 18) * 512 * 1024;
+        best = l3 > l2 ? l3 : l2;
+    }
+    return best;
+}
 
 void arch_string_init(void) {
     uint32 eax = 0, ebx = 0, ecx = 0, edx = 0;
     arch_cpuid(0, 0, &eax, &ebx, &ecx, &edx);
-    if (eax >= 7) {
+    uint32 max_leaf = eax;
+    if (max_leaf >= 1) {
+        arch_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+        has_sse2 = (edx & (1 << 26)) != 0;
+    }
+    if (max_leaf >= 7) {
         arch_cpuid(7, 0, &eax, &ebx, &ecx, &edx);
         has_erms = (ebx & (1 << 9)) != 0;
         has_fsrm = (edx & (1 << 4)) != 0;
     }
+
+    //movnti needs SSE2; past roughly half the LLC the copy would
+    //stream through the cache anyway so skip it entirely
+    if (has_sse2) {
+        size llc = string_detect_llc_size(max_leaf);
+        nt_threshold = llc ? llc / 2 : STRING_NT_DEFAULT_THRESHOLD;
+        if (nt_threshold < STRING_NT_MIN_THRESHOLD) nt_threshold = STRING_NT_MIN_THRESHOLD;
+    }
     cpu_features_detected = 1;
 }
 
+//non-temporal forward copy, uses only general purpose registers (movnti)
+//so it is safe with lazy FPU switching and -mgeneral-regs-only
+static void memcpy_nt(void *dest, const void *src, size n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+
+    //align the destination so every movnti is a full naturally aligned store
+    size head = (8 - ((uintptr)d & 7)) & 7;
+    n -= head;
+    if (head) {
+        __asm__ volatile (
+            "rep movsb"
+            : "+D"(d), "+S"(s), "+c"(head)
+            :
+            : "memory"
+        );
+    }
+
+    size blocks = n / 64;
+    if (blocks) {
+        __asm__ volatile (
+            "1:\n\t"
+            "prefetchnta 512(%1)\n\t"
+            "mov 0(%1), %%r8\n\t"
+            "mov 8(%1), %%r9\n\t"
+            "mov 16(%1), %%r10\n\t"
+            "mov 24(%1), %%r11\n\t"
+            "movnti %%r8, 0(%0)\n\t"
+            "movnti %%r9, 8(%0)\n\t"
+            "movnti %%r10, 16(%0)\n\t"
+            "movnti %%r11, 24(%0)\n\t"
+            "mov 32(%1), %%r8\n\t"
+            "mov 40(%1), %%r9\n\t"
+            "mov 48(%1), %%r10\n\t"
+            "mov 56(%1), %%r11\n\t"
+            "movnti %%r8, 32(%0)\n\t"
+            "movnti %%r9, 40(%0)\n\t"
+            "movnti %%r10, 48(%0)\n\t"
+            "movnti %%r11, 56(%0)\n\t"
+            "add $64, %1\n\t"
+            "add $64, %0\n\t"
+            "dec %2\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(d), "+r"(s), "+r"(blocks) //outputs (modified)
+            : //inputs (in registers via constraints)
+            : "r8", "r9", "r10", "r11", "cc", "memory" //clobbers
+        );
+    }
+
+    size tail = n & 63;
+    if (tail) {
+        __asm__ volatile (
+            "rep movsb"
+            : "+D"(d), "+S"(s), "+c"(tail)
+            :
+            : "memory"
+        );
+    }
+}
+
+//non-temporal fill, same constraints as memcpy_nt
+static void memset_nt(void *dest, uint64 word_val, size n) {
+    unsigned char *d = (unsigned char *)dest;
+    unsigned char val = (unsigned char)word_val;
+
+    size head = (8 - ((uintptr)d & 7)) & 7;
+    n -= head;
+    if (head) {
+        __asm__ volatile (
+            "rep stosb"
+            : "+D"(d), "+c"(head)
+            : "a"(val)
+            : "memory"
+        );
+    }
+
+    size blocks = n / 64;
+    if (blocks) {
+        __asm__ volatile (
+            "1:\n\t"
+            "movnti %2, 0(%0)\n\t"
+            "movnti %2, 8(%0)\n\t"
+            "movnti %2, 16(%0)\n\t"
+            "movnti %2, 24(%0)\n\t"
+            "movnti %2, 32(%0)\n\t"
+            "movnti %2, 40(%0)\n\t"
+            "movnti %2, 48(%0)\n\t"
+            "movnti %2, 56(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(d), "+r"(blocks) //outputs (modified)
+            : "r"(word_val) //inputs (in registers via constraints)
+            : "cc", "memory" //clobbers
+        );
+    }
+
+    size tail = n & 63;
+    if (tail) {
+        __asm__ volatile (
+            "rep stosb"
+            : "+D"(d), "+c"(tail)
+            : "a"(val)
+            : "memory"
+        );
+    }
+}
+
 void *memcpy(void *dest, const void *src, size n) {
     if (n == 0) return dest;
 
+    //huge copies stream past the cache
+    if (n >= nt_threshold) {
+        memcpy_nt(dest, src, n);
+        return dest;
+    }
+
     //use fsrm if available
     if (has_fsrm) {
         void *d = dest;
@@ -73,6 +242,11 @@ void *memset(void *s, int c, size n) {
 
     unsigned char val = (unsigned char)c;
 
+    if (n >= nt_threshold) {
+        memset_nt(s, val * 0x0101010101010101ULL, n);
+        return s;
+    }
+
     //use erms for larger clears
     if (has_erms && n >= 256) {
         void *d = s;
@@ -108,8 +282,9 @@ void *memset(void *s, int c, size n) {
 void *memmove(void *dest, const void *src, size n) {
     if (dest == src || n == 0) return dest;
 
-    if (dest < src) {
-        //forward copy - just use memcpy
+    //forward copy is safe below the source and for disjoint ranges, both
+    //go through memcpy so large moves still get erms/non-temporal paths
+    if (dest < src || (const unsigned char *)dest >= (const unsigned char *)src + n) {
         return memcpy(dest, src, n);
     } else {
         //backward copy using loop to avoid direction flag (df) bugs
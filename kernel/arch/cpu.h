@@ -23,6 +23,7 @@
  * arch_idle() - idle CPU (enable interrupts and halt)
  * arch_pause() - hint to CPU that we're in a spin loop
  * arch_set_kernel_stack(void *stack_top) - set kernel stack for ring transitions
+ * arch_set_user_tls(uint64 base) - load the user thread pointer of the next thread
  * arch_cpu_index() - get the current CPU logical index/ID
  * arch_cpu_count() - get the number of online CPUs (if architecture supports SMP)
  *
@@ -36,11 +37,15 @@
  *
  * irq_state_t arch_irq_save() - disable interrupts and return previous state
  * arch_irq_restore(irq_state_t) - restore interrupt state
+ * arch_irq_state_enabled(irq_state_t) - true if the state has interrupts on
  *
  * optional (arch-specific):
  *
  * arch_rdtsc() - read time-stamp counter (x86/amd64)
  * arch_cpuid(leaf, subleaf, *eax, *ebx, *ecx, *edx) - CPU identification (x86/amd64)
+ * arch_idle_has_doorbell() - true if idle CPUs can wait for a store instead of an IPI
+ * arch_idle_arm(addr) - watch the cache line at addr for the next arch_idle_sleep()
+ * arch_idle_sleep(predicted_cycles) - sleep until addr is written or an interrupt arrives
  */
 
 #endif
@@ -22,9 +22,13 @@
  * required MI functions - each arch must implement:
  *
  * mmu_init() - initialize MMU for current kernel
+ * mmu_init_ap() - apply the boot CPU's paging controls on an AP
  * mmu_map_range(map, virt, phys, pages, flags) - map range of pages
  * mmu_unmap_range(map, virt, pages) - unmap range of pages
  * mmu_virt_to_phys(map, virt) - translate virtual address to physical physical
+ * mmu_get_page_flags(map, virt) - MI flags of a 4KiB leaf mapping (0 if none)
+ * mmu_flush_tlb() - flush this CPU's non-global TLB entries
+ * mmu_enable_wp() - make kernel writes fault on read-only user pages on every CPU
  * mmu_switch(map) - switch to a different address space
  * mmu_get_kernel_pagemap() - get the kernel's initial pagemap
  * mmu_pagemap_create() - create a new address space (pagemap)
@@ -40,6 +44,7 @@
  *
  * required flags:
  * MMU_FLAG_PRESENT, MMU_FLAG_WRITE, MMU_FLAG_USER, MMU_FLAG_NOCACHE, MMU_FLAG_EXEC
+ * MMU_FLAG_COW (stored in a software bit, hardware ignores it)
  */
 
 #endif
@@ -25,6 +25,7 @@ required MI functions - each arch must implement in its specific header:
 - uint32 smp_cpu_count(void);
 - bool smp_ap_started(uint32 cpu_index);
 - void arch_smp_send_resched(uint32 cpu_index);
+- void arch_smp_tlb_shootdown(void);
 */
 
 #endif
@@ -3,6 +3,10 @@
 
 #include <arch/types.h>
 
+//largest transfer a device object op hands to the driver in one call
+//(NVMe maps a request with a single PRP list page, good for 2MB)
+#define BLKDEV_MAX_IO_BYTES (1u << 20)
+
 //forward declaration
 struct blkdev;
 
@@ -15,6 +19,17 @@ typedef struct blkdev_ops {
     //write sectors to device
     //returns 0 on success nnd negative on error
     int (*write)(struct blkdev *dev, uint64 lba, uint32 count, const void *buf);
+
+    //the rest is optional (NULL when the device has no such command)
+
+    //make every completed write durable (drains a volatile write cache)
+    int (*flush)(struct blkdev *dev);
+
+    //sectors are no longer in use, their contents are undefined afterwards
+    int (*discard)(struct blkdev *dev, uint64 lba, uint32 count);
+
+    //zero sectors without transferring data, negative if the device cannot
+    int (*write_zeroes)(struct blkdev *dev, uint64 lba, uint32 count);
 } blkdev_ops_t;
 
 //block device
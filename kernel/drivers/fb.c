@@ -9,6 +9,7 @@
 #include <obj/namespace.h>
 #include <arch/mmu.h>
 #include <drivers/init.h>
+#include <syscall/syscall.h>
 
 //the active backend, whoever calls fb_set_backend() first wins
 //NULL until a driver registers or fb_init_backbuffer() falls back to boot-GOP
@@ -125,6 +126,27 @@ static ssize fb_obj_write(object_t *obj, const void *buf, size len, size offset)
     return len;
 }
 
+//user variants copy between VRAM and the caller's buffer with no bounce
+static ssize fb_obj_read_user(object_t *obj, void *ubuf, size len, size offset) {
+    (void)obj;
+    if (!active_backend) return 0;
+    if (offset >= active_backend->size) return 0;
+    if (len > active_backend->size - offset) len = active_backend->size - offset;
+    if (copy_to_user_bytes(ubuf, (uint8 *)active_backend->display_buffer + offset, len) != 0) return -1;
+    return len;
+}
+
+static ssize fb_obj_write_user(object_t *obj, const void *ubuf, size len, size offset) {
+    (void)obj;
+    if (!active_backend) return 0;
+    if (offset >= active_backend->size) return 0;
+    if (len > active_backend->size - offset) len = active_backend->size - offset;
+    size end = offset + len;
+    if (copy_user_bytes(ubuf, (uint8 *)active_backend->draw_buffer + offset, len) != 0) return -1;
+    if (end >= active_backend->size) fb_flip();
+    return len;
+}
+
 static int fb_obj_stat(object_t *obj, stat_t *st) {
     (void)obj;
     if (!st || !active_backend) return -1;
@@ -141,7 +163,9 @@ static int fb_obj_stat(object_t *obj, stat_t *st) {
 static object_ops_t fb_object_ops = {
     .read = fb_obj_read,
     .write = fb_obj_write,
-    .stat = fb_obj_stat
+    .stat = fb_obj_stat,
+    .read_user = fb_obj_read_user,
+    .write_user = fb_obj_write_user
 };
 
 //backend registration
@@ -9,6 +9,7 @@
 #include <lib/string.h>
 #include <lib/crc32.h>
 #include <fs/fs.h>
+#include <fs/bcache.h>
 #include <syscall/syscall.h>
 
 static int part_stat_op(object_t *obj, stat_t *st);
@@ -44,9 +45,32 @@ static int partition_write(blkdev_t *dev, uint64 lba, uint32 count, const void *
     return parent->ops->write(parent, dev->start_lba + lba, count, buf);
 }
 
+static int partition_flush(blkdev_t *dev) {
+    blkdev_t *parent = dev->parent;
+    if (!parent) return -1;
+    return parent->ops->flush ? parent->ops->flush(parent) : 0;
+}
+
+static int partition_discard(blkdev_t *dev, uint64 lba, uint32 count) {
+    blkdev_t *parent = dev->parent;
+    if (!parent) return -1;
+    if (lba >= dev->sector_count || (uint64)count > dev->sector_count - lba) return -1;
+    return parent->ops->discard ? parent->ops->discard(parent, dev->start_lba + lba, count) : 0;
+}
+
+static int partition_write_zeroes(blkdev_t *dev, uint64 lba, uint32 count) {
+    blkdev_t *parent = dev->parent;
+    if (!parent || !parent->ops->write_zeroes) return -1;
+    if (lba >= dev->sector_count || (uint64)count > dev->sector_count - lba) return -1;
+    return parent->ops->write_zeroes(parent, dev->start_lba + lba, count);
+}
+
 static blkdev_ops_t partition_ops = {
     .read = partition_read,
     .write = partition_write,
+    .flush = partition_flush,
+    .discard = partition_discard,
+    .write_zeroes = partition_write_zeroes,
 };
 
 //object ops for partition device
@@ -68,7 +92,7 @@ static ssize part_read_op(object_t *obj, void *buf, size len, size offset) {
     if (!kbuf_phys) return -1;
     void *kbuf = P2V(kbuf_phys);
     
-    int result = partition_read(dev, lba, count, kbuf);
+    int result = bcache_read(dev, lba, count, kbuf);
     if (result == 0) {
         memcpy(buf, kbuf, len);  //copy to userspace
     }
@@ -96,12 +120,60 @@ static ssize part_write_op(object_t *obj, const void *buf, size len, size offset
     void *kbuf = P2V(kbuf_phys);      
     
     memcpy(kbuf, buf, len);  //copy from userspace
-    int result = partition_write(dev, lba, count, kbuf);
+    int result = bcache_write(dev, lba, count, kbuf);
     
     pmm_free(kbuf_phys, (len + 4095) / 4096);
     return (result == 0) ? (ssize)len : -1;
 }
 
+//scatter/gather, only the total length and offset have to be sector aligned
+//the segments are staged in one buffer and go to the disk in BLKDEV_MAX_IO_BYTES pieces
+static ssize part_rwv_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset, bool write) {
+    blkdev_t *dev = (blkdev_t *)obj->data;
+    if (!dev) return -1;
+    
+    size len = 0;
+    for (uint32 i = 0; i < count; i++) len += iov[i].len;
+    if (offset % dev->sector_size != 0) return -1;
+    if (len == 0 || len % dev->sector_size != 0) return -1;
+    
+    uint64 lba = offset / dev->sector_size;
+    uint64 sectors = len / dev->sector_size;
+    if (lba >= dev->sector_count || sectors > dev->sector_count - lba) return -1;
+    
+    size chunk_max = len < BLKDEV_MAX_IO_BYTES ? len : BLKDEV_MAX_IO_BYTES;
+    size pages = (chunk_max + 4095) / 4096;
+    void *kbuf_phys = pmm_alloc(pages);
+    if (!kbuf_phys) return -1;
+    uint8 *kbuf = P2V(kbuf_phys);
+    
+    int result = 0;
+    for (size pos = 0; pos < len && result == 0;) {
+        size n = len - pos < chunk_max ? len - pos : chunk_max;
+        uint32 chunk = (uint32)(n / dev->sector_size);
+        if (write) {
+            result = io_vec_copy(iov, count, pos, kbuf, n, false);
+            if (result == 0) result = bcache_write(dev, lba, chunk, kbuf);
+        } else {
+            result = bcache_read(dev, lba, chunk, kbuf);
+            if (result == 0) result = io_vec_copy(iov, count, pos, kbuf, n, true);
+        }
+        lba += chunk;
+        pos += n;
+    }
+    
+    pmm_free(kbuf_phys, pages);
+    return (result == 0) ? (ssize)len : -1;
+}
+
+static ssize part_readv_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    return part_rwv_op(obj, iov, count, offset, false);
+}
+
+static ssize part_writev_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    return part_rwv_op(obj, iov, count, offset, true);
+}
+
 static int part_stat_op(object_t *obj, stat_t *st) {
     blkdev_t *dev = (blkdev_t *)obj->data;
     if (!dev || !st) return -1;
@@ -113,7 +185,21 @@ static int part_stat_op(object_t *obj, stat_t *st) {
 
 static intptr part_get_info_op(object_t *obj, uint32 topic, void *buf, size len) {
     blkdev_t *dev = (blkdev_t *)obj->data;
-    if (!dev || !buf) return -1;
+    if (!dev) return -1;
+    if (topic == OBJ_INFO_BLOCK_FLUSH) return bcache_sync(dev);
+    if (!buf) return -1;
+
+    if (topic == OBJ_INFO_BLOCK_DISCARD || topic == OBJ_INFO_BLOCK_ZERO ||
+        topic == OBJ_INFO_BLOCK_PREFETCH) {
+        if (len < sizeof(block_range_t)) return -1;
+        const block_range_t *range = (const block_range_t *)buf;
+        if (range->offset % dev->sector_size != 0 || range->len % dev->sector_size != 0) return -1;
+        uint64 lba = range->offset / dev->sector_size;
+        uint64 count = range->len / dev->sector_size;
+        if (topic == OBJ_INFO_BLOCK_PREFETCH) return bcache_prefetch(dev, lba, count);
+        if (topic == OBJ_INFO_BLOCK_DISCARD) return bcache_discard(dev, lba, count);
+        return bcache_write_zeroes(dev, lba, count);
+    }
 
     if (topic == OBJ_INFO_BLOCK_DEVICE) {
         if (len < sizeof(block_device_info_t)) return -1;
@@ -133,7 +219,9 @@ static object_ops_t partition_object_ops = {
     .readdir = NULL,
     .lookup = NULL,
     .stat = part_stat_op,
-    .get_info = part_get_info_op
+    .get_info = part_get_info_op,
+    .readv_user = part_readv_op,
+    .writev_user = part_writev_op
 };
 
 int gpt_scan(blkdev_t *dev) {
@@ -145,7 +233,7 @@ int gpt_scan(blkdev_t *dev) {
     void *buf = P2V(buf_phys);
     
     //read LBA 1 (GPT header)
-    if (dev->ops->read(dev, 1, 1, buf) != 0) {
+    if (bcache_read(dev, 1, 1, buf) != 0) {
         pmm_free(buf_phys, 1);
         return -1;
     }
@@ -232,7 +320,7 @@ int gpt_scan(blkdev_t *dev) {
     }
     void *table_buf = P2V(table_buf_phys);
 
-    if (dev->ops->read(dev, hdr->partition_entry_lba, (uint32)table_sectors_to_read, table_buf) != 0) {
+    if (bcache_read(dev, hdr->partition_entry_lba, (uint32)table_sectors_to_read, table_buf) != 0) {
         printf("[gpt] ERR: %s failed to read partition entry table\n", dev->name);
         pmm_free(table_buf_phys, table_pages);
         pmm_free(buf_phys, 1);
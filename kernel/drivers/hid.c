@@ -418,7 +418,7 @@ static bool channel_queue_full(channel_endpoint_t *ep) {
     channel_t *ch = ep->channel;
     int peer_id = 1 - ep->endpoint_id;
     irq_state_t flags = spinlock_irq_acquire(&ch->lock);
-    bool full = (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE);
+    bool full = (ch->queue_len[peer_id] >= ch->queue_depth[peer_id]);
     spinlock_irq_release(&ch->lock, flags);
     return full;
 }
@@ -455,7 +455,7 @@ static void push_to_channel(channel_endpoint_t *ep, void *data, uint32 len) {
 
     //fast path: if queue is already full, drop without heap churn
     irq_state_t flags = spinlock_irq_acquire(&ch->lock);
-    if (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+    if (ch->queue_len[peer_id] >= ch->queue_depth[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
         kfree(data);
         return;
@@ -471,7 +471,7 @@ static void push_to_channel(channel_endpoint_t *ep, void *data, uint32 len) {
 
     flags = spinlock_irq_acquire(&ch->lock);
 
-    if (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+    if (ch->queue_len[peer_id] >= ch->queue_depth[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
         kfree(entry);
         kfree(data);
@@ -487,6 +487,7 @@ static void push_to_channel(channel_endpoint_t *ep, void *data, uint32 len) {
 
     thread_wake_one(&ch->waiters[peer_id]);
     spinlock_irq_release(&ch->lock, flags);
+    port_observers_signal(&ch->endpoints[peer_id].observers, PORT_SIGNAL_READABLE);
 }
 
 //keyboard report processing
@@ -158,7 +158,7 @@ static void kbd_push_event(uint8 keycode, uint8 pressed, uint32 codepoint) {
 
         //enqueue under the channel own lock
         flags = spinlock_irq_acquire(&ch->lock);
-        if (ch->closed[peer_id] || ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+        if (ch->closed[peer_id] || ch->queue_len[peer_id] >= ch->queue_depth[peer_id]) {
             spinlock_irq_release(&ch->lock, flags);
             kfree(entry);
             kfree(ev);
@@ -173,6 +173,7 @@ static void kbd_push_event(uint8 keycode, uint8 pressed, uint32 codepoint) {
         ch->queue_len[peer_id]++;
         thread_wake_one(&ch->waiters[peer_id]);
         spinlock_irq_release(&ch->lock, flags);
+        port_observers_signal(&ch->endpoints[peer_id].observers, PORT_SIGNAL_READABLE);
     }
 }
 
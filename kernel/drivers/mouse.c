@@ -84,7 +84,7 @@ static void mouse_push_event(int16 dx, int16 dy, uint8 buttons) {
 
     //fast drop when queue is full (avoid heap churn in IRQ context)
     irq_state_t flags = spinlock_irq_acquire(&ch->lock);
-    if (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+    if (ch->queue_len[peer_id] >= ch->queue_depth[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
         return;
     }
@@ -111,7 +111,7 @@ static void mouse_push_event(int16 dx, int16 dy, uint8 buttons) {
 
     //lock the channel for queue manipulation
     flags = spinlock_irq_acquire(&ch->lock);
-    if (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+    if (ch->queue_len[peer_id] >= ch->queue_depth[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
         kfree(entry);
         kfree(event);
@@ -128,6 +128,9 @@ static void mouse_push_event(int16 dx, int16 dy, uint8 buttons) {
 
     thread_wake_one(&ch->waiters[peer_id]);
     spinlock_irq_release(&ch->lock, flags);
+
+    //the compositor waits on a port rather than in channel_recv
+    port_observers_signal(&ch->endpoints[peer_id].observers, PORT_SIGNAL_READABLE);
 }
 
 void mouse_irq(void) {
@@ -15,17 +15,21 @@
 #include <obj/namespace.h>
 #include <obj/object.h>
 #include <drivers/blkdev.h>
+#include <fs/bcache.h>
 #include <drivers/gpt.h>
 #include <fs/fs.h>
 #include <syscall/syscall.h>
-
-#define NVME_QUEUE_SIZE 64
+#include <arch/timer.h>
+#include <mm/vmo.h>
+#include <proc/process.h>
 
 static nvme_ctrl_t *ctrls[NVME_MAX_CONTROLLERS];
 static uint32 ctrl_count = 0;
 
 static ssize nvme_read_op(object_t *obj, void *buf, size len, size offset);
 static ssize nvme_write_op(object_t *obj, const void *buf, size len, size offset);
+static ssize nvme_readv_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset);
+static ssize nvme_writev_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset);
 static int nvme_stat(object_t *obj, stat_t *st);
 static intptr nvme_get_info(object_t *obj, uint32 topic, void *buf, size len);
 static int nvme_discover_namespaces(nvme_ctrl_t *ctrl);
@@ -38,15 +42,23 @@ static object_ops_t nvme_ops = {
     .readdir = NULL,
     .lookup = NULL,
     .stat = nvme_stat,
-    .get_info = nvme_get_info
+    .get_info = nvme_get_info,
+    .readv_user = nvme_readv_op,
+    .writev_user = nvme_writev_op
 };
 
 static int nvme_blkdev_read(blkdev_t *dev, uint64 lba, uint32 count, void *buf);
 static int nvme_blkdev_write(blkdev_t *dev, uint64 lba, uint32 count, const void *buf);
+static int nvme_blkdev_flush(blkdev_t *dev);
+static int nvme_blkdev_discard(blkdev_t *dev, uint64 lba, uint32 count);
+static int nvme_blkdev_write_zeroes(blkdev_t *dev, uint64 lba, uint32 count);
 
 static blkdev_ops_t nvme_blkdev_ops = {
     .read = nvme_blkdev_read,
     .write = nvme_blkdev_write,
+    .flush = nvme_blkdev_flush,
+    .discard = nvme_blkdev_discard,
+    .write_zeroes = nvme_blkdev_write_zeroes,
 };
 
 static void nvme_trim(char *str, size len) {
@@ -56,12 +68,14 @@ static void nvme_trim(char *str, size len) {
     }
 }
 
+static void nvme_queue_reap(nvme_ctrl_t *ctrl, nvme_queue_t *q);
+
 void nvme_msix_handler(nvme_ctrl_t *ctrl, uint16 qid) {
     ctrl->int_count++;
     if (qid == 0) {
-        thread_wake_all(&ctrl->admin_q.wq);
+        nvme_queue_reap(ctrl, &ctrl->admin_q);
     } else if (qid <= ctrl->num_io_queues) {
-        thread_wake_all(&ctrl->io_q[qid - 1].wq);
+        nvme_queue_reap(ctrl, &ctrl->io_q[qid - 1]);
     }
 }
 
@@ -96,67 +110,204 @@ static uint64 nvme_read64(nvme_ctrl_t *ctrl, uint32 reg) {
     return *(volatile uint64 *)((uintptr)ctrl->regs + reg);
 }
 
-//wait for completion on a specific queue
-static int nvme_wait_completion(nvme_ctrl_t *ctrl, nvme_queue_t *q, uint16 cmd_id, uint32 *cdw0) {
+static void nvme_queue_init(nvme_queue_t *q) {
+    wait_queue_init(&q->slot_wq);
+    spinlock_irq_init(&q->lock);
+    q->cq_phase = 1;
+}
+
+static uint64 nvme_ticks_from_ms(uint64 ms) {
+    uint32 freq = arch_timer_getfreq();
+    if (freq == 0) freq = 1000;
+    uint64 ticks = (ms * freq + 999) / 1000;
+    return ticks ? ticks : 1;
+}
+
+//interrupts only help once the scheduler runs, before that everything polls
+static bool nvme_can_sleep(void) {
     thread_t *current = thread_current();
-    bool use_interrupts = (current != NULL && current->state == THREAD_STATE_RUNNING);
-    int retries = use_interrupts ? 500 : 5000000;
-    
-    while (retries--) {
+    return current != NULL && current->state == THREAD_STATE_RUNNING;
+}
+
+//consume every posted CQE, completions may come in any order
+static void nvme_queue_reap(nvme_ctrl_t *ctrl, nvme_queue_t *q) {
+    bool reaped = false;
+
+    irq_state_t flags = spinlock_irq_acquire(&q->lock);
+    for (;;) {
         nvme_cqe_t *cqe = &q->cq[q->cq_head];
         uint16 status = __atomic_load_n(&cqe->status, __ATOMIC_ACQUIRE);
-        
-        if ((status & 1) == q->cq_phase) {
-            //ensure we see the command_id and results written by the controller
-            __atomic_thread_fence(__ATOMIC_ACQUIRE);
-            
-            if (cqe->command_id == cmd_id) {
-                if (cdw0) *cdw0 = cqe->command_specific;
-                
-                q->cq_head = (q->cq_head + 1) % NVME_QUEUE_SIZE;
-                if (q->cq_head == 0) q->cq_phase ^= 1;
-                
-                //update CQ doorbell
-                nvme_write32(ctrl, q->db_cq, q->cq_head);
-                
-                uint16 sc = status >> 1;
-                if (sc != 0) {
-                    printf("[nvme] Command failed with status 0x%x\n", sc);
-                }
-                return sc;
+        if ((status & 1) != q->cq_phase) break;
+
+        //ensure we see the command_id and results written by the controller
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint16 cid = cqe->command_id;
+        uint32 cdw0 = cqe->command_specific;
+
+        q->cq_head = (q->cq_head + 1) % NVME_QUEUE_SIZE;
+        if (q->cq_head == 0) q->cq_phase ^= 1;
+        reaped = true;
+
+        if (cid >= NVME_QUEUE_SIZE || !(q->cid_busy & (1ULL << cid))) continue;
+        nvme_req_t *req = q->reqs[cid];
+        q->reqs[cid] = NULL;
+        q->cid_busy &= ~(1ULL << cid);
+        q->inflight--;
+        if (!req) {
+            //its waiter timed out and gave it up, the list is no longer in use
+            if (q->stale_prp[cid]) q->prp_free |= 1U << (q->stale_prp[cid] - 1);
+            q->stale_prp[cid] = 0;
+            //pmm_lock is irq safe, fine from the interrupt handler as well
+            if (q->stale_page[cid]) pmm_free(q->stale_page[cid], 1);
+            q->stale_page[cid] = NULL;
+            continue;
+        }
+
+        req->status = status >> 1;
+        req->cdw0 = cdw0;
+        //woken under the lock so the waiter cannot return and free req first
+        req->done = true;
+        thread_wake_all(&req->wq);
+    }
+
+    if (reaped) {
+        //update CQ doorbell once for the whole batch
+        nvme_write32(ctrl, q->db_cq, q->cq_head);
+        thread_wake_all(&q->slot_wq);
+    }
+    spinlock_irq_release(&q->lock, flags);
+}
+
+void nvme_req_init(nvme_req_t *req) {
+    memset(req, 0, sizeof(*req));
+    wait_queue_init(&req->wq);
+}
+
+int nvme_req_submit(nvme_ctrl_t *ctrl, nvme_queue_t *q, nvme_req_t *req) {
+    bool can_sleep = nvme_can_sleep();
+    int spins = 5000000;
+
+    req->ctrl = ctrl;
+    req->q = q;
+    req->done = false;
+    req->status = 0;
+
+    //at most NVME_QUEUE_SIZE - 1 commands in flight so neither SQ nor CQ can overrun
+    irq_state_t flags = spinlock_irq_acquire(&q->lock);
+    while (q->inflight >= NVME_QUEUE_SIZE - 1) {
+        spinlock_irq_release(&q->lock, flags);
+        nvme_queue_reap(ctrl, q);
+        if (!can_sleep) {
+            if (--spins <= 0) return -1;
+            arch_pause();
+        }
+        flags = spinlock_irq_acquire(&q->lock);
+        if (can_sleep && q->inflight >= NVME_QUEUE_SIZE - 1) {
+            uint64 slice = arch_timer_get_ticks() + nvme_ticks_from_ms(NVME_POLL_SLICE_MS);
+            thread_sleep_locked_irq_timeout(&q->slot_wq, &q->lock, &flags, slice);
+        }
+    }
+
+    uint16 cid = (uint16)__builtin_ctzll(~q->cid_busy);
+    q->cid_busy |= 1ULL << cid;
+    q->reqs[cid] = req;
+    q->inflight++;
+
+    req->cmd.command_id = cid;
+    memcpy(&q->sq[q->sq_tail], &req->cmd, sizeof(nvme_sqe_t));
+    q->sq_tail = (q->sq_tail + 1) % NVME_QUEUE_SIZE;
+
+    //update SQ doorbell
+    nvme_write32(ctrl, q->db_sq, q->sq_tail);
+    spinlock_irq_release(&q->lock, flags);
+    return 0;
+}
+
+static void nvme_abort(nvme_ctrl_t *ctrl, nvme_queue_t *q, uint16 cid);
+
+int nvme_req_wait(nvme_req_t *req) {
+    nvme_ctrl_t *ctrl = req->ctrl;
+    nvme_queue_t *q = req->q;
+    bool can_sleep = nvme_can_sleep();
+    uint64 deadline = arch_timer_get_ticks() + nvme_ticks_from_ms(NVME_CMD_TIMEOUT_MS);
+    int spins = 5000000;
+
+    for (;;) {
+        nvme_queue_reap(ctrl, q);
+
+        irq_state_t flags = spinlock_irq_acquire(&q->lock);
+        if (req->done) {
+            spinlock_irq_release(&q->lock, flags);
+            break;
+        }
+
+        uint64 now = arch_timer_get_ticks();
+        bool expired = can_sleep ? now >= deadline : --spins <= 0;
+        if (expired) {
+            //leave the command_id busy until the controller answers after all,
+            //the device may still read the PRP list until then, so it is
+            //given back on that completion
+            uint16 cid = req->cmd.command_id;
+            if (q->reqs[cid] == req) {
+                q->reqs[cid] = NULL;
+                if (req->prp_list && req->prp_slot >= 0) q->stale_prp[cid] = (uint8)(req->prp_slot + 1);
+                else if (req->prp_list) q->stale_page[cid] = req->prp_list;
+                req->prp_list = NULL;
             }
+            spinlock_irq_release(&q->lock, flags);
+            printf("[nvme] Command %u timed out\n", cid);
+            req->status = -1;
+            //an aborted command completes, which frees its command_id
+            if (q != &ctrl->admin_q) nvme_abort(ctrl, q, cid);
+            return -1;
         }
-        
-        if (use_interrupts) {
-            thread_sleep(&q->wq);
+
+        if (can_sleep) {
+            uint64 slice = now + nvme_ticks_from_ms(NVME_POLL_SLICE_MS);
+            thread_sleep_locked_irq_timeout(&req->wq, &q->lock, &flags, slice < deadline ? slice : deadline);
+            spinlock_irq_release(&q->lock, flags);
         } else {
+            spinlock_irq_release(&q->lock, flags);
             arch_pause();
         }
     }
-    return -1; //timeout
+
+    if (req->status != 0) {
+        printf("[nvme] Command failed with status 0x%x\n", req->status);
+    }
+    return req->status;
+}
+
+nvme_queue_t *nvme_io_queue(nvme_ctrl_t *ctrl) {
+    uint32 cpu = arch_cpu_index();
+    return &ctrl->io_q[cpu % ctrl->num_io_queues];
 }
 
 static int nvme_submit_cmd(nvme_ctrl_t *ctrl, nvme_queue_t *q, nvme_sqe_t *cmd, uint32 *cdw0) {
-    spinlock_acquire(&q->lock);
-    
-    uint16 cmd_id = q->sq_tail;
-    cmd->command_id = cmd_id;
-    
-    memcpy(&q->sq[q->sq_tail], cmd, sizeof(nvme_sqe_t));
-    q->sq_tail = (q->sq_tail + 1) % NVME_QUEUE_SIZE;
-    
-    //update SQ doorbell
-    nvme_write32(ctrl, q->db_sq, q->sq_tail);
-    
-    spinlock_release(&q->lock);
-    
-    return nvme_wait_completion(ctrl, q, cmd_id, cdw0);
+    nvme_req_t req;
+    nvme_req_init(&req);
+    req.cmd = *cmd;
+
+    if (nvme_req_submit(ctrl, q, &req) < 0) return -1;
+    int rc = nvme_req_wait(&req);
+    if (rc == 0 && cdw0) *cdw0 = req.cdw0;
+    return rc;
 }
 
 static int nvme_submit_admin(nvme_ctrl_t *ctrl, nvme_sqe_t *cmd, uint32 *cdw0) {
     return nvme_submit_cmd(ctrl, &ctrl->admin_q, cmd, cdw0);
 }
 
+//ask the controller to drop a timed out I/O command, it then completes it
+//with an abort status. admin commands are not aborted, the abort itself is one
+static void nvme_abort(nvme_ctrl_t *ctrl, nvme_queue_t *q, uint16 cid) {
+    nvme_sqe_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = NVME_OP_ABORT;
+    cmd.cdw10 = ((uint32)cid << 16) | (uint32)(q - ctrl->io_q + 1); //cid | sqid
+    nvme_submit_admin(ctrl, &cmd, NULL);
+}
+
 static int nvme_identify(nvme_ctrl_t *ctrl) {
     void *ptr_phys = pmm_alloc(1);
     if (!ptr_phys) return -1;
@@ -178,6 +329,10 @@ static int nvme_identify(nvme_ctrl_t *ctrl) {
     
     nvme_identify_ctrl_t *id = (nvme_identify_ctrl_t *)ptr_virt;
     uint32 nn = id->nn;
+    //MDTS is in units of the 4K minimum page size, 0 means no limit
+    ctrl->max_transfer_shift = id->mdts ? 12 + id->mdts : 0;
+    ctrl->oncs = id->oncs;
+    ctrl->vwc = id->vwc;
     
     char model[41];
     char serial[21];
@@ -292,8 +447,9 @@ static int nvme_setup_io_queues(nvme_ctrl_t *ctrl) {
         nvme_queue_t *q = &ctrl->io_q[i];
         uint16 qid = i + 1;
         
-        wait_queue_init(&q->wq);
-        spinlock_init(&q->lock);
+        nvme_queue_init(q);
+        q->prp_pool = pmm_alloc(NVME_PRP_POOL_PAGES);
+        q->prp_free = q->prp_pool ? (uint32)((1ULL << NVME_PRP_POOL_PAGES) - 1) : 0;
         q->db_sq = NVME_REG_DBL(qid, false, ctrl->dstrd);
         q->db_cq = NVME_REG_DBL(qid, true, ctrl->dstrd);
         
@@ -301,7 +457,6 @@ static int nvme_setup_io_queues(nvme_ctrl_t *ctrl) {
         void *cq_phys = pmm_alloc(1);
         q->cq = P2V(cq_phys);
         memset(q->cq, 0, 4096);
-        q->cq_phase = 1;
         
         memset(&cmd, 0, sizeof(cmd));
         cmd.opcode = NVME_OP_CREATE_I_CQ;
@@ -326,91 +481,189 @@ static int nvme_setup_io_queues(nvme_ctrl_t *ctrl) {
     return 0;
 }
 
-static int nvme_io_submit(nvme_ctrl_t *ctrl, nvme_sqe_t *cmd) {
-    uint32 cpu = arch_cpu_index();
-    uint16 qidx = cpu % ctrl->num_io_queues;
-    return nvme_submit_cmd(ctrl, &ctrl->io_q[qidx], cmd, NULL);
+//list pages come from the queue pool, pmm_alloc only covers an exhausted pool
+static void *nvme_prp_get(nvme_queue_t *q, int *slot) {
+    irq_state_t flags = spinlock_irq_acquire(&q->lock);
+    if (q->prp_free) {
+        int i = __builtin_ctz(q->prp_free);
+        q->prp_free &= ~(1U << i);
+        spinlock_irq_release(&q->lock, flags);
+        *slot = i;
+        return (uint8 *)q->prp_pool + (size)i * 4096;
+    }
+    spinlock_irq_release(&q->lock, flags);
+    *slot = -1;
+    return pmm_alloc(1);
 }
 
-int nvme_read(nvme_ns_t *ns, uint64 lba, uint16 count, void *buf) {
-    nvme_ctrl_t *ctrl = ns->ctrl;
-    nvme_sqe_t cmd = {0};
-    cmd.opcode = NVME_OP_READ;
-    cmd.nsid = ns->nsid;
-    
+static void nvme_req_put_prps(nvme_req_t *req) {
+    if (!req->prp_list) return;
+    if (req->prp_slot >= 0) {
+        irq_state_t flags = spinlock_irq_acquire(&req->q->lock);
+        req->q->prp_free |= 1U << req->prp_slot;
+        spinlock_irq_release(&req->q->lock, flags);
+    } else {
+        pmm_free(req->prp_list, 1);
+    }
+    req->prp_list = NULL;
+}
+
+//describe a kernel buffer with PRPs for queue q. every page is translated on
+//its own so any mapped kernel memory works, physically contiguous or not.
+//the controller only needs the start dword aligned
+static int nvme_req_set_prps(nvme_queue_t *q, nvme_req_t *req, const void *buf, uint32 bytes) {
+    uintptr va = (uintptr)buf;
+    uintptr page = va & ~0xFFFULL;
+    uint32 num_pages = ((va & 0xFFF) + bytes + 4095) / 4096;
+
+    req->q = q;
+    req->prp_list = NULL;
+    if (va & 3) return -1;
+
     uintptr phys = V2P(buf);
-    cmd.prp1 = phys;
-    
-    //check if we need more than one PRP
-    uint32 bytes = count * ns->sector_size;
-    uint32 offset_in_page = (uintptr)buf & 0xFFF;
-    
-    void *prp_list_phys = NULL;
-    if (offset_in_page + bytes > 4096) {
-        //multi-page transfer
-        if (offset_in_page + bytes <= 8192) {
-            //exactly two pages
-            cmd.prp2 = (phys & ~0xFFFULL) + 4096;
-        } else {
-            //more than two pages so need a PRP list
-            uint32 num_pages = (offset_in_page + bytes + 4095) / 4096;
-            prp_list_phys = pmm_alloc(1);
-            if (!prp_list_phys) return -1;
-            uint64 *prp_list = (uint64 *)P2V(prp_list_phys);
-            
-            for (uint32 i = 0; i < num_pages - 1; i++) {
-                prp_list[i] = (phys & ~0xFFFULL) + (i + 1) * 4096;
-            }
-            cmd.prp2 = (uintptr)prp_list_phys;
+    if (phys == (uintptr)-1) return -1;
+    req->cmd.prp1 = phys;
+    if (num_pages == 1) return 0;
+
+    if (num_pages == 2) {
+        //exactly two pages
+        phys = V2P(page + 4096);
+        if (phys == (uintptr)-1) return -1;
+        req->cmd.prp2 = phys;
+        return 0;
+    }
+
+    //more than two pages so need a PRP list
+    if (num_pages - 1 > 4096 / sizeof(uint64)) return -1;
+    req->prp_list = nvme_prp_get(q, &req->prp_slot);
+    if (!req->prp_list) return -1;
+    uint64 *prp_list = (uint64 *)P2V(req->prp_list);
+    for (uint32 i = 0; i < num_pages - 1; i++) {
+        phys = V2P(page + (uintptr)(i + 1) * 4096);
+        if (phys == (uintptr)-1) {
+            nvme_req_put_prps(req);
+            return -1;
         }
+        prp_list[i] = phys;
     }
+    req->cmd.prp2 = (uintptr)req->prp_list;
+    return 0;
+}
 
-    cmd.cdw10 = lba & 0xFFFFFFFF;
-    cmd.cdw11 = (lba >> 32) & 0xFFFFFFFF;
-    cmd.cdw12 = (count - 1); //number of blocks (0-based)
-    
-    int result = nvme_io_submit(ctrl, &cmd);
-    if (prp_list_phys) pmm_free(prp_list_phys, 1);
-    return result;
+//sectors one command may move, bounded by MDTS and by a single PRP list page
+static uint32 nvme_max_xfer_sectors(nvme_ns_t *ns) {
+    uint64 bytes = NVME_MAX_XFER_BYTES;
+    if (ns->ctrl->max_transfer_shift && (1ULL << ns->ctrl->max_transfer_shift) < bytes) {
+        bytes = 1ULL << ns->ctrl->max_transfer_shift;
+    }
+    uint64 sectors = bytes / ns->sector_size;
+    if (sectors > 0x10000) sectors = 0x10000;
+    return sectors ? (uint32)sectors : 1;
 }
 
-int nvme_write(nvme_ns_t *ns, uint64 lba, uint16 count, const void *buf) {
+//split a transfer into commands and keep up to NVME_RW_WINDOW of them in flight
+//buf is NULL for commands without data (write zeroes), MDTS does not apply then
+static int nvme_rw(nvme_ns_t *ns, uint8 opcode, uint64 lba, uint32 count, const void *buf) {
     nvme_ctrl_t *ctrl = ns->ctrl;
-    nvme_sqe_t cmd = {0};
-    cmd.opcode = NVME_OP_WRITE;
-    cmd.nsid = ns->nsid;
-    
-    uintptr phys = V2P(buf);
-    cmd.prp1 = phys;
-    
-    uint32 bytes = count * ns->sector_size;
-    uint32 offset_in_page = (uintptr)buf & 0xFFF;
-    
-    void *prp_list_phys = NULL;
-    if (offset_in_page + bytes > 4096) {
-        if (offset_in_page + bytes <= 8192) {
-            cmd.prp2 = (phys & ~0xFFFULL) + 4096;
-        } else {
-            uint32 num_pages = (offset_in_page + bytes + 4095) / 4096;
-            prp_list_phys = pmm_alloc(1);
-            if (!prp_list_phys) return -1;
-            uint64 *prp_list = (uint64 *)P2V(prp_list_phys);
-            for (uint32 i = 0; i < num_pages - 1; i++) {
-                prp_list[i] = (phys & ~0xFFFULL) + (i + 1) * 4096;
+    nvme_queue_t *q = nvme_io_queue(ctrl);
+    uint32 max_sectors = buf ? nvme_max_xfer_sectors(ns) : 0x10000;
+    nvme_req_t reqs[NVME_RW_WINDOW];
+    uint32 submitted = 0;
+    uint32 finished = 0;
+    int result = 0;
+
+    while (finished < submitted || (count > 0 && result == 0)) {
+        //top up the window before waiting for its oldest command
+        while (count > 0 && result == 0 && submitted - finished < NVME_RW_WINDOW) {
+            uint32 chunk = count > max_sectors ? max_sectors : count;
+            nvme_req_t *req = &reqs[submitted % NVME_RW_WINDOW];
+            nvme_req_init(req);
+            req->cmd.opcode = opcode;
+            req->cmd.nsid = ns->nsid;
+            req->cmd.cdw10 = lba & 0xFFFFFFFF;
+            req->cmd.cdw11 = (lba >> 32) & 0xFFFFFFFF;
+            req->cmd.cdw12 = (chunk - 1); //number of blocks (0-based)
+
+            req->q = q;
+            if ((buf && nvme_req_set_prps(q, req, buf, chunk * ns->sector_size) < 0) ||
+                nvme_req_submit(ctrl, q, req) < 0) {
+                nvme_req_put_prps(req);
+                result = -1;
+                break;
             }
-            cmd.prp2 = (uintptr)prp_list_phys;
+            submitted++;
+            lba += chunk;
+            count -= chunk;
+            if (buf) buf = (const uint8 *)buf + (size)chunk * ns->sector_size;
         }
+        if (finished == submitted) break;
+
+        nvme_req_t *req = &reqs[finished % NVME_RW_WINDOW];
+        int rc = nvme_req_wait(req);
+        nvme_req_put_prps(req);     //a timed out command left its list to the queue
+        if (rc != 0 && result == 0) result = rc;
+        finished++;
     }
+    return result;
+}
 
-    cmd.cdw10 = lba & 0xFFFFFFFF;
-    cmd.cdw11 = (lba >> 32) & 0xFFFFFFFF;
-    cmd.cdw12 = (count - 1); //number of blocks (0-based)
-    
-    int result = nvme_io_submit(ctrl, &cmd);
-    if (prp_list_phys) pmm_free(prp_list_phys, 1);
+//the device reads and writes caller memory directly, only a buffer it cannot
+//address (not dword aligned or outside the kernel mappings) goes through a copy
+static int nvme_rw_any(nvme_ns_t *ns, uint8 opcode, uint64 lba, uint32 count, const void *buf) {
+    uintptr va = (uintptr)buf;
+    if (!(va & 3) && va >= HHDM_OFFSET) return nvme_rw(ns, opcode, lba, count, buf);
+
+    uint32 max_sectors = nvme_max_xfer_sectors(ns);
+    uint32 chunk_max = count > max_sectors ? max_sectors : count;
+    size pages = ((size)chunk_max * ns->sector_size + 4095) / 4096;
+    void *bounce_phys = pmm_alloc(pages);
+    if (!bounce_phys) return -1;
+    uint8 *bounce = P2V(bounce_phys);
+
+    int result = 0;
+    while (count > 0 && result == 0) {
+        uint32 chunk = count > chunk_max ? chunk_max : count;
+        size bytes = (size)chunk * ns->sector_size;
+        if (opcode == NVME_OP_WRITE) memcpy(bounce, buf, bytes);
+        result = nvme_rw(ns, opcode, lba, chunk, bounce);
+        if (result == 0 && opcode == NVME_OP_READ) memcpy((void *)buf, bounce, bytes);
+        lba += chunk;
+        count -= chunk;
+        buf = (const uint8 *)buf + bytes;
+    }
+
+    pmm_free(bounce_phys, pages);
     return result;
 }
 
+int nvme_read(nvme_ns_t *ns, uint64 lba, uint32 count, void *buf) {
+    return nvme_rw_any(ns, NVME_OP_READ, lba, count, buf);
+}
+
+int nvme_write(nvme_ns_t *ns, uint64 lba, uint32 count, const void *buf) {
+    return nvme_rw_any(ns, NVME_OP_WRITE, lba, count, buf);
+}
+
+//the namespace object shares the block cache with its partitions. pinned
+//user pages and large page aligned buffers are DMA targets themselves, those
+//skip the cache copy once the cache has no dirty blocks over the range
+static bool nvme_ns_direct(nvme_ns_t *ns, uint32 count, const void *buf) {
+    uintptr va = (uintptr)buf;
+    return !(va & 4095) && va >= HHDM_OFFSET && (size)count * ns->sector_size >= NVME_DIRECT_MIN_BYTES;
+}
+
+static int nvme_ns_read(nvme_ns_t *ns, uint64 lba, uint32 count, void *buf, bool direct) {
+    if (!ns->blkdev) return nvme_read(ns, lba, count, buf);
+    if (direct || nvme_ns_direct(ns, count, buf)) return bcache_read_direct(ns->blkdev, lba, count, buf);
+    return bcache_read(ns->blkdev, lba, count, buf);
+}
+
+static int nvme_ns_write(nvme_ns_t *ns, uint64 lba, uint32 count, const void *buf, bool direct) {
+    if (!ns->blkdev) return nvme_write(ns, lba, count, buf);
+    if (direct || nvme_ns_direct(ns, count, buf)) return bcache_write_direct(ns->blkdev, lba, count, buf);
+    return bcache_write(ns->blkdev, lba, count, buf);
+}
+
 //object operations
 static ssize nvme_read_op(object_t *obj, void *buf, size len, size offset) {
     nvme_ns_t *ns = (nvme_ns_t *)obj->data;
@@ -425,17 +678,8 @@ static ssize nvme_read_op(object_t *obj, void *buf, size len, size offset) {
     if (lba + count > ns->sector_count) return -1;
     if (count > 0xFFFF) return -1; 
     
-    //allocate kernel bounce buffer for DMA
-    void *kbuf_phys = pmm_alloc((len + 4095) / 4096);
-    if (!kbuf_phys) return -1;
-    void *kbuf = P2V(kbuf_phys);
-    
-    int result = nvme_read(ns, lba, (uint16)count, kbuf);
-    if (result == 0) {
-        memcpy(buf, kbuf, len);  //copy to userspace
-    }
-    
-    pmm_free(kbuf_phys, (len + 4095) / 4096);
+    //straight into the caller's buffer, nvme_read copies only when it has to
+    int result = nvme_ns_read(ns, lba, count, buf, false);
     return (result == 0) ? (ssize)len : -1;
 }
 
@@ -452,18 +696,132 @@ static ssize nvme_write_op(object_t *obj, const void *buf, size len, size offset
     if (lba + count > ns->sector_count) return -1;
     if (count > 0xFFFF) return -1; 
 
-    //allocate kernel bounce buffer for DMA
-    void *kbuf_phys = pmm_alloc((len + 4095) / 4096);
+    int result = nvme_ns_write(ns, lba, count, buf, false);
+    return (result == 0) ? (ssize)len : -1;
+}
+
+//kernel address of user memory backed by a fixed size VMO, pin keeps the
+//frames alive until the I/O is done. anonymous memory is not used directly,
+//it may be merged or unmapped under the device
+static void *nvme_pin_user(const void *ubuf, size len, bool dev_writes, object_t **pin) {
+    process_t *proc = process_current();
+    if (!proc || !proc->pagemap) return NULL;
+
+    size offset = 0;
+    uint32 need = MMU_FLAG_USER | (dev_writes ? MMU_FLAG_WRITE : 0);
+    object_t *obj = process_vma_pin(proc, (uintptr)ubuf, len, need, &offset);
+    if (!obj) return NULL;
+
+    vmo_t *vmo = obj->type == OBJECT_VMO ? (vmo_t *)obj->data : NULL;
+    if (!vmo || (vmo->flags & VMO_FLAG_RESIZABLE) || offset > vmo->size || len > vmo->size - offset) {
+        object_deref(obj);
+        return NULL;
+    }
+    *pin = obj;
+    return (uint8 *)vmo->pages + offset;
+}
+
+//one sector aligned user segment, DMA into the pinned pages or through a
+//bounce buffer in BLKDEV_MAX_IO_BYTES pieces
+static int nvme_user_segment(nvme_ns_t *ns, uint64 lba, void *ubuf, size len, bool write) {
+    uint32 sectors = (uint32)(len / ns->sector_size);
+    object_t *pin = NULL;
+    void *kbuf = nvme_pin_user(ubuf, len, !write, &pin);
+    if (kbuf) {
+        int result = write ? nvme_ns_write(ns, lba, sectors, kbuf, true) : nvme_ns_read(ns, lba, sectors, kbuf, true);
+        object_deref(pin);
+        return result;
+    }
+
+    size chunk_max = len < BLKDEV_MAX_IO_BYTES ? len : BLKDEV_MAX_IO_BYTES;
+    size pages = (chunk_max + 4095) / 4096;
+    void *kbuf_phys = pmm_alloc(pages);
     if (!kbuf_phys) return -1;
-    void *kbuf = P2V(kbuf_phys);
+    kbuf = P2V(kbuf_phys);
+
+    int result = 0;
+    for (size pos = 0; pos < len && result == 0;) {
+        size n = len - pos < chunk_max ? len - pos : chunk_max;
+        uint32 chunk = (uint32)(n / ns->sector_size);
+        uint8 *useg = (uint8 *)ubuf + pos;
+        if (write) {
+            if (copy_user_bytes(useg, kbuf, n) != 0) result = -1;
+            if (result == 0) result = nvme_ns_write(ns, lba, chunk, kbuf, false);
+        } else {
+            result = nvme_ns_read(ns, lba, chunk, kbuf, false);
+            if (result == 0 && copy_to_user_bytes(useg, kbuf, n) != 0) result = -1;
+        }
+        lba += chunk;
+        pos += n;
+    }
+    pmm_free(kbuf_phys, pages);
+    return result;
+}
+
+//scatter/gather, only the total has to be sector aligned. whole sector
+//segments go to the device one by one, anything else is staged in one buffer
+//and goes to the device in BLKDEV_MAX_IO_BYTES commands
+static ssize nvme_rwv_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset, bool write) {
+    nvme_ns_t *ns = (nvme_ns_t *)obj->data;
+    if (!ns) return -1;
     
-    memcpy(kbuf, buf, len);  //copy from userspace
-    int result = nvme_write(ns, lba, (uint16)count, kbuf);
+    size len = 0;
+    for (uint32 i = 0; i < count; i++) len += iov[i].len;
+    if (offset % ns->sector_size != 0) return -1;
+    if (len == 0 || len % ns->sector_size != 0) return -1;
     
-    pmm_free(kbuf_phys, (len + 4095) / 4096);
+    uint64 lba = offset / ns->sector_size;
+    uint64 sectors = len / ns->sector_size;
+    if (lba >= ns->sector_count || sectors > ns->sector_count - lba) return -1;
+    if (sectors > 0xFFFFFFFF) return -1;
+
+    //whole sector segments are done one by one without staging them
+    bool aligned = true;
+    for (uint32 i = 0; i < count; i++) {
+        if (iov[i].len % ns->sector_size != 0) aligned = false;
+    }
+    if (aligned) {
+        for (uint32 i = 0; i < count; i++) {
+            if (iov[i].len == 0) continue;
+            if (nvme_user_segment(ns, lba, iov[i].base, iov[i].len, write) != 0) return -1;
+            lba += iov[i].len / ns->sector_size;
+        }
+        return (ssize)len;
+    }
+    
+    size chunk_max = len < BLKDEV_MAX_IO_BYTES ? len : BLKDEV_MAX_IO_BYTES;
+    size pages = (chunk_max + 4095) / 4096;
+    void *kbuf_phys = pmm_alloc(pages);
+    if (!kbuf_phys) return -1;
+    uint8 *kbuf = P2V(kbuf_phys);
+    
+    int result = 0;
+    for (size pos = 0; pos < len && result == 0;) {
+        size n = len - pos < chunk_max ? len - pos : chunk_max;
+        uint32 chunk = (uint32)(n / ns->sector_size);
+        if (write) {
+            result = io_vec_copy(iov, count, pos, kbuf, n, false);
+            if (result == 0) result = nvme_ns_write(ns, lba, chunk, kbuf, false);
+        } else {
+            result = nvme_ns_read(ns, lba, chunk, kbuf, false);
+            if (result == 0) result = io_vec_copy(iov, count, pos, kbuf, n, true);
+        }
+        lba += chunk;
+        pos += n;
+    }
+    
+    pmm_free(kbuf_phys, pages);
     return (result == 0) ? (ssize)len : -1;
 }
 
+static ssize nvme_readv_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    return nvme_rwv_op(obj, iov, count, offset, false);
+}
+
+static ssize nvme_writev_op(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    return nvme_rwv_op(obj, iov, count, offset, true);
+}
+
 static int nvme_stat(object_t *obj, stat_t *st) {
     nvme_ns_t *ns = (nvme_ns_t *)obj->data;
     if (!ns || !st) return -1;
@@ -475,7 +833,21 @@ static int nvme_stat(object_t *obj, stat_t *st) {
 
 static intptr nvme_get_info(object_t *obj, uint32 topic, void *buf, size len) {
     nvme_ns_t *ns = (nvme_ns_t *)obj->data;
-    if (!ns || !buf) return -1;
+    if (!ns) return -1;
+    if (topic == OBJ_INFO_BLOCK_FLUSH) return ns->blkdev ? bcache_sync(ns->blkdev) : -1;
+    if (!buf) return -1;
+
+    if (topic == OBJ_INFO_BLOCK_DISCARD || topic == OBJ_INFO_BLOCK_ZERO ||
+        topic == OBJ_INFO_BLOCK_PREFETCH) {
+        if (!ns->blkdev || len < sizeof(block_range_t)) return -1;
+        const block_range_t *range = (const block_range_t *)buf;
+        if (range->offset % ns->sector_size != 0 || range->len % ns->sector_size != 0) return -1;
+        uint64 lba = range->offset / ns->sector_size;
+        uint64 count = range->len / ns->sector_size;
+        if (topic == OBJ_INFO_BLOCK_PREFETCH) return bcache_prefetch(ns->blkdev, lba, count);
+        if (topic == OBJ_INFO_BLOCK_DISCARD) return bcache_discard(ns->blkdev, lba, count);
+        return bcache_write_zeroes(ns->blkdev, lba, count);
+    }
 
     if (topic == OBJ_INFO_BLOCK_DEVICE) {
         if (len < sizeof(block_device_info_t)) return -1;
@@ -541,33 +913,62 @@ static int nvme_enable_msix(nvme_ctrl_t *ctrl) {
 
 //blkdev wrappers for GPT
 static int nvme_blkdev_read(blkdev_t *dev, uint64 lba, uint32 count, void *buf) {
-    nvme_ns_t *ns = (nvme_ns_t *)dev->data;
-    
-    while (count > 0) {
-        uint32 chunk = count > 0xFFFF ? 0xFFFF : count;
-        int res = nvme_read(ns, lba, (uint16)chunk, buf);
-        if (res != 0) return res;
-        
-        lba += chunk;
-        count -= chunk;
-        buf = (uint8 *)buf + chunk * ns->sector_size;
-    }
-    return 0;
+    return nvme_read((nvme_ns_t *)dev->data, lba, count, buf);
 }
 
 static int nvme_blkdev_write(blkdev_t *dev, uint64 lba, uint32 count, const void *buf) {
+    return nvme_write((nvme_ns_t *)dev->data, lba, count, buf);
+}
+
+static int nvme_blkdev_flush(blkdev_t *dev) {
     nvme_ns_t *ns = (nvme_ns_t *)dev->data;
-    
-    while (count > 0) {
-        uint32 chunk = count > 0xFFFF ? 0xFFFF : count;
-        int res = nvme_write(ns, lba, (uint16)chunk, buf);
-        if (res != 0) return res;
-        
-        lba += chunk;
-        count -= chunk;
-        buf = (const uint8 *)buf + chunk * ns->sector_size;
+    //without a volatile write cache a completed write is already durable
+    if (!(ns->ctrl->vwc & NVME_VWC_PRESENT)) return 0;
+
+    nvme_sqe_t cmd = {0};
+    cmd.opcode = NVME_OP_FLUSH;
+    cmd.nsid = ns->nsid;
+    return nvme_submit_cmd(ns->ctrl, nvme_io_queue(ns->ctrl), &cmd, NULL);
+}
+
+//deallocate one range, count fits a single DSM range
+static int nvme_blkdev_discard(blkdev_t *dev, uint64 lba, uint32 count) {
+    nvme_ns_t *ns = (nvme_ns_t *)dev->data;
+    nvme_ctrl_t *ctrl = ns->ctrl;
+    if (!(ctrl->oncs & NVME_ONCS_DSM)) return 0; //only a hint
+
+    nvme_queue_t *q = nvme_io_queue(ctrl);
+    nvme_req_t req;
+    nvme_req_init(&req);
+    //the range list borrows a PRP list page and is given back the same way
+    req.q = q;
+    req.prp_list = nvme_prp_get(q, &req.prp_slot);
+    if (!req.prp_list) return -1;
+
+    nvme_dsm_range_t *range = (nvme_dsm_range_t *)P2V(req.prp_list);
+    memset(range, 0, sizeof(*range));
+    range->nlb = count;
+    range->slba = lba;
+
+    req.cmd.opcode = NVME_OP_DSM;
+    req.cmd.nsid = ns->nsid;
+    req.cmd.prp1 = (uintptr)req.prp_list;
+    req.cmd.cdw10 = 0; //number of ranges (0-based)
+    req.cmd.cdw11 = NVME_DSM_ATTR_DEALLOCATE;
+
+    if (nvme_req_submit(ctrl, q, &req) < 0) {
+        nvme_req_put_prps(&req);
+        return -1;
     }
-    return 0;
+    int rc = nvme_req_wait(&req);
+    nvme_req_put_prps(&req);
+    return rc;
+}
+
+static int nvme_blkdev_write_zeroes(blkdev_t *dev, uint64 lba, uint32 count) {
+    nvme_ns_t *ns = (nvme_ns_t *)dev->data;
+    if (!(ns->ctrl->oncs & NVME_ONCS_WRITE_ZEROES)) return -1;
+    return nvme_rw(ns, NVME_OP_WRITE_ZEROES, lba, count, NULL);
 }
 
 static void nvme_init_ctrl(pci_device_t *pci) {
@@ -608,9 +1009,7 @@ static void nvme_init_ctrl(pci_device_t *pci) {
     
     ctrl->admin_q.sq = P2V(asq_phys);
     ctrl->admin_q.cq = P2V(acq_phys);
-    ctrl->admin_q.cq_phase = 1;
-    wait_queue_init(&ctrl->admin_q.wq);
-    spinlock_init(&ctrl->admin_q.lock);
+    nvme_queue_init(&ctrl->admin_q);
     
     ctrl->admin_q.db_sq = NVME_REG_DBL(0, false, ctrl->dstrd);
     ctrl->admin_q.db_cq = NVME_REG_DBL(0, true, ctrl->dstrd);
@@ -41,11 +41,29 @@
 #define NVME_OP_DELETE_I_CQ    0x04
 #define NVME_OP_CREATE_I_CQ    0x05
 #define NVME_OP_IDENTIFY       0x06
+#define NVME_OP_ABORT          0x08
 #define NVME_OP_SET_FEATURES   0x09
 
 //NVMe opcodes (NVM)
+#define NVME_OP_FLUSH          0x00
 #define NVME_OP_WRITE          0x01
 #define NVME_OP_READ           0x02
+#define NVME_OP_WRITE_ZEROES   0x08
+#define NVME_OP_DSM            0x09
+
+//optional NVM command support (identify controller ONCS)
+#define NVME_ONCS_DSM          (1 << 2)
+#define NVME_ONCS_WRITE_ZEROES (1 << 3)
+
+#define NVME_VWC_PRESENT       (1 << 0)    //volatile write cache, needs flush
+#define NVME_DSM_ATTR_DEALLOCATE (1 << 2)  //cdw11 AD bit
+
+//one dataset management range
+typedef struct {
+    uint32 cattr;
+    uint32 nlb;         //blocks, not 0-based
+    uint64 slba;
+} __attribute__((packed)) nvme_dsm_range_t;
 
 //64-byte submission queue entry (SQE)
 typedef struct {
@@ -101,7 +119,11 @@ typedef struct {
     uint8  cqes;       //513
     uint16 maxcmd;     //514
     uint32 nn;         //516
-    uint8  reserved3[4096 - 520];
+    uint16 oncs;       //520
+    uint16 fuses;      //522
+    uint8  fna;        //524
+    uint8  vwc;        //525
+    uint8  reserved3[4096 - 526];
 } __attribute__((packed)) nvme_identify_ctrl_t;
 
 typedef struct {
@@ -142,19 +164,60 @@ typedef struct {
 #define NVME_MSIX_VECTOR_STRIDE (1 + NVME_MAX_IO_QUEUES)
 #define NVME_MSIX_VECTOR_LIMIT (NVME_MSIX_VECTOR_BASE + NVME_MAX_CONTROLLERS * NVME_MSIX_VECTOR_STRIDE)
 
-typedef struct {
+#define NVME_QUEUE_SIZE 64          //entries per queue, also the command_id space
+#define NVME_CMD_TIMEOUT_MS 5000
+#define NVME_POLL_SLICE_MS 10       //waiters recheck the CQ in case an interrupt was lost
+#define NVME_MAX_XFER_BYTES (2 * 1024 * 1024)   //what one PRP list page can describe
+#define NVME_RW_WINDOW 8            //commands one large transfer keeps in flight
+#define NVME_PRP_POOL_PAGES 32      //PRP list pages preallocated per I/O queue
+#define NVME_DIRECT_MIN_BYTES (64 * 1024) //page aligned transfers this big skip the block cache
+
+typedef struct nvme_ctrl nvme_ctrl_t;
+typedef struct nvme_queue nvme_queue_t;
+typedef struct nvme_req nvme_req_t;
+
+/*
+ *one command in flight
+ *
+ *the caller fills cmd (command_id is assigned on submit) and waits with
+ *nvme_req_wait. the request has to stay valid until that returns. a command
+ *that times out is aborted and its command_id and PRP list stay with the
+ *queue until the controller answers for it after all
+*/
+struct nvme_req {
+    nvme_sqe_t  cmd;
+    int         status;         //NVMe status code, 0 on success and -1 on timeout
+    uint32      cdw0;           //command specific result
+    volatile bool done;
+    wait_queue_t wq;            //nvme_req_wait sleeps here
+    void        *prp_list;      //PRP list page (phys) owned by the request
+    int         prp_slot;       //its index in the queue pool, -1 if from pmm_alloc
+    nvme_ctrl_t *ctrl;          //set on submit
+    nvme_queue_t *q;
+};
+
+struct nvme_queue {
     nvme_sqe_t  *sq;
     nvme_cqe_t  *cq;
     uint16      sq_tail;
     uint16      cq_head;
     uint16      cq_phase;
-    wait_queue_t wq;
+    uint16      inflight;
+    //completions are matched by command_id so they may arrive in any order
+    nvme_req_t  *reqs[NVME_QUEUE_SIZE];
+    //pool slot + 1 of the PRP list a timed out command_id still holds (0 if
+    //none), given back when its late completion arrives
+    uint8       stale_prp[NVME_QUEUE_SIZE];
+    //same for a PRP list page from pmm_alloc (phys, NULL if none)
+    void        *stale_page[NVME_QUEUE_SIZE];
+    uint64      cid_busy;       //one bit per command_id, NVME_QUEUE_SIZE <= 64
+    wait_queue_t slot_wq;       //submitters waiting for a free entry
+    void        *prp_pool;      //NVME_PRP_POOL_PAGES contiguous list pages (phys)
+    uint32      prp_free;       //one bit per free pool page
     uint32      db_sq;
     uint32      db_cq;
-    spinlock_t  lock;
-} nvme_queue_t;
-
-typedef struct nvme_ctrl nvme_ctrl_t;
+    spinlock_irq_t lock;        //also taken by the interrupt handler
+};
 
 struct blkdev;
 
@@ -180,6 +243,8 @@ struct nvme_ctrl {
     uint16      num_io_queues;
     
     size        max_transfer_shift;
+    uint16      oncs;           //NVME_ONCS_*
+    uint8       vwc;
     
     //Namespaces
     nvme_ns_t   *ns;
@@ -198,4 +263,17 @@ void nvme_init(void);
 void nvme_msix_handler(nvme_ctrl_t *ctrl, uint16 qid);
 bool nvme_isr_callback(uint64 vector);
 
+//asynchronous command interface, see nvme_req_t
+void nvme_req_init(nvme_req_t *req);
+
+//queue req on q, blocks only while every entry of q is in flight
+//returns 0 once the doorbell was rung and negative on error
+int nvme_req_submit(nvme_ctrl_t *ctrl, nvme_queue_t *q, nvme_req_t *req);
+
+//wait for a submitted req without a complete callback, returns its status
+int nvme_req_wait(nvme_req_t *req);
+
+//the I/O queue of the calling CPU
+nvme_queue_t *nvme_io_queue(nvme_ctrl_t *ctrl);
+
 #endif
@@ -273,7 +273,7 @@ static void pci_channel_handler(channel_endpoint_t *ep, channel_msg_t *msg, void
                 .handles = NULL,
                 .handle_count = 0
             };
-            channel_reply(ep, &reply);
+            channel_reply(ep, msg, &reply);
             break;
         }
         
@@ -294,7 +294,7 @@ static void pci_channel_handler(channel_endpoint_t *ep, channel_msg_t *msg, void
                 .handles = NULL,
                 .handle_count = 0
             };
-            channel_reply(ep, &reply);
+            channel_reply(ep, msg, &reply);
             break;
         }
         
@@ -317,7 +317,7 @@ static void pci_channel_handler(channel_endpoint_t *ep, channel_msg_t *msg, void
                 .handles = NULL,
                 .handle_count = 0
             };
-            channel_reply(ep, &reply);
+            channel_reply(ep, msg, &reply);
             break;
         }
         
@@ -345,7 +345,7 @@ static void pci_channel_handler(channel_endpoint_t *ep, channel_msg_t *msg, void
                 .handles = NULL,
                 .handle_count = 0
             };
-            channel_reply(ep, &reply);
+            channel_reply(ep, msg, &reply);
             break;
         }
         
@@ -363,7 +363,7 @@ static void pci_channel_handler(channel_endpoint_t *ep, channel_msg_t *msg, void
                     .handles = NULL,
                     .handle_count = 0
                 };
-                channel_reply(ep, &reply);
+                channel_reply(ep, msg, &reply);
             }
             break;
     }
@@ -0,0 +1,606 @@
+#include <fs/bcache.h>
+#include <fs/mount.h>
+#include <mm/pmm.h>
+#include <mm/mm.h>
+#include <arch/timer.h>
+#include <proc/process.h>
+#include <proc/thread.h>
+#include <proc/sched.h>
+#include <proc/wait.h>
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <lib/time.h>
+#include <lib/io.h>
+
+typedef struct bcache_buf {
+    blkdev_t *dev;              //whole disk, NULL while the slot is unused
+    uint64 block;
+    uint8 *data;                //one page, allocated on first use
+    uint32 sectors;             //sectors of the block on the disk (short at its end)
+    uint8 valid;                //data matches (or is newer than) the disk
+    uint8 dirty;
+    uint8 busy;                 //owned by one thread doing I/O or a copy
+    uint8 referenced;           //CLOCK second chance bit
+    uint64 dirty_tick;          //when the buffer last went from clean to dirty
+    struct bcache_buf *hash_next;
+} bcache_buf_t;
+
+//protects every buffer header and the hash table, never held across I/O
+static spinlock_t bcache_lock = SPINLOCK_INIT;
+static wait_queue_t bcache_wait;
+static uint32 bcache_waiters = 0;
+static bcache_buf_t bcache_bufs[BCACHE_MAX_BLOCKS];
+static bcache_buf_t *bcache_hash[BCACHE_HASH_BUCKETS];
+static uint32 bcache_hand = 0;
+static bool bcache_started = false;
+static uint64 bcache_gen = 0;           //bumped by every write to the disk
+static blkdev_t *bcache_disks[BCACHE_MAX_DISKS];   //written disks, for flush
+static uint32 bcache_disk_count = 0;
+
+//prefetch requests, a ring drained by bcache_prefetch_worker
+typedef struct {
+    blkdev_t *root;
+    uint64 lba;
+    uint32 count;
+} bcache_prefetch_t;
+
+static spinlock_irq_t bcache_pf_lock = SPINLOCK_IRQ_INIT;
+static wait_queue_t bcache_pf_wait;
+static bcache_prefetch_t bcache_pf[BCACHE_PREFETCH_QUEUE];
+static uint32 bcache_pf_head = 0;
+static uint32 bcache_pf_count = 0;
+static bool bcache_pf_started = false;
+
+static inline uint32 bcache_bucket(blkdev_t *dev, uint64 block) {
+    uint64 h = ((uintptr)dev >> 4) ^ (block * 0x9E3779B97F4A7C15ULL);
+    return (uint32)(h >> 32) % BCACHE_HASH_BUCKETS;
+}
+
+static bcache_buf_t *bcache_lookup(blkdev_t *dev, uint64 block) {
+    bcache_buf_t *b = bcache_hash[bcache_bucket(dev, block)];
+    while (b && (b->dev != dev || b->block != block)) b = b->hash_next;
+    return b;
+}
+
+static void bcache_unhash(bcache_buf_t *b) {
+    if (!b->dev) return;
+    bcache_buf_t **pp = &bcache_hash[bcache_bucket(b->dev, b->block)];
+    while (*pp && *pp != b) pp = &(*pp)->hash_next;
+    if (*pp) *pp = b->hash_next;
+    b->hash_next = NULL;
+    b->dev = NULL;
+}
+
+//called with bcache_lock held, returns with it held
+static void bcache_sleep(void) {
+    bcache_waiters++;
+    thread_sleep_locked(&bcache_wait, &bcache_lock);
+    bcache_waiters--;
+}
+
+static void bcache_release_locked(bcache_buf_t *b) {
+    b->busy = 0;
+    if (bcache_waiters) thread_wake_all(&bcache_wait);
+}
+
+static uint64 bcache_now_ms(void) {
+    uint32 freq = arch_timer_getfreq();
+    return freq ? arch_timer_get_ticks() * 1000 / freq : 0;
+}
+
+//the disk a partition lives on and the lba translated onto it
+static blkdev_t *bcache_root(blkdev_t *dev, uint64 *lba) {
+    while (dev->parent) {
+        *lba += dev->start_lba;
+        dev = dev->parent;
+    }
+    return dev;
+}
+
+static inline uint32 bcache_spb(blkdev_t *root) {
+    return BCACHE_BLOCK_SIZE / root->sector_size;
+}
+
+//remember a disk that was written so bcache_sync can flush it later
+static void bcache_note_disk(blkdev_t *root) {
+    spinlock_acquire(&bcache_lock);
+    uint32 i = 0;
+    while (i < bcache_disk_count && bcache_disks[i] != root) i++;
+    if (i == bcache_disk_count && i < BCACHE_MAX_DISKS) bcache_disks[bcache_disk_count++] = root;
+    spinlock_release(&bcache_lock);
+}
+
+//caller owns b (busy)
+//bumps bcache_gen, once b is evicted a fill_run read from before this write is stale
+static int bcache_writeback(bcache_buf_t *b) {
+    blkdev_t *root = b->dev;
+    int rc = root->ops->write(root, b->block * bcache_spb(root), b->sectors, b->data);
+    __atomic_fetch_add(&bcache_gen, 1, __ATOMIC_RELEASE);
+    return rc;
+}
+
+//pick a buffer to reuse, NULL if every buffer is busy
+//a dirty victim is only returned when no clean one is left
+static bcache_buf_t *bcache_victim(void) {
+    bcache_buf_t *dirty = NULL;
+    for (uint32 scan = 0; scan < 2 * BCACHE_MAX_BLOCKS; scan++) {
+        bcache_buf_t *b = &bcache_bufs[bcache_hand];
+        bcache_hand = (bcache_hand + 1) % BCACHE_MAX_BLOCKS;
+        if (b->busy) continue;
+        if (!b->data) {
+            void *phys = pmm_alloc(1);
+            if (!phys) continue;
+            b->data = P2V(phys);
+            return b;
+        }
+        if (b->referenced) {
+            b->referenced = 0;
+            continue;
+        }
+        if (!b->dirty) return b;
+        if (!dirty) dirty = b;
+    }
+    return dirty;
+}
+
+//return the buffer for block of root owned by the caller (busy)
+//with fill it is read from the disk unless it is already cached
+static bcache_buf_t *bcache_get(blkdev_t *root, uint64 block, bool fill) {
+    bcache_buf_t *b;
+    spinlock_acquire(&bcache_lock);
+    for (;;) {
+        b = bcache_lookup(root, block);
+        if (b) {
+            if (b->busy) {
+                bcache_sleep();
+                continue;
+            }
+            b->busy = 1;
+            b->referenced = 1;
+            break;
+        }
+
+        b = bcache_victim();
+        if (!b) {
+            bcache_sleep();
+            continue;
+        }
+        if (b->dirty) {
+            //clean it first, then look again since the lock was dropped
+            b->busy = 1;
+            spinlock_release(&bcache_lock);
+            int rc = bcache_writeback(b);
+            spinlock_acquire(&bcache_lock);
+            if (rc == 0) b->dirty = 0;
+            bcache_release_locked(b);
+            if (rc != 0) {
+                spinlock_release(&bcache_lock);
+                return NULL;
+            }
+            continue;
+        }
+
+        bcache_unhash(b);
+        uint32 spb = bcache_spb(root);
+        uint64 first = block * spb;
+        b->dev = root;
+        b->block = block;
+        b->sectors = root->sector_count - first < spb ? (uint32)(root->sector_count - first) : spb;
+        b->valid = 0;
+        b->busy = 1;
+        b->referenced = 1;
+        uint32 bucket = bcache_bucket(root, block);
+        b->hash_next = bcache_hash[bucket];
+        bcache_hash[bucket] = b;
+        break;
+    }
+    spinlock_release(&bcache_lock);
+
+    if (!b->valid && fill) {
+        if (root->ops->read(root, block * bcache_spb(root), b->sectors, b->data) != 0) {
+            spinlock_acquire(&bcache_lock);
+            bcache_unhash(b);
+            bcache_release_locked(b);
+            spinlock_release(&bcache_lock);
+            return NULL;
+        }
+        b->valid = 1;
+    }
+    return b;
+}
+
+static void bcache_put(bcache_buf_t *b) {
+    spinlock_acquire(&bcache_lock);
+    bcache_release_locked(b);
+    spinlock_release(&bcache_lock);
+}
+
+//number of consecutive uncached blocks from block on, at most max
+static uint32 bcache_miss_run(blkdev_t *root, uint64 block, uint32 max) {
+    uint32 n = 0;
+    spinlock_acquire(&bcache_lock);
+    while (n < max && !bcache_lookup(root, block + n)) n++;
+    spinlock_release(&bcache_lock);
+    return n;
+}
+
+//load run uncached blocks with one device read, blocks someone cached in the
+//meantime keep their (possibly newer) contents. failures are left to the
+//per-block path which retries the read
+static void bcache_fill_run(blkdev_t *root, uint64 block, uint32 run) {
+    uint32 spb = bcache_spb(root);
+    uint64 first = block * spb;
+    uint64 sectors = (uint64)run * spb;
+    if (sectors > root->sector_count - first) sectors = root->sector_count - first;
+
+    void *phys = pmm_alloc(run);
+    if (!phys) return;
+    uint8 *tmp = P2V(phys);
+
+    uint64 gen = __atomic_load_n(&bcache_gen, __ATOMIC_ACQUIRE);
+    if (root->ops->read(root, first, (uint32)sectors, tmp) == 0) {
+        for (uint32 i = 0; i < run; i++) {
+            bcache_buf_t *b = bcache_get(root, block + i, false);
+            if (!b) break;
+            //any disk write since the read may have made tmp stale
+            if (!b->valid && __atomic_load_n(&bcache_gen, __ATOMIC_ACQUIRE) == gen) {
+                memcpy(b->data, tmp + (size)i * BCACHE_BLOCK_SIZE, (size)b->sectors * root->sector_size);
+                b->valid = 1;
+            }
+            bcache_put(b);
+        }
+    }
+    pmm_free(phys, run);
+}
+
+//write back dirty buffers of root in [first, last] (all of root when last is
+//~0), drop_clean also forgets the clean ones. with expire_ms only buffers
+//dirty for at least that long are written
+static int bcache_flush(blkdev_t *root, uint64 first, uint64 last, bool drop_clean, uint64 expire_ms) {
+    int result = 0;
+    uint64 now = expire_ms ? bcache_now_ms() : 0;
+
+    spinlock_acquire(&bcache_lock);
+    for (uint32 i = 0; i < BCACHE_MAX_BLOCKS; i++) {
+        bcache_buf_t *b = &bcache_bufs[i];
+        for (;;) {
+            if (!b->dev || (root && b->dev != root)) break;
+            if (b->block < first || b->block > last) break;
+            if (b->busy) {
+                bcache_sleep();
+                continue;
+            }
+            if (b->dirty) {
+                if (expire_ms && now - b->dirty_tick < expire_ms) break;
+                b->busy = 1;
+                spinlock_release(&bcache_lock);
+                int rc = bcache_writeback(b);
+                spinlock_acquire(&bcache_lock);
+                if (rc == 0) b->dirty = 0;
+                else result = -1;
+                bcache_release_locked(b);
+                if (rc != 0) break;
+                continue;
+            }
+            if (drop_clean) bcache_unhash(b);
+            break;
+        }
+    }
+    spinlock_release(&bcache_lock);
+    return result;
+}
+
+//forget buffers of root in [first, last] without writing them back
+static void bcache_drop(blkdev_t *root, uint64 first, uint64 last) {
+    spinlock_acquire(&bcache_lock);
+    for (uint32 i = 0; i < BCACHE_MAX_BLOCKS; i++) {
+        bcache_buf_t *b = &bcache_bufs[i];
+        for (;;) {
+            if (b->dev != root || b->block < first || b->block > last) break;
+            if (b->busy) {
+                bcache_sleep();
+                continue;
+            }
+            b->dirty = 0;
+            bcache_unhash(b);
+            break;
+        }
+    }
+    spinlock_release(&bcache_lock);
+}
+
+static int bcache_check(blkdev_t *dev, uint64 lba, uint32 count) {
+    if (!dev || !dev->ops || count == 0) return -1;
+    //subtraction form to avoid lba+count wrap
+    if (lba >= dev->sector_count || (uint64)count > dev->sector_count - lba) return -1;
+    return 0;
+}
+
+static bool bcache_cacheable(blkdev_t *root, uint32 count) {
+    if (root->sector_size == 0 || root->sector_size > BCACHE_BLOCK_SIZE) return false;
+    if (BCACHE_BLOCK_SIZE % root->sector_size != 0) return false;
+    return (uint64)count * root->sector_size <= BCACHE_DIRECT_BYTES;
+}
+
+static int bcache_direct_read(blkdev_t *root, uint64 lba, uint32 count, void *buf) {
+    //the disk has to see writes still sitting in the cache first
+    uint32 ss = root->sector_size;
+    if (ss && ss <= BCACHE_BLOCK_SIZE && BCACHE_BLOCK_SIZE % ss == 0) {
+        uint32 spb = bcache_spb(root);
+        if (bcache_flush(root, lba / spb, (lba + count - 1) / spb, false, 0) < 0) return -1;
+    }
+    return root->ops->read(root, lba, count, buf);
+}
+
+static int bcache_direct_write(blkdev_t *root, uint64 lba, uint32 count, const void *buf) {
+    bcache_note_disk(root);
+    uint32 ss = root->sector_size;
+    if (!ss || ss > BCACHE_BLOCK_SIZE || BCACHE_BLOCK_SIZE % ss != 0) {
+        return root->ops->write(root, lba, count, buf);
+    }
+
+    //partly covered dirty blocks go out first, cached copies are stale after
+    uint32 spb = bcache_spb(root);
+    uint64 first = lba / spb, last = (lba + count - 1) / spb;
+    if (bcache_flush(root, first, last, false, 0) < 0) return -1;
+    int rc = root->ops->write(root, lba, count, buf);
+    __atomic_fetch_add(&bcache_gen, 1, __ATOMIC_RELEASE);
+    bcache_flush(root, first, last, true, 0);
+    return rc;
+}
+
+int bcache_read(blkdev_t *dev, uint64 lba, uint32 count, void *buf) {
+    if (bcache_check(dev, lba, count) < 0 || !buf) return -1;
+
+    blkdev_t *root = bcache_root(dev, &lba);
+    uint32 ss = root->sector_size;
+    if (!bcache_cacheable(root, count)) return bcache_direct_read(root, lba, count, buf);
+
+    uint32 spb = bcache_spb(root);
+    uint64 last_block = (lba + count - 1) / spb;
+    uint8 *out = (uint8 *)buf;
+    while (count > 0) {
+        uint64 block = lba / spb;
+        uint32 skip = (uint32)(lba % spb);
+        uint32 n = spb - skip < count ? spb - skip : count;
+
+        //adjacent misses become one device request instead of one per block
+        uint64 left = last_block - block + 1;
+        uint32 run = bcache_miss_run(root, block, left < BCACHE_MAX_RUN ? (uint32)left : BCACHE_MAX_RUN);
+        if (run > 1) bcache_fill_run(root, block, run);
+
+        bcache_buf_t *b = bcache_get(root, block, true);
+        if (!b) return -1;
+        memcpy(out, b->data + (size)skip * ss, (size)n * ss);
+        bcache_put(b);
+
+        out += (size)n * ss;
+        lba += n;
+        count -= n;
+    }
+    return 0;
+}
+
+int bcache_write(blkdev_t *dev, uint64 lba, uint32 count, const void *buf) {
+    if (bcache_check(dev, lba, count) < 0 || !buf) return -1;
+
+    blkdev_t *root = bcache_root(dev, &lba);
+    if (!bcache_cacheable(root, count)) return bcache_direct_write(root, lba, count, buf);
+    bcache_note_disk(root);
+    uint32 ss = root->sector_size;
+
+    uint32 spb = bcache_spb(root);
+    const uint8 *in = (const uint8 *)buf;
+    while (count > 0) {
+        uint64 block = lba / spb;
+        uint32 skip = (uint32)(lba % spb);
+        uint32 n = spb - skip < count ? spb - skip : count;
+
+        //a whole block is overwritten without reading it first
+        bool whole = skip == 0 && (n == spb || lba + n == root->sector_count);
+        bcache_buf_t *b = bcache_get(root, block, !whole);
+        if (!b) return -1;
+        memcpy(b->data + (size)skip * ss, in, (size)n * ss);
+        b->valid = 1;
+        if (!b->dirty) {
+            b->dirty = 1;
+            b->dirty_tick = bcache_now_ms();
+        }
+        bcache_put(b);
+
+        in += (size)n * ss;
+        lba += n;
+        count -= n;
+    }
+    return 0;
+}
+
+int bcache_read_direct(blkdev_t *dev, uint64 lba, uint32 count, void *buf) {
+    if (bcache_check(dev, lba, count) < 0 || !buf) return -1;
+    blkdev_t *root = bcache_root(dev, &lba);
+    return bcache_direct_read(root, lba, count, buf);
+}
+
+int bcache_write_direct(blkdev_t *dev, uint64 lba, uint32 count, const void *buf) {
+    if (bcache_check(dev, lba, count) < 0 || !buf) return -1;
+    blkdev_t *root = bcache_root(dev, &lba);
+    return bcache_direct_write(root, lba, count, buf);
+}
+
+int bcache_sync(blkdev_t *dev) {
+    blkdev_t *root = NULL;
+    if (dev) {
+        uint64 unused = 0;
+        root = bcache_root(dev, &unused);
+    }
+    int result = bcache_flush(root, 0, ~0ULL, false, 0);
+
+    //the data may still sit in a volatile cache of the disk itself
+    blkdev_t *disks[BCACHE_MAX_DISKS];
+    uint32 n = 0;
+    spinlock_acquire(&bcache_lock);
+    for (uint32 i = 0; i < bcache_disk_count; i++) {
+        if (!root || bcache_disks[i] == root) disks[n++] = bcache_disks[i];
+    }
+    spinlock_release(&bcache_lock);
+
+    for (uint32 i = 0; i < n; i++) {
+        if (disks[i]->ops->flush && disks[i]->ops->flush(disks[i]) < 0) result = -1;
+    }
+    return result;
+}
+
+//discard or zero a range of root the way a direct write is done: blocks it
+//covers only partly are written back first, whole ones are dropped unwritten
+//and whatever got cached while the command ran is forgotten afterwards
+static int bcache_range_op(blkdev_t *root, uint64 lba, uint64 count, bool zero) {
+    bcache_note_disk(root);
+    uint32 ss = root->sector_size;
+    bool cached = ss && ss <= BCACHE_BLOCK_SIZE && BCACHE_BLOCK_SIZE % ss == 0;
+    uint32 spb = cached ? bcache_spb(root) : 1;
+    uint64 end = lba + count;
+    uint64 first = lba / spb, last = (end - 1) / spb;
+
+    if (cached) {
+        if (lba % spb && bcache_flush(root, first, first, true, 0) < 0) return -1;
+        bool tail = end % spb && end != root->sector_count;
+        if (tail && bcache_flush(root, last, last, true, 0) < 0) return -1;
+        uint64 full_first = (lba + spb - 1) / spb;
+        uint64 full_end = tail ? end / spb : last + 1;
+        if (full_first < full_end) bcache_drop(root, full_first, full_end - 1);
+    }
+
+    int rc = 0;
+    while (count > 0 && rc == 0) {
+        uint32 n = count > 0x80000000ULL ? 0x80000000U : (uint32)count;
+        rc = zero ? root->ops->write_zeroes(root, lba, n) : root->ops->discard(root, lba, n);
+        lba += n;
+        count -= n;
+    }
+    __atomic_fetch_add(&bcache_gen, 1, __ATOMIC_RELEASE);
+    if (cached) bcache_flush(root, first, last, true, 0);
+    return rc;
+}
+
+static int bcache_check_range(blkdev_t *dev, uint64 lba, uint64 count) {
+    if (!dev || !dev->ops || count == 0) return -1;
+    if (lba >= dev->sector_count || count > dev->sector_count - lba) return -1;
+    return 0;
+}
+
+int bcache_discard(blkdev_t *dev, uint64 lba, uint64 count) {
+    if (bcache_check_range(dev, lba, count) < 0) return -1;
+    blkdev_t *root = bcache_root(dev, &lba);
+    if (!root->ops->discard) return 0;
+    return bcache_range_op(root, lba, count, false);
+}
+
+int bcache_write_zeroes(blkdev_t *dev, uint64 lba, uint64 count) {
+    if (bcache_check_range(dev, lba, count) < 0) return -1;
+    blkdev_t *root = bcache_root(dev, &lba);
+    if (root->ops->write_zeroes && bcache_range_op(root, lba, count, true) == 0) return 0;
+
+    //no such command: write zeroes, in runs big enough to bypass the cache
+    size pages = 2 * BCACHE_DIRECT_BYTES / PAGE_SIZE;
+    void *phys = pmm_alloc(pages);
+    if (!phys) return -1;
+    void *zero = P2V(phys);
+    memset(zero, 0, pages * PAGE_SIZE);
+
+    uint32 chunk = (uint32)(pages * PAGE_SIZE / root->sector_size);
+    int rc = 0;
+    while (count > 0 && rc == 0) {
+        uint32 n = count > chunk ? chunk : (uint32)count;
+        rc = bcache_write(root, lba, n, zero);
+        lba += n;
+        count -= n;
+    }
+    pmm_free(phys, pages);
+    return rc;
+}
+
+int bcache_prefetch(blkdev_t *dev, uint64 lba, uint64 count) {
+    if (bcache_check_range(dev, lba, count) < 0) return -1;
+    blkdev_t *root = bcache_root(dev, &lba);
+    if (!bcache_cacheable(root, 1)) return 0;
+    //a longer read would go around the cache anyway
+    uint64 max = BCACHE_DIRECT_BYTES / root->sector_size;
+    if (count > max) count = max;
+
+    irq_state_t flags = spinlock_irq_acquire(&bcache_pf_lock);
+    if (bcache_pf_started && bcache_pf_count < BCACHE_PREFETCH_QUEUE) {
+        bcache_prefetch_t *req = &bcache_pf[(bcache_pf_head + bcache_pf_count) % BCACHE_PREFETCH_QUEUE];
+        req->root = root;
+        req->lba = lba;
+        req->count = (uint32)count;
+        bcache_pf_count++;
+        thread_wake_one(&bcache_pf_wait);
+    }
+    spinlock_irq_release(&bcache_pf_lock, flags);
+    return 0;
+}
+
+//load the uncached blocks under count sectors at lba of root, cached ones are left alone
+static void bcache_load(blkdev_t *root, uint64 lba, uint32 count) {
+    uint32 spb = bcache_spb(root);
+    uint64 block = lba / spb;
+    uint64 last = (lba + count - 1) / spb;
+    while (block <= last) {
+        uint64 left = last - block + 1;
+        uint32 run = bcache_miss_run(root, block, left < BCACHE_MAX_RUN ? (uint32)left : BCACHE_MAX_RUN);
+        if (run) bcache_fill_run(root, block, run);
+        block += run ? run : 1;
+    }
+}
+
+static void bcache_prefetch_worker(void *arg) {
+    (void)arg;
+    irq_state_t flags = spinlock_irq_acquire(&bcache_pf_lock);
+    for (;;) {
+        while (bcache_pf_count == 0) thread_sleep_locked_irq(&bcache_pf_wait, &bcache_pf_lock, &flags);
+        bcache_prefetch_t req = bcache_pf[bcache_pf_head];
+        bcache_pf_head = (bcache_pf_head + 1) % BCACHE_PREFETCH_QUEUE;
+        bcache_pf_count--;
+        spinlock_irq_release(&bcache_pf_lock, flags);
+
+        bcache_load(req.root, req.lba, req.count);
+        flags = spinlock_irq_acquire(&bcache_pf_lock);
+    }
+}
+
+static void bcache_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        sleep(BCACHE_WRITEBACK_INTERVAL_MS);
+        //filesystems batch their metadata until here, then it ages like data
+        fs_sync_all();
+        if (bcache_flush(NULL, 0, ~0ULL, false, BCACHE_DIRTY_EXPIRE_MS) < 0) {
+            printf("[bcache] WARN: write-back failed, will retry\n");
+        }
+    }
+}
+
+void bcache_start(void) {
+    if (bcache_started) return;
+    wait_queue_init(&bcache_wait);
+
+    process_t *kernel = process_get_kernel();
+    thread_t *thread = kernel ? thread_create(kernel, bcache_worker, NULL) : NULL;
+    if (!thread) {
+        printf("[bcache] ERR: failed to create write-back thread\n");
+        return;
+    }
+
+    bcache_started = true;
+    sched_add(thread);
+
+    //without it prefetches are dropped, reads still work
+    wait_queue_init(&bcache_pf_wait);
+    thread_t *pf_thread = thread_create(kernel, bcache_prefetch_worker, NULL);
+    if (!pf_thread) {
+        printf("[bcache] WARN: failed to create prefetch thread\n");
+        return;
+    }
+    bcache_pf_started = true;
+    sched_add(pf_thread);
+}
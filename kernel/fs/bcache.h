@@ -0,0 +1,69 @@
+#ifndef FS_BCACHE_H
+#define FS_BCACHE_H
+
+#include <arch/types.h>
+#include <drivers/blkdev.h>
+
+/*
+ *block buffer cache
+ *
+ *sits between filesystems (and raw device objects) and blkdev_t. buffers are
+ *one page each and keyed by the whole disk and block number, so a partition
+ *and the disk under it share the same buffers and stay coherent
+ *
+ *consecutive uncached blocks of a read are loaded with a single device
+ *request. writes only dirty the buffer. a background thread writes back
+ *buffers that have been dirty for BCACHE_DIRTY_EXPIRE_MS, bcache_sync writes
+ *back everything right away. eviction is CLOCK and prefers clean buffers
+ *
+ *transfers larger than BCACHE_DIRECT_BYTES go straight to the device (after
+ *writing back any dirty buffers they overlap) so one big copy does not flush
+ *the whole cache. discard and write-zeroes drop the buffers they cover
+ *instead of writing them back first
+ *
+ *readahead is queued with bcache_prefetch and loaded by its own thread, so the
+ *reader that asked for it never waits on the device for data it has not read
+*/
+
+#define BCACHE_BLOCK_SIZE           4096
+#define BCACHE_MAX_BLOCKS           1024    //4MB of cached blocks
+#define BCACHE_HASH_BUCKETS         256
+#define BCACHE_DIRECT_BYTES         (256 * 1024)
+#define BCACHE_MAX_RUN              64      //uncached blocks loaded by one device read
+#define BCACHE_WRITEBACK_INTERVAL_MS 500
+#define BCACHE_DIRTY_EXPIRE_MS      2000
+#define BCACHE_MAX_DISKS            16      //disks bcache_sync flushes
+#define BCACHE_PREFETCH_QUEUE       16      //prefetches waiting for the prefetch thread
+
+//read or write count sectors at lba of dev (a disk or a partition of one)
+//buf must be DMA-able kernel memory, like for blkdev ops
+//returns 0 on success and negative on error
+int bcache_read(blkdev_t *dev, uint64 lba, uint32 count, void *buf);
+int bcache_write(blkdev_t *dev, uint64 lba, uint32 count, const void *buf);
+
+//the same but always straight between buf and the device, the way transfers
+//over BCACHE_DIRECT_BYTES go: overlapping dirty buffers are written back first
+//and a write drops the cached copies it makes stale
+int bcache_read_direct(blkdev_t *dev, uint64 lba, uint32 count, void *buf);
+int bcache_write_direct(blkdev_t *dev, uint64 lba, uint32 count, const void *buf);
+
+//write back every dirty buffer of the disk under dev (NULL for all disks)
+//and flush the disk so the data is durable
+int bcache_sync(blkdev_t *dev);
+
+//discard count sectors at lba of dev, a no-op when the disk cannot discard
+int bcache_discard(blkdev_t *dev, uint64 lba, uint64 count);
+
+//zero count sectors at lba of dev, written out as zero buffers when the disk
+//has no write-zeroes command
+int bcache_write_zeroes(blkdev_t *dev, uint64 lba, uint64 count);
+
+//queue count sectors at lba of dev to be loaded into the cache by a background
+//thread, at most BCACHE_DIRECT_BYTES of it. only a hint: dropped when the
+//queue is full or the disk cannot be cached
+int bcache_prefetch(blkdev_t *dev, uint64 lba, uint64 count);
+
+//start the write-back and prefetch threads (needs the scheduler)
+void bcache_start(void);
+
+#endif
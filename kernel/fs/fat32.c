@@ -1,6 +1,7 @@
 #include <fs/fat32.h>
 #include <fs/mount.h>
 #include <drivers/blkdev.h>
+#include <fs/bcache.h>
 #include <mm/kheap.h>
 #include <mm/mm.h>
 #include <mm/pmm.h>
@@ -25,6 +26,15 @@
 #define FAT32_EOC_MIN       0x0FFFFFF8
 #define FAT32_EOC_MASK      0x0FFFFFFF
 
+#define FAT32_FSINFO_LEAD_SIG   0x41615252
+#define FAT32_FSINFO_STRUCT_SIG 0x61417272
+#define FAT32_FSINFO_TRAIL_SIG  0xAA550000
+#define FAT32_FSINFO_UNKNOWN    0xFFFFFFFF
+#define FAT32_FAT_LOAD_CHUNK    (64 * 1024)
+#define FAT32_MAX_IO_BYTES      (256 * 1024)    //largest single device request
+#define FAT32_RA_MIN            (32 * 1024)     //readahead window of a new stream
+#define FAT32_RA_MAX            BCACHE_DIRECT_BYTES //kept within what the block cache holds on to
+
 typedef struct __attribute__((packed)) {
     uint8 jump[3];
     //boot sector oem string
@@ -58,6 +68,16 @@ typedef struct __attribute__((packed)) {
     char fs_type[8];
 } fat32_bpb_t;
 
+typedef struct __attribute__((packed)) {
+    uint32 lead_sig;           //FAT32_FSINFO_LEAD_SIG
+    uint8 reserved[480];
+    uint32 struct_sig;         //FAT32_FSINFO_STRUCT_SIG
+    uint32 free_count;         //free clusters, FAT32_FSINFO_UNKNOWN if not known
+    uint32 next_free;          //where to start looking, a hint only
+    uint8 reserved2[12];
+    uint32 trail_sig;          //FAT32_FSINFO_TRAIL_SIG
+} fat32_fsinfo_t;
+
 typedef struct __attribute__((packed)) {
     //8.3 short name, no dot abd no terminator
     char name[11];
@@ -87,6 +107,13 @@ typedef struct __attribute__((packed)) {
 
 typedef struct fat32_fs fat32_fs_t;
 
+//a run of clusters that are contiguous both in the file and on the disk
+typedef struct {
+    uint32 file_cluster;       //index of the first cluster in the file
+    uint32 disk_cluster;
+    uint32 length;
+} fat32_extent_t;
+
 typedef struct fat32_node {
     fat32_fs_t *fs;
     uint32 first_cluster;      //first data cluster
@@ -96,8 +123,32 @@ typedef struct fat32_node {
     uint64 dir_entry_offset;   //short entry offset in parent
     bool is_dir;
     bool is_root;              //root has no dirent
+
+    //lazily built map of the cluster chain, dropped when the chain changes
+    fat32_extent_t *extents;
+    uint32 extent_count;
+    uint32 extent_cap;
+    uint32 mapped_clusters;    //chain length the map covers
+    bool extents_valid;
+
+    //sequential readahead state
+    uint64 ra_next;            //where a sequential read would start
+    uint64 ra_end;             //end of what has been prefetched
+    uint32 ra_window;          //0 while the access pattern is random
+
+    //size or first cluster changed but the dirent not written yet
+    bool meta_dirty;
+    struct fat32_node *dirty_next;
 } fat32_node_t;
 
+//what a delayed dirent update needs once the node may be gone
+typedef struct {
+    uint32 parent_cluster;
+    uint64 dir_entry_offset;
+    uint32 first_cluster;
+    uint32 size;
+} fat32_meta_t;
+
 struct fat32_fs {
     object_t *source;          //backing block device
     uint32 dev_sector_size;    //device sector size
@@ -118,6 +169,25 @@ struct fat32_fs {
     uint64 cluster_size;        //bytes per cluster
 
     uint32 next_free_cluster;   //roving allocation hint
+
+    //the first FAT lives in memory, changes are written to every copy by
+    //fat32_fat_flush_locked on sync and close. free_map has a bit per cluster,
+    //set while in use
+    uint8 **fat_pages;
+    uint32 fat_page_count;
+    uint32 fat_sectors;         //FAT sectors held in fat_pages
+    uint64 *fat_dirty;          //one bit per FAT sector
+    uint64 *free_map;
+    uint32 free_map_words;
+    uint32 free_count;
+    bool fsinfo_valid;          //FSInfo sector found, kept up to date on flush
+    bool fsinfo_dirty;
+    fat32_node_t *dirty_nodes;  //open nodes with meta_dirty set
+    //freed runs waiting for their discard. they stay set in free_map until
+    //fat32_sync has the FAT and dirents that free them on the disk
+    fat32_extent_t *discards;
+    uint32 discard_count;
+    uint32 discard_cap;
     spinlock_t lock;
     fs_t *fs;
 };
@@ -131,6 +201,7 @@ static int fat32_dir_stat(object_t *obj, stat_t *st);
 static int fat32_node_close(object_t *obj);
 static int fat32_update_dirent(fat32_fs_t *fs, uint32 dir_cluster, uint64 entry_offset, const fat32_dirent_t *ent);
 static int fat32_find_child(fat32_fs_t *fs, uint32 dir_cluster, const char *name, fat32_dirent_t *ent_out, uint64 *offset_out);
+static void fat32_apply_dirty_meta(fat32_fs_t *fs, uint32 dir_cluster, uint64 entry_offset, fat32_dirent_t *ent);
 
 static object_ops_t fat32_file_ops = {
     .read = fat32_file_read,
@@ -336,7 +407,6 @@ static int fat32_dev_read_bytes(fat32_fs_t *fs, uint64 offset, void *buf, size l
 static int fat32_dev_write_bytes(fat32_fs_t *fs, uint64 offset, const void *buf, size len) {
     if (!fs || !fs->source || !buf || len == 0) return -1;
 
-    //read modify write so bytes outside the request stay intact
     uint64 dev_align = fs->dev_sector_size ? fs->dev_sector_size : 512;
     uint64 aligned_start = align_down_u64(offset, dev_align);
     uint64 aligned_end = align_up_u64(offset + len, dev_align);
@@ -345,10 +415,17 @@ static int fat32_dev_write_bytes(fat32_fs_t *fs, uint64 offset, const void *buf,
 
     void *phys = pmm_alloc(pages);
     if (!phys) return -1;
-    void *tmp = P2V(phys);
-    memset(tmp, 0, aligned_len);
+    uint8 *tmp = P2V(phys);
 
-    if (object_read(fs->source, tmp, aligned_len, aligned_start) < 0) {
+    //read modify write only the partly covered sectors at either edge
+    bool head = offset != aligned_start;
+    bool tail = offset + len != aligned_end;
+    if (head && object_read(fs->source, tmp, dev_align, aligned_start) < 0) {
+        pmm_free(phys, pages);
+        return -1;
+    }
+    if (tail && (!head || aligned_len > dev_align) &&
+        object_read(fs->source, tmp + aligned_len - dev_align, dev_align, aligned_end - dev_align) < 0) {
         pmm_free(phys, pages);
         return -1;
     }
@@ -364,23 +441,94 @@ static int fat32_dev_write_bytes(fat32_fs_t *fs, uint64 offset, const void *buf,
     return 0;
 }
 
+static inline uint32 *fat32_fat_slot(fat32_fs_t *fs, uint32 cluster) {
+    uint64 off = (uint64)cluster * 4;
+    return (uint32 *)(fs->fat_pages[off / PAGE_SIZE] + (off % PAGE_SIZE));
+}
+
+static inline void fat32_free_map_set(fat32_fs_t *fs, uint32 cluster, bool used) {
+    uint64 bit = 1ULL << (cluster % 64);
+    uint64 *word = &fs->free_map[cluster / 64];
+    if (used && !(*word & bit)) {
+        *word |= bit;
+        fs->free_count--;
+    } else if (!used && (*word & bit)) {
+        *word &= ~bit;
+        fs->free_count++;
+    }
+}
+
 static uint32 fat32_fat_read_entry(fat32_fs_t *fs, uint32 cluster) {
-    uint32 entry = 0;
-    uint64 offset = fs->fat_offset + ((uint64)cluster * 4);
-    if (fat32_dev_read_bytes(fs, offset, &entry, sizeof(entry)) < 0) return FAT32_EOC_MASK;
-    return entry & FAT32_EOC_MASK;
+    //chains are walked in memory, out of range reads end the chain
+    if (cluster >= fs->total_clusters + 2) return FAT32_EOC_MASK;
+    return *fat32_fat_slot(fs, cluster) & FAT32_EOC_MASK;
 }
 
 static int fat32_fat_write_entry_locked(fat32_fs_t *fs, uint32 cluster, uint32 value) {
-    //write both fat copies
-    value &= FAT32_EOC_MASK;
-    for (uint32 copy = 0; copy < fs->fat_count; copy++) {
-        uint64 offset = fs->fat_offset + ((uint64)copy * fs->fat_size_sectors * fs->bytes_per_sector) + ((uint64)cluster * 4);
-        if (fat32_dev_write_bytes(fs, offset, &value, sizeof(value)) < 0) {
-            return -1;
+    if (cluster < 2 || cluster >= fs->total_clusters + 2) return -1;
+
+    //keep the reserved top bits, the disk copies follow on the next flush
+    uint32 *slot = fat32_fat_slot(fs, cluster);
+    *slot = (*slot & ~FAT32_EOC_MASK) | (value & FAT32_EOC_MASK);
+    uint32 sector = (uint32)(((uint64)cluster * 4) / fs->bytes_per_sector);
+    fs->fat_dirty[sector / 64] |= 1ULL << (sector % 64);
+
+    fat32_free_map_set(fs, cluster, (value & FAT32_EOC_MASK) != 0);
+    fs->fsinfo_dirty = true;
+    return 0;
+}
+
+//write every dirty FAT sector to all FAT copies, runs of dirty sectors in one
+//page go out as one write per copy
+static int fat32_fat_flush_locked(fat32_fs_t *fs) {
+    uint32 per_page = PAGE_SIZE / fs->bytes_per_sector;
+    uint64 fat_bytes = (uint64)fs->fat_size_sectors * fs->bytes_per_sector;
+    int result = 0;
+
+    for (uint32 sector = 0; sector < fs->fat_sectors; ) {
+        uint64 word = fs->fat_dirty[sector / 64];
+        if (!word) {
+            sector = (sector | 63) + 1;
+            continue;
+        }
+        if (!(word & (1ULL << (sector % 64)))) {
+            sector++;
+            continue;
+        }
+
+        uint32 run = 1;
+        while (sector + run < fs->fat_sectors && (sector + run) % per_page != 0 &&
+               (fs->fat_dirty[(sector + run) / 64] & (1ULL << ((sector + run) % 64)))) {
+            run++;
+        }
+
+        uint64 off = (uint64)sector * fs->bytes_per_sector;
+        const uint8 *src = fs->fat_pages[off / PAGE_SIZE] + (off % PAGE_SIZE);
+        size len = (size)run * fs->bytes_per_sector;
+        bool ok = true;
+        for (uint32 copy = 0; copy < fs->fat_count; copy++) {
+            if (fat32_dev_write_bytes(fs, fs->fat_offset + copy * fat_bytes + off, src, len) < 0) ok = false;
+        }
+        if (ok) {
+            for (uint32 i = 0; i < run; i++) {
+                fs->fat_dirty[(sector + i) / 64] &= ~(1ULL << ((sector + i) % 64));
+            }
+        } else {
+            result = -1;
         }
+        sector += run;
     }
-    return 0;
+
+    if (fs->fsinfo_valid && fs->fsinfo_dirty) {
+        fat32_fsinfo_t info;
+        uint64 off = (uint64)fs->fsinfo_sector * fs->bytes_per_sector;
+        if (fat32_dev_read_bytes(fs, off, &info, sizeof(info)) == 0) {
+            info.free_count = fs->free_count;
+            info.next_free = fs->next_free_cluster;
+            if (fat32_dev_write_bytes(fs, off, &info, sizeof(info)) == 0) fs->fsinfo_dirty = false;
+        }
+    }
+    return result;
 }
 
 static int fat32_fat_write_entry(fat32_fs_t *fs, uint32 cluster, uint32 value) {
@@ -391,13 +539,107 @@ static int fat32_fat_write_entry(fat32_fs_t *fs, uint32 cluster, uint32 value) {
     return rc;
 }
 
+//read the first FAT into memory and build the free-cluster bitmap from it
+//the FSInfo next-free hint (when present and sane) seeds the allocator
+static int fat32_fat_load(fat32_fs_t *fs) {
+    if (fs->bytes_per_sector > PAGE_SIZE) return -1;
+    uint64 fat_bytes = (uint64)fs->fat_size_sectors * fs->bytes_per_sector;
+    //clusters the FAT has no entries for can never be used
+    if ((uint64)(fs->total_clusters + 2) * 4 > fat_bytes) {
+        if (fat_bytes / 4 <= 2) return -1;
+        fs->total_clusters = (uint32)(fat_bytes / 4 - 2);
+    }
+    uint64 need = align_up_u64((uint64)(fs->total_clusters + 2) * 4, fs->bytes_per_sector);
+
+    fs->fat_sectors = (uint32)(need / fs->bytes_per_sector);
+    fs->fat_page_count = (uint32)((need + PAGE_SIZE - 1) / PAGE_SIZE);
+    fs->fat_pages = kzalloc(fs->fat_page_count * sizeof(uint8 *));
+    fs->fat_dirty = kzalloc(((fs->fat_sectors + 63) / 64) * sizeof(uint64));
+    fs->free_map_words = (fs->total_clusters + 2 + 63) / 64;
+    fs->free_map = kzalloc(fs->free_map_words * sizeof(uint64));
+    if (!fs->fat_pages || !fs->fat_dirty || !fs->free_map) return -1;
+
+    uint8 *chunk = kmalloc(FAT32_FAT_LOAD_CHUNK);
+    if (!chunk) return -1;
+    for (uint32 i = 0; i < fs->fat_page_count; i++) {
+        void *phys = pmm_alloc(1);
+        if (!phys) {
+            kfree(chunk);
+            return -1;
+        }
+        fs->fat_pages[i] = P2V(phys);
+        memset(fs->fat_pages[i], 0, PAGE_SIZE);
+    }
+    for (uint64 off = 0; off < need; off += FAT32_FAT_LOAD_CHUNK) {
+        size len = need - off < FAT32_FAT_LOAD_CHUNK ? (size)(need - off) : FAT32_FAT_LOAD_CHUNK;
+        if (fat32_dev_read_bytes(fs, fs->fat_offset + off, chunk, len) < 0) {
+            kfree(chunk);
+            return -1;
+        }
+        for (size done = 0; done < len; done += PAGE_SIZE) {
+            size n = len - done < PAGE_SIZE ? len - done : PAGE_SIZE;
+            memcpy(fs->fat_pages[(off + done) / PAGE_SIZE], chunk + done, n);
+        }
+    }
+    kfree(chunk);
+
+    //clusters 0 and 1 are reserved and never handed out
+    fs->free_count = fs->total_clusters + 2;
+    fat32_free_map_set(fs, 0, true);
+    fat32_free_map_set(fs, 1, true);
+    for (uint32 cluster = 2; cluster < fs->total_clusters + 2; cluster++) {
+        if (fat32_fat_read_entry(fs, cluster) != 0) fat32_free_map_set(fs, cluster, true);
+    }
+    //bits past the last cluster count as used so the allocator skips them
+    for (uint32 bit = fs->total_clusters + 2; bit < fs->free_map_words * 64; bit++) {
+        fs->free_map[bit / 64] |= 1ULL << (bit % 64);
+    }
+
+    fat32_fsinfo_t info;
+    if (fs->fsinfo_sector && fs->fsinfo_sector < fs->reserved_sectors &&
+        fat32_dev_read_bytes(fs, (uint64)fs->fsinfo_sector * fs->bytes_per_sector, &info, sizeof(info)) == 0 &&
+        info.lead_sig == FAT32_FSINFO_LEAD_SIG && info.struct_sig == FAT32_FSINFO_STRUCT_SIG &&
+        info.trail_sig == FAT32_FSINFO_TRAIL_SIG) {
+        fs->fsinfo_valid = true;
+        if (info.next_free >= 2 && info.next_free < fs->total_clusters + 2) {
+            fs->next_free_cluster = info.next_free;
+        }
+        //a stale count from an unclean unmount is corrected on the next flush
+        fs->fsinfo_dirty = info.free_count != fs->free_count;
+    }
+    return 0;
+}
+
+static void fat32_fat_unload(fat32_fs_t *fs) {
+    if (fs->fat_pages) {
+        for (uint32 i = 0; i < fs->fat_page_count; i++) {
+            if (fs->fat_pages[i]) pmm_free((void *)V2P(fs->fat_pages[i]), 1);
+        }
+        kfree(fs->fat_pages);
+    }
+    if (fs->fat_dirty) kfree(fs->fat_dirty);
+    if (fs->free_map) kfree(fs->free_map);
+    if (fs->discards) kfree(fs->discards);
+}
+
 static uint32 fat32_cluster_next(fat32_fs_t *fs, uint32 cluster) {
     //follow one link in the chain
     return fat32_fat_read_entry(fs, cluster);
 }
 
+//discard (OBJ_INFO_BLOCK_DISCARD), zero (OBJ_INFO_BLOCK_ZERO) or prefetch
+//(OBJ_INFO_BLOCK_PREFETCH) a byte range of the source without moving data
+//through us, fails when it is not device sector aligned
+static int fat32_dev_range(fat32_fs_t *fs, uint32 topic, uint64 offset, uint64 len) {
+    block_range_t range = { .offset = offset, .len = len };
+    return object_get_info(fs->source, topic, &range, sizeof(range)) < 0 ? -1 : 0;
+}
+
 static int fat32_cluster_zero(fat32_fs_t *fs, uint32 cluster) {
     //new clusters start blank so old data does not leak back out
+    uint64 offset = fat32_cluster_offset(fs, cluster);
+    if (fat32_dev_range(fs, OBJ_INFO_BLOCK_ZERO, offset, fs->cluster_size) == 0) return 0;
+
     void *zero = kzalloc(fs->cluster_size);
     if (!zero) return -1;
     int ret = fat32_dev_write_bytes(fs, fat32_cluster_offset(fs, cluster), zero, fs->cluster_size);
@@ -409,10 +651,6 @@ static int fat32_cluster_read(fat32_fs_t *fs, uint32 cluster, void *buf) {
     return fat32_dev_read_bytes(fs, fat32_cluster_offset(fs, cluster), buf, fs->cluster_size);
 }
 
-static int fat32_cluster_write(fat32_fs_t *fs, uint32 cluster, const void *buf) {
-    return fat32_dev_write_bytes(fs, fat32_cluster_offset(fs, cluster), buf, fs->cluster_size);
-}
-
 static uint32 fat32_chain_length(fat32_fs_t *fs, uint32 first_cluster, uint32 *last_cluster) {
     if (first_cluster < 2) {
         if (last_cluster) *last_cluster = 0;
@@ -437,35 +675,113 @@ static uint32 fat32_chain_length(fat32_fs_t *fs, uint32 first_cluster, uint32 *l
     return count;
 }
 
-static uint32 fat32_alloc_cluster_locked(fat32_fs_t *fs) {
-    //start from the last hint and wrap once
+//first free cluster at or after the rover, wrapping once, 0 when full
+static uint32 fat32_free_map_find(fat32_fs_t *fs) {
+    if (fs->free_count == 0) return 0;
+
     uint32 start = fs->next_free_cluster < 2 ? 2 : fs->next_free_cluster;
-    for (uint32 pass = 0; pass < 2; pass++) {
-        uint32 begin = (pass == 0) ? start : 2;
-        uint32 end = (pass == 0) ? (fs->total_clusters + 2) : start;
-        for (uint32 cluster = begin; cluster < end; cluster++) {
-            if (fat32_fat_read_entry(fs, cluster) == 0) {
-                if (fat32_fat_write_entry_locked(fs, cluster, FAT32_EOC_MASK) < 0) return 0;
-                if (fat32_cluster_zero(fs, cluster) < 0) {
-                    fat32_fat_write_entry_locked(fs, cluster, 0);
-                    return 0;
-                }
-                fs->next_free_cluster = cluster + 1;
-                return cluster;
-            }
-        }
+    if (start >= fs->total_clusters + 2) start = 2;
+    uint32 w = start / 64;
+    //mask off clusters below the rover in its own word on the first visit
+    uint64 word = fs->free_map[w] | ((1ULL << (start % 64)) - 1);
+    for (uint32 i = 0; i <= fs->free_map_words; i++) {
+        if (~word) return w * 64 + (uint32)__builtin_ctzll(~word);
+        w = (w + 1) % fs->free_map_words;
+        word = fs->free_map[w];
     }
     return 0;
 }
 
-static uint32 fat32_alloc_cluster(fat32_fs_t *fs) {
+//file data clusters are not zeroed, reads stop at the file size and a gap
+//left by a write past the end is zero filled by the write itself
+static uint32 fat32_alloc_cluster_locked(fat32_fs_t *fs, bool zero) {
+    uint32 cluster = fat32_free_map_find(fs);
+    if (!cluster) return 0;
+
+    if (fat32_fat_write_entry_locked(fs, cluster, FAT32_EOC_MASK) < 0) return 0;
+    if (zero && fat32_cluster_zero(fs, cluster) < 0) {
+        fat32_fat_write_entry_locked(fs, cluster, 0);
+        return 0;
+    }
+    fs->next_free_cluster = cluster + 1;
+    return cluster;
+}
+
+static uint32 fat32_alloc_cluster(fat32_fs_t *fs, bool zero) {
     if (!fs) return 0;
     spinlock_acquire(&fs->lock);
-    uint32 cluster = fat32_alloc_cluster_locked(fs);
+    uint32 cluster = fat32_alloc_cluster_locked(fs, zero);
     spinlock_release(&fs->lock);
     return cluster;
 }
 
+static void fat32_extents_invalidate(fat32_node_t *node) {
+    node->extents_valid = false;
+}
+
+//walk the chain once and fold it into runs, called with fs->lock held
+static int fat32_extents_build_locked(fat32_fs_t *fs, fat32_node_t *node) {
+    node->extent_count = 0;
+    node->mapped_clusters = 0;
+
+    uint32 cluster = node->first_cluster;
+    uint32 index = 0;
+    while (cluster >= 2 && cluster < fs->total_clusters + 2 && index <= fs->total_clusters) {
+        fat32_extent_t *last = node->extent_count ? &node->extents[node->extent_count - 1] : NULL;
+        if (last && last->disk_cluster + last->length == cluster) {
+            last->length++;
+        } else {
+            if (node->extent_count == node->extent_cap) {
+                uint32 cap = node->extent_cap ? node->extent_cap * 2 : 8;
+                fat32_extent_t *grown = krealloc(node->extents, cap * sizeof(fat32_extent_t));
+                if (!grown) return -1;
+                node->extents = grown;
+                node->extent_cap = cap;
+            }
+            fat32_extent_t *ext = &node->extents[node->extent_count++];
+            ext->file_cluster = index;
+            ext->disk_cluster = cluster;
+            ext->length = 1;
+        }
+        index++;
+
+        uint32 next = fat32_cluster_next(fs, cluster);
+        if (next == cluster) break;
+        cluster = next;
+    }
+
+    node->mapped_clusters = index;
+    node->extents_valid = true;
+    return 0;
+}
+
+//disk cluster holding file cluster index, 0 past the end of the chain
+//*run (optional) receives how many clusters from there on are contiguous
+static uint32 fat32_node_map(fat32_node_t *node, uint32 index, uint32 *run) {
+    fat32_fs_t *fs = node->fs;
+    uint32 disk = 0;
+
+    spinlock_acquire(&fs->lock);
+    //another open of the file may have grown the chain since the map was built
+    if (!node->extents_valid || index >= node->mapped_clusters) {
+        if (fat32_extents_build_locked(fs, node) < 0) node->extents_valid = false;
+    }
+    if (node->extents_valid && index < node->mapped_clusters) {
+        uint32 lo = 0, hi = node->extent_count;
+        while (hi - lo > 1) {
+            uint32 mid = lo + (hi - lo) / 2;
+            if (node->extents[mid].file_cluster <= index) lo = mid;
+            else hi = mid;
+        }
+        fat32_extent_t *ext = &node->extents[lo];
+        uint32 delta = index - ext->file_cluster;
+        disk = ext->disk_cluster + delta;
+        if (run) *run = ext->length - delta;
+    }
+    spinlock_release(&fs->lock);
+    return disk;
+}
+
 static int fat32_chain_ensure_locked(fat32_fs_t *fs, fat32_node_t *node, uint32 wanted_clusters) {
     if (!fs || !node || wanted_clusters == 0) return -1;
 
@@ -474,8 +790,9 @@ static int fat32_chain_ensure_locked(fat32_fs_t *fs, fat32_node_t *node, uint32
     uint32 have = fat32_chain_length(fs, node->first_cluster, &last);
     if (have >= wanted_clusters) return 0;
 
+    fat32_extents_invalidate(node);
     while (have < wanted_clusters) {
-        uint32 cluster = fat32_alloc_cluster_locked(fs);
+        uint32 cluster = fat32_alloc_cluster_locked(fs, false);
         if (!cluster) return -1;
 
         if (node->first_cluster < 2) {
@@ -777,7 +1094,7 @@ extend_chain:
     uint32 first_new_cluster = 0;
 
     while (extra_clusters-- > 0) {
-        uint32 new_cluster = fat32_alloc_cluster(fs);
+        uint32 new_cluster = fat32_alloc_cluster(fs, true);
         if (!new_cluster) {
             pmm_free(phys, cluster_pages);
             return -1;
@@ -948,7 +1265,9 @@ static int fat32_read_dirent(fat32_fs_t *fs, uint32 dir_cluster, uint64 entry_of
 static int fat32_find_entry(fat32_fs_t *fs, uint32 dir_cluster, const char *name, fat32_dirent_t *ent_out, uint64 *offset_out) {
     uint32 dummy = 0;
     if (fat32_dir_scan(fs, dir_cluster, &dummy, name, ent_out, offset_out) < 0) return -1;
-    return ent_out && ent_out->name[0] != 0 ? 0 : -1;
+    if (!ent_out || ent_out->name[0] == 0) return -1;
+    if (offset_out) fat32_apply_dirty_meta(fs, dir_cluster, *offset_out, ent_out);
+    return 0;
 }
 
 static fat32_node_t *fat32_node_from_entry(fat32_fs_t *fs, const fat32_dirent_t *ent,
@@ -1008,66 +1327,178 @@ static int fat32_dir_empty(fat32_fs_t *fs, uint32 dir_cluster) {
     return 1;
 }
 
-static int fat32_update_file_meta(fat32_fs_t *fs, fat32_node_t *node) {
-    if (!fs || !node || node->is_root) return 0;
-
+static int fat32_write_meta(fat32_fs_t *fs, const fat32_meta_t *meta) {
     //write back size and first cluster to the parent dirent
     fat32_dirent_t ent;
     uint32 target_cluster = 0;
     uint64 cluster_offset = 0;
-    if (fat32_dir_cluster_for_offset(fs, node->parent_cluster, node->dir_entry_offset,
+    if (fat32_dir_cluster_for_offset(fs, meta->parent_cluster, meta->dir_entry_offset,
                                      &target_cluster, &cluster_offset) < 0) return -1;
     if (fat32_read_dirent(fs, target_cluster, cluster_offset, &ent) < 0) return -1;
-    ent.first_cluster_hi = (uint16)((node->first_cluster >> 16) & 0xFFFF);
-    ent.first_cluster_lo = (uint16)(node->first_cluster & 0xFFFF);
-    ent.size = node->size;
+    ent.first_cluster_hi = (uint16)((meta->first_cluster >> 16) & 0xFFFF);
+    ent.first_cluster_lo = (uint16)(meta->first_cluster & 0xFFFF);
+    ent.size = meta->size;
     return fat32_update_dirent(fs, target_cluster, cluster_offset, &ent);
 }
 
+//dirents of growing files are written on close or sync, not on every write
+static void fat32_mark_meta_dirty(fat32_node_t *node) {
+    if (node->is_root) return;
+    fat32_fs_t *fs = node->fs;
+    spinlock_acquire(&fs->lock);
+    if (!node->meta_dirty) {
+        node->meta_dirty = true;
+        node->dirty_next = fs->dirty_nodes;
+        fs->dirty_nodes = node;
+    }
+    spinlock_release(&fs->lock);
+}
+
+//take node off the dirty list, returns whether its dirent still needs writing
+static bool fat32_take_meta_locked(fat32_fs_t *fs, fat32_node_t *node, fat32_meta_t *meta) {
+    if (!node->meta_dirty) return false;
+    fat32_node_t **pp = &fs->dirty_nodes;
+    while (*pp && *pp != node) pp = &(*pp)->dirty_next;
+    if (*pp) *pp = node->dirty_next;
+    node->dirty_next = NULL;
+    node->meta_dirty = false;
+
+    meta->parent_cluster = node->parent_cluster;
+    meta->dir_entry_offset = node->dir_entry_offset;
+    meta->first_cluster = node->first_cluster;
+    meta->size = node->size;
+    return true;
+}
+
+//lookups see the size an open writer has not written back yet
+static void fat32_apply_dirty_meta(fat32_fs_t *fs, uint32 dir_cluster, uint64 entry_offset, fat32_dirent_t *ent) {
+    spinlock_acquire(&fs->lock);
+    for (fat32_node_t *n = fs->dirty_nodes; n; n = n->dirty_next) {
+        if (n->parent_cluster != dir_cluster || n->dir_entry_offset != entry_offset) continue;
+        ent->first_cluster_hi = (uint16)((n->first_cluster >> 16) & 0xFFFF);
+        ent->first_cluster_lo = (uint16)(n->first_cluster & 0xFFFF);
+        ent->size = n->size;
+        break;
+    }
+    spinlock_release(&fs->lock);
+}
+
+static void fat32_discard_flush(fat32_fs_t *fs, fat32_extent_t *runs, uint32 count);
+
+//push the FAT (once per copy) and every delayed dirent into the block layer,
+//then discard the clusters they freed
+static int fat32_sync(fat32_fs_t *fs) {
+    int result = 0;
+    for (;;) {
+        fat32_meta_t meta;
+        spinlock_acquire(&fs->lock);
+        bool have = fs->dirty_nodes && fat32_take_meta_locked(fs, fs->dirty_nodes, &meta);
+        spinlock_release(&fs->lock);
+        if (!have) break;
+        if (fat32_write_meta(fs, &meta) < 0) result = -1;
+    }
+
+    spinlock_acquire(&fs->lock);
+    if (fat32_fat_flush_locked(fs) < 0) result = -1;
+    fat32_extent_t *runs = NULL;
+    uint32 count = 0;
+    if (result == 0 && fs->discard_count) {
+        runs = fs->discards;
+        count = fs->discard_count;
+        fs->discards = NULL;
+        fs->discard_count = 0;
+        fs->discard_cap = 0;
+    }
+    spinlock_release(&fs->lock);
+
+    if (count) fat32_discard_flush(fs, runs, count);
+    return result;
+}
+
+//ask the block cache to load a device range in the background, returns how
+//much of [offset, offset + len) the request covers
+static size fat32_dev_prefetch(fat32_fs_t *fs, uint64 offset, size len) {
+    uint64 dev_align = fs->dev_sector_size ? fs->dev_sector_size : 512;
+    uint64 aligned_start = align_down_u64(offset, dev_align);
+    uint64 aligned_end = align_up_u64(offset + len, dev_align);
+    //rounding out an unaligned window must not push it past what gets cached
+    if (aligned_end - aligned_start > BCACHE_DIRECT_BYTES) {
+        aligned_end = aligned_start + align_down_u64(BCACHE_DIRECT_BYTES, dev_align);
+    }
+
+    //only a hint, a source without a block cache just reads on demand
+    fat32_dev_range(fs, OBJ_INFO_BLOCK_PREFETCH, aligned_start, aligned_end - aligned_start);
+    return aligned_end - offset < len ? (size)(aligned_end - offset) : len;
+}
+
+//a read that starts where the last one ended grows the window (doubling up
+//to FAT32_RA_MAX) and tops up the prefetched range once the reader gets
+//within half a window of its end. any other read resets the stream
+//the block cache loads the range on its prefetch thread, the reader goes on
+static void fat32_readahead(fat32_node_t *node, uint64 pos, size len) {
+    fat32_fs_t *fs = node->fs;
+    uint64 end = pos + len;
+    bool sequential = pos == node->ra_next;
+    node->ra_next = end;
+    if (!sequential) {
+        node->ra_window = 0;
+        node->ra_end = 0;
+        return;
+    }
+
+    uint32 window = node->ra_window ? node->ra_window * 2 : FAT32_RA_MIN;
+    if (window > FAT32_RA_MAX) window = FAT32_RA_MAX;
+    node->ra_window = window;
+    if (node->ra_end > end + window / 2) return;
+
+    uint64 start = node->ra_end > end ? node->ra_end : end;
+    uint64 stop = end + window;
+    if (stop > node->size) stop = node->size;
+    while (start < stop) {
+        uint32 run = 0;
+        uint32 cluster_off = (uint32)(start % fs->cluster_size);
+        uint32 cluster = fat32_node_map(node, (uint32)(start / fs->cluster_size), &run);
+        if (!cluster) break;
+
+        uint64 chunk = (uint64)run * fs->cluster_size - cluster_off;
+        if (chunk > stop - start) chunk = stop - start;
+        start += fat32_dev_prefetch(fs, fat32_cluster_offset(fs, cluster) + cluster_off, (size)chunk);
+    }
+    node->ra_end = start;
+}
+
 static ssize fat32_file_read(object_t *obj, void *buf, size len, size offset) {
     fat32_node_t *node = (fat32_node_t *)obj->data;
     if (!node || !node->fs || !buf) return -1;
     if (node->is_dir) return -1;
     if (node->first_cluster < 2 || offset >= node->size) return 0;
 
+    fat32_fs_t *fs = node->fs;
     size remaining = len;
     if (offset + remaining > node->size) remaining = node->size - offset;
 
-    size cluster_pages = (node->fs->cluster_size + PAGE_SIZE - 1) / PAGE_SIZE;
-    void *phys = pmm_alloc(cluster_pages);
-    if (!phys) return -1;
-    void *tmp = P2V(phys);
-
     size copied = 0;
     uint64 pos = offset;
     while (remaining > 0) {
-        //walk to the cluster that contains the current offset
-        uint32 cluster_index = (uint32)(pos / node->fs->cluster_size);
-        uint32 cluster_off = (uint32)(pos % node->fs->cluster_size);
-        uint32 cluster = node->first_cluster;
-
-        for (uint32 i = 0; i < cluster_index; i++) {
-            cluster = fat32_cluster_next(node->fs, cluster);
-            if (cluster < 2 || fat32_cluster_eoc(cluster)) {
-                pmm_free(phys, cluster_pages);
-                return (ssize)copied;
-            }
-        }
-
-        if (fat32_cluster_read(node->fs, cluster, tmp) < 0) {
-            pmm_free(phys, cluster_pages);
-            return -1;
-        }
+        //one device read per contiguous run of clusters
+        uint32 run = 0;
+        uint32 cluster_off = (uint32)(pos % fs->cluster_size);
+        uint32 cluster = fat32_node_map(node, (uint32)(pos / fs->cluster_size), &run);
+        if (!cluster) break;
 
-        size chunk = node->fs->cluster_size - cluster_off;
+        uint64 chunk = (uint64)run * fs->cluster_size - cluster_off;
         if (chunk > remaining) chunk = remaining;
-        memcpy((uint8 *)buf + copied, (uint8 *)tmp + cluster_off, chunk);
+        if (chunk > FAT32_MAX_IO_BYTES) chunk = FAT32_MAX_IO_BYTES;
+        if (fat32_dev_read_bytes(fs, fat32_cluster_offset(fs, cluster) + cluster_off,
+                                 (uint8 *)buf + copied, (size)chunk) < 0) {
+            return copied ? (ssize)copied : -1;
+        }
         copied += chunk;
         remaining -= chunk;
         pos += chunk;
     }
 
-    pmm_free(phys, cluster_pages);
+    if (copied) fat32_readahead(node, offset, copied);
     return (ssize)copied;
 }
 
@@ -1077,51 +1508,24 @@ static int fat32_file_write_range(fat32_node_t *node, size offset, const void *b
     size written = 0;
     uint64 pos = offset;
 
-    size cluster_pages = (fs->cluster_size + PAGE_SIZE - 1) / PAGE_SIZE;
-    void *phys = pmm_alloc(cluster_pages);
-    if (!phys) return -1;
-    void *tmp = P2V(phys);
-
     while (remaining > 0) {
-        //same cluster walk as read
-        uint32 cluster_index = (uint32)(pos / fs->cluster_size);
+        //the caller extended the chain, a hole here means it failed to
+        uint32 run = 0;
         uint32 cluster_off = (uint32)(pos % fs->cluster_size);
-        uint32 cluster = node->first_cluster;
+        uint32 cluster = fat32_node_map(node, (uint32)(pos / fs->cluster_size), &run);
+        if (cluster < 2 || fat32_cluster_eoc(cluster)) return -1;
 
-        for (uint32 i = 0; i < cluster_index; i++) {
-            uint32 next = fat32_cluster_next(fs, cluster);
-            if (next < 2 || fat32_cluster_eoc(next)) {
-                //chain ended early, caller should have extended it
-                next = 0;
-            }
-            cluster = next ? next : cluster;
-            if (!next) break;
-        }
-
-        if (cluster < 2 || fat32_cluster_eoc(cluster)) {
-            pmm_free(phys, cluster_pages);
-            return -1;
-        }
-
-        if (fat32_cluster_read(fs, cluster, tmp) < 0) {
-            pmm_free(phys, cluster_pages);
-            return -1;
-        }
-
-        size chunk = fs->cluster_size - cluster_off;
+        //one device write per contiguous run, only its edge sectors are read back
+        uint64 chunk = (uint64)run * fs->cluster_size - cluster_off;
         if (chunk > remaining) chunk = remaining;
-        memcpy((uint8 *)tmp + cluster_off, (const uint8 *)buf + written, chunk);
-        if (fat32_cluster_write(fs, cluster, tmp) < 0) {
-            pmm_free(phys, cluster_pages);
-            return -1;
-        }
+        if (chunk > FAT32_MAX_IO_BYTES) chunk = FAT32_MAX_IO_BYTES;
+        if (fat32_dev_write_bytes(fs, fat32_cluster_offset(fs, cluster) + cluster_off,
+                                  (const uint8 *)buf + written, (size)chunk) < 0) return -1;
 
         written += chunk;
         remaining -= chunk;
         pos += chunk;
     }
-
-    pmm_free(phys, cluster_pages);
     return 0;
 }
 
@@ -1138,10 +1542,10 @@ static ssize fat32_file_write(object_t *obj, const void *buf, size len, size off
 
     if (node->first_cluster < 2) {
         //brand new file, give it its first cluster now
-        uint32 first = fat32_alloc_cluster(node->fs);
+        uint32 first = fat32_alloc_cluster(node->fs, false);
         if (!first) return -1;
         node->first_cluster = first;
-        if (fat32_update_file_meta(node->fs, node) < 0) return -1;
+        fat32_mark_meta_dirty(node);
     }
 
     if (fat32_chain_ensure(node->fs, node, needed_clusters) < 0) return -1;
@@ -1171,7 +1575,7 @@ static ssize fat32_file_write(object_t *obj, const void *buf, size len, size off
 
     if (end > node->size) {
         node->size = end;
-        if (fat32_update_file_meta(node->fs, node) < 0) return -1;
+        fat32_mark_meta_dirty(node);
     }
 
     return (ssize)len;
@@ -1200,6 +1604,20 @@ static int fat32_dir_stat(object_t *obj, stat_t *st) {
 static int fat32_node_close(object_t *obj) {
     //node data is owned by the open object
     if (!obj || !obj->data) return 0;
+    fat32_node_t *node = (fat32_node_t *)obj->data;
+
+    //a closed file is written back like on sync
+    fat32_fs_t *fs = node->fs;
+    fat32_meta_t meta;
+    spinlock_acquire(&fs->lock);
+    bool dirty = fat32_take_meta_locked(fs, node, &meta);
+    spinlock_release(&fs->lock);
+    if (dirty) {
+        fat32_write_meta(fs, &meta);
+        fat32_sync(fs);
+    }
+
+    if (node->extents) kfree(node->extents);
     kfree(obj->data);
     obj->data = NULL;
     return 0;
@@ -1283,8 +1701,9 @@ static int fat32_find_child(fat32_fs_t *fs, uint32 dir_cluster, const char *name
     //thin wrapper used by create and lookup helpers
     uint32 dummy = 0;
     if (fat32_dir_scan(fs, dir_cluster, &dummy, name, ent_out, offset_out) < 0) return -1;
-    if (ent_out && ent_out->name[0] != 0) return 0;
-    return -1;
+    if (!ent_out || ent_out->name[0] == 0) return -1;
+    if (offset_out) fat32_apply_dirty_meta(fs, dir_cluster, *offset_out, ent_out);
+    return 0;
 }
 
 static int fat32_lookup_path(fat32_fs_t *fs, const char *path, fat32_dirent_t *ent_out, uint32 *parent_cluster_out, uint64 *entry_offset_out) {
@@ -1370,24 +1789,125 @@ static int fat32_dir_remove_entry_chain(fat32_fs_t *fs, uint32 parent_cluster, u
     return fat32_update_dirent(fs, cluster, cluster_off, &ent);
 }
 
-static int fat32_free_chain(fat32_fs_t *fs, uint32 first_cluster) {
-    //clear every fat link in the chain
+//hand reserved runs back to the allocator, called with fs->lock held
+static void fat32_release_runs_locked(fat32_fs_t *fs, const fat32_extent_t *runs, uint32 count) {
+    for (uint32 i = 0; i < count; i++) {
+        for (uint32 c = 0; c < runs[i].length; c++) {
+            fat32_free_map_set(fs, runs[i].disk_cluster + c, false);
+        }
+    }
+    fs->fsinfo_dirty = true;
+}
+
+//queue freed runs for the discard on the next sync, called with fs->lock held.
+//without room they are released right away and keep their old data
+static void fat32_discard_queue_locked(fat32_fs_t *fs, const fat32_extent_t *runs, uint32 count) {
+    if (fs->discard_count + count > fs->discard_cap) {
+        uint32 new_cap = fs->discard_cap ? fs->discard_cap : 16;
+        while (new_cap < fs->discard_count + count) new_cap *= 2;
+        fat32_extent_t *grown = krealloc(fs->discards, new_cap * sizeof(fat32_extent_t));
+        if (!grown) {
+            fat32_release_runs_locked(fs, runs, count);
+            return;
+        }
+        fs->discards = grown;
+        fs->discard_cap = new_cap;
+    }
+    memcpy(&fs->discards[fs->discard_count], runs, count * sizeof(fat32_extent_t));
+    fs->discard_count += count;
+}
+
+//tell the device the runs hold nothing anymore once the metadata freeing
+//them is durable, then let the allocator have them. if the flush fails they
+//wait for the next sync
+static void fat32_discard_flush(fat32_fs_t *fs, fat32_extent_t *runs, uint32 count) {
+    if (object_get_info(fs->source, OBJ_INFO_BLOCK_FLUSH, NULL, 0) < 0) {
+        spinlock_acquire(&fs->lock);
+        fat32_discard_queue_locked(fs, runs, count);
+        spinlock_release(&fs->lock);
+        kfree(runs);
+        return;
+    }
+
+    //only a hint, a device without discard just keeps the old data
+    for (uint32 i = 0; i < count; i++) {
+        fat32_dev_range(fs, OBJ_INFO_BLOCK_DISCARD, fat32_cluster_offset(fs, runs[i].disk_cluster),
+                        (uint64)runs[i].length * fs->cluster_size);
+    }
+    spinlock_acquire(&fs->lock);
+    fat32_release_runs_locked(fs, runs, count);
+    spinlock_release(&fs->lock);
+    kfree(runs);
+}
+
+//clear every fat link in the chain. the clusters stay set in free_map so none
+//can be handed out and written before the discard, their runs are returned
+//for fat32_discard_chain once the dirent pointing at them is gone too
+static int fat32_free_chain(fat32_fs_t *fs, uint32 first_cluster, fat32_extent_t **runs_out, uint32 *count_out) {
     if (!fs) return -1;
+    fat32_extent_t *runs = NULL;
+    uint32 count = 0;
+    uint32 cap = 0;
+    int result = 0;
+
     spinlock_acquire(&fs->lock);
     uint32 cluster = first_cluster;
-    while (cluster >= 2 && cluster < FAT32_EOC_MIN) {
+    for (uint32 steps = 0; cluster >= 2 && cluster < FAT32_EOC_MIN && steps < fs->total_clusters; steps++) {
         uint32 next = fat32_cluster_next(fs, cluster);
         if (fat32_fat_write_entry_locked(fs, cluster, 0) < 0) {
-            spinlock_release(&fs->lock);
-            return -1;
+            result = -1;
+            break;
+        }
+
+        //a cluster that does not fit in the list is simply free, just not discarded
+        if (count && runs[count - 1].disk_cluster + runs[count - 1].length == cluster) {
+            runs[count - 1].length++;
+            fat32_free_map_set(fs, cluster, true);
+        } else {
+            if (count == cap) {
+                uint32 new_cap = cap ? cap * 2 : 16;
+                fat32_extent_t *grown = krealloc(runs, new_cap * sizeof(fat32_extent_t));
+                if (grown) {
+                    runs = grown;
+                    cap = new_cap;
+                }
+            }
+            if (count < cap) {
+                runs[count].file_cluster = 0;
+                runs[count].disk_cluster = cluster;
+                runs[count].length = 1;
+                count++;
+                fat32_free_map_set(fs, cluster, true);
+            }
         }
         if (next == cluster) break;
         cluster = next;
     }
+    if (result < 0) fat32_release_runs_locked(fs, runs, count);
     spinlock_release(&fs->lock);
+
+    if (result < 0) {
+        if (runs) kfree(runs);
+        return -1;
+    }
+    *runs_out = runs;
+    *count_out = count;
     return 0;
 }
 
+//queue the runs of a freed chain for the discard on the next sync, or give
+//them straight back when the dirent removal failed
+static void fat32_discard_chain(fat32_fs_t *fs, fat32_extent_t *runs, uint32 count, bool removed) {
+    spinlock_acquire(&fs->lock);
+    if (removed) {
+        fat32_discard_queue_locked(fs, runs, count);
+    } else {
+        fat32_release_runs_locked(fs, runs, count);
+    }
+    spinlock_release(&fs->lock);
+    if (runs) kfree(runs);
+}
+
 static int fat32_fs_stat_path(fat32_fs_t *fs, const char *path, stat_t *st) {
     if (!fs || !path || !st) return -1;
 
@@ -1506,7 +2026,7 @@ static int fat32_fs_create(fs_t *fs_obj, const char *path, uint32 type) {
     }
 
     if (type == FS_TYPE_DIR) {
-        uint32 new_dir_cluster = fat32_alloc_cluster(fs);
+        uint32 new_dir_cluster = fat32_alloc_cluster(fs, false);
         if (!new_dir_cluster) return -1;
 
         //new dirs get their own cluster and dotdot records
@@ -1557,24 +2077,31 @@ static int fat32_fs_remove(fs_t *fs_obj, const char *path) {
         parent_cluster = ((uint32)parent_ent.first_cluster_hi << 16) | parent_ent.first_cluster_lo;
     }
 
+    //no delayed dirent may land on the slot once it is freed
+    fat32_sync(fs);
+
     fat32_dirent_t ent;
     uint64 entry_offset = 0;
     if (fat32_find_child(fs, parent_cluster, name, &ent, &entry_offset) < 0) return -1;
 
+    fat32_extent_t *runs = NULL;
+    uint32 run_count = 0;
     if (ent.attr & FAT32_ATTR_DIR) {
         //dirs must be empty before removal
         uint32 dir_cluster = ((uint32)ent.first_cluster_hi << 16) | ent.first_cluster_lo;
         if (dir_cluster == fs->root_cluster) return -1;
         if (fat32_dir_empty(fs, dir_cluster) != 1) return -1;
-        if (fat32_free_chain(fs, dir_cluster) < 0) return -1;
+        if (fat32_free_chain(fs, dir_cluster, &runs, &run_count) < 0) return -1;
     } else {
         uint32 first_cluster = ((uint32)ent.first_cluster_hi << 16) | ent.first_cluster_lo;
         if (first_cluster >= 2) {
-            if (fat32_free_chain(fs, first_cluster) < 0) return -1;
+            if (fat32_free_chain(fs, first_cluster, &runs, &run_count) < 0) return -1;
         }
     }
 
-    return fat32_dir_remove_entry_chain(fs, parent_cluster, entry_offset);
+    int result = fat32_dir_remove_entry_chain(fs, parent_cluster, entry_offset);
+    fat32_discard_chain(fs, runs, run_count, result == 0);
+    return result;
 }
 
 static int fat32_fs_stat(fs_t *fs_obj, const char *path, stat_t *st) {
@@ -1584,12 +2111,19 @@ static int fat32_fs_stat(fs_t *fs_obj, const char *path, stat_t *st) {
     return fat32_fs_stat_path(fs, path, st);
 }
 
+static int fat32_fs_sync(fs_t *fs_obj) {
+    fat32_fs_t *fs = (fat32_fs_t *)fs_obj->data;
+    if (!fs) return -1;
+    return fat32_sync(fs);
+}
+
 static fs_ops_t fat32_ops = {
     .lookup = fat32_fs_lookup,  //path lookup
     .create = fat32_fs_create,  //create file or dir
     .remove = fat32_fs_remove,  //delete file or dir
     .readdir = NULL,
-    .stat = fat32_fs_stat       //path stat
+    .stat = fat32_fs_stat,      //path stat
+    .sync = fat32_fs_sync       //write back FAT and dirents
 };
 
 intptr fat32_mount(object_t *source, const char *target) {
@@ -1689,11 +2223,21 @@ intptr fat32_mount(object_t *source, const char *target) {
         return -1;
     }
 
+    if (fat32_fat_load(state) < 0) {
+        fat32_fat_unload(state);
+        object_deref(source);
+        kfree(fs);
+        kfree(state);
+        pmm_free(boot_phys, boot_pages);
+        return -1;
+    }
+
     fs->name = "fat32";
     fs->ops = &fat32_ops;
     fs->data = state;
 
     if (fs_mount_register(target, fs) < 0) {
+        fat32_fat_unload(state);
         object_deref(source);
         kfree(fs);
         kfree(state);
@@ -50,6 +50,9 @@ typedef struct fs_ops {
     
     //get file status (returns 0 on success, -1 on error)
     int (*stat)(struct fs *fs, const char *path, stat_t *st);
+
+    //write delayed metadata back to the block layer (optional)
+    int (*sync)(struct fs *fs);
 } fs_ops_t;
 
 //filesystem instance
@@ -3,6 +3,7 @@
 #include <lib/string.h>
 #include <lib/spinlock.h>
 #include <lib/io.h>
+#include <proc/rcu.h>
 
 #define MOUNT_PATH_MAX 256
 
@@ -13,6 +14,8 @@ typedef struct fs_mount_entry {
     struct fs_mount_entry *next;
 } fs_mount_entry_t;
 
+//entries are never removed so readers walk the list under RCU alone
+//mount_lock only serialises writers
 static fs_mount_entry_t *mounts = NULL;
 static spinlock_t mount_lock = SPINLOCK_INIT;
 
@@ -53,7 +56,7 @@ static int mount_paths_overlap(const char *a, const char *b) {
 }
 
 static int mount_conflicts_unlocked(const char *target) {
-    for (fs_mount_entry_t *e = mounts; e; e = e->next) {
+    for (fs_mount_entry_t *e = rcu_dereference(mounts); e; e = rcu_dereference(e->next)) {
         if (mount_paths_overlap(e->target, target) || mount_paths_overlap(target, e->target)) {
             return 1;
         }
@@ -65,9 +68,9 @@ int fs_mount_conflicts(const char *target) {
     if (!target || target[0] != '/') return 1;
 
     //keep mount points from overlapping or nesting
-    spinlock_acquire(&mount_lock);
+    rcu_read_lock();
     int rc = mount_conflicts_unlocked(target);
-    spinlock_release(&mount_lock);
+    rcu_read_unlock();
     return rc;
 }
 
@@ -94,7 +97,7 @@ int fs_mount_register(const char *target, fs_t *fs) {
     memcpy(entry->target, target, len + 1);
     entry->fs = fs;
     entry->next = mounts;
-    mounts = entry;
+    rcu_assign_pointer(mounts, entry);
     spinlock_release(&mount_lock);
 
     printf("[mount] mounted %s at %s\n", fs->name ? fs->name : "fs", target);
@@ -108,8 +111,8 @@ int fs_mount_resolve(const char *path, fs_t **fs_out, const char **fs_path_out)
     size best_len = 0;
 
     //pick the most specific mount that matches the path
-    spinlock_acquire(&mount_lock);
-    for (fs_mount_entry_t *e = mounts; e; e = e->next) {
+    rcu_read_lock();
+    for (fs_mount_entry_t *e = rcu_dereference(mounts); e; e = rcu_dereference(e->next)) {
         if (!mount_path_matches(e->target, path)) continue;
         size len = strlen(e->target);
         //deepest mount wins
@@ -118,7 +121,7 @@ int fs_mount_resolve(const char *path, fs_t **fs_out, const char **fs_path_out)
             best_len = len;
         }
     }
-    spinlock_release(&mount_lock);
+    rcu_read_unlock();
 
     if (!best) return 0;
 
@@ -136,3 +139,14 @@ int fs_mount_resolve(const char *path, fs_t **fs_out, const char **fs_path_out)
 
     return 1;
 }
+
+int fs_sync_all(void) {
+    int result = 0;
+    //sync may sleep on I/O so no RCU section, entries are never freed anyway
+    for (fs_mount_entry_t *e = rcu_dereference(mounts); e; e = rcu_dereference(e->next)) {
+        fs_t *fs = e->fs;
+        if (!fs->ops || !fs->ops->sync) continue;
+        if (fs->ops->sync(fs) < 0) result = -1;
+    }
+    return result;
+}
@@ -13,4 +13,8 @@ int fs_mount_resolve(const char *path, fs_t **fs_out, const char **fs_path_out);
 //check whether a mountpoint would overlap an existing mount
 int fs_mount_conflicts(const char *target);
 
+//push delayed metadata of every mounted filesystem into the block cache
+//returns 0 when all succeeded and negative otherwise
+int fs_sync_all(void);
+
 #endif
@@ -7,6 +7,7 @@
 #include <lib/io.h>
 #include <lib/spinlock.h>
 #include <drivers/rtc.h>
+#include <syscall/syscall.h>
 
 #define TMPFS_MAX_NAME 64
 #define TMPFS_INITIAL_BUF 256
@@ -57,7 +58,8 @@ typedef struct tmpfs_node {
 
 //root directory
 static tmpfs_node_t *root = NULL;
-static spinlock_t tmpfs_lock = {0};
+static spinlock_stats_t tmpfs_lock_stats = SPINLOCK_STATS_INIT("tmpfs");
+static spinlock_t tmpfs_lock = SPINLOCK_INIT_STATS(&tmpfs_lock_stats);
 
 //find child by name in directory
 static tmpfs_node_t *find_child(tmpfs_node_t *dir, const char *name) {
@@ -157,8 +159,8 @@ static tmpfs_node_t *resolve_path(const char *path, bool create_dirs, tmpfs_node
     return current;
 }
 
-//file object read
-static ssize tmpfs_file_read(object_t *obj, void *buf, size len, size offset) {
+//file object read, user buffers are filled straight from the node's data
+static ssize tmpfs_file_read_common(object_t *obj, void *buf, size len, size offset, bool user) {
     tmpfs_node_t *node = (tmpfs_node_t *)obj->data;
     if (!node || node->type != FS_TYPE_FILE) return -1;
     
@@ -170,13 +172,44 @@ static ssize tmpfs_file_read(object_t *obj, void *buf, size len, size offset) {
     
     size avail = node->file.size - offset;
     size to_read = len < avail ? len : avail;
-    memcpy(buf, node->file.data + offset, to_read);
+    ssize result = (ssize)to_read;
+    if (user) {
+        if (copy_to_user_bytes(buf, node->file.data + offset, to_read) != 0) result = -1;
+    } else {
+        memcpy(buf, node->file.data + offset, to_read);
+    }
     spinlock_release(&tmpfs_lock);
-    return to_read;
+    return result;
+}
+
+static ssize tmpfs_file_read(object_t *obj, void *buf, size len, size offset) {
+    return tmpfs_file_read_common(obj, buf, len, offset, false);
+}
+
+static ssize tmpfs_file_read_user(object_t *obj, void *ubuf, size len, size offset) {
+    return tmpfs_file_read_common(obj, ubuf, len, offset, true);
+}
+
+//grow the file buffer to hold end bytes (tmpfs_lock held)
+static int tmpfs_file_reserve(tmpfs_node_t *node, size end) {
+    if (end <= node->file.capacity) return 0;
+
+    size new_cap = node->file.capacity ? node->file.capacity : TMPFS_INITIAL_BUF;
+    while (new_cap < end) {
+        if (new_cap > SIZE_MAX / 2) { new_cap = SIZE_MAX; break; }
+        new_cap *= 2;
+    }
+    
+    uint8 *new_data = krealloc(node->file.data, new_cap);
+    if (!new_data) return -1;
+    
+    node->file.data = new_data;
+    node->file.capacity = new_cap;
+    return 0;
 }
 
 //file object write
-static ssize tmpfs_file_write(object_t *obj, const void *buf, size len, size offset) {
+static ssize tmpfs_file_write_common(object_t *obj, const void *buf, size len, size offset, bool user) {
     tmpfs_node_t *node = (tmpfs_node_t *)obj->data;
     if (!node || node->type != FS_TYPE_FILE) return -1;
     
@@ -188,30 +221,80 @@ static ssize tmpfs_file_write(object_t *obj, const void *buf, size len, size off
     }
     size end = offset + len;
     
-    if (end > node->file.capacity) {
-        size new_cap = node->file.capacity ? node->file.capacity : TMPFS_INITIAL_BUF;
-        while (new_cap < end) {
-            if (new_cap > SIZE_MAX / 2) { new_cap = SIZE_MAX; break; }
-            new_cap *= 2;
-        }
-        
-        uint8 *new_data = krealloc(node->file.data, new_cap);
-        if (!new_data) {
+    if (tmpfs_file_reserve(node, end) != 0) {
+        spinlock_release(&tmpfs_lock);
+        return -1;
+    }
+    
+    if (user) {
+        //the buffer may have grown but the file size only moves on success
+        if (copy_user_bytes(buf, node->file.data + offset, len) != 0) {
             spinlock_release(&tmpfs_lock);
             return -1;
         }
-        
-        node->file.data = new_data;
-        node->file.capacity = new_cap;
+    } else {
+        memcpy(node->file.data + offset, buf, len);
     }
-    
-    memcpy(node->file.data + offset, buf, len);
     if (end > node->file.size) node->file.size = end;
     
     spinlock_release(&tmpfs_lock);
     return len;
 }
 
+static ssize tmpfs_file_write(object_t *obj, const void *buf, size len, size offset) {
+    return tmpfs_file_write_common(obj, buf, len, offset, false);
+}
+
+static ssize tmpfs_file_write_user(object_t *obj, const void *ubuf, size len, size offset) {
+    return tmpfs_file_write_common(obj, ubuf, len, offset, true);
+}
+
+//scatter read, every segment comes from one snapshot of the file
+static ssize tmpfs_file_readv_user(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    tmpfs_node_t *node = (tmpfs_node_t *)obj->data;
+    if (!node || node->type != FS_TYPE_FILE) return -1;
+    
+    spinlock_acquire(&tmpfs_lock);
+    size total = 0;
+    for (uint32 i = 0; i < count && offset < node->file.size; i++) {
+        size avail = node->file.size - offset;
+        size n = iov[i].len < avail ? iov[i].len : avail;
+        if (copy_to_user_bytes(iov[i].base, node->file.data + offset, n) != 0) {
+            spinlock_release(&tmpfs_lock);
+            return total > 0 ? (ssize)total : -1;
+        }
+        offset += n;
+        total += n;
+    }
+    spinlock_release(&tmpfs_lock);
+    return (ssize)total;
+}
+
+//gather write, the buffer grows once for the whole request
+static ssize tmpfs_file_writev_user(object_t *obj, const io_vec_t *iov, uint32 count, size offset) {
+    tmpfs_node_t *node = (tmpfs_node_t *)obj->data;
+    if (!node || node->type != FS_TYPE_FILE) return -1;
+    
+    size len = 0;
+    for (uint32 i = 0; i < count; i++) len += iov[i].len;
+    
+    spinlock_acquire(&tmpfs_lock);
+    if (len > SIZE_MAX - offset || tmpfs_file_reserve(node, offset + len) != 0) {
+        spinlock_release(&tmpfs_lock);
+        return -1;
+    }
+    
+    size total = 0;
+    for (uint32 i = 0; i < count; i++) {
+        if (copy_user_bytes(iov[i].base, node->file.data + offset + total, iov[i].len) != 0) break;
+        total += iov[i].len;
+    }
+    if (offset + total > node->file.size) node->file.size = offset + total;
+    
+    spinlock_release(&tmpfs_lock);
+    return total > 0 ? (ssize)total : -1;
+}
+
 static int tmpfs_file_stat(object_t *obj, stat_t *st) {
     tmpfs_node_t *node = (tmpfs_node_t *)obj->data;
     if (!node || !st) return -1;
@@ -227,7 +310,11 @@ static object_ops_t tmpfs_file_ops = {
     .close = NULL,
     .readdir = NULL,
     .lookup = NULL,
-    .stat = tmpfs_file_stat
+    .stat = tmpfs_file_stat,
+    .read_user = tmpfs_file_read_user,
+    .write_user = tmpfs_file_write_user,
+    .readv_user = tmpfs_file_readv_user,
+    .writev_user = tmpfs_file_writev_user
 };
 
 //directory object readdir
@@ -491,6 +578,8 @@ static object_ops_t tmpfs_root_ops = {
 static object_t *tmpfs_root_obj = NULL;
 
 void tmpfs_init(void) {
+    spinlock_stats_register(&tmpfs_lock_stats);
+
     //create root directory
     root = kzalloc(sizeof(tmpfs_node_t));
     if (!root) {
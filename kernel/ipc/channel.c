@@ -1,12 +1,62 @@
 #include <ipc/channel.h>
 #include <proc/process.h>
+#include <proc/thread.h>
 #include <proc/event.h>
 #include <proc/bottom_half.h>
 #include <mm/kheap.h>
 #include <lib/string.h>
 #include <lib/io.h>
 #include <lib/spinlock.h>
+#include <arch/timer.h>
 #include <drivers/serial.h>
+#include <syscall/syscall.h>
+#include <errno.h>
+
+//internal send flags
+#define CHANNEL_SEND_HANDOFF    (1 << 0)    //wake the receiver onto this CPU first
+#define CHANNEL_SEND_BLOCK      (1 << 1)    //sleep while the peer's queue is full
+
+//free a queue entry together with any objects and loan it still holds
+static void channel_entry_free(channel_msg_entry_t *entry) {
+    if (entry->data) kfree(entry->data);
+    for (uint32 i = 0; i < entry->object_count; i++) {
+        if (entry->objects && entry->objects[i]) object_deref(entry->objects[i]);
+    }
+    if (entry->objects) kfree(entry->objects);
+    if (entry->rights) kfree(entry->rights);
+    if (entry->loan_obj) object_deref(entry->loan_obj);
+    kfree(entry);
+}
+
+//a channel_call caller waiting for the reply to txid
+typedef struct channel_call_wait {
+    uint32 txid;
+    channel_msg_entry_t *reply;     //set by the sender that claimed it
+    wait_queue_t wq;
+    struct channel_call_wait *next;
+} channel_call_wait_t;
+
+//hand entry to the caller on endpoint id waiting for it, called with ch->lock held
+//returns true when the entry was claimed as a reply and must not be queued
+static bool channel_call_claim(channel_t *ch, int id, channel_msg_entry_t *entry) {
+    if (!entry->is_reply || !ch->calls[id]) return false;
+
+    for (channel_call_wait_t **pp = &ch->calls[id]; *pp; pp = &(*pp)->next) {
+        channel_call_wait_t *w = *pp;
+        if (w->txid != entry->txid) continue;
+        *pp = w->next;
+        w->reply = entry;
+        //the caller is switched to directly, as the request was to the server
+        thread_wake_one_direct(&w->wq);
+        return true;
+    }
+    return false;
+}
+
+//wake every caller on endpoint id so it notices the close
+static void channel_call_wake_all(channel_t *ch, int id) {
+    for (channel_call_wait_t *w = ch->calls[id]; w; w = w->next) thread_wake_all(&w->wq);
+}
 
 static int channel_endpoint_close(object_t *obj) {
     channel_endpoint_t *ep = (channel_endpoint_t *)obj;
@@ -23,19 +73,16 @@ static int channel_endpoint_close(object_t *obj) {
     //wake any threads waiting on either end - their wait state is now invalid
     thread_wake_all(&ch->waiters[id]);
     thread_wake_all(&ch->waiters[1 - id]);
+    thread_wake_all(&ch->writers[id]);
+    thread_wake_all(&ch->writers[1 - id]);
+    channel_call_wake_all(ch, id);
+    channel_call_wake_all(ch, 1 - id);
 
     //free any pending messages in our queue
     channel_msg_entry_t *msg = ch->queue[id];
     while (msg) {
         channel_msg_entry_t *next = msg->next;
-        if (msg->data) kfree(msg->data);
-        //deref any pending objects
-        for (uint32 i = 0; i < msg->object_count; i++) {
-            if (msg->objects[i]) object_deref(msg->objects[i]);
-        }
-        if (msg->objects) kfree(msg->objects);
-        if (msg->rights) kfree(msg->rights);
-        kfree(msg);
+        channel_entry_free(msg);
         msg = next;
     }
     ch->queue[id] = NULL;
@@ -44,6 +91,10 @@ static int channel_endpoint_close(object_t *obj) {
 
     spinlock_irq_release(&ch->lock, flags);
 
+    //ports watching the peer learn it is now alone, ours lose their source
+    port_observers_signal(&ch->endpoints[1 - id].observers, PORT_SIGNAL_PEER_CLOSED);
+    port_observers_detach(&ep->observers);
+
     //decrement the channel's own lifetime refcount; free only when both endpoints are gone
     //ch_refcount is decremented atomically outside the channel lock to avoid
     //holding the lock across kfree
@@ -89,8 +140,10 @@ int channel_create(process_t *proc, handle_rights_t rights,
         ch->queue[i]      = NULL;
         ch->queue_tail[i] = NULL;
         ch->queue_len[i]  = 0;
+        ch->queue_depth[i] = CHANNEL_MSG_QUEUE_SIZE;
         ch->closed[i]     = 0;
         wait_queue_init(&ch->waiters[i]);
+        wait_queue_init(&ch->writers[i]);
     }
     spinlock_irq_init(&ch->lock);
 
@@ -130,7 +183,9 @@ channel_endpoint_t *channel_get_endpoint(process_t *proc, int32 handle) {
     return (channel_endpoint_t *)obj;
 }
 
-int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
+//flags are CHANNEL_SEND_*, deadline only applies with CHANNEL_SEND_BLOCK
+static int channel_send_common(process_t *proc, int32 endpoint_handle, channel_msg_t *msg,
+                               uint32 send_flags, uint64 deadline) {
     if (!proc || !msg) return -1;
     if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_WRITE)) {
         return -8;
@@ -167,6 +222,8 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
 
     //record sender PID
     entry->sender_pid = proc->pid;
+    entry->txid = msg->txid;
+    entry->is_reply = msg->is_reply && msg->txid != 0;
 
     //transfer handles (MOVE semantics)
     if (msg->handle_count > 0 && msg->handles) {
@@ -218,36 +275,62 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
 
     //lock for queue manipulation
     irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    bool claimed = false;
+
+    for (;;) {
+        //check if peer is closed
+        if (ch->closed[peer_id]) {
+            spinlock_irq_release(&ch->lock, flags);
+            channel_entry_free(entry);
+            return -2;  //peer closed
+        }
+
+        //a reply goes straight to its caller and never takes a queue slot
+        if (channel_call_claim(ch, peer_id, entry)) {
+            claimed = true;
+            break;
+        }
+
+        //check queue limit
+        if (ch->queue_len[peer_id] < ch->queue_depth[peer_id]) break;
+
+        bool expired = deadline && arch_timer_get_ticks() >= deadline;
+        if (!(send_flags & CHANNEL_SEND_BLOCK) || expired) {
+            spinlock_irq_release(&ch->lock, flags);
+            channel_entry_free(entry);
+            return -3;  //queue full
+        }
 
-    //check if peer is closed
-    if (ch->closed[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
-        //cleanup the entry we built
-        if (entry->data) kfree(entry->data);
-        if (entry->objects) {
-            for (uint32 i = 0; i < entry->object_count; i++) {
-                if (entry->objects[i]) object_deref(entry->objects[i]);
-            }
-            kfree(entry->objects);
+        if (proc_current_should_abort_blocking()) {
+            channel_entry_free(entry);
+            return -3;  //interrupted by process event
         }
-        if (entry->rights) kfree(entry->rights);
-        kfree(entry);
-        return -2;  //peer closed
+        flags = spinlock_irq_acquire(&ch->lock);
+
+        //recheck under the lock, a receiver may have made room meanwhile
+        if (ch->closed[peer_id] || ch->queue_len[peer_id] < ch->queue_depth[peer_id]) continue;
+
+        //a timeout just loops back and reports the queue as full
+        thread_sleep_locked_irq_timeout(&ch->writers[peer_id], &ch->lock, &flags, deadline);
     }
 
-    //check queue limit
-    if (ch->queue_len[peer_id] >= CHANNEL_MSG_QUEUE_SIZE) {
+    //the loan travels with the entry from here on
+    entry->loan_obj = msg->loan_obj;
+    entry->loan_offset = msg->loan_offset;
+    entry->loan_len = msg->loan_len;
+    entry->loan_flags = msg->loan_flags;
+    msg->loan_obj = NULL;
+
+    //the caller can't look at the reply before we drop the lock
+    if (claimed) {
         spinlock_irq_release(&ch->lock, flags);
-        if (entry->data) kfree(entry->data);
-        if (entry->objects) {
-            for (uint32 i = 0; i < entry->object_count; i++) {
-                if (entry->objects[i]) object_deref(entry->objects[i]);
+        if (msg->handle_count > 0 && msg->handles) {
+            for (uint32 i = 0; i < msg->handle_count; i++) {
+                process_close_handle(proc, msg->handles[i]);
             }
-            kfree(entry->objects);
         }
-        if (entry->rights) kfree(entry->rights);
-        kfree(entry);
-        return -3;  //queue full
+        return 0;
     }
 
     //enqueue message to peer's queue
@@ -261,7 +344,8 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
     ch->queue_len[peer_id]++;
 
     //wake any thread waiting for a message on this endpoint
-    thread_wake_one(&ch->waiters[peer_id]);
+    if (send_flags & CHANNEL_SEND_HANDOFF) thread_wake_one_direct(&ch->waiters[peer_id]);
+    else thread_wake_one(&ch->waiters[peer_id]);
 
     //if peer has a handler registered, call it immediately (synchronous dispatch)
     channel_endpoint_t *peer_ep = &ch->endpoints[peer_id];
@@ -278,6 +362,7 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
             handler_msg.data = e->data;
             handler_msg.data_len = e->data_len;
             handler_msg.sender_pid = e->sender_pid;
+            handler_msg.txid = e->txid;
             handler_msg.handles = NULL;  //not used for kernel handlers
             handler_msg.handle_count = 0;
 
@@ -286,6 +371,12 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
             handler_msg.rights = e->rights;
             handler_msg.object_count = e->object_count;
 
+            //the loan too, a handler that keeps it clears loan_obj
+            handler_msg.loan_obj = e->loan_obj;
+            handler_msg.loan_offset = e->loan_offset;
+            handler_msg.loan_len = e->loan_len;
+            handler_msg.loan_flags = e->loan_flags;
+
             e->data = NULL;     //handler takes ownership
             e->objects = NULL;  //don't free - handler owns them now
             e->rights = NULL;
@@ -302,12 +393,16 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
 
             //call handler outside the lock (handler may do its own locking)
             peer_ep->handler(peer_ep, &handler_msg, peer_ep->handler_ctx);
+            channel_msg_drop_loan(&handler_msg);
             return 0;
         }
     }
 
     spinlock_irq_release(&ch->lock, flags);
 
+    //signalled outside the channel lock, port_bind samples the level under it
+    port_observers_signal(&peer_ep->observers, PORT_SIGNAL_READABLE);
+
     //send is committed - now safe to remove sender's handles (MOVE semantics)
     if (msg->handle_count > 0 && msg->handles) {
         for (uint32 i = 0; i < msg->handle_count; i++) {
@@ -318,8 +413,18 @@ int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
     return 0;
 }
 
-int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
-    if (!proc || !msg) return -1;
+int channel_send(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
+    return channel_send_common(proc, endpoint_handle, msg, 0, 0);
+}
+
+int channel_send_blocking(process_t *proc, int32 endpoint_handle, channel_msg_t *msg,
+                          uint64 deadline) {
+    return channel_send_common(proc, endpoint_handle, msg, CHANNEL_SEND_BLOCK, deadline);
+}
+
+int channel_set_queue_depth(process_t *proc, int32 endpoint_handle, uint32 depth) {
+    if (!proc) return -1;
+    if (depth == 0 || depth > CHANNEL_MAX_QUEUE_DEPTH) return -2;
     if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_READ)) {
         return -4;
     }
@@ -330,54 +435,29 @@ int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
     channel_t *ch = ep->channel;
     int my_id = ep->endpoint_id;
 
-    //wait for a message (blocking)
     irq_state_t flags = spinlock_irq_acquire(&ch->lock);
-    while (!ch->queue[my_id]) {
-        //check if peer closed
-        if (ch->closed[1 - my_id]) {
-            spinlock_irq_release(&ch->lock, flags);
-            return -2;  //peer closed, no more messages
-        }
-        
-        spinlock_irq_release(&ch->lock, flags);
-        bottom_half_run_budget(16);
-        if (proc_current_should_abort_blocking()) {
-            return -3;  //interrupted by process event
-        }
-        flags = spinlock_irq_acquire(&ch->lock);
-
-        if (ch->queue[my_id]) {
-            break;
-        }
-        if (ch->closed[1 - my_id]) {
-            spinlock_irq_release(&ch->lock, flags);
-            return -2;
-        }
-
-        //atomically release channel lock + sleep to avoid missed wakeups
-        thread_sleep_locked_irq(&ch->waiters[my_id], &ch->lock, &flags);
-
-        //if peer closed while we were sleeping, return error
-        if (ch->closed[1 - my_id] && !ch->queue[my_id]) {
-            spinlock_irq_release(&ch->lock, flags);
-            return -2;
-        }
-    }
-
-    //dequeue message
-    channel_msg_entry_t *entry = ch->queue[my_id];
-    ch->queue[my_id] = entry->next;
-    if (!ch->queue[my_id]) {
-        ch->queue_tail[my_id] = NULL;
-    }
-    ch->queue_len[my_id]--;
+    ch->queue_depth[my_id] = depth;
+    //a deeper queue may have room for senders that are already asleep
+    if (ch->queue_len[my_id] < depth) thread_wake_all(&ch->writers[my_id]);
     spinlock_irq_release(&ch->lock, flags);
 
+    return 0;
+}
+
+//hand a dequeued entry to msg, granting its handles to proc
+//the entry is consumed, on failure nothing is left for the caller to free
+static int channel_entry_deliver(process_t *proc, channel_msg_entry_t *entry, channel_msg_t *msg) {
     //copy data to caller (outside lock - entry is ours now)
     msg->data = entry->data;  //caller takes ownership
     msg->data_len = entry->data_len;
     msg->sender_pid = entry->sender_pid;
+    msg->txid = entry->txid;
+    msg->is_reply = entry->is_reply;
     entry->data = NULL;  //don't free it
+    msg->loan_obj = entry->loan_obj;  //caller takes the loan ref as well
+    msg->loan_offset = entry->loan_offset;
+    msg->loan_len = entry->loan_len;
+    msg->loan_flags = entry->loan_flags;
 
     //grant handles to receiver
     if (entry->object_count > 0) {
@@ -390,6 +470,11 @@ int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
             kfree(entry->objects);
             kfree(entry->rights);
             kfree(entry);
+            //free the payload we already handed to the caller
+            if (msg->data) kfree(msg->data);
+            msg->data = NULL;
+            msg->data_len = 0;
+            channel_msg_drop_loan(msg);
             return -1;
         }
         msg->handle_count = entry->object_count;
@@ -412,6 +497,7 @@ int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
                 if (msg->data) kfree(msg->data);
                 msg->data = NULL;
                 msg->data_len = 0;
+                channel_msg_drop_loan(msg);
                 kfree(entry->objects);
                 kfree(entry->rights);
                 kfree(entry);
@@ -432,6 +518,134 @@ int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
     return 0;
 }
 
+int channel_call(process_t *proc, int32 endpoint_handle, channel_msg_t *request,
+                 channel_msg_t *reply) {
+    if (!proc || !request || !reply) return -1;
+    if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_READ)) {
+        return -8;
+    }
+
+    channel_endpoint_t *ep = channel_get_endpoint(proc, endpoint_handle);
+    if (!ep) return -1;
+
+    channel_t *ch = ep->channel;
+    int my_id = ep->endpoint_id;
+
+    channel_call_wait_t wait;
+    memset(&wait, 0, sizeof(wait));
+    wait_queue_init(&wait.wq);
+
+    //registered before the send so a fast reply can't end up in the queue
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    do {
+        wait.txid = ++ch->next_txid;
+    } while (!wait.txid);
+    wait.next = ch->calls[my_id];
+    ch->calls[my_id] = &wait;
+    spinlock_irq_release(&ch->lock, flags);
+
+    request->txid = wait.txid;
+    request->is_reply = false;
+
+    //a server blocked in recv now sits at the head of our run queue, so the
+    //sleep below switches straight to it and it runs out our time slice
+    int rc = channel_send_common(proc, endpoint_handle, request, CHANNEL_SEND_HANDOFF, 0);
+
+    flags = spinlock_irq_acquire(&ch->lock);
+    while (rc == 0 && !wait.reply) {
+        if (ch->closed[my_id] || ch->closed[1 - my_id]) {
+            rc = -2;
+            break;
+        }
+
+        spinlock_irq_release(&ch->lock, flags);
+        bottom_half_run_budget(16);
+        bool abort = proc_current_should_abort_blocking();
+        flags = spinlock_irq_acquire(&ch->lock);
+
+        if (wait.reply) break;
+        if (abort) {
+            rc = -3;  //interrupted by process event
+            break;
+        }
+        if (ch->closed[my_id] || ch->closed[1 - my_id]) continue;
+        thread_sleep_locked_irq(&wait.wq, &ch->lock, &flags);
+    }
+
+    //an unanswered call leaves the list, a late reply is then queued normally
+    if (!wait.reply) {
+        for (channel_call_wait_t **pp = &ch->calls[my_id]; *pp; pp = &(*pp)->next) {
+            if (*pp == &wait) {
+                *pp = wait.next;
+                break;
+            }
+        }
+    }
+    spinlock_irq_release(&ch->lock, flags);
+
+    if (!wait.reply) return rc;
+    return channel_entry_deliver(proc, wait.reply, reply);
+}
+
+int channel_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
+    if (!proc || !msg) return -1;
+    if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_READ)) {
+        return -4;
+    }
+
+    channel_endpoint_t *ep = channel_get_endpoint(proc, endpoint_handle);
+    if (!ep) return -1;
+
+    channel_t *ch = ep->channel;
+    int my_id = ep->endpoint_id;
+
+    //wait for a message (blocking)
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    while (!ch->queue[my_id]) {
+        //check if peer closed
+        if (ch->closed[1 - my_id]) {
+            spinlock_irq_release(&ch->lock, flags);
+            return -2;  //peer closed, no more messages
+        }
+        
+        spinlock_irq_release(&ch->lock, flags);
+        bottom_half_run_budget(16);
+        if (proc_current_should_abort_blocking()) {
+            return -3;  //interrupted by process event
+        }
+        flags = spinlock_irq_acquire(&ch->lock);
+
+        if (ch->queue[my_id]) {
+            break;
+        }
+        if (ch->closed[1 - my_id]) {
+            spinlock_irq_release(&ch->lock, flags);
+            return -2;
+        }
+
+        //atomically release channel lock + sleep to avoid missed wakeups
+        thread_sleep_locked_irq(&ch->waiters[my_id], &ch->lock, &flags);
+
+        //if peer closed while we were sleeping, return error
+        if (ch->closed[1 - my_id] && !ch->queue[my_id]) {
+            spinlock_irq_release(&ch->lock, flags);
+            return -2;
+        }
+    }
+
+    //dequeue message
+    channel_msg_entry_t *entry = ch->queue[my_id];
+    ch->queue[my_id] = entry->next;
+    if (!ch->queue[my_id]) {
+        ch->queue_tail[my_id] = NULL;
+    }
+    ch->queue_len[my_id]--;
+    thread_wake_one(&ch->writers[my_id]);
+    spinlock_irq_release(&ch->lock, flags);
+
+    return channel_entry_deliver(proc, entry, msg);
+}
+
 int channel_try_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
     if (!proc || !msg) return -1;
     if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_READ)) {
@@ -464,69 +678,239 @@ int channel_try_recv(process_t *proc, int32 endpoint_handle, channel_msg_t *msg)
         ch->queue_tail[my_id] = NULL;
     }
     ch->queue_len[my_id]--;
+    thread_wake_one(&ch->writers[my_id]);
     spinlock_irq_release(&ch->lock, flags);
 
-    //copy data to caller (outside lock - entry is ours now)
-    msg->data = entry->data;  //caller takes ownership
-    msg->data_len = entry->data_len;
-    msg->sender_pid = entry->sender_pid;
-    entry->data = NULL;  //don't free it
+    return channel_entry_deliver(proc, entry, msg);
+}
 
-    //grant handles to receiver
-    if (entry->object_count > 0) {
-        msg->handles = kzalloc(entry->object_count * sizeof(int32));
-        if (!msg->handles) {
-            //cleanup objects
-            for (uint32 i = 0; i < entry->object_count; i++) {
-                if (entry->objects[i]) object_deref(entry->objects[i]);
-            }
-            kfree(entry->objects);
-            kfree(entry->rights);
+int channel_requeue(process_t *proc, int32 endpoint_handle, channel_msg_t *msg) {
+    if (!proc || !msg) return -1;
+
+    channel_endpoint_t *ep = channel_get_endpoint(proc, endpoint_handle);
+    if (!ep) return -1;
+
+    channel_t *ch = ep->channel;
+    int my_id = ep->endpoint_id;
+
+    channel_msg_entry_t *entry = kzalloc(sizeof(channel_msg_entry_t));
+    if (!entry) return -1;
+
+    //take the objects back out of the handles delivery granted
+    if (msg->handle_count > 0 && msg->handles) {
+        entry->objects = kzalloc(msg->handle_count * sizeof(object_t *));
+        entry->rights = kzalloc(msg->handle_count * sizeof(handle_rights_t));
+        if (!entry->objects || !entry->rights) {
+            if (entry->objects) kfree(entry->objects);
+            if (entry->rights) kfree(entry->rights);
             kfree(entry);
-            //free the payload we already handed to the caller
-            if (msg->data) kfree(msg->data);
-            msg->data = NULL;
-            msg->data_len = 0;
             return -1;
         }
-        msg->handle_count = entry->object_count;
+        //another thread may already have closed one, skip it
+        for (uint32 i = 0; i < msg->handle_count; i++) {
+            proc_handle_t *he = process_get_handle_entry(proc, msg->handles[i]);
+            if (!he) continue;
+            entry->objects[entry->object_count] = he->obj;
+            entry->rights[entry->object_count] = he->rights;
+            entry->object_count++;
+            object_ref(he->obj);
+        }
+        for (uint32 i = 0; i < msg->handle_count; i++) {
+            process_close_handle(proc, msg->handles[i]);
+        }
+        kfree(msg->handles);
+        msg->handles = NULL;
+        msg->handle_count = 0;
+    }
 
-        for (uint32 i = 0; i < entry->object_count; i++) {
-            int h = process_grant_handle(proc, entry->objects[i], entry->rights[i]);
-            if (h < 0) {
-                //partial failure close already-granted handles
-                for (uint32 j = 0; j < i; j++) {
-                    process_close_handle(proc, msg->handles[j]);
-                }
-                //deref remaining objects
-                for (uint32 j = i; j < entry->object_count; j++) {
-                    if (entry->objects[j]) object_deref(entry->objects[j]);
+    entry->data = msg->data;
+    entry->data_len = msg->data_len;
+    entry->sender_pid = msg->sender_pid;
+    entry->txid = msg->txid;
+    entry->is_reply = msg->is_reply;
+    entry->loan_obj = msg->loan_obj;
+    entry->loan_offset = msg->loan_offset;
+    entry->loan_len = msg->loan_len;
+    entry->loan_flags = msg->loan_flags;
+    msg->data = NULL;
+    msg->data_len = 0;
+    msg->loan_obj = NULL;
+
+    //the slot it left is ours to take back, even if a sender refilled the queue
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    entry->next = ch->queue[my_id];
+    ch->queue[my_id] = entry;
+    if (!ch->queue_tail[my_id]) ch->queue_tail[my_id] = entry;
+    ch->queue_len[my_id]++;
+    thread_wake_one(&ch->waiters[my_id]);
+    spinlock_irq_release(&ch->lock, flags);
+
+    return 0;
+}
+
+int channel_send_batch(process_t *proc, int32 endpoint_handle, const channel_iov_t *iov,
+                       uint32 count) {
+    if (!proc || (!iov && count > 0)) return -1;
+    if (count > CHANNEL_MAX_BATCH) return -5;
+    if (count == 0) return 0;
+    if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_WRITE)) {
+        return -8;
+    }
+
+    channel_endpoint_t *ep = channel_get_endpoint(proc, endpoint_handle);
+    if (!ep) return -1;
+
+    channel_t *ch = ep->channel;
+    int peer_id = 1 - ep->endpoint_id;
+    channel_endpoint_t *peer_ep = &ch->endpoints[peer_id];
+
+    //kernel handlers consume each message synchronously, nothing to batch
+    if (peer_ep->handler) {
+        uint32 sent = 0;
+        for (; sent < count; sent++) {
+            if (iov[sent].len > CHANNEL_MAX_MSG_SIZE) return sent ? (int)sent : -4;
+            channel_msg_t msg;
+            memset(&msg, 0, sizeof(msg));
+            if (iov[sent].len > 0) {
+                msg.data = kmalloc(iov[sent].len);
+                if (!msg.data) return sent ? (int)sent : -1;
+                if (copy_user_bytes(iov[sent].data, msg.data, iov[sent].len) != 0) {
+                    kfree(msg.data);
+                    return sent ? (int)sent : -EFAULT;
                 }
-                kfree(msg->handles);
-                msg->handles = NULL;
-                msg->handle_count = 0;
-                //free the payload we already handed to the caller
-                if (msg->data) kfree(msg->data);
-                msg->data = NULL;
-                msg->data_len = 0;
-                kfree(entry->objects);
-                kfree(entry->rights);
+            }
+            msg.data_len = iov[sent].len;
+            int rc = channel_send(proc, endpoint_handle, &msg);
+            if (msg.data) kfree(msg.data);
+            if (rc != 0) return sent ? (int)sent : rc;
+        }
+        return (int)sent;
+    }
+
+    //build every entry up front so the lock is only held to link them
+    channel_msg_entry_t *entries[CHANNEL_MAX_BATCH];
+    for (uint32 i = 0; i < count; i++) {
+        if (iov[i].len > CHANNEL_MAX_MSG_SIZE || (!iov[i].data && iov[i].len > 0)) {
+            for (uint32 j = 0; j < i; j++) channel_entry_free(entries[j]);
+            return iov[i].len > CHANNEL_MAX_MSG_SIZE ? -4 : -1;
+        }
+
+        channel_msg_entry_t *entry = kzalloc(sizeof(channel_msg_entry_t));
+        if (entry && iov[i].len > 0) {
+            entry->data = kmalloc(iov[i].len);
+            if (entry->data && copy_user_bytes(iov[i].data, entry->data, iov[i].len) != 0) {
+                for (uint32 j = 0; j < i; j++) channel_entry_free(entries[j]);
+                kfree(entry->data);
                 kfree(entry);
-                return -1;
+                return -EFAULT;
             }
-            msg->handles[i] = h;
-            object_deref(entry->objects[i]);  //grant added ref sp we remove ours
+            if (entry->data) {
+                entry->data_len = iov[i].len;
+            } else {
+                kfree(entry);
+                entry = NULL;
+            }
+        }
+        if (!entry) {
+            for (uint32 j = 0; j < i; j++) channel_entry_free(entries[j]);
+            return -1;
         }
+        entry->sender_pid = proc->pid;
+        entries[i] = entry;
+    }
 
-        kfree(entry->objects);
-        kfree(entry->rights);
-    } else {
-        msg->handles = NULL;
-        msg->handle_count = 0;
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+
+    if (ch->closed[peer_id]) {
+        spinlock_irq_release(&ch->lock, flags);
+        for (uint32 i = 0; i < count; i++) channel_entry_free(entries[i]);
+        return -2;  //peer closed
     }
 
-    kfree(entry);
-    return 0;
+    uint32 room = ch->queue_len[peer_id] < ch->queue_depth[peer_id]
+                ? ch->queue_depth[peer_id] - ch->queue_len[peer_id] : 0;
+    uint32 sent = 0;
+    uint32 queued = 0;
+
+    for (; sent < count; sent++) {
+        channel_msg_entry_t *entry = entries[sent];
+        if (queued == room) break;
+        entry->next = NULL;
+        if (ch->queue_tail[peer_id]) {
+            ch->queue_tail[peer_id]->next = entry;
+        } else {
+            ch->queue[peer_id] = entry;
+        }
+        ch->queue_tail[peer_id] = entry;
+        queued++;
+        thread_wake_one(&ch->waiters[peer_id]);
+    }
+    ch->queue_len[peer_id] += queued;
+
+    spinlock_irq_release(&ch->lock, flags);
+
+    for (uint32 i = sent; i < count; i++) channel_entry_free(entries[i]);
+    if (sent == 0) return -3;  //queue full
+
+    if (queued) port_observers_signal(&peer_ep->observers, PORT_SIGNAL_READABLE);
+    return (int)sent;
+}
+
+int channel_recv_batch(process_t *proc, int32 endpoint_handle, channel_msg_t *msgs,
+                       uint32 max, bool block) {
+    if (!proc || !msgs || max == 0) return -1;
+    if (max > CHANNEL_MAX_BATCH) max = CHANNEL_MAX_BATCH;
+
+    uint32 got = 0;
+    if (block) {
+        //the blocking path already knows how to sleep, then we drain the rest
+        int rc = channel_recv(proc, endpoint_handle, &msgs[0]);
+        if (rc != 0) return rc;
+        got = 1;
+    } else if (!process_handle_has_rights(proc, endpoint_handle, HANDLE_RIGHT_READ)) {
+        return -4;
+    }
+
+    channel_endpoint_t *ep = channel_get_endpoint(proc, endpoint_handle);
+    if (!ep) return got ? (int)got : -1;
+
+    channel_t *ch = ep->channel;
+    int my_id = ep->endpoint_id;
+
+    channel_msg_entry_t *entries[CHANNEL_MAX_BATCH];
+    uint32 taken = 0;
+
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    while (got + taken < max && ch->queue[my_id]) {
+        channel_msg_entry_t *entry = ch->queue[my_id];
+        ch->queue[my_id] = entry->next;
+        entries[taken++] = entry;
+        thread_wake_one(&ch->writers[my_id]);
+    }
+    if (!ch->queue[my_id]) ch->queue_tail[my_id] = NULL;
+    ch->queue_len[my_id] -= taken;
+    bool peer_closed = ch->closed[1 - my_id];
+    spinlock_irq_release(&ch->lock, flags);
+
+    if (got + taken == 0) return peer_closed ? -2 : -3;
+
+    for (uint32 i = 0; i < taken; i++) {
+        memset(&msgs[got], 0, sizeof(channel_msg_t));
+        if (channel_entry_deliver(proc, entries[i], &msgs[got]) != 0) {
+            //the failed entry is gone, later ones are dropped too so order is kept
+            for (uint32 j = i + 1; j < taken; j++) channel_entry_free(entries[j]);
+            return got ? (int)got : -1;
+        }
+        got++;
+    }
+    return (int)got;
+}
+
+void channel_msg_drop_loan(channel_msg_t *msg) {
+    if (!msg || !msg->loan_obj) return;
+    object_deref(msg->loan_obj);
+    msg->loan_obj = NULL;
+    msg->loan_len = 0;
 }
 
 int channel_close(process_t *proc, int32 endpoint_handle) {
@@ -544,6 +928,20 @@ int channel_peer_closed(process_t *proc, int32 endpoint_handle) {
     return ch->closed[peer_id];
 }
 
+port_observers_t *channel_port_observers(channel_endpoint_t *ep, uint32 *level) {
+    channel_t *ch = ep->channel;
+    int id = ep->endpoint_id;
+
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    uint32 l = 0;
+    if (ch->queue[id]) l |= PORT_SIGNAL_READABLE;
+    if (ch->closed[1 - id]) l |= PORT_SIGNAL_PEER_CLOSED;
+    spinlock_irq_release(&ch->lock, flags);
+
+    *level = l;
+    return &ep->observers;
+}
+
 //channel server functions (for kernel-side handlers)
 void channel_set_handler(channel_endpoint_t *ep,
                          void (*handler)(channel_endpoint_t *, channel_msg_t *, void *),
@@ -559,7 +957,7 @@ void channel_clear_handler(channel_endpoint_t *ep) {
     ep->handler_ctx = NULL;
 }
 
-int channel_reply(channel_endpoint_t *ep, channel_msg_t *msg) {
+int channel_reply(channel_endpoint_t *ep, const channel_msg_t *request, channel_msg_t *msg) {
     if (!ep || !msg) return -1;
 
     channel_t *ch = ep->channel;
@@ -610,19 +1008,24 @@ int channel_reply(channel_endpoint_t *ep, channel_msg_t *msg) {
     //check if peer is closed
     if (ch->closed[peer_id]) {
         spinlock_irq_release(&ch->lock, flags);
-        //cleanup
-        if (entry->data) kfree(entry->data);
-        if (entry->objects) {
-            for (uint32 i = 0; i < entry->object_count; i++) {
-                if (entry->objects[i]) object_deref(entry->objects[i]);
-            }
-            kfree(entry->objects);
-        }
-        if (entry->rights) kfree(entry->rights);
-        kfree(entry);
+        channel_entry_free(entry);
         return -2;
     }
 
+    entry->loan_obj = msg->loan_obj;
+    entry->loan_offset = msg->loan_offset;
+    entry->loan_len = msg->loan_len;
+    entry->loan_flags = msg->loan_flags;
+    msg->loan_obj = NULL;
+
+    //a caller blocked in channel_call on this request takes the reply directly
+    entry->txid = request ? request->txid : 0;
+    entry->is_reply = entry->txid != 0;
+    if (channel_call_claim(ch, peer_id, entry)) {
+        spinlock_irq_release(&ch->lock, flags);
+        return 0;
+    }
+
     //enqueue to peer
     entry->next = NULL;
     if (ch->queue_tail[peer_id]) {
@@ -635,5 +1038,48 @@ int channel_reply(channel_endpoint_t *ep, channel_msg_t *msg) {
 
     spinlock_irq_release(&ch->lock, flags);
 
+    port_observers_signal(&ch->endpoints[peer_id].observers, PORT_SIGNAL_READABLE);
+
+    return 0;
+}
+
+int channel_post(channel_endpoint_t *ep, const void *data, size len) {
+    if (!ep || (len > 0 && !data) || len > CHANNEL_MAX_MSG_SIZE) return -1;
+
+    channel_t *ch = ep->channel;
+    int peer_id = 1 - ep->endpoint_id;
+
+    channel_msg_entry_t *entry = kzalloc(sizeof(channel_msg_entry_t));
+    if (!entry) return -1;
+    if (len > 0) {
+        entry->data = kmalloc(len);
+        if (!entry->data) {
+            kfree(entry);
+            return -1;
+        }
+        memcpy(entry->data, data, len);
+        entry->data_len = len;
+    }
+
+    irq_state_t flags = spinlock_irq_acquire(&ch->lock);
+    int err = ch->closed[peer_id] ? -2 :
+              ch->queue_len[peer_id] >= ch->queue_depth[peer_id] ? -3 : 0;
+    if (err) {
+        spinlock_irq_release(&ch->lock, flags);
+        channel_entry_free(entry);
+        return err;
+    }
+
+    if (ch->queue_tail[peer_id]) {
+        ch->queue_tail[peer_id]->next = entry;
+    } else {
+        ch->queue[peer_id] = entry;
+    }
+    ch->queue_tail[peer_id] = entry;
+    ch->queue_len[peer_id]++;
+    thread_wake_one(&ch->waiters[peer_id]);
+    spinlock_irq_release(&ch->lock, flags);
+
+    port_observers_signal(&ch->endpoints[peer_id].observers, PORT_SIGNAL_READABLE);
     return 0;
 }
@@ -6,6 +6,7 @@
 #include <obj/rights.h>
 #include <proc/wait.h>
 #include <lib/spinlock.h>
+#include <ipc/port.h>
 
 /*
  *channels - fuchsia-style (zircon) IPC primitive
@@ -18,11 +19,19 @@
 
 #define CHANNEL_MAX_MSG_SIZE    4096
 #define CHANNEL_MAX_MSG_HANDLES 64
-#define CHANNEL_MSG_QUEUE_SIZE  16
+#define CHANNEL_MSG_QUEUE_SIZE  16      //default queue depth per endpoint
+#define CHANNEL_MAX_QUEUE_DEPTH 1024
+#define CHANNEL_MAX_BATCH       64      //messages per batched send or recv
+
+//a message may also lend a page-aligned VMO range instead of copying it
+//the receiver maps the same frames, so the loan is not bound by CHANNEL_MAX_MSG_SIZE
+#define CHANNEL_MAX_LOAN_SIZE   (64 * 1024 * 1024)
+#define CHANNEL_LOAN_WRITE      (1 << 0)    //receiver may map the loan writable
 
 //forward declarations
 struct process;
 struct channel;
+struct channel_call_wait;
 
 //message structure (for sending/receiving)
 typedef struct channel_msg {
@@ -31,13 +40,28 @@ typedef struct channel_msg {
     int32 *handles;          //array of handles to transfer (for userspace)
     uint32 handle_count;     //number of handles
     uint32 sender_pid;       //PID of the process that sent this message (0 if kernel)
+    uint32 txid;             //channel_call transaction this belongs to (0 if none)
+    bool is_reply;           //answers the caller waiting on txid
     
     //kernel-side: raw objects for kernel handlers (not for userspace)
     struct object **objects; //transferred objects (with +1 ref)
     handle_rights_t *rights; //rights for each object
     uint32 object_count;
+
+    //kernel-side: loaned VMO range (with +1 ref), NULL if the message carries none
+    //channel_send clears loan_obj once the loan is queued
+    struct object *loan_obj;
+    size loan_offset;
+    size loan_len;
+    uint32 loan_flags;
 } channel_msg_t;
 
+//one message of a batched send, data only
+typedef struct channel_iov {
+    const void *data;
+    size len;
+} channel_iov_t;
+
 //internal message queue entry
 typedef struct channel_msg_entry {
     void *data; //allocated copy of message data
@@ -46,6 +70,12 @@ typedef struct channel_msg_entry {
     handle_rights_t *rights; //rights for each transferred object
     uint32 object_count;
     uint32 sender_pid; //PID of the sending process
+    uint32 txid; //channel_call transaction (0 if none)
+    bool is_reply; //claimed by the caller waiting on txid instead of queued
+    object_t *loan_obj; //loaned VMO (with +1 ref) or NULL
+    size loan_offset;
+    size loan_len;
+    uint32 loan_flags;
     struct channel_msg_entry *next;
 } channel_msg_entry_t;
 
@@ -58,6 +88,9 @@ typedef struct channel_endpoint {
     //kernel-side handler (for driver/service endpoints)
     void (*handler)(struct channel_endpoint *ep, struct channel_msg *msg, void *ctx);
     void *handler_ctx;
+
+    //ports watching this endpoint
+    port_observers_t observers;
 } channel_endpoint_t;
 
 //channel (connects two endpoints)
@@ -68,9 +101,17 @@ typedef struct channel {
     channel_msg_entry_t *queue[2]; //head of each queue
     channel_msg_entry_t *queue_tail[2]; //tail for appending
     uint32 queue_len[2]; //current queue length
+    uint32 queue_depth[2]; //messages allowed in each queue before senders block or fail
     
     //wait queues (threads waiting for messages on each endpoint)
     wait_queue_t waiters[2];
+
+    //senders sleeping until queue[i] has room
+    wait_queue_t writers[2];
+
+    //channel_call callers on endpoint i still waiting for their reply
+    struct channel_call_wait *calls[2];
+    uint32 next_txid;
     
     //state
     int closed[2]; //1 if endpoint is closed
@@ -95,6 +136,27 @@ int channel_create(struct process *proc,
 //handles listed in msg are MOVED from sender (removed from their table)
 int channel_send(struct process *proc, int32 endpoint_handle, channel_msg_t *msg);
 
+//like channel_send but sleeps while the peer's queue is full
+//deadline is an absolute tick count, 0 waits forever
+//returns -3 if the queue is still full at the deadline or the wait is interrupted
+int channel_send_blocking(struct process *proc, int32 endpoint_handle, channel_msg_t *msg,
+                          uint64 deadline);
+
+//set how many messages may queue up for this endpoint (1..CHANNEL_MAX_QUEUE_DEPTH)
+//needs READ on the endpoint since it sizes the caller's own receive queue
+int channel_set_queue_depth(struct process *proc, int32 endpoint_handle, uint32 depth);
+
+//send a request and block for its reply on the same endpoint
+//the request is stamped with a fresh txid, the server gets it with the message
+//and answers through channel_send with txid and is_reply set (channel_reply for
+//kernel handlers). that reply goes straight to the caller, anything else keeps
+//going to the endpoint's queue
+//a server thread blocked in recv is switched to directly instead of going
+//through the run queue, and its reply wakes the caller the same way
+//returns the send error, -2 if either end closes, -3 if interrupted
+int channel_call(struct process *proc, int32 endpoint_handle, channel_msg_t *request,
+                 channel_msg_t *reply);
+
 //receive a message from a channel endpoint
 //handles in the message are added to receiver's handle table
 //caller must free msg->data after use
@@ -103,6 +165,27 @@ int channel_recv(struct process *proc, int32 endpoint_handle, channel_msg_t *msg
 //non-blocking version of channel_recv
 int channel_try_recv(struct process *proc, int32 endpoint_handle, channel_msg_t *msg);
 
+//put a received message back at the head of the endpoint's queue
+//takes the data, handles and loan from msg, on failure msg is left untouched
+int channel_requeue(struct process *proc, int32 endpoint_handle, channel_msg_t *msg);
+
+//send up to count data-only messages taking the channel lock once, iov and its
+//entries are kernel memory but every iov[i].data is a user address of proc
+//stops early when the peer queue fills, returns how many were queued
+//or -3 if none fit, -5 if count is over CHANNEL_MAX_BATCH, -EFAULT if a payload
+//cannot be read (other errors as channel_send)
+int channel_send_batch(struct process *proc, int32 endpoint_handle, const channel_iov_t *iov,
+                       uint32 count);
+
+//receive up to max messages taking the channel lock once, each msg as from channel_recv
+//with block set, waits for the first message, returns the number received
+int channel_recv_batch(struct process *proc, int32 endpoint_handle, channel_msg_t *msgs,
+                       uint32 max, bool block);
+
+//drop the loaned VMO reference of a received message (if any)
+//receivers that do not map loans must call this
+void channel_msg_drop_loan(channel_msg_t *msg);
+
 //close a channel endpoint
 //the peer endpoint will receive a "peer closed" signal
 int channel_close(struct process *proc, int32 endpoint_handle);
@@ -113,11 +196,18 @@ int channel_peer_closed(struct process *proc, int32 endpoint_handle);
 //get the channel endpoint object from a handle (returns NULL if not a channel)
 channel_endpoint_t *channel_get_endpoint(struct process *proc, int32 handle);
 
+//port source hook: observer list and current PORT_SIGNAL_* level of an endpoint
+port_observers_t *channel_port_observers(channel_endpoint_t *ep, uint32 *level);
+
 //channel server functions (for kernel-side handlers)
 void channel_set_handler(channel_endpoint_t *ep, 
                          void (*handler)(channel_endpoint_t *, channel_msg_t *, void *),
                          void *ctx);
 void channel_clear_handler(channel_endpoint_t *ep);
-int channel_reply(channel_endpoint_t *ep, channel_msg_t *msg);
+int channel_reply(channel_endpoint_t *ep, const channel_msg_t *request, channel_msg_t *msg);
+
+//queue a data-only message from kernel code without ever sleeping
+//returns -2 if the peer is closed, -3 if its queue is at its depth
+int channel_post(channel_endpoint_t *ep, const void *data, size len);
 
 #endif
@@ -27,8 +27,9 @@ void channel_set_handler(channel_endpoint_t *ep, channel_handler_t handler, void
 //clear handler for endpoint
 void channel_clear_handler(channel_endpoint_t *ep);
 
-//send a response back through the same channel
+//send a response to request back through the same channel
 //this is a convenience for handlers - sends to the peer endpoint
-int channel_reply(channel_endpoint_t *ep, channel_msg_t *msg);
+//a channel_call caller waiting on the request gets it directly
+int channel_reply(channel_endpoint_t *ep, const channel_msg_t *request, channel_msg_t *msg);
 
 #endif
@@ -0,0 +1,82 @@
+#include <ipc/doorbell.h>
+#include <proc/process.h>
+#include <proc/event.h>
+#include <mm/kheap.h>
+#include <syscall/syscall.h>
+#include <errno.h>
+
+static object_ops_t doorbell_ops = {
+    .read = NULL,
+    .write = NULL,
+    .close = NULL,
+    .readdir = NULL,
+    .lookup = NULL
+};
+
+int32 doorbell_create(process_t *proc, handle_rights_t rights) {
+    if (!proc) return -1;
+
+    doorbell_t *db = kzalloc(sizeof(doorbell_t));
+    if (!db) return -1;
+
+    db->obj.type = OBJECT_DOORBELL;
+    db->obj.refcount = 0;
+    db->obj.ops = &doorbell_ops;
+    db->obj.data = db;
+    spinlock_irq_init(&db->lock);
+    wait_queue_init(&db->waiters);
+
+    int32 h = process_grant_handle(proc, &db->obj, rights);
+    if (h < 0) {
+        kfree(db);
+        return -1;
+    }
+
+    return h;
+}
+
+doorbell_t *doorbell_get(process_t *proc, int32 handle) {
+    if (!proc) return NULL;
+
+    object_t *obj = process_get_handle(proc, handle);
+    if (!obj || obj->type != OBJECT_DOORBELL) return NULL;
+
+    return (doorbell_t *)obj;
+}
+
+void doorbell_ring(doorbell_t *db) {
+    if (!db) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&db->lock);
+    db->rings++;
+    thread_wake_all(&db->waiters);
+    spinlock_irq_release(&db->lock, flags);
+}
+
+int doorbell_wait(doorbell_t *db, const volatile uint32 *word, uint32 expected) {
+    if (!db || !word) return -1;
+
+    if (proc_current_should_abort_blocking()) {
+        return -3;  //interrupted by process event
+    }
+
+    irq_state_t flags = spinlock_irq_acquire(&db->lock);
+
+    //the ringer clears the word before taking our lock
+    //so if it still holds the expected value no ring can have been missed
+    //the load is fault-safe, the word may have been unmapped under us
+    uint32 current;
+    if (copy_user_bytes((const void *)word, &current, sizeof(current)) != 0) {
+        spinlock_irq_release(&db->lock, flags);
+        return -EFAULT;
+    }
+    if (current != expected) {
+        spinlock_irq_release(&db->lock, flags);
+        return 0;
+    }
+
+    thread_sleep_locked_irq(&db->waiters, &db->lock, &flags);
+    spinlock_irq_release(&db->lock, flags);
+
+    return 0;
+}
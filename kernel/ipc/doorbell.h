@@ -0,0 +1,46 @@
+#ifndef IPC_DOORBELL_H
+#define IPC_DOORBELL_H
+
+#include <arch/types.h>
+#include <obj/object.h>
+#include <obj/rights.h>
+#include <proc/wait.h>
+#include <lib/spinlock.h>
+
+/*
+ *doorbell - wakeup object for shared-memory rings
+ *
+ *peers exchange data through a mapped ring without entering the kernel
+ *a side that runs dry publishes a "waiting" word in shared memory and
+ *sleeps on the doorbell, the other side only rings (a syscall) when it sees
+ *that word set, so a busy ring never takes a syscall at all
+ *
+ *doorbell_wait re-checks the word under the doorbell lock before sleeping
+ *so a ring between the user-side check and the sleep is never lost
+*/
+
+struct process;
+
+typedef struct doorbell {
+    object_t obj;           //kernel object (embedded)
+    spinlock_irq_t lock;
+    wait_queue_t waiters;
+    uint64 rings;           //times the bell was rung
+} doorbell_t;
+
+//create a doorbell and grant a handle to proc
+int32 doorbell_create(struct process *proc, handle_rights_t rights);
+
+//get doorbell from handle (returns NULL if not a doorbell)
+doorbell_t *doorbell_get(struct process *proc, int32 handle);
+
+//wake every thread sleeping on the doorbell
+void doorbell_ring(doorbell_t *db);
+
+//sleep until rung, but only if *word still equals expected
+//word must be a user address in the current process
+//returns 0 after a wakeup or a changed word, -3 if interrupted by a process event
+//and -EFAULT if the word cannot be read
+int doorbell_wait(doorbell_t *db, const volatile uint32 *word, uint32 expected);
+
+#endif
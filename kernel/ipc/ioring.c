@@ -0,0 +1,463 @@
+#include <ipc/ioring.h>
+#include <ipc/channel.h>
+#include <obj/handle.h>
+#include <obj/kobject.h>
+#include <mm/vmo.h>
+#include <mm/kheap.h>
+#include <proc/process.h>
+#include <proc/thread.h>
+#include <proc/sched.h>
+#include <proc/event.h>
+#include <arch/timer.h>
+#include <lib/string.h>
+#include <syscall/syscall.h>
+
+static bool ioring_user_ok(uint64 addr, size len) {
+    if (addr < USER_SPACE_START || addr >= USER_SPACE_END) return false;
+    return len <= (size)(USER_SPACE_END - addr);
+}
+
+static void ioring_free(ioring_t *ring) {
+    while (ring->pending) {
+        ioring_req_t *chain = ring->pending;
+        ring->pending = chain->next;
+        while (chain) {
+            ioring_req_t *next = chain->link;
+            kfree(chain);
+            chain = next;
+        }
+    }
+    object_deref(&ring->vmo->obj);
+    process_unref(ring->proc);
+    kfree(ring);
+}
+
+static void ioring_put(ioring_t *ring) {
+    if (__atomic_sub_fetch(&ring->refcount, 1, __ATOMIC_SEQ_CST) == 0) {
+        ioring_free(ring);
+    }
+}
+
+//post one completion, an entry the CQ has no room for is only counted
+static void ioring_complete(ioring_t *ring, uint64 user_data, int32 res) {
+    ioring_header_t *hdr = ring->hdr;
+
+    irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+    uint32 head = __atomic_load_n(&hdr->cq_head, __ATOMIC_ACQUIRE);
+    if (ring->cq_tail - head >= ring->cq_entries) {
+        hdr->cq_overflow++;
+    } else {
+        ioring_cqe_t *cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+        cqe->user_data = user_data;
+        cqe->res = res;
+        cqe->flags = 0;
+        ring->cq_tail++;
+        __atomic_store_n(&hdr->cq_tail, ring->cq_tail, __ATOMIC_RELEASE);
+    }
+    ring->inflight--;
+    thread_wake_all(&ring->cq_wait);
+    spinlock_irq_release(&ring->lock, flags);
+}
+
+static int32 ioring_channel_send(process_t *proc, const ioring_sqe_t *sqe) {
+    if (sqe->len > CHANNEL_MAX_MSG_SIZE) return -2;
+
+    void *kbuf = NULL;
+    if (sqe->len > 0) {
+        if (!ioring_user_ok(sqe->addr, sqe->len)) return -1;
+        kbuf = kmalloc(sqe->len);
+        if (!kbuf) return -3;
+        if (copy_user_bytes((const void *)sqe->addr, kbuf, sqe->len) != 0) {
+            kfree(kbuf);
+            return -1;
+        }
+    }
+
+    channel_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.data = kbuf;
+    msg.data_len = sqe->len;
+
+    //the worker is allowed to wait, so a full peer queue is not an error here
+    int result = channel_send_blocking(proc, sqe->handle, &msg, 0);
+    if (kbuf) kfree(kbuf);
+    return result;
+}
+
+static int32 ioring_channel_recv(process_t *proc, const ioring_sqe_t *sqe) {
+    if (sqe->len > 0 && !ioring_user_ok(sqe->addr, sqe->len)) return -1;
+
+    channel_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    int result = channel_recv(proc, sqe->handle, &msg);
+    if (result != 0) return result;
+    channel_msg_drop_loan(&msg);  //no place to map it
+
+    int32 res = (int32)msg.data_len;
+    size to_copy = msg.data_len < sqe->len ? msg.data_len : sqe->len;
+    if (to_copy > 0 && msg.data &&
+        copy_to_user_bytes((void *)sqe->addr, msg.data, to_copy) != 0) {
+        res = -1;
+    }
+    if (msg.data) kfree(msg.data);
+
+    for (uint32 i = 0; i < msg.handle_count; i++) {
+        process_close_handle(proc, msg.handles[i]);
+    }
+    if (msg.handles) kfree(msg.handles);
+    return res;
+}
+
+//run one entry on a worker, returns the completion result
+static int32 ioring_exec(ioring_t *ring, const ioring_sqe_t *sqe) {
+    uint8 op = sqe->opcode;
+    if (op == IORING_OP_NOP) return 0;
+    if (op == IORING_OP_CHANNEL_SEND) return ioring_channel_send(ring->proc, sqe);
+    if (op == IORING_OP_CHANNEL_RECV) return ioring_channel_recv(ring->proc, sqe);
+    if (op >= IORING_OP_COUNT) return -1;
+
+    bool write = op == IORING_OP_WRITE || op == IORING_OP_WRITEV || op == IORING_OP_SEND;
+    bool stream = op == IORING_OP_RECV || op == IORING_OP_SEND;
+
+    int64 pos = -1;
+    if (!stream && sqe->offset != IORING_OFFSET_CURRENT) {
+        if ((int64)sqe->offset < 0) return -1;
+        pos = (int64)sqe->offset;
+    }
+
+    io_vec_t iov[IO_VEC_MAX];
+    uint32 count = 1;
+    if (op == IORING_OP_READV || op == IORING_OP_WRITEV) {
+        count = sqe->len;
+        if (copy_user_iov((const io_vec_t *)sqe->addr, count, iov) != 0) return -1;
+    } else {
+        if (sqe->len == 0) return 0;
+        if (!ioring_user_ok(sqe->addr, sqe->len)) return -1;
+        iov[0].base = (void *)sqe->addr;
+        iov[0].len = sqe->len;
+    }
+
+    //results have to fit the completion's 32 bit res
+    size total = 0;
+    for (uint32 i = 0; i < count; i++) total += iov[i].len;
+    if (total > 0x7FFFFFFF) return -1;
+
+    ssize r = write ? handle_writev_user(sqe->handle, iov, count, pos)
+                    : handle_readv_user(sqe->handle, iov, count, pos);
+    return (int32)r;
+}
+
+//a failed entry cancels everything linked behind it
+static void ioring_run_chain(ioring_t *ring, ioring_req_t *req) {
+    bool failed = false;
+    while (req) {
+        ioring_req_t *next = req->link;
+        int32 res = failed ? IORING_RES_CANCELED : ioring_exec(ring, &req->sqe);
+        if (res < 0) failed = true;
+        ioring_complete(ring, req->sqe.user_data, res);
+        kfree(req);
+        req = next;
+    }
+}
+
+static void ioring_worker(void *arg) {
+    ioring_t *ring = (ioring_t *)arg;
+
+    irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+    for (;;) {
+        while (!ring->pending && !ring->dying) {
+            ring->idle_workers++;
+            thread_sleep_locked_irq(&ring->work_wait, &ring->lock, &flags);
+            ring->idle_workers--;
+        }
+        if (ring->dying) break;
+
+        ioring_req_t *req = ring->pending;
+        ring->pending = req->next;
+        if (!ring->pending) ring->pending_tail = NULL;
+        ring->pending_count--;
+        spinlock_irq_release(&ring->lock, flags);
+
+        ioring_run_chain(ring, req);
+        flags = spinlock_irq_acquire(&ring->lock);
+    }
+    ring->workers--;
+    spinlock_irq_release(&ring->lock, flags);
+}
+
+static void ioring_thread_reap(void *arg) {
+    ioring_put((ioring_t *)arg);
+}
+
+//each ring thread holds a ref that is only dropped once the thread is reaped,
+//so threads of an exited process that never run again still let the ring go
+static int ioring_start_thread(ioring_t *ring, void (*entry)(void *)) {
+    __atomic_add_fetch(&ring->refcount, 1, __ATOMIC_SEQ_CST);
+    thread_t *thread = thread_create(ring->proc, entry, ring);
+    if (!thread) {
+        __atomic_sub_fetch(&ring->refcount, 1, __ATOMIC_SEQ_CST);
+        return -1;
+    }
+    thread->on_reap = ioring_thread_reap;
+    thread->reap_arg = ring;
+    sched_add(thread);
+    return 0;
+}
+
+//hand a chain to the workers, growing the pool while every worker is busy
+static void ioring_queue_chain(ioring_t *ring, ioring_req_t *chain) {
+    irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+    chain->next = NULL;
+    if (ring->pending_tail) ring->pending_tail->next = chain;
+    else ring->pending = chain;
+    ring->pending_tail = chain;
+    ring->pending_count++;
+
+    bool grow = ring->pending_count > ring->idle_workers && ring->workers < IORING_MAX_WORKERS;
+    if (grow) ring->workers++;
+    if (ring->idle_workers > 0) thread_wake_one(&ring->work_wait);
+    spinlock_irq_release(&ring->lock, flags);
+
+    //the first worker is started with the ring, so a failure here only costs parallelism
+    if (grow && ioring_start_thread(ring, ioring_worker) != 0) {
+        flags = spinlock_irq_acquire(&ring->lock);
+        ring->workers--;
+        spinlock_irq_release(&ring->lock, flags);
+    }
+}
+
+//consume up to max SQ entries, a chain is only taken once the CQ has room
+//for every entry in it so completions are never dropped by a well behaved user
+static uint32 ioring_submit(ioring_t *ring, uint32 max) {
+    ioring_header_t *hdr = ring->hdr;
+    uint32 sq_entries = ring->sq_mask + 1;
+    uint32 submitted = 0;
+
+    spinlock_acquire(&ring->submit_lock);
+    uint32 avail = __atomic_load_n(&hdr->sq_tail, __ATOMIC_ACQUIRE) - ring->sq_head;
+    if (avail > sq_entries) avail = sq_entries;
+    if (avail > max) avail = max;
+
+    while (submitted < avail) {
+        //a chain runs up to the first entry without IOSQE_LINK (or the end of the batch)
+        uint32 len = 1;
+        while (submitted + len < avail &&
+               (ring->sqes[(ring->sq_head + len - 1) & ring->sq_mask].flags & IOSQE_LINK)) {
+            len++;
+        }
+
+        irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+        uint32 used = ring->cq_tail - __atomic_load_n(&hdr->cq_head, __ATOMIC_ACQUIRE) +
+                      ring->inflight;
+        bool room = used <= ring->cq_entries && ring->cq_entries - used >= len;
+        if (room) ring->inflight += len;
+        spinlock_irq_release(&ring->lock, flags);
+        if (!room) break;
+
+        //copy the entries out of shared memory so later user writes cannot race the worker
+        ioring_req_t *chain = NULL;
+        ioring_req_t **link = &chain;
+        uint32 built = 0;
+        for (; built < len; built++) {
+            ioring_req_t *req = kmalloc(sizeof(ioring_req_t));
+            if (!req) break;
+            req->sqe = ring->sqes[(ring->sq_head + built) & ring->sq_mask];
+            req->link = NULL;
+            *link = req;
+            link = &req->link;
+        }
+        if (built < len) {
+            //out of memory: fail the whole chain rather than run half of it
+            for (uint32 i = 0; i < len; i++) {
+                ioring_sqe_t *sqe = &ring->sqes[(ring->sq_head + i) & ring->sq_mask];
+                ioring_complete(ring, sqe->user_data, -3);
+            }
+            while (chain) {
+                ioring_req_t *next = chain->link;
+                kfree(chain);
+                chain = next;
+            }
+        }
+
+        ring->sq_head += len;
+        __atomic_store_n(&hdr->sq_head, ring->sq_head, __ATOMIC_RELEASE);
+        submitted += len;
+
+        if (chain) ioring_queue_chain(ring, chain);
+    }
+    spinlock_release(&ring->submit_lock);
+    return submitted;
+}
+
+//kernel side submitter for IORING_SETUP_SQPOLL
+static void ioring_sqpoll(void *arg) {
+    ioring_t *ring = (ioring_t *)arg;
+    ioring_header_t *hdr = ring->hdr;
+
+    uint32 freq = arch_timer_getfreq();
+    if (freq == 0) freq = 1000;
+    uint64 idle_ticks = (uint64)IORING_SQPOLL_IDLE_MS * freq / 1000;
+    uint64 last = arch_timer_get_ticks();
+
+    while (!__atomic_load_n(&ring->dying, __ATOMIC_ACQUIRE)) {
+        if (ioring_submit(ring, ring->sq_mask + 1) > 0) {
+            last = arch_timer_get_ticks();
+            continue;
+        }
+        if (arch_timer_get_ticks() - last < idle_ticks) {
+            sched_yield();
+            continue;
+        }
+
+        //announce the sleep then look once more, an entry queued in between
+        //is either seen here or its submitter sees the flag and wakes us
+        irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+        __atomic_or_fetch(&hdr->sq_flags, IORING_SQ_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&hdr->sq_tail, __ATOMIC_SEQ_CST) == ring->sq_head && !ring->dying) {
+            thread_sleep_locked_irq(&ring->sq_wait, &ring->lock, &flags);
+        }
+        __atomic_and_fetch(&hdr->sq_flags, ~IORING_SQ_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        spinlock_irq_release(&ring->lock, flags);
+        last = arch_timer_get_ticks();
+    }
+}
+
+int ioring_enter(ioring_t *ring, uint32 to_submit, uint32 min_complete, uint32 flags) {
+    if (!ring) return -1;
+
+    uint32 submitted = 0;
+    if (ring->hdr->flags & IORING_SETUP_SQPOLL) {
+        if (flags & IORING_ENTER_SQ_WAKEUP) {
+            irq_state_t irq = spinlock_irq_acquire(&ring->lock);
+            thread_wake_all(&ring->sq_wait);
+            spinlock_irq_release(&ring->lock, irq);
+        }
+    } else if (to_submit > 0) {
+        submitted = ioring_submit(ring, to_submit);
+    }
+
+    if (!(flags & IORING_ENTER_GETEVENTS) || min_complete == 0) return (int)submitted;
+    if (min_complete > ring->cq_entries) min_complete = ring->cq_entries;
+
+    irq_state_t irq = spinlock_irq_acquire(&ring->lock);
+    for (;;) {
+        uint32 ready = ring->cq_tail - __atomic_load_n(&ring->hdr->cq_head, __ATOMIC_ACQUIRE);
+        if (ready >= min_complete) break;
+        //nothing in flight means nothing more is coming (the poller may still
+        //be about to submit, but then it is the poller's completions we wait for)
+        if (ring->inflight == 0 && !(ring->hdr->flags & IORING_SETUP_SQPOLL)) break;
+        if (ring->dying) break;
+        if (proc_current_should_abort_blocking()) {
+            spinlock_irq_release(&ring->lock, irq);
+            return -9;
+        }
+        thread_sleep_locked_irq(&ring->cq_wait, &ring->lock, &irq);
+    }
+    spinlock_irq_release(&ring->lock, irq);
+    return (int)submitted;
+}
+
+static int ioring_close(object_t *obj) {
+    ioring_t *ring = (ioring_t *)obj;
+
+    irq_state_t flags = spinlock_irq_acquire(&ring->lock);
+    ring->dying = 1;
+    thread_wake_all(&ring->work_wait);
+    thread_wake_all(&ring->sq_wait);
+    thread_wake_all(&ring->cq_wait);
+    spinlock_irq_release(&ring->lock, flags);
+
+    //each thread leaves once its current operation is done and the last one reaped frees the ring
+    ioring_put(ring);
+    return 0;
+}
+
+static object_ops_t ioring_ops = {
+    .read = NULL,
+    .write = NULL,
+    .close = ioring_close,
+    .readdir = NULL,
+    .lookup = NULL
+};
+
+int32 ioring_create(process_t *proc, uint32 entries, uint32 flags, int32 *vmo_out) {
+    if (!proc || !vmo_out) return -1;
+    if (entries == 0 || entries > IORING_MAX_ENTRIES) return -2;
+    if (entries & (entries - 1)) return -2;  //must be a power of two
+    if (flags & ~IORING_SETUP_SQPOLL) return -2;
+
+    uint32 cq_entries = entries * 2;
+    uint32 sq_off = IORING_HEADER_SIZE;
+    uint32 cq_off = sq_off + entries * sizeof(ioring_sqe_t);
+    size total = cq_off + (size)cq_entries * sizeof(ioring_cqe_t);
+
+    int32 vh = vmo_create(proc, total, 0, HANDLE_RIGHTS_DEFAULT | HANDLE_RIGHT_MAP);
+    if (vh < 0) return -1;
+    vmo_t *vmo = vmo_get(proc, vh);
+    ioring_t *ring = vmo ? kzalloc(sizeof(ioring_t)) : NULL;
+    if (!ring) {
+        process_close_handle(proc, vh);
+        return -1;
+    }
+
+    //VMO pages come back zeroed, only the geometry needs filling in
+    ioring_header_t *hdr = (ioring_header_t *)vmo->pages;
+    hdr->magic = IORING_MAGIC;
+    hdr->flags = flags;
+    hdr->sq_entries = entries;
+    hdr->cq_entries = cq_entries;
+    hdr->sq_off = sq_off;
+    hdr->cq_off = cq_off;
+
+    object_ref(&vmo->obj);
+    process_ref(proc);
+    ring->proc = proc;
+    ring->vmo = vmo;
+    ring->hdr = hdr;
+    ring->sqes = (ioring_sqe_t *)((uint8 *)vmo->pages + sq_off);
+    ring->cqes = (ioring_cqe_t *)((uint8 *)vmo->pages + cq_off);
+    ring->sq_mask = entries - 1;
+    ring->cq_entries = cq_entries;
+    spinlock_irq_init(&ring->lock);
+    spinlock_init(&ring->submit_lock);
+    wait_queue_init(&ring->work_wait);
+    wait_queue_init(&ring->cq_wait);
+    wait_queue_init(&ring->sq_wait);
+
+    ring->obj.type = OBJECT_IORING;
+    ring->obj.refcount = 1;
+    ring->obj.flags = OBJECT_FLAG_EMBEDDED;
+    ring->obj.ops = &ioring_ops;
+    ring->obj.data = ring;
+    ring->refcount = 1;  //dropped in ioring_close
+
+    int32 h = process_grant_handle(proc, &ring->obj, HANDLE_RIGHTS_DEFAULT);
+    object_deref(&ring->obj);  //the handle holds the only reference now
+    if (h < 0) {
+        process_close_handle(proc, vh);
+        return -1;
+    }
+
+    ring->workers = 1;
+    bool started = ioring_start_thread(ring, ioring_worker) == 0;
+    if (started && (flags & IORING_SETUP_SQPOLL)) {
+        started = ioring_start_thread(ring, ioring_sqpoll) == 0;
+    }
+    if (!started) {
+        process_close_handle(proc, h);
+        process_close_handle(proc, vh);
+        return -1;
+    }
+
+    *vmo_out = vh;
+    return h;
+}
+
+ioring_t *ioring_get(process_t *proc, int32 handle) {
+    if (!proc) return NULL;
+
+    object_t *obj = process_get_handle(proc, handle);
+    if (!obj || obj->type != OBJECT_IORING) return NULL;
+
+    return (ioring_t *)obj;
+}
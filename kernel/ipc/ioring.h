@@ -0,0 +1,160 @@
+#ifndef IPC_IORING_H
+#define IPC_IORING_H
+
+#include <arch/types.h>
+#include <obj/object.h>
+#include <obj/rights.h>
+#include <proc/wait.h>
+#include <lib/spinlock.h>
+
+/*
+ *asynchronous I/O rings
+ *
+ *one VMO holds a submission queue (SQ) and a completion queue (CQ). the
+ *process fills SQ entries and moves sq_tail, the kernel consumes them, runs
+ *every operation on a small pool of worker threads that live in the process
+ *(so they see its handles and address space) and posts a CQ entry carrying
+ *the submitter's user_data when it is done
+ *
+ *ioring_enter submits a batch and optionally waits for completions. with
+ *IORING_SETUP_SQPOLL a kernel thread watches sq_tail instead, so a busy ring
+ *takes no syscalls at all, the thread sets IORING_SQ_NEED_WAKEUP before it
+ *goes idle and then needs an ioring_enter with IORING_ENTER_SQ_WAKEUP
+ *
+ *IOSQE_LINK chains an entry to the next one: a chain runs in order on one
+ *worker and a failing entry completes the rest with IORING_RES_CANCELED
+ *
+ *the layout below is ABI and mirrored in user/libc/include/system.h
+*/
+
+#define IORING_MAGIC            0x474e5249  //"IRNG"
+#define IORING_HEADER_SIZE      256
+#define IORING_MAX_ENTRIES      256         //SQ entries, the CQ gets twice as many
+#define IORING_MAX_WORKERS      32          //operations in flight at once per ring
+#define IORING_SQPOLL_IDLE_MS   50          //poller spins this long before sleeping
+
+//setup flags
+#define IORING_SETUP_SQPOLL     (1 << 0)
+
+//sq_flags (written by the kernel)
+#define IORING_SQ_NEED_WAKEUP   (1 << 0)
+
+//enter flags
+#define IORING_ENTER_GETEVENTS  (1 << 0)    //wait for min_complete completions
+#define IORING_ENTER_SQ_WAKEUP  (1 << 1)    //wake an idle SQ poller
+
+//opcodes
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1   //addr/len buffer at offset
+#define IORING_OP_WRITE         2
+#define IORING_OP_READV         3   //addr is an io_vec_t array of len entries
+#define IORING_OP_WRITEV        4
+#define IORING_OP_RECV          5   //stream read (socket, pipe), offset ignored
+#define IORING_OP_SEND          6
+#define IORING_OP_CHANNEL_SEND  7   //one data-only message of len bytes
+#define IORING_OP_CHANNEL_RECV  8   //next message into addr/len, res is its full length
+#define IORING_OP_COUNT         9
+
+//sqe flags
+#define IOSQE_LINK              (1 << 0)    //next entry runs only if this one succeeds
+
+//offset meaning "the handle position" (which the operation then advances)
+#define IORING_OFFSET_CURRENT   (~0ULL)
+
+//result of entries dropped because an earlier link failed
+#define IORING_RES_CANCELED     (-125)
+
+typedef struct {
+    uint8 opcode;
+    uint8 flags;                    //IOSQE_*
+    uint16 reserved0;
+    int32 handle;
+    uint64 offset;
+    uint64 addr;
+    uint32 len;
+    uint32 reserved1;
+    uint64 user_data;               //copied to the completion untouched
+    uint64 reserved2[3];
+} ioring_sqe_t;
+
+typedef struct {
+    uint64 user_data;
+    int32 res;                      //bytes moved or a negative error
+    uint32 flags;
+} ioring_cqe_t;
+
+typedef struct {
+    uint32 magic;
+    uint32 flags;                   //IORING_SETUP_*
+    uint32 sq_entries;              //power of two
+    uint32 cq_entries;
+    uint32 sq_off;                  //byte offset of the SQ array in the VMO
+    uint32 cq_off;                  //byte offset of the CQ array
+    uint32 reserved[10];
+
+    //each side's index sits on its own cache line
+    volatile uint32 sq_head;        //kernel: next entry it consumes
+    volatile uint32 sq_tail;        //user: one past the last filled entry
+    uint8 pad0[56];
+    volatile uint32 cq_head;        //user: next completion it reads
+    volatile uint32 cq_tail;        //kernel: one past the last posted completion
+    volatile uint32 cq_overflow;    //completions dropped because the CQ was full
+    uint8 pad1[52];
+    volatile uint32 sq_flags;       //IORING_SQ_*
+    uint8 pad2[60];
+} ioring_header_t;
+
+_Static_assert(sizeof(ioring_header_t) == IORING_HEADER_SIZE, "ioring header is ABI");
+_Static_assert(sizeof(ioring_sqe_t) == 64, "ioring sqe is ABI");
+_Static_assert(sizeof(ioring_cqe_t) == 16, "ioring cqe is ABI");
+
+struct process;
+struct vmo;
+
+//a consumed SQ entry, chains hang off link in submission order
+typedef struct ioring_req {
+    ioring_sqe_t sqe;
+    struct ioring_req *link;
+    struct ioring_req *next;        //pending queue
+} ioring_req_t;
+
+typedef struct ioring {
+    object_t obj;                   //kernel object (embedded, OBJECT_IORING)
+    struct process *proc;
+    struct vmo *vmo;                //ref held for the ring's lifetime
+    ioring_header_t *hdr;           //kernel view of the shared VMO
+    ioring_sqe_t *sqes;
+    ioring_cqe_t *cqes;
+    uint32 sq_mask;
+    uint32 cq_entries;
+
+    spinlock_t submit_lock;         //serializes SQ consumption
+    spinlock_irq_t lock;
+    uint32 sq_head;                 //kernel copies, the shared ones are only published
+    uint32 cq_tail;
+    uint32 inflight;                //consumed entries not yet completed
+    ioring_req_t *pending;          //chains waiting for a worker
+    ioring_req_t *pending_tail;
+    uint32 pending_count;
+    uint32 workers;
+    uint32 idle_workers;
+    wait_queue_t work_wait;         //idle workers
+    wait_queue_t cq_wait;           //ioring_enter waiting for completions
+    wait_queue_t sq_wait;           //idle SQ poller
+    uint8 dying;
+    uint32 refcount;                //the object plus one per kernel thread
+} ioring_t;
+
+//create a ring with entries SQ slots (power of two, up to IORING_MAX_ENTRIES)
+//grants proc a ring handle (returned) and a mappable VMO handle (*vmo_out)
+int32 ioring_create(struct process *proc, uint32 entries, uint32 flags, int32 *vmo_out);
+
+//get ring from handle (returns NULL if not a ring)
+ioring_t *ioring_get(struct process *proc, int32 handle);
+
+//submit up to to_submit entries, then with IORING_ENTER_GETEVENTS wait until
+//min_complete completions are ready. returns the number submitted,
+//-9 if interrupted while waiting
+int ioring_enter(ioring_t *ring, uint32 to_submit, uint32 min_complete, uint32 flags);
+
+#endif
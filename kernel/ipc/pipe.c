@@ -0,0 +1,584 @@
+#include <ipc/pipe.h>
+#include <proc/process.h>
+#include <proc/event.h>
+#include <mm/pmm.h>
+#include <mm/mm.h>
+#include <mm/kheap.h>
+#include <lib/string.h>
+#include <syscall/syscall.h>
+
+static pipe_page_t *pipe_page_alloc(void) {
+    pipe_page_t *pg = kmalloc(sizeof(pipe_page_t));
+    if (!pg) return NULL;
+
+    void *phys = pmm_alloc(1);
+    if (!phys) {
+        kfree(pg);
+        return NULL;
+    }
+    pg->phys = (uintptr)phys;
+    pg->data = P2V(phys);
+    pg->refs = 1;
+    return pg;
+}
+
+static void pipe_page_put(pipe_page_t *pg) {
+    if (__atomic_sub_fetch(&pg->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        pmm_free((void *)pg->phys, 1);
+        kfree(pg);
+    }
+}
+
+static inline pipe_buf_t *pipe_slot(pipe_t *p, uint32 i) {
+    return &p->bufs[(p->head + i) % PIPE_BUFFERS];
+}
+
+//append a buffer, returns true if the pipe was empty before
+static bool pipe_push_locked(pipe_t *p, const pipe_buf_t *b) {
+    bool was_empty = p->bytes == 0;
+    *pipe_slot(p, p->count) = *b;
+    p->count++;
+    p->bytes += b->len;
+    return was_empty;
+}
+
+//drop the consumed front buffer
+static void pipe_pop_locked(pipe_t *p) {
+    p->bufs[p->head].page = NULL;
+    p->head = (p->head + 1) % PIPE_BUFFERS;
+    p->count--;
+}
+
+//wait until data is queued or every writer is gone (count stays 0 then)
+//and no other reader holds the front buffer
+static int pipe_wait_data_locked(pipe_t *p, irq_state_t *flags, bool nonblock) {
+    while (p->taken || (p->count == 0 && !p->closed[PIPE_END_WRITE])) {
+        if (nonblock) return -3;
+        if (proc_current_should_abort_blocking()) return -9;
+        thread_sleep_locked_irq(&p->readers, &p->lock, flags);
+    }
+    return 0;
+}
+
+//wait until a slot is free, a pipe nobody reads any more is an error
+static int pipe_wait_room_locked(pipe_t *p, irq_state_t *flags, bool nonblock) {
+    while (!p->closed[PIPE_END_READ] && p->count >= PIPE_BUFFERS) {
+        if (nonblock) return -3;
+        if (proc_current_should_abort_blocking()) return -9;
+        thread_sleep_locked_irq(&p->writers, &p->lock, flags);
+    }
+    return p->closed[PIPE_END_READ] ? -4 : 0;
+}
+
+static int pipe_wait_room(pipe_t *p, bool nonblock) {
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    int r = pipe_wait_room_locked(p, &flags, nonblock);
+    spinlock_irq_release(&p->lock, flags);
+    return r;
+}
+
+//queue b on p, on failure the caller still owns b's page reference
+static int pipe_push_buf(pipe_t *p, const pipe_buf_t *b, bool nonblock) {
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    int r = pipe_wait_room_locked(p, &flags, nonblock);
+    if (r < 0) {
+        spinlock_irq_release(&p->lock, flags);
+        return r;
+    }
+    bool was_empty = pipe_push_locked(p, b);
+    thread_wake_all(&p->readers);
+    spinlock_irq_release(&p->lock, flags);
+
+    if (was_empty) port_observers_signal(&p->observers, PORT_SIGNAL_READABLE);
+    return 0;
+}
+
+//reference up to max bytes at the front of p in *out (with its own page ref)
+//the buffer stays queued and other readers wait until pipe_consume, so a
+//failed copy loses nothing and data never goes out of order
+//returns 1 when taken, 0 at end of file, <0 on error
+static int pipe_take(pipe_t *p, size max, bool nonblock, pipe_buf_t *out) {
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    int r = pipe_wait_data_locked(p, &flags, nonblock);
+    if (r < 0 || p->count == 0) {
+        spinlock_irq_release(&p->lock, flags);
+        return r;
+    }
+
+    pipe_buf_t *front = &p->bufs[p->head];
+    uint32 n = front->len < max ? front->len : (uint32)max;
+    out->page = front->page;
+    out->offset = front->offset;
+    out->len = n;
+    __atomic_add_fetch(&front->page->refs, 1, __ATOMIC_RELAXED);
+    p->taken = 1;
+    spinlock_irq_release(&p->lock, flags);
+    return 1;
+}
+
+//end a pipe_take: drop the first n bytes of the front buffer and let the
+//next reader in, the taken page ref stays with the caller
+static void pipe_consume(pipe_t *p, uint32 n) {
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    if (n > 0) {
+        pipe_buf_t *front = &p->bufs[p->head];
+        front->offset += n;
+        front->len -= n;
+        p->bytes -= n;
+        if (front->len == 0) {
+            pipe_page_put(front->page);
+            pipe_pop_locked(p);
+        }
+        thread_wake_all(&p->writers);
+    }
+    p->taken = 0;
+    thread_wake_all(&p->readers);
+    spinlock_irq_release(&p->lock, flags);
+}
+
+static ssize pipe_read(object_t *obj, void *buf, size len, size offset) {
+    (void)offset;
+    pipe_end_t *end = (pipe_end_t *)obj;
+    if (!end || end->end != PIPE_END_READ) return -1;
+    if (!buf || len == 0) return 0;
+
+    pipe_t *p = end->pipe;
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    int r = pipe_wait_data_locked(p, &flags, false);
+    if (r < 0) {
+        spinlock_irq_release(&p->lock, flags);
+        return r;
+    }
+
+    //hand back whatever is queued rather than waiting to fill buf
+    size done = 0;
+    while (done < len && p->count > 0) {
+        pipe_buf_t *b = &p->bufs[p->head];
+        uint32 n = b->len;
+        if (n > len - done) n = (uint32)(len - done);
+
+        memcpy((uint8 *)buf + done, (uint8 *)b->page->data + b->offset, n);
+        b->offset += n;
+        b->len -= n;
+        p->bytes -= n;
+        done += n;
+
+        if (b->len == 0) {
+            pipe_page_put(b->page);
+            pipe_pop_locked(p);
+        }
+    }
+    thread_wake_all(&p->writers);
+    spinlock_irq_release(&p->lock, flags);
+
+    return (ssize)done;
+}
+
+//read straight into a user buffer, each page is copied with the pipe unlocked
+static ssize pipe_read_user(object_t *obj, void *ubuf, size len, size offset) {
+    (void)offset;
+    pipe_end_t *end = (pipe_end_t *)obj;
+    if (!end || end->end != PIPE_END_READ) return -1;
+    if (!ubuf || len == 0) return 0;
+
+    pipe_t *p = end->pipe;
+    size done = 0;
+    while (done < len) {
+        pipe_buf_t b;
+        int r = pipe_take(p, len - done, done > 0, &b);
+        if (r <= 0) {
+            if (done == 0) return r;
+            break;
+        }
+
+        bool ok = copy_to_user_bytes((uint8 *)ubuf + done, (uint8 *)b.page->data + b.offset,
+                                     b.len) == 0;
+        pipe_consume(p, ok ? b.len : 0);
+        pipe_page_put(b.page);
+        if (!ok) return done > 0 ? (ssize)done : -1;
+        done += b.len;
+    }
+
+    return (ssize)done;
+}
+
+//a user buffer can fault, so its bytes are first staged in the spare page with
+//the pipe unlocked and only moved on or queued under the lock
+static ssize pipe_write_common(object_t *obj, const void *buf, size len, bool user) {
+    pipe_end_t *end = (pipe_end_t *)obj;
+    if (!end || end->end != PIPE_END_WRITE) return -1;
+    if (!buf || len == 0) return 0;
+
+    pipe_t *p = end->pipe;
+    pipe_page_t *spare = NULL;
+    uint32 staged_off = 0;      //user bytes waiting in spare
+    uint32 staged = 0;
+    size done = 0;
+    ssize result = 0;
+    bool signal = false;
+
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    while (done < len) {
+        if (p->closed[PIPE_END_READ]) {
+            result = -4;
+            break;
+        }
+
+        if (user && staged == 0) {
+            spinlock_irq_release(&p->lock, flags);
+            if (!spare) spare = pipe_page_alloc();
+            size n = len - done < PAGE_SIZE ? len - done : PAGE_SIZE;
+            bool ok = spare && copy_user_bytes((const uint8 *)buf + done, spare->data, n) == 0;
+            flags = spinlock_irq_acquire(&p->lock);
+            if (!ok) {
+                result = -1;
+                break;
+            }
+            staged_off = 0;
+            staged = (uint32)n;
+            continue;  //the ring may have changed while unlocked
+        }
+        const uint8 *src = user ? (const uint8 *)spare->data + staged_off : (const uint8 *)buf + done;
+        size avail = user ? staged : len - done;
+
+        //top up the newest buffer while its page is ours alone
+        if (p->count > 0) {
+            pipe_buf_t *last = pipe_slot(p, p->count - 1);
+            uint32 tail = last->offset + last->len;
+            if (last->page->refs == 1 && tail < PAGE_SIZE) {
+                size n = PAGE_SIZE - tail;
+                if (n > avail) n = avail;
+                memcpy((uint8 *)last->page->data + tail, src, n);
+                if (p->bytes == 0) signal = true;
+                last->len += (uint32)n;
+                p->bytes += n;
+                done += n;
+                if (user) {
+                    staged_off += (uint32)n;
+                    staged -= (uint32)n;
+                }
+                continue;
+            }
+        }
+
+        if (p->count >= PIPE_BUFFERS) {
+            //let the reader drain what we queued so far before sleeping
+            thread_wake_all(&p->readers);
+            if (proc_current_should_abort_blocking()) {
+                result = -9;
+                break;
+            }
+            thread_sleep_locked_irq(&p->writers, &p->lock, &flags);
+            continue;
+        }
+
+        if (user) {
+            //the staged page is queued as it is
+            pipe_buf_t b = { spare, staged_off, staged };
+            if (pipe_push_locked(p, &b)) signal = true;
+            spare = NULL;
+            done += staged;
+            staged = 0;
+            continue;
+        }
+
+        if (!spare) {
+            spinlock_irq_release(&p->lock, flags);
+            spare = pipe_page_alloc();
+            flags = spinlock_irq_acquire(&p->lock);
+            if (!spare) {
+                result = -1;
+                break;
+            }
+            continue;  //the ring may have changed while unlocked
+        }
+
+        size n = len - done < PAGE_SIZE ? len - done : PAGE_SIZE;
+        memcpy(spare->data, src, n);
+        pipe_buf_t b = { spare, 0, (uint32)n };
+        if (pipe_push_locked(p, &b)) signal = true;
+        spare = NULL;
+        done += n;
+    }
+    thread_wake_all(&p->readers);
+    spinlock_irq_release(&p->lock, flags);
+
+    if (spare) pipe_page_put(spare);
+    if (signal) port_observers_signal(&p->observers, PORT_SIGNAL_READABLE);
+
+    return done > 0 ? (ssize)done : result;
+}
+
+static ssize pipe_write(object_t *obj, const void *buf, size len, size offset) {
+    (void)offset;
+    return pipe_write_common(obj, buf, len, false);
+}
+
+static ssize pipe_write_user(object_t *obj, const void *ubuf, size len, size offset) {
+    (void)offset;
+    return pipe_write_common(obj, ubuf, len, true);
+}
+
+static int pipe_end_close(object_t *obj) {
+    pipe_end_t *end = (pipe_end_t *)obj;
+    if (!end || !end->pipe) return -1;
+
+    pipe_t *p = end->pipe;
+
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    p->closed[end->end] = 1;
+    //blocked readers see end of file, blocked writers a broken pipe
+    thread_wake_all(&p->readers);
+    thread_wake_all(&p->writers);
+    spinlock_irq_release(&p->lock, flags);
+
+    if (end->end == PIPE_END_WRITE) {
+        port_observers_signal(&p->observers, PORT_SIGNAL_PEER_CLOSED);
+    } else {
+        port_observers_detach(&p->observers);
+    }
+
+    //the pipe goes once both ends are gone
+    if (__atomic_sub_fetch(&p->refcount, 1, __ATOMIC_SEQ_CST) == 0) {
+        for (uint32 i = 0; i < p->count; i++) {
+            pipe_page_put(pipe_slot(p, i)->page);
+        }
+        kfree(p);
+    }
+
+    return 0;
+}
+
+static object_ops_t pipe_end_ops = {
+    .read = pipe_read,
+    .write = pipe_write,
+    .close = pipe_end_close,
+    .readdir = NULL,
+    .lookup = NULL,
+    .read_user = pipe_read_user,
+    .write_user = pipe_write_user
+};
+
+int pipe_create(process_t *proc, int32 *out_read, int32 *out_write) {
+    if (!proc || !out_read || !out_write) return -1;
+
+    pipe_t *p = kzalloc(sizeof(pipe_t));
+    if (!p) return -1;
+
+    //one ref per end, dropped in pipe_end_close
+    p->refcount = 2;
+    for (int i = 0; i < 2; i++) {
+        p->ends[i].obj.type     = OBJECT_PIPE;
+        p->ends[i].obj.refcount = 1;
+        p->ends[i].obj.flags    = OBJECT_FLAG_EMBEDDED;
+        p->ends[i].obj.ops      = &pipe_end_ops;
+        p->ends[i].obj.data     = &p->ends[i];
+        p->ends[i].pipe         = p;
+        p->ends[i].end          = (uint8)i;
+    }
+    spinlock_irq_init(&p->lock);
+    wait_queue_init(&p->readers);
+    wait_queue_init(&p->writers);
+
+    //each end only gets the direction it is for
+    handle_rights_t base = HANDLE_RIGHTS_BASIC | HANDLE_RIGHT_GET_INFO;
+    int rh = process_grant_handle(proc, &p->ends[PIPE_END_READ].obj, base | HANDLE_RIGHT_READ);
+    if (rh < 0) {
+        kfree(p);
+        return -1;
+    }
+    object_deref(&p->ends[PIPE_END_READ].obj);
+
+    int wh = process_grant_handle(proc, &p->ends[PIPE_END_WRITE].obj, base | HANDLE_RIGHT_WRITE);
+    if (wh < 0) {
+        process_close_handle(proc, rh);
+        object_deref(&p->ends[PIPE_END_WRITE].obj);
+        return -1;
+    }
+    object_deref(&p->ends[PIPE_END_WRITE].obj);
+
+    *out_read = rh;
+    *out_write = wh;
+    return 0;
+}
+
+pipe_end_t *pipe_get(process_t *proc, int32 handle) {
+    if (!proc) return NULL;
+
+    //referenced under the handle table lock so a racing close can't free it
+    spinlock_acquire(&proc->lock);
+    object_t *obj = process_get_handle(proc, handle);
+    if (obj && obj->type == OBJECT_PIPE) object_ref(obj);
+    else obj = NULL;
+    spinlock_release(&proc->lock);
+
+    return (pipe_end_t *)obj;
+}
+
+ssize pipe_splice_pipes(pipe_t *src, pipe_t *dst, size len, uint32 flags) {
+    if (!src || !dst || src == dst) return -1;
+
+    bool nonblock = (flags & SPLICE_NONBLOCK) != 0;
+    size done = 0;
+    ssize result = 0;
+
+    while (done < len) {
+        //check for room first so a full destination never strands a taken page
+        int r = pipe_wait_room(dst, nonblock);
+        if (r < 0) {
+            result = r;
+            break;
+        }
+
+        //only the first buffer is worth waiting for
+        pipe_buf_t b;
+        r = pipe_take(src, len - done, nonblock || done > 0, &b);
+        if (r <= 0) {
+            result = (r == -3 && done > 0) ? 0 : r;
+            break;
+        }
+
+        //dst takes over our page ref
+        r = pipe_push_buf(dst, &b, false);
+        pipe_consume(src, r < 0 ? 0 : b.len);
+        if (r < 0) {
+            pipe_page_put(b.page);
+            result = r;
+            break;
+        }
+        done += b.len;
+    }
+
+    return done > 0 ? (ssize)done : result;
+}
+
+ssize pipe_tee(pipe_t *src, pipe_t *dst, size len, uint32 flags) {
+    if (!src || !dst || src == dst) return -1;
+
+    bool nonblock = (flags & SPLICE_NONBLOCK) != 0;
+    pipe_buf_t bufs[PIPE_BUFFERS];
+    uint32 n = 0;
+    size total = 0;
+
+    irq_state_t irq = spinlock_irq_acquire(&src->lock);
+    int r = pipe_wait_data_locked(src, &irq, nonblock);
+    if (r < 0) {
+        spinlock_irq_release(&src->lock, irq);
+        return r;
+    }
+    for (uint32 i = 0; i < src->count && n < PIPE_BUFFERS && total < len; i++) {
+        pipe_buf_t *b = pipe_slot(src, i);
+        uint32 take = b->len;
+        if (take > len - total) take = (uint32)(len - total);
+        __atomic_add_fetch(&b->page->refs, 1, __ATOMIC_RELAXED);
+        bufs[n].page = b->page;
+        bufs[n].offset = b->offset;
+        bufs[n].len = take;
+        total += take;
+        n++;
+    }
+    spinlock_irq_release(&src->lock, irq);
+
+    size done = 0;
+    ssize result = 0;
+    uint32 i = 0;
+    for (; i < n; i++) {
+        r = pipe_push_buf(dst, &bufs[i], nonblock);
+        if (r < 0) {
+            result = r;
+            break;
+        }
+        done += bufs[i].len;
+    }
+    for (; i < n; i++) pipe_page_put(bufs[i].page);
+
+    return done > 0 ? (ssize)done : result;
+}
+
+ssize pipe_splice_to(pipe_t *src, handle_t out, size len, uint32 flags) {
+    if (!src) return -1;
+
+    bool nonblock = (flags & SPLICE_NONBLOCK) != 0;
+    size done = 0;
+    ssize result = 0;
+
+    while (done < len) {
+        pipe_buf_t b;
+        int r = pipe_take(src, len - done, nonblock || done > 0, &b);
+        if (r <= 0) {
+            result = (r == -3 && done > 0) ? 0 : r;
+            break;
+        }
+
+        //the page is written out in place, no user buffer in between
+        ssize w = handle_write(out, (uint8 *)b.page->data + b.offset, b.len);
+        uint32 used = w > 0 ? (uint32)w : 0;
+        pipe_consume(src, used);
+        pipe_page_put(b.page);
+        done += used;
+        if (used < b.len) {
+            result = w < 0 ? w : 0;
+            break;
+        }
+    }
+
+    return done > 0 ? (ssize)done : result;
+}
+
+ssize pipe_splice_from(handle_t in, pipe_t *dst, size len, uint32 flags) {
+    if (!dst) return -1;
+
+    bool nonblock = (flags & SPLICE_NONBLOCK) != 0;
+    size done = 0;
+    ssize result = 0;
+
+    while (done < len) {
+        int r = pipe_wait_room(dst, nonblock);
+        if (r < 0) {
+            result = r;
+            break;
+        }
+
+        pipe_page_t *pg = pipe_page_alloc();
+        if (!pg) {
+            result = -1;
+            break;
+        }
+
+        //read straight into the page that gets queued
+        size want = len - done < PAGE_SIZE ? len - done : PAGE_SIZE;
+        ssize got = handle_read(in, pg->data, want);
+        if (got <= 0) {
+            pipe_page_put(pg);
+            result = got;
+            break;
+        }
+
+        pipe_buf_t b = { pg, 0, (uint32)got };
+        r = pipe_push_buf(dst, &b, false);
+        if (r < 0) {
+            pipe_page_put(pg);
+            result = r;
+            break;
+        }
+        done += (size)got;
+
+        //a short read is end of file or a socket with nothing more queued
+        if ((size)got < want) break;
+    }
+
+    return done > 0 ? (ssize)done : result;
+}
+
+port_observers_t *pipe_port_observers(pipe_end_t *end, uint32 *level) {
+    pipe_t *p = end->pipe;
+
+    irq_state_t flags = spinlock_irq_acquire(&p->lock);
+    uint32 l = 0;
+    if (p->bytes > 0) l |= PORT_SIGNAL_READABLE;
+    if (p->closed[PIPE_END_WRITE]) l |= PORT_SIGNAL_PEER_CLOSED;
+    spinlock_irq_release(&p->lock, flags);
+
+    *level = l;
+    return &p->observers;
+}
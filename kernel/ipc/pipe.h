@@ -0,0 +1,96 @@
+#ifndef IPC_PIPE_H
+#define IPC_PIPE_H
+
+#include <arch/types.h>
+#include <obj/object.h>
+#include <obj/rights.h>
+#include <obj/handle.h>
+#include <proc/wait.h>
+#include <lib/spinlock.h>
+#include <ipc/port.h>
+
+/*
+ *pipes - anonymous byte streams
+ *
+ *a pipe is a ring of page sized buffers with a read end and a write end
+ *reads block until some data is queued (or every writer is gone, which reads
+ *as end of file) and writes block while the ring is full
+ *
+ *buffers reference refcounted pages rather than owning bytes, so splice can
+ *move a page from one pipe to another and tee can share it between two
+ *without copying. splice to or from a file or socket goes straight between
+ *the pipe page and the object, never through a user buffer
+*/
+
+#define PIPE_BUFFERS        16      //ring slots, one page each
+#define PIPE_MAX_SPLICE     (1u << 20)
+
+//splice/tee flags
+#define SPLICE_NONBLOCK     (1 << 0)    //return -3 instead of waiting
+
+#define PIPE_END_READ       0
+#define PIPE_END_WRITE      1
+
+struct process;
+struct pipe;
+
+//page shared by every pipe buffer pointing at it
+typedef struct pipe_page {
+    void *data;         //HHDM address of the frame
+    uintptr phys;
+    uint32 refs;
+} pipe_page_t;
+
+typedef struct {
+    pipe_page_t *page;
+    uint32 offset;
+    uint32 len;
+} pipe_buf_t;
+
+typedef struct pipe_end {
+    object_t obj;               //kernel object (embedded, OBJECT_PIPE)
+    struct pipe *pipe;
+    uint8 end;                  //PIPE_END_READ or PIPE_END_WRITE
+} pipe_end_t;
+
+typedef struct pipe {
+    pipe_end_t ends[2];
+    spinlock_irq_t lock;
+    pipe_buf_t bufs[PIPE_BUFFERS];
+    uint32 head;                //oldest queued buffer
+    uint32 count;               //queued buffers
+    size bytes;                 //queued bytes
+    uint8 taken;                //a reader is moving the front buffer out
+    uint8 closed[2];
+    wait_queue_t readers;       //waiting for data
+    wait_queue_t writers;       //waiting for a free slot
+    port_observers_t observers; //ports watching the read end
+    uint32 refcount;            //one per open end
+} pipe_t;
+
+//create a pipe and grant a read-only and a write-only handle to proc
+int pipe_create(struct process *proc, int32 *out_read, int32 *out_write);
+
+//get a referenced pipe end from handle (returns NULL if not a pipe)
+//the caller drops it with object_deref
+pipe_end_t *pipe_get(struct process *proc, int32 handle);
+
+//the calls below return bytes moved, 0 at end of file, -3 if SPLICE_NONBLOCK
+//would have to wait, -4 once the destination pipe has no reader, -9 if interrupted
+
+//move up to len bytes between two pipes, pages change hands without copying
+ssize pipe_splice_pipes(pipe_t *src, pipe_t *dst, size len, uint32 flags);
+
+//duplicate up to len queued bytes of src into dst without consuming them
+ssize pipe_tee(pipe_t *src, pipe_t *dst, size len, uint32 flags);
+
+//drain up to len bytes of src into handle out (file, socket, device)
+ssize pipe_splice_to(pipe_t *src, handle_t out, size len, uint32 flags);
+
+//fill dst with up to len bytes read from handle in straight into pipe pages
+ssize pipe_splice_from(handle_t in, pipe_t *dst, size len, uint32 flags);
+
+//port source hook: observers of a read end and its current level
+port_observers_t *pipe_port_observers(pipe_end_t *end, uint32 *level);
+
+#endif
@@ -0,0 +1,357 @@
+#include <ipc/port.h>
+#include <ipc/channel.h>
+#include <ipc/pipe.h>
+#include <net/socket.h>
+#include <proc/process.h>
+#include <proc/event.h>
+#include <proc/rcu.h>
+#include <arch/timer.h>
+#include <mm/kheap.h>
+
+//guards every observer list and binding->obs, taken before any port lock
+//sources only touch it when somebody is actually watching them
+static spinlock_irq_t port_obs_lock = SPINLOCK_IRQ_INIT;
+
+//queue a binding on its port (port_obs_lock or port->lock context)
+static void port_raise_locked(port_t *port, port_binding_t *b, uint32 signals) {
+    b->pending |= signals;
+    if (b->queued) return;
+
+    b->queued = 1;
+    b->ready_next = NULL;
+    if (port->ready_tail) {
+        port->ready_tail->ready_next = b;
+    } else {
+        port->ready_head = b;
+    }
+    port->ready_tail = b;
+    thread_wake_all(&port->waiters);
+}
+
+static void port_raise(port_binding_t *b, uint32 signals) {
+    port_t *port = b->port;
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+    port_raise_locked(port, b, signals);
+    spinlock_irq_release(&port->lock, flags);
+}
+
+void port_observers_signal(port_observers_t *obs, uint32 signals) {
+    if (!obs) return;
+
+    //pairs with the fence in port_bind: either we see the new binding or
+    //the binder sees the state change we are signalling
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&obs->head, __ATOMIC_RELAXED)) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&port_obs_lock);
+    for (port_binding_t *b = obs->head; b; b = b->obs_next) {
+        if (b->want & signals) port_raise(b, b->want & signals);
+    }
+    spinlock_irq_release(&port_obs_lock, flags);
+}
+
+void port_observers_detach(port_observers_t *obs) {
+    if (!obs) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&port_obs_lock);
+    port_binding_t *b = obs->head;
+    while (b) {
+        port_binding_t *next = b->obs_next;
+        b->obs = NULL;
+        b->obs_next = NULL;
+        b = next;
+    }
+    obs->head = NULL;
+    spinlock_irq_release(&port_obs_lock, flags);
+}
+
+//unlink from the source list, caller holds port_obs_lock
+static void port_binding_unlink_obs(port_binding_t *b) {
+    if (!b->obs) return;
+
+    port_binding_t **bp = &b->obs->head;
+    while (*bp && *bp != b) bp = &(*bp)->obs_next;
+    if (*bp) *bp = b->obs_next;
+    b->obs = NULL;
+    b->obs_next = NULL;
+}
+
+//unlink from the ready list, caller holds port->lock
+static void port_binding_unqueue(port_t *port, port_binding_t *b) {
+    if (!b->queued) return;
+
+    port_binding_t *prev = NULL;
+    for (port_binding_t *cur = port->ready_head; cur; prev = cur, cur = cur->ready_next) {
+        if (cur != b) continue;
+        if (prev) {
+            prev->ready_next = b->ready_next;
+        } else {
+            port->ready_head = b->ready_next;
+        }
+        if (port->ready_tail == b) port->ready_tail = prev;
+        break;
+    }
+    b->queued = 0;
+    b->ready_next = NULL;
+}
+
+static port_binding_t *port_find_locked(port_t *port, uint64 key) {
+    for (port_binding_t *b = port->bindings; b; b = b->next) {
+        if (b->key == key) return b;
+    }
+    return NULL;
+}
+
+static int port_obj_close(object_t *obj) {
+    port_t *port = (port_t *)obj;
+
+    irq_state_t obs_flags = spinlock_irq_acquire(&port_obs_lock);
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+    port_binding_t *b = port->bindings;
+    port->bindings = NULL;
+    port->ready_head = NULL;
+    port->ready_tail = NULL;
+    for (port_binding_t *cur = b; cur; cur = cur->next) {
+        port_binding_unlink_obs(cur);
+    }
+    spinlock_irq_release(&port->lock, flags);
+    spinlock_irq_release(&port_obs_lock, obs_flags);
+
+    while (b) {
+        port_binding_t *next = b->next;
+        kfree(b);
+        b = next;
+    }
+    return 0;
+}
+
+static object_ops_t port_ops = {
+    .read = NULL,
+    .write = NULL,
+    .close = port_obj_close,
+    .readdir = NULL,
+    .lookup = NULL
+};
+
+int32 port_create(process_t *proc, handle_rights_t rights) {
+    if (!proc) return -1;
+
+    port_t *port = kzalloc(sizeof(port_t));
+    if (!port) return -1;
+
+    port->obj.type = OBJECT_PORT;
+    port->obj.refcount = 0;
+    port->obj.ops = &port_ops;
+    port->obj.data = port;
+    spinlock_irq_init(&port->lock);
+    wait_queue_init(&port->waiters);
+
+    int32 h = process_grant_handle(proc, &port->obj, rights);
+    if (h < 0) {
+        kfree(port);
+        return -1;
+    }
+
+    return h;
+}
+
+port_t *port_get(process_t *proc, int32 handle) {
+    if (!proc) return NULL;
+
+    object_t *obj = process_get_handle(proc, handle);
+    if (!obj || obj->type != OBJECT_PORT) return NULL;
+
+    return (port_t *)obj;
+}
+
+//find the observer list of a source and its current signal level
+//returns NULL with a level if the source can be watched but is already gone
+static int port_source(object_t *obj, port_observers_t **obs, uint32 *level) {
+    switch (obj->type) {
+        case OBJECT_CHANNEL:
+            *obs = channel_port_observers((channel_endpoint_t *)obj, level);
+            return 0;
+        case OBJECT_SOCKET:
+            *obs = socket_port_observers(obj, level);
+            return 0;
+        case OBJECT_PROCESS:
+            *obs = process_port_observers(obj, level);
+            return 0;
+        case OBJECT_PIPE:
+            //only the read end has anything to wait for
+            if (((pipe_end_t *)obj)->end != PIPE_END_READ) return -1;
+            *obs = pipe_port_observers((pipe_end_t *)obj, level);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+int port_bind(port_t *port, object_t *obj, uint64 key, uint32 signals) {
+    if (!port || !obj || !signals) return -1;
+
+    port_binding_t *b = kzalloc(sizeof(port_binding_t));
+    if (!b) return -1;
+    b->port = port;
+    b->key = key;
+    b->type = obj->type;
+    b->want = signals;
+
+    rcu_read_lock();
+    irq_state_t obs_flags = spinlock_irq_acquire(&port_obs_lock);
+
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+    if (port_find_locked(port, key)) {
+        spinlock_irq_release(&port->lock, flags);
+        spinlock_irq_release(&port_obs_lock, obs_flags);
+        rcu_read_unlock();
+        kfree(b);
+        return -4;  //key already bound
+    }
+    spinlock_irq_release(&port->lock, flags);
+
+    //link first, then sample the level (see port_observers_signal)
+    port_observers_t *obs = NULL;
+    uint32 level = 0;
+    if (port_source(obj, &obs, &level) < 0) {
+        spinlock_irq_release(&port_obs_lock, obs_flags);
+        rcu_read_unlock();
+        kfree(b);
+        return -2;  //object cannot be watched
+    }
+    if (obs) {
+        b->obs = obs;
+        b->obs_next = obs->head;
+        __atomic_store_n(&obs->head, b, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        port_source(obj, &obs, &level);
+    }
+
+    flags = spinlock_irq_acquire(&port->lock);
+    b->next = port->bindings;
+    port->bindings = b;
+    if (level & signals) port_raise_locked(port, b, level & signals);
+    spinlock_irq_release(&port->lock, flags);
+
+    spinlock_irq_release(&port_obs_lock, obs_flags);
+    rcu_read_unlock();
+    return 0;
+}
+
+int port_set_timer(port_t *port, uint64 key, uint64 deadline) {
+    if (!port || !deadline) return -1;
+
+    port_binding_t *fresh = kzalloc(sizeof(port_binding_t));
+    if (!fresh) return -1;
+
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+    port_binding_t *b = port_find_locked(port, key);
+    if (b && (b->obs || b->type != 0)) {
+        spinlock_irq_release(&port->lock, flags);
+        kfree(fresh);
+        return -4;  //key belongs to an object binding
+    }
+
+    if (b) {
+        //rearm an existing timer, dropping a not yet collected expiry
+        port_binding_unqueue(port, b);
+        b->pending = 0;
+        b->deadline = deadline;
+    } else {
+        b = fresh;
+        fresh = NULL;
+        b->port = port;
+        b->key = key;
+        b->want = PORT_SIGNAL_TIMER;
+        b->deadline = deadline;
+        b->next = port->bindings;
+        port->bindings = b;
+    }
+
+    //a sleeper may need to shorten its timeout
+    thread_wake_all(&port->waiters);
+    spinlock_irq_release(&port->lock, flags);
+
+    if (fresh) kfree(fresh);
+    return 0;
+}
+
+int port_unbind(port_t *port, uint64 key) {
+    if (!port) return -1;
+
+    irq_state_t obs_flags = spinlock_irq_acquire(&port_obs_lock);
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+
+    port_binding_t **bp = &port->bindings;
+    while (*bp && (*bp)->key != key) bp = &(*bp)->next;
+    port_binding_t *b = *bp;
+    if (b) {
+        *bp = b->next;
+        port_binding_unqueue(port, b);
+        port_binding_unlink_obs(b);
+    }
+
+    spinlock_irq_release(&port->lock, flags);
+    spinlock_irq_release(&port_obs_lock, obs_flags);
+
+    if (!b) return -1;
+    kfree(b);
+    return 0;
+}
+
+//fire due timers, returns the earliest deadline still armed (0 if none)
+static uint64 port_fire_timers_locked(port_t *port, uint64 now) {
+    uint64 next = 0;
+    for (port_binding_t *b = port->bindings; b; b = b->next) {
+        if (!b->deadline) continue;
+        if (b->deadline <= now) {
+            b->deadline = 0;
+            port_raise_locked(port, b, PORT_SIGNAL_TIMER);
+        } else if (!next || b->deadline < next) {
+            next = b->deadline;
+        }
+    }
+    return next;
+}
+
+int port_wait(port_t *port, port_packet_t *out, uint32 max, uint64 deadline, bool poll) {
+    if (!port || !out || max == 0) return -1;
+
+    irq_state_t flags = spinlock_irq_acquire(&port->lock);
+    for (;;) {
+        uint64 now = arch_timer_get_ticks();
+        uint64 next_timer = port_fire_timers_locked(port, now);
+        if (port->ready_head) break;
+
+        if (poll || (deadline && now >= deadline)) {
+            spinlock_irq_release(&port->lock, flags);
+            return 0;
+        }
+        if (proc_current_should_abort_blocking()) {
+            spinlock_irq_release(&port->lock, flags);
+            return -3;  //interrupted by process event
+        }
+
+        uint64 wake = deadline;
+        if (next_timer && (!wake || next_timer < wake)) wake = next_timer;
+        thread_sleep_locked_irq_timeout(&port->waiters, &port->lock, &flags, wake);
+    }
+
+    uint32 n = 0;
+    while (n < max && port->ready_head) {
+        port_binding_t *b = port->ready_head;
+        port->ready_head = b->ready_next;
+        if (!port->ready_head) port->ready_tail = NULL;
+        b->ready_next = NULL;
+        b->queued = 0;
+
+        out[n].key = b->key;
+        out[n].type = b->type;
+        out[n].signals = b->pending;
+        b->pending = 0;
+        n++;
+    }
+
+    spinlock_irq_release(&port->lock, flags);
+    return (int)n;
+}
@@ -0,0 +1,97 @@
+#ifndef IPC_PORT_H
+#define IPC_PORT_H
+
+#include <arch/types.h>
+#include <obj/object.h>
+#include <obj/rights.h>
+#include <proc/wait.h>
+#include <lib/spinlock.h>
+
+/*
+ *ports - wait on many handles at once
+ *
+ *a handle is bound to a port with a caller chosen key and a signal mask
+ *when the source raises one of those signals the binding is queued on the
+ *port and port_wait hands back (key, signals) packets in batches
+ *
+ *delivery is edge triggered: a packet means "something changed", the
+ *caller drains the source (until try_recv says empty) before waiting again
+ *binding reports the current level once so nothing already pending is lost
+ *
+ *sources keep a port_observers_t list; bindings never hold a reference on
+ *their source, a source that goes away detaches its observers instead
+*/
+
+//readiness signals
+#define PORT_SIGNAL_READABLE    (1 << 0)    //channel message queued / socket data
+#define PORT_SIGNAL_PEER_CLOSED (1 << 1)    //channel peer or socket remote closed
+#define PORT_SIGNAL_EXITED      (1 << 2)    //process exited
+#define PORT_SIGNAL_TIMER       (1 << 3)    //port timer expired
+
+#define PORT_WAIT_MAX_PACKETS   32
+
+struct port_binding;
+struct process;
+
+//per-source list of bindings watching it
+typedef struct port_observers {
+    struct port_binding *head;
+} port_observers_t;
+
+//packet returned by port_wait (ABI, mirrored in user system.h)
+typedef struct {
+    uint64 key;
+    uint32 type;        //OBJECT_* of the source, 0 for timers
+    uint32 signals;     //PORT_SIGNAL_* raised since the last packet
+} port_packet_t;
+
+typedef struct port_binding {
+    struct port *port;
+    port_observers_t *obs;          //source list, NULL for timers or once detached
+    uint64 key;
+    uint32 type;
+    uint32 want;                    //signals of interest
+    uint32 pending;                 //signals raised and not yet delivered
+    uint8 queued;                   //on the port ready list
+    uint64 deadline;                //timer bindings: tick to fire at, 0 once fired
+    struct port_binding *next;      //port binding list
+    struct port_binding *ready_next;
+    struct port_binding *obs_next;  //source observer list
+} port_binding_t;
+
+typedef struct port {
+    object_t obj;                   //kernel object (embedded)
+    spinlock_irq_t lock;
+    wait_queue_t waiters;
+    port_binding_t *bindings;
+    port_binding_t *ready_head;
+    port_binding_t *ready_tail;
+} port_t;
+
+//create a port and grant a handle to proc
+int32 port_create(struct process *proc, handle_rights_t rights);
+
+//get port from handle (returns NULL if not a port)
+port_t *port_get(struct process *proc, int32 handle);
+
+//watch obj (channel endpoint, socket or process) for signals under key
+int port_bind(port_t *port, object_t *obj, uint64 key, uint32 signals);
+
+//arm a one-shot timer that raises PORT_SIGNAL_TIMER under key at tick deadline
+int port_set_timer(port_t *port, uint64 key, uint64 deadline);
+
+//remove the binding or timer registered under key
+int port_unbind(port_t *port, uint64 key);
+
+//wait for up to max packets
+//deadline is an absolute tick (0 = forever), poll returns at once if nothing is ready
+//returns the number of packets, 0 on timeout, -3 if interrupted
+int port_wait(port_t *port, port_packet_t *out, uint32 max, uint64 deadline, bool poll);
+
+//raise signals on every binding watching a source
+void port_observers_signal(port_observers_t *obs, uint32 signals);
+
+//detach every binding from a source that is going away
+void port_observers_detach(port_observers_t *obs);
+
+#endif
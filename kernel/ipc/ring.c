@@ -0,0 +1,51 @@
+#include <ipc/ring.h>
+#include <ipc/doorbell.h>
+#include <mm/vmo.h>
+#include <proc/process.h>
+#include <lib/string.h>
+
+int ring_create(process_t *proc, uint32 slot_size, uint32 slot_count, uint32 flags,
+                int32 *vmo_out, int32 *bell_out) {
+    if (!proc || !vmo_out || !bell_out) return -1;
+    if (slot_size == 0 || slot_size > RING_MAX_SLOT_SIZE) return -2;
+    if (slot_count < 2 || slot_count > RING_MAX_SLOTS) return -2;
+    if (slot_count & (slot_count - 1)) return -2;  //must be a power of two
+    if (flags & ~RING_FLAG_MPSC) return -2;
+
+    //keep every slot header 16 byte aligned
+    uint32 stride = (sizeof(ring_slot_t) + slot_size + 15) & ~15u;
+    size total = RING_HEADER_SIZE + (size)stride * slot_count;
+
+    int32 vh = vmo_create(proc, total, 0, HANDLE_RIGHTS_DEFAULT | HANDLE_RIGHT_MAP);
+    if (vh < 0) return -1;
+
+    vmo_t *vmo = vmo_get(proc, vh);
+    if (!vmo) {
+        process_close_handle(proc, vh);
+        return -1;
+    }
+
+    //VMO pages come back zeroed, fill in geometry and slot sequences
+    ring_header_t *hdr = (ring_header_t *)vmo->pages;
+    hdr->magic = RING_MAGIC;
+    hdr->flags = flags;
+    hdr->slot_size = slot_size;
+    hdr->slot_count = slot_count;
+    hdr->slot_stride = stride;
+
+    char *slots = (char *)vmo->pages + RING_HEADER_SIZE;
+    for (uint32 i = 0; i < slot_count; i++) {
+        ring_slot_t *slot = (ring_slot_t *)(slots + (size)i * stride);
+        slot->seq = i;
+    }
+
+    int32 bh = doorbell_create(proc, HANDLE_RIGHTS_DEFAULT);
+    if (bh < 0) {
+        process_close_handle(proc, vh);
+        return -1;
+    }
+
+    *vmo_out = vh;
+    *bell_out = bh;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef IPC_RING_H
+#define IPC_RING_H
+
+#include <arch/types.h>
+#include <obj/rights.h>
+
+/*
+ *shared-memory ring channels
+ *
+ *the kernel only builds the ring: a VMO holding a header and a power of two
+ *array of fixed size slots, plus a doorbell for sleeping. producers and the
+ *single consumer then map the VMO and move messages with plain loads and
+ *stores, entering the kernel only to sleep or to wake a sleeping peer
+ *
+ *every slot carries a sequence number (bounded queue a la vyukov):
+ *  seq == pos              slot is free for the producer claiming pos
+ *  seq == pos + 1          slot holds the message published at pos
+ *  seq == pos + slot_count consumer released it for the next lap
+ *with RING_FLAG_MPSC producers claim head with a CAS, otherwise a plain store
+ *
+ *the layout below is ABI and mirrored in user/libc/include/system.h
+*/
+
+#define RING_MAGIC          0x474e4952  //"RING"
+#define RING_FLAG_MPSC      (1 << 0)    //several producers share the ring
+
+#define RING_HEADER_SIZE    256
+#define RING_MAX_SLOTS      4096
+#define RING_MAX_SLOT_SIZE  (64 * 1024)
+
+typedef struct {
+    uint32 magic;
+    uint32 flags;                   //RING_FLAG_*
+    uint32 slot_size;               //payload bytes per slot
+    uint32 slot_count;              //power of two
+    uint32 slot_stride;             //bytes from one slot to the next
+    uint32 reserved[11];
+
+    //each index lives on its own cache line so the two sides do not bounce it
+    volatile uint64 head;           //next position a producer claims
+    uint8 pad0[56];
+    volatile uint64 tail;           //next position the consumer reads
+    uint8 pad1[56];
+
+    //set by a side about to sleep on the doorbell, cleared by whoever rings it
+    volatile uint32 consumer_waiting;
+    volatile uint32 producer_waiting;
+    uint8 pad2[56];
+} ring_header_t;
+
+typedef struct {
+    volatile uint64 seq;
+    uint32 len;                     //bytes used in this slot's payload
+    uint32 reserved;
+} ring_slot_t;
+
+_Static_assert(sizeof(ring_header_t) == RING_HEADER_SIZE, "ring header is ABI");
+
+struct process;
+
+//create a ring VMO and its doorbell, both granted to proc
+//returns 0 or negative error
+int ring_create(struct process *proc, uint32 slot_size, uint32 slot_count, uint32 flags,
+                int32 *vmo_out, int32 *bell_out);
+
+#endif
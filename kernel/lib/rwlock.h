@@ -0,0 +1,61 @@
+#ifndef LIB_RWLOCK_H
+#define LIB_RWLOCK_H
+
+#include <arch/types.h>
+#include <arch/cpu.h>
+
+//reader-writer spinlock
+//readers only share one atomic counter and never exclude each other
+//a waiting writer sets RWLOCK_WRITER_WAIT so new readers back off and the
+//writer cannot be starved by a steady stream of lookups
+typedef struct {
+    volatile uint32 state;
+} rwlock_t;
+
+#define RWLOCK_WRITER       0x80000000u
+#define RWLOCK_WRITER_WAIT  0x40000000u
+#define RWLOCK_READER_MASK  0x3FFFFFFFu
+
+#define RWLOCK_INIT {0}
+
+static inline void rwlock_init(rwlock_t *rw) {
+    rw->state = 0;
+}
+
+static inline void rwlock_read_acquire(rwlock_t *rw) {
+    for (;;) {
+        uint32 s = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+        if (!(s & (RWLOCK_WRITER | RWLOCK_WRITER_WAIT)) &&
+            __atomic_compare_exchange_n(&rw->state, &s, s + 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        arch_pause();
+    }
+}
+
+static inline void rwlock_read_release(rwlock_t *rw) {
+    __atomic_sub_fetch(&rw->state, 1, __ATOMIC_RELEASE);
+}
+
+static inline void rwlock_write_acquire(rwlock_t *rw) {
+    for (;;) {
+        uint32 s = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+        if (!(s & (RWLOCK_WRITER | RWLOCK_READER_MASK))) {
+            //free (possibly with our own or another writer's wait bit set)
+            if (__atomic_compare_exchange_n(&rw->state, &s, RWLOCK_WRITER, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+        } else if (!(s & RWLOCK_WRITER_WAIT)) {
+            __atomic_fetch_or(&rw->state, RWLOCK_WRITER_WAIT, __ATOMIC_RELAXED);
+        }
+        arch_pause();
+    }
+}
+
+static inline void rwlock_write_release(rwlock_t *rw) {
+    __atomic_store_n(&rw->state, 0, __ATOMIC_RELEASE);
+}
+
+#endif
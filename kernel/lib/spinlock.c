@@ -0,0 +1,37 @@
+#include <lib/spinlock.h>
+#include <lib/string.h>
+#include <syscall/syscall.h>
+
+//registered statistics, append-only so readers can walk it without a lock
+static spinlock_stats_t *stats_head = NULL;
+static spinlock_t stats_lock = SPINLOCK_INIT;
+
+void spinlock_stats_register(spinlock_stats_t *stats) {
+    if (!stats) return;
+
+    spinlock_acquire(&stats_lock);
+    if (!stats->registered) {
+        stats->registered = 1;
+        stats->next = stats_head;
+        __atomic_store_n(&stats_head, stats, __ATOMIC_RELEASE);
+    }
+    spinlock_release(&stats_lock);
+}
+
+uint32 spinlock_stats_snapshot(lock_stats_t *out, uint32 max) {
+    uint32 count = 0;
+    spinlock_stats_t *st = __atomic_load_n(&stats_head, __ATOMIC_ACQUIRE);
+
+    for (; st && count < max; st = st->next) {
+        lock_stats_t *e = &out[count++];
+        memset(e, 0, sizeof(*e));
+        if (st->name) strncpy(e->name, st->name, sizeof(e->name) - 1);
+        //counters are updated by lock holders, a torn read only skews one sample
+        e->acquisitions = st->acquisitions;
+        e->contended = st->contended;
+        e->spin_cycles = st->spin_cycles;
+        e->max_hold_cycles = st->max_hold_cycles;
+    }
+
+    return count;
+}
@@ -4,25 +4,76 @@
 #include <arch/types.h>
 #include <arch/cpu.h>
 
+//optional contention statistics, attached to hot global locks
+//counters are only written by the lock holder so they need no atomics
+typedef struct spinlock_stats {
+    const char *name;
+    uint64 acquisitions;
+    uint64 contended;           //acquisitions that had to wait
+    uint64 spin_cycles;         //TSC cycles spent waiting
+    uint64 max_hold_cycles;     //longest critical section seen
+    uint64 hold_start;          //TSC at the current acquisition
+    struct spinlock_stats *next;
+    uint8 registered;
+} spinlock_stats_t;
+
+#define SPINLOCK_STATS_INIT(n) { (n), 0, 0, 0, 0, 0, NULL, 0 }
+
+//ticket lock: waiters are served in FIFO order and only read owner
+//while spinning so the line is not bounced by atomic writes
 typedef struct {
-    volatile int lock;
+    volatile uint32 next;       //next ticket to hand out
+    volatile uint32 owner;      //ticket currently allowed in
+    spinlock_stats_t *stats;
 } spinlock_t;
 
-#define SPINLOCK_INIT {0}
+#define SPINLOCK_INIT {0, 0, NULL}
+#define SPINLOCK_INIT_STATS(st) {0, 0, (st)}
 #define SPINLOCK_IRQ_INIT { SPINLOCK_INIT }
+#define SPINLOCK_IRQ_INIT_STATS(st) { SPINLOCK_INIT_STATS(st) }
 
 static inline void spinlock_init(spinlock_t *sl) {
-    sl->lock = 0;
+    sl->next = 0;
+    sl->owner = 0;
+    sl->stats = NULL;
 }
 
 static inline void spinlock_acquire(spinlock_t *sl) {
-    while (__atomic_test_and_set(&sl->lock, __ATOMIC_ACQUIRE)) {
-        arch_pause();
+    uint32 ticket = __atomic_fetch_add(&sl->next, 1, __ATOMIC_RELAXED);
+    uint32 owner = __atomic_load_n(&sl->owner, __ATOMIC_ACQUIRE);
+    spinlock_stats_t *st = sl->stats;
+
+    if (owner != ticket) {
+        uint64 start = st ? arch_rdtsc() : 0;
+        do {
+            //back off in proportion to our place in the queue
+            for (uint32 i = ticket - owner; i > 0; i--) arch_pause();
+            owner = __atomic_load_n(&sl->owner, __ATOMIC_ACQUIRE);
+        } while (owner != ticket);
+
+        if (st) {
+            uint64 now = arch_rdtsc();
+            st->contended++;
+            st->spin_cycles += now - start;
+            st->hold_start = now;
+            st->acquisitions++;
+        }
+        return;
+    }
+
+    if (st) {
+        st->hold_start = arch_rdtsc();
+        st->acquisitions++;
     }
 }
 
 static inline void spinlock_release(spinlock_t *sl) {
-    __atomic_clear(&sl->lock, __ATOMIC_RELEASE);
+    spinlock_stats_t *st = sl->stats;
+    if (st) {
+        uint64 held = arch_rdtsc() - st->hold_start;
+        if (held > st->max_hold_cycles) st->max_hold_cycles = held;
+    }
+    __atomic_store_n(&sl->owner, sl->owner + 1, __ATOMIC_RELEASE);
 }
 
 typedef struct {
@@ -44,4 +95,11 @@ static inline void spinlock_irq_release(spinlock_irq_t *sl, irq_state_t flags) {
     arch_irq_restore(flags);
 }
 
+//make a lock's statistics visible through OBJ_INFO_LOCK_STATS
+void spinlock_stats_register(spinlock_stats_t *stats);
+
+//copy up to max registered entries into out, returns the number written
+typedef struct lock_stats lock_stats_t;
+uint32 spinlock_stats_snapshot(lock_stats_t *out, uint32 max);
+
 #endif
@@ -2,6 +2,7 @@
 #include <arch/timer.h>
 #include <arch/percpu.h>
 #include <proc/sched.h>
+#include <proc/rcu.h>
 
 static void wait_ticks(uint64 ticks_needed) {
     if (ticks_needed == 0) return;
@@ -10,6 +11,8 @@ static void wait_ticks(uint64 ticks_needed) {
     while ((arch_timer_get_ticks() - start) < ticks_needed) {
         percpu_t *cpu = percpu_get();
         if (cpu && cpu->sched_running) {
+            //a sleeping kernel thread holds no RCU references
+            rcu_note_quiescent();
             sched_yield();
         } else {
             arch_halt();
@@ -15,7 +15,8 @@ static size bucket_sizes[BUCKET_COUNT] = {16, 32, 64, 128, 256, 512, 1024, 2048}
 
 static uintptr heap_virt_cursor = KHEAP_VIRT_START;
 static bool kheap_ready = false;
-static spinlock_irq_t kheap_lock = SPINLOCK_IRQ_INIT;
+static spinlock_stats_t kheap_lock_stats = SPINLOCK_STATS_INIT("kheap");
+static spinlock_irq_t kheap_lock = SPINLOCK_IRQ_INIT_STATS(&kheap_lock_stats);
 static uint64 current_slab_used = 0;
 static uint64 current_slab_capacity = 0;
 static uint64 current_large_used = 0;
@@ -230,6 +231,8 @@ static void slab_destroy(slab_t *slab) {
 }
 
 void kheap_init(void) {
+    spinlock_stats_register(&kheap_lock_stats);
+
     for (int i = 0; i < BUCKET_COUNT; i++) {
         buckets[i].obj_size = bucket_sizes[i];
         buckets[i].partial_slabs = NULL;
@@ -0,0 +1,460 @@
+#include <mm/ksm.h>
+#include <mm/pmm.h>
+#include <mm/mm.h>
+#include <mm/kheap.h>
+#include <arch/mmu.h>
+#include <arch/smp.h>
+#include <proc/process.h>
+#include <proc/thread.h>
+#include <proc/sched.h>
+#include <lib/crc32.h>
+#include <lib/string.h>
+#include <lib/spinlock.h>
+#include <lib/time.h>
+#include <lib/io.h>
+
+#define KSM_HASH_BUCKETS     1024
+#define KSM_CANDIDATE_SLOTS  8192
+#define KSM_CANDIDATE_PROBE  16
+#define KSM_MAX_SCAN_PROCS   256
+
+//a frame shared by one or more read-only user mappings
+typedef struct ksm_frame {
+    uintptr phys;
+    uint32 hash;
+    uint32 refs;                    //number of PTEs pointing at this frame
+    struct ksm_frame *hash_next;
+    struct ksm_frame *phys_next;
+} ksm_frame_t;
+
+//one page picked up by the scanner during a pass
+typedef struct {
+    uintptr virt;
+    uintptr phys;
+    uint64 flags;       //mapping flags at collection time
+    uint32 hash;
+    uint8 wanted;       //hash matched a stable frame or an earlier candidate
+    uint8 protected;    //scanner cleared the write bit for this pass
+    uint8 merged;       //phys was replaced and must be freed after shootdown
+} ksm_item_t;
+
+typedef struct {
+    uint64 pids[KSM_MAX_SCAN_PROCS];
+    uint32 count;
+} ksm_pid_list_t;
+
+//protects both frame tables, frame refcounts and PTE edits on COW pages
+static spinlock_irq_t ksm_lock = SPINLOCK_IRQ_INIT;
+static ksm_frame_t *ksm_by_hash[KSM_HASH_BUCKETS];
+static ksm_frame_t *ksm_by_phys[KSM_HASH_BUCKETS];
+static volatile uint32 ksm_frame_count = 0;
+static uint64 ksm_total_refs = 0;
+static uint64 ksm_cow_breaks = 0;
+
+static bool ksm_enabled = false;
+static bool ksm_started = false;
+
+//scanner-private state
+static uint64 ksm_pages_scanned = 0;
+static uint64 ksm_full_scans = 0;
+//hashes seen once in the current pass (0 marks an empty slot)
+static uint32 ksm_candidates[KSM_CANDIDATE_SLOTS];
+
+void ksm_set_enabled(bool enabled) {
+    ksm_enabled = enabled;
+}
+
+bool ksm_is_enabled(void) {
+    return ksm_enabled;
+}
+
+static uint32 ksm_page_hash(uintptr phys) {
+    uint32 h = crc32(P2V(phys), PAGE_SIZE);
+    return h ? h : 1;
+}
+
+static size ksm_phys_bucket(uintptr phys) {
+    return (phys / PAGE_SIZE) % KSM_HASH_BUCKETS;
+}
+
+static ksm_frame_t *ksm_find_phys_locked(uintptr phys) {
+    for (ksm_frame_t *f = ksm_by_phys[ksm_phys_bucket(phys)]; f; f = f->phys_next) {
+        if (f->phys == phys) return f;
+    }
+    return NULL;
+}
+
+static bool ksm_hash_known_locked(uint32 hash) {
+    for (ksm_frame_t *f = ksm_by_hash[hash % KSM_HASH_BUCKETS]; f; f = f->hash_next) {
+        if (f->hash == hash) return true;
+    }
+    return false;
+}
+
+//find a stable frame holding exactly the contents of phys
+static ksm_frame_t *ksm_find_content_locked(uint32 hash, uintptr phys) {
+    for (ksm_frame_t *f = ksm_by_hash[hash % KSM_HASH_BUCKETS]; f; f = f->hash_next) {
+        if (f->hash != hash || f->phys == phys) continue;
+        if (memcmp(P2V(f->phys), P2V(phys), PAGE_SIZE) == 0) return f;
+    }
+    return NULL;
+}
+
+static void ksm_insert_locked(ksm_frame_t *f) {
+    size hb = f->hash % KSM_HASH_BUCKETS;
+    size pb = ksm_phys_bucket(f->phys);
+    f->hash_next = ksm_by_hash[hb];
+    ksm_by_hash[hb] = f;
+    f->phys_next = ksm_by_phys[pb];
+    ksm_by_phys[pb] = f;
+    __atomic_add_fetch(&ksm_frame_count, 1, __ATOMIC_RELEASE);
+}
+
+static void ksm_remove_locked(ksm_frame_t *f) {
+    ksm_frame_t **pp = &ksm_by_hash[f->hash % KSM_HASH_BUCKETS];
+    while (*pp) {
+        if (*pp == f) { *pp = f->hash_next; break; }
+        pp = &(*pp)->hash_next;
+    }
+    pp = &ksm_by_phys[ksm_phys_bucket(f->phys)];
+    while (*pp) {
+        if (*pp == f) { *pp = f->phys_next; break; }
+        pp = &(*pp)->phys_next;
+    }
+    __atomic_sub_fetch(&ksm_frame_count, 1, __ATOMIC_RELEASE);
+}
+
+bool ksm_handle_fault(uintptr addr, uint64 error_code, irq_state_t interrupted) {
+    //only the scanner makes pages copy-on-write, without it no fault is ours
+    if (!__atomic_load_n(&ksm_started, __ATOMIC_ACQUIRE)) return false;
+
+    //only writes to present pages can hit a copy-on-write mapping
+    if ((error_code & 0x3) != 0x3) return false;
+    if (addr >= USER_SPACE_END) return false;
+
+    process_t *proc = process_current();
+    if (!proc || !proc->pagemap) return false;
+    pagemap_t *pm = (pagemap_t *)proc->pagemap;
+    uintptr page = addr & ~(uintptr)(PAGE_SIZE - 1);
+
+    irq_state_t flags = spinlock_irq_acquire(&ksm_lock);
+    uint64 pte_flags = mmu_get_page_flags(pm, page);
+    if (pte_flags & MMU_FLAG_WRITE) {
+        //sharing was already broken, this CPU just had a stale TLB entry
+        spinlock_irq_release(&ksm_lock, flags);
+        mmu_flush_tlb();
+        return true;
+    }
+    if (!(pte_flags & MMU_FLAG_COW)) {
+        spinlock_irq_release(&ksm_lock, flags);
+        return false;
+    }
+
+    uintptr phys = mmu_virt_to_phys(pm, page);
+    uint64 new_flags = (pte_flags | MMU_FLAG_WRITE) & ~MMU_FLAG_COW;
+    ksm_frame_t *f = ksm_find_phys_locked(phys);
+
+    if (f && f->refs > 1) {
+        //other threads of the process may hold the shared frame in their
+        //TLBs, the shootdown needs interrupts so it only works if the
+        //faulting context had them on (always true for user mode)
+        if (!arch_irq_state_enabled(interrupted)) {
+            spinlock_irq_release(&ksm_lock, flags);
+            return false;
+        }
+        void *copy = pmm_alloc(1);
+        if (!copy) {
+            spinlock_irq_release(&ksm_lock, flags);
+            return false;
+        }
+        memcpy(P2V(copy), P2V(phys), PAGE_SIZE);
+        ksm_cow_breaks++;
+        mmu_map_range(pm, page, (uintptr)copy, 1, new_flags);
+        spinlock_irq_release(&ksm_lock, flags);
+
+        //no CPU may read the shared frame through this mapping once we let
+        //go of it, the last sharer is free to take it back and write it
+        arch_irq_restore(interrupted);
+        arch_smp_tlb_shootdown();
+        arch_irq_save();
+        ksm_release_page(phys);
+        return true;
+    }
+
+    //last user of a merged frame (or a page the scanner is still comparing)
+    //simply takes the frame back as private memory
+    if (f) {
+        ksm_remove_locked(f);
+        ksm_total_refs--;
+    }
+    mmu_map_range(pm, page, phys, 1, new_flags);
+    spinlock_irq_release(&ksm_lock, flags);
+
+    if (f) kfree(f);
+    return true;
+}
+
+bool ksm_release_page(uintptr phys) {
+    if (__atomic_load_n(&ksm_frame_count, __ATOMIC_ACQUIRE) == 0) return false;
+    phys &= ~(uintptr)(PAGE_SIZE - 1);
+
+    irq_state_t flags = spinlock_irq_acquire(&ksm_lock);
+    ksm_frame_t *f = ksm_find_phys_locked(phys);
+    if (!f) {
+        spinlock_irq_release(&ksm_lock, flags);
+        return false;
+    }
+
+    f->refs--;
+    ksm_total_refs--;
+    if (f->refs > 0) {
+        spinlock_irq_release(&ksm_lock, flags);
+        return true;
+    }
+
+    ksm_remove_locked(f);
+    spinlock_irq_release(&ksm_lock, flags);
+    pmm_free((void *)phys, 1);
+    kfree(f);
+    return true;
+}
+
+//returns true if hash was already recorded during this pass
+static bool ksm_candidate_seen(uint32 hash) {
+    size slot = hash % KSM_CANDIDATE_SLOTS;
+    for (size i = 0; i < KSM_CANDIDATE_PROBE; i++) {
+        uint32 *entry = &ksm_candidates[(slot + i) % KSM_CANDIDATE_SLOTS];
+        if (*entry == hash) return true;
+        if (*entry == 0) {
+            *entry = hash;
+            return false;
+        }
+    }
+    return false;
+}
+
+//gather present anonymous pages that are not already merged
+static size ksm_collect(process_t *proc, ksm_item_t *items) {
+    size count = 0;
+
+    spinlock_acquire(&proc->lock);
+    pagemap_t *pm = (pagemap_t *)proc->pagemap;
+    if (!pm || proc->thread_count == 0 ||
+        proc->state == PROC_STATE_DEAD || proc->state == PROC_STATE_ZOMBIE) {
+        spinlock_release(&proc->lock);
+        return 0;
+    }
+
+    for (proc_vma_t *vma = proc->vma_list; vma && count < KSM_MAX_PAGES_PER_PROC; vma = vma->next) {
+        //VMO-backed ranges are owned by their object, not the address space
+        if (vma->obj) continue;
+
+        for (uintptr addr = vma->start; addr < vma->start + vma->length; addr += PAGE_SIZE) {
+            if (count >= KSM_MAX_PAGES_PER_PROC) break;
+
+            uint64 flags = mmu_get_page_flags(pm, addr);
+            if (!(flags & MMU_FLAG_PRESENT) || !(flags & MMU_FLAG_USER)) continue;
+            if (flags & MMU_FLAG_COW) continue;
+
+            ksm_item_t *it = &items[count++];
+            it->virt = addr;
+            it->phys = mmu_virt_to_phys(pm, addr);
+            it->flags = flags;
+            it->hash = 0;
+            it->wanted = 0;
+            it->protected = 0;
+            it->merged = 0;
+        }
+    }
+    spinlock_release(&proc->lock);
+
+    return count;
+}
+
+static void ksm_scan_process(process_t *proc, ksm_item_t *items) {
+    size count = ksm_collect(proc, items);
+    if (count == 0) return;
+
+    //first-pass hashes are only hints, contents are rechecked once write-protected
+    size wanted = 0;
+    for (size i = 0; i < count; i++) {
+        ksm_item_t *it = &items[i];
+        it->hash = ksm_page_hash(it->phys);
+
+        irq_state_t flags = spinlock_irq_acquire(&ksm_lock);
+        bool shared = ksm_find_phys_locked(it->phys) != NULL;
+        bool known = !shared && ksm_hash_known_locked(it->hash);
+        spinlock_irq_release(&ksm_lock, flags);
+
+        if (shared) continue;
+        if (known || ksm_candidate_seen(it->hash)) {
+            it->wanted = 1;
+            wanted++;
+        }
+    }
+    ksm_pages_scanned += count;
+    if (wanted == 0) return;
+
+    //write-protect the pages we want so their contents cannot change under us
+    size protected = 0;
+    spinlock_acquire(&proc->lock);
+    pagemap_t *pm = (pagemap_t *)proc->pagemap;
+    if (!pm) {
+        spinlock_release(&proc->lock);
+        return;
+    }
+    irq_state_t flags = spinlock_irq_acquire(&ksm_lock);
+    for (size i = 0; i < count; i++) {
+        ksm_item_t *it = &items[i];
+        if (!it->wanted) continue;
+
+        if (mmu_get_page_flags(pm, it->virt) != it->flags ||
+            mmu_virt_to_phys(pm, it->virt) != it->phys) {
+            it->wanted = 0;
+            continue;
+        }
+        if (it->flags & MMU_FLAG_WRITE) {
+            uint64 ro = (it->flags & ~MMU_FLAG_WRITE) | MMU_FLAG_COW;
+            mmu_map_range(pm, it->virt, it->phys, 1, ro);
+            it->protected = 1;
+            protected++;
+        }
+    }
+    spinlock_irq_release(&ksm_lock, flags);
+    spinlock_release(&proc->lock);
+
+    if (protected) arch_smp_tlb_shootdown();
+
+    //contents are now stable unless a write fault hands the page back
+    for (size i = 0; i < count; i++) {
+        if (items[i].wanted) items[i].hash = ksm_page_hash(items[i].phys);
+    }
+
+    size merged = 0;
+    spinlock_acquire(&proc->lock);
+    pm = (pagemap_t *)proc->pagemap;
+    if (!pm) {
+        //process teardown already freed every page we collected
+        spinlock_release(&proc->lock);
+        return;
+    }
+    flags = spinlock_irq_acquire(&ksm_lock);
+    for (size i = 0; i < count; i++) {
+        ksm_item_t *it = &items[i];
+        if (!it->wanted) continue;
+
+        uint64 cur = mmu_get_page_flags(pm, it->virt);
+        if (!(cur & MMU_FLAG_PRESENT) || mmu_virt_to_phys(pm, it->virt) != it->phys) continue;
+        //a write fault already took the page back, it is too hot to share
+        if (cur & MMU_FLAG_WRITE) continue;
+
+        ksm_frame_t *f = ksm_find_content_locked(it->hash, it->phys);
+        if (f) {
+            f->refs++;
+            ksm_total_refs++;
+            mmu_map_range(pm, it->virt, f->phys, 1, cur);
+            it->merged = 1;
+            merged++;
+            continue;
+        }
+
+        //first copy of this content becomes the stable frame others fold into
+        f = kzalloc(sizeof(ksm_frame_t));
+        if (f) {
+            f->phys = it->phys;
+            f->hash = it->hash;
+            f->refs = 1;
+            ksm_insert_locked(f);
+            ksm_total_refs++;
+            continue;
+        }
+
+        if (it->protected) {
+            mmu_map_range(pm, it->virt, it->phys, 1, it->flags);
+        }
+    }
+    spinlock_irq_release(&ksm_lock, flags);
+    spinlock_release(&proc->lock);
+
+    if (merged == 0) return;
+
+    //no CPU may still reach the old frames through a stale TLB entry
+    arch_smp_tlb_shootdown();
+    for (size i = 0; i < count; i++) {
+        if (items[i].merged) pmm_free((void *)items[i].phys, 1);
+    }
+}
+
+static void ksm_collect_pid(process_t *proc, void *data) {
+    ksm_pid_list_t *list = (ksm_pid_list_t *)data;
+    if (list->count >= KSM_MAX_SCAN_PROCS) return;
+    if (!proc->pagemap || proc->destroying) return;
+    list->pids[list->count++] = proc->pid;
+}
+
+static void ksm_scan_pass(ksm_pid_list_t *list, ksm_item_t *items) {
+    memset(ksm_candidates, 0, sizeof(ksm_candidates));
+
+    list->count = 0;
+    process_iterate(ksm_collect_pid, list);
+
+    for (uint32 i = 0; i < list->count; i++) {
+        process_t *proc = process_find_ref(list->pids[i]);
+        if (!proc) continue;
+        ksm_scan_process(proc, items);
+        process_unref(proc);
+    }
+
+    ksm_full_scans++;
+}
+
+static void ksm_worker(void *arg) {
+    (void)arg;
+
+    ksm_pid_list_t *list = kzalloc(sizeof(ksm_pid_list_t));
+    ksm_item_t *items = kmalloc(KSM_MAX_PAGES_PER_PROC * sizeof(ksm_item_t));
+    if (!list || !items) {
+        printf("[ksm] ERR: failed to allocate scanner state\n");
+        if (list) kfree(list);
+        if (items) kfree(items);
+        thread_exit();
+        return;
+    }
+
+    //merged pages are read-only, kernel copies into them have to fault too
+    mmu_enable_wp();
+
+    for (;;) {
+        if (ksm_enabled) ksm_scan_pass(list, items);
+        sleep(KSM_SCAN_INTERVAL_MS);
+    }
+}
+
+void ksm_start(void) {
+    if (!ksm_enabled || ksm_started) return;
+
+    process_t *kernel = process_get_kernel();
+    thread_t *thread = kernel ? thread_create(kernel, ksm_worker, NULL) : NULL;
+    if (!thread) {
+        printf("[ksm] ERR: failed to create scanner thread\n");
+        return;
+    }
+
+    ksm_started = true;
+    sched_add(thread);
+    printf("[ksm] same-page merging enabled\n");
+}
+
+void ksm_get_stats(ksm_stats_t *stats) {
+    if (!stats) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&ksm_lock);
+    stats->pages_shared = ksm_frame_count;
+    stats->pages_sharing = ksm_total_refs - ksm_frame_count;
+    stats->cow_breaks = ksm_cow_breaks;
+    spinlock_irq_release(&ksm_lock, flags);
+
+    stats->pages_scanned = ksm_pages_scanned;
+    stats->full_scans = ksm_full_scans;
+    stats->enabled = ksm_enabled ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+#ifndef MM_KSM_H
+#define MM_KSM_H
+
+#include <arch/types.h>
+#include <arch/cpu.h>
+
+/*
+ *kernel same-page merging
+ *
+ *an opt-in background scanner hashes anonymous user pages (ELF segments and
+ *stacks), folds identical ones into a single read-only frame and breaks the
+ *sharing again with a private copy on the next write
+ *
+ *merged writable pages carry MMU_FLAG_COW so the page fault path can tell a
+ *shared frame apart from a genuinely read-only mapping
+*/
+
+//pages considered per process per pass
+#define KSM_MAX_PAGES_PER_PROC  4096
+
+//delay between scan passes
+#define KSM_SCAN_INTERVAL_MS    2000
+
+//enable or disable merging (boot option "ksm")
+void ksm_set_enabled(bool enabled);
+bool ksm_is_enabled(void);
+
+//start the background scanner thread if merging is enabled
+void ksm_start(void);
+
+//resolve a write fault on a copy-on-write page of the current process,
+//interrupted is the RFLAGS of the faulting context
+//returns true if the fault was handled and the access can be retried
+bool ksm_handle_fault(uintptr addr, uint64 error_code, irq_state_t interrupted);
+
+//drop one mapping of a user page
+//returns true if the frame belongs to KSM (and was freed if last user)
+//returns false if the caller still owns the frame and must free it itself
+bool ksm_release_page(uintptr phys);
+
+typedef struct {
+    uint64 pages_shared;    //frames currently backing merged pages
+    uint64 pages_sharing;   //mappings folded onto those frames (memory saved)
+    uint64 pages_scanned;   //candidate pages hashed since boot
+    uint64 full_scans;      //completed passes over every process
+    uint64 cow_breaks;      //private copies made on write
+    uint32 enabled;
+} ksm_stats_t;
+
+void ksm_get_stats(ksm_stats_t *stats);
+
+#endif
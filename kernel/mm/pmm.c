@@ -5,7 +5,8 @@
 #include <drivers/serial.h>
 #include <lib/spinlock.h>
 
-static spinlock_irq_t pmm_lock = SPINLOCK_IRQ_INIT;
+static spinlock_stats_t pmm_lock_stats = SPINLOCK_STATS_INIT("pmm");
+static spinlock_irq_t pmm_lock = SPINLOCK_IRQ_INIT_STATS(&pmm_lock_stats);
 static uint8 *bitmap = NULL;
 static size bitmap_size = 0; //in bytes
 size max_pages = 0;
@@ -20,6 +21,8 @@ size free_pages = 0;
 size total_usable_pages = 0;
 
 void pmm_init(void) {
+    spinlock_stats_register(&pmm_lock_stats);
+
     struct db_tag_memory_map *mmap = db_get_memory_map();
     if (!mmap) {
         serial_write("[pmm] ERROR: no memory map tag found\n");
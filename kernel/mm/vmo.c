@@ -164,6 +164,13 @@ void *vmo_map(process_t *proc, int32 handle, void *vaddr_hint,
     vmo_t *vmo = (vmo_t *)entry->obj;
     if (!vmo) return NULL;
     
+    return vmo_map_object(proc, vmo, vaddr_hint, offset, len, map_rights);
+}
+
+void *vmo_map_object(process_t *proc, vmo_t *vmo, void *vaddr_hint,
+                     size offset, size len, handle_rights_t map_rights) {
+    if (!proc || !vmo) return NULL;
+    
     //validate offset and length
     if (offset >= vmo->size) return NULL;
     if (len > vmo->size - offset) return NULL;
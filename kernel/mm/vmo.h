@@ -54,6 +54,11 @@ size vmo_get_size(struct process *proc, int32 handle);
 void *vmo_map(struct process *proc, int32 handle, void *vaddr_hint, 
               size offset, size len, handle_rights_t map_rights);
 
+//map an already resolved VMO (rights are checked by the caller)
+//used for channel page loans where the receiver holds no handle
+void *vmo_map_object(struct process *proc, vmo_t *vmo, void *vaddr_hint,
+                     size offset, size len, handle_rights_t map_rights);
+
 //unmap VMO from a process's address space
 int vmo_unmap(struct process *proc, void *vaddr, size len);
 
@@ -11,7 +11,10 @@
 #include <proc/process.h>
 #include <proc/sched.h>
 #include <proc/thread.h>
+#include <proc/rcu.h>
 
+//interfaces are only ever appended so the RX and route lookup paths read
+//the list and default_netif under RCU, netif_lock serialises writers
 static netif_t *netif_list = NULL;
 static netif_t *netif_tail = NULL;
 static netif_t *default_netif = NULL;
@@ -26,32 +29,35 @@ static bool netif_is_configured(const netif_t *nif) {
     return nif && (nif->gateway != 0 || netif_has_ipv6_route(nif));
 }
 
-static netif_t *net_pick_default_locked(void) {
-    netif_t *fallback = default_netif ? default_netif : netif_list;
+//caller holds netif_lock or is inside an RCU read-side section
+static netif_t *net_pick_default(void) {
+    netif_t *def = rcu_dereference(default_netif);
+    netif_t *head = rcu_dereference(netif_list);
+    netif_t *fallback = def ? def : head;
 
-    if (netif_is_configured(default_netif)) {
-        return default_netif;
+    if (netif_is_configured(def)) {
+        return def;
     }
 
-    for (netif_t *nif = netif_list; nif; nif = nif->next) {
+    for (netif_t *nif = head; nif; nif = rcu_dereference(nif->next)) {
         if (nif->gateway != 0) {
             return nif;
         }
     }
 
-    for (netif_t *nif = netif_list; nif; nif = nif->next) {
+    for (netif_t *nif = head; nif; nif = rcu_dereference(nif->next)) {
         if (nif->ip_addr != 0) {
             return nif;
         }
     }
 
-    for (netif_t *nif = netif_list; nif; nif = nif->next) {
+    for (netif_t *nif = head; nif; nif = rcu_dereference(nif->next)) {
         if (nif->dns_server != 0) {
             return nif;
         }
     }
 
-    for (netif_t *nif = netif_list; nif; nif = nif->next) {
+    for (netif_t *nif = head; nif; nif = rcu_dereference(nif->next)) {
         if (netif_has_ipv6_route(nif)) {
             return nif;
         }
@@ -71,11 +77,11 @@ void net_register_netif(netif_t *nif) {
     irq_state_t flags = spinlock_irq_acquire(&netif_lock);
     nif->next = NULL;
     if (!netif_list) {
-        netif_list = nif;
+        rcu_assign_pointer(netif_list, nif);
         netif_tail = nif;
-        if (!default_netif) default_netif = nif;
+        if (!default_netif) rcu_assign_pointer(default_netif, nif);
     } else {
-        netif_tail->next = nif;
+        rcu_assign_pointer(netif_tail->next, nif);
         netif_tail = nif;
     }
     spinlock_irq_release(&netif_lock, flags);
@@ -89,9 +95,9 @@ void net_register_netif(netif_t *nif) {
 }
 
 netif_t *net_get_default_netif(void) {
-    irq_state_t flags = spinlock_irq_acquire(&netif_lock);
-    netif_t *res = net_pick_default_locked();
-    spinlock_irq_release(&netif_lock, flags);
+    rcu_read_lock();
+    netif_t *res = net_pick_default();
+    rcu_read_unlock();
     return res;
 }
 
@@ -104,13 +110,14 @@ void net_poll(void) {
     netif_t *snapshot[MAX_NETIFS];
     size count = 0;
 
-    irq_state_t flags = spinlock_irq_acquire(&netif_lock);
-    for (netif_t *nif = netif_list; nif && count < MAX_NETIFS; nif = nif->next) {
+    rcu_read_lock();
+    for (netif_t *nif = rcu_dereference(netif_list); nif && count < MAX_NETIFS;
+         nif = rcu_dereference(nif->next)) {
         if (nif->poll) {
             snapshot[count++] = nif;
         }
     }
-    spinlock_irq_release(&netif_lock, flags);
+    rcu_read_unlock();
 
     for (size i = 0; i < count; i++) {
         snapshot[i]->poll(snapshot[i]);
@@ -124,11 +131,14 @@ static void net_boot_worker(void *arg) {
     netif_t *order[MAX_NETIFS];
     size count = 0;
 
-    irq_state_t flags = spinlock_irq_acquire(&netif_lock);
-    for (netif_t *nif = netif_list; nif && count < MAX_NETIFS; nif = nif->next) {
+    rcu_read_lock();
+    for (netif_t *nif = rcu_dereference(netif_list); nif && count < MAX_NETIFS;
+         nif = rcu_dereference(nif->next)) {
         order[count++] = nif;
     }
-    spinlock_irq_release(&netif_lock, flags);
+    rcu_read_unlock();
+
+    irq_state_t flags;
 
     if (count == 0) {
         printf("[net] No network interfaces available for bring-up\n");
@@ -163,16 +173,16 @@ static void net_boot_worker(void *arg) {
 
         if (!have_primary) {
             flags = spinlock_irq_acquire(&netif_lock);
-            default_netif = nif;
+            rcu_assign_pointer(default_netif, nif);
             spinlock_irq_release(&netif_lock, flags);
             have_primary = true;
         }
     }
 
     flags = spinlock_irq_acquire(&netif_lock);
-    netif_t *best = net_pick_default_locked();
+    netif_t *best = net_pick_default();
     if (best && best != default_netif) {
-        default_netif = best;
+        rcu_assign_pointer(default_netif, best);
     }
     spinlock_irq_release(&netif_lock, flags);
 
@@ -32,6 +32,20 @@ static ssize socket_read(object_t *obj, void *buf, size len, size offset) {
     return (ssize)result;
 }
 
+static ssize socket_read_user(object_t *obj, void *ubuf, size len, size offset) {
+    (void)offset;
+    tcp_conn_t *conn = (tcp_conn_t *)obj->data;
+    if (!conn) return -1;
+    
+    if (conn->state == TCP_STATE_CLOSED && conn->rx_len == 0) {
+        return 0;
+    }
+    
+    int result = tcp_read_user(conn, ubuf, len);
+    if (result < 0) return -1;
+    return (ssize)result;
+}
+
 static ssize socket_write(object_t *obj, const void *buf, size len, size offset) {
     (void)offset;
     tcp_conn_t *conn = (tcp_conn_t *)obj->data;
@@ -47,11 +61,18 @@ static ssize socket_write(object_t *obj, const void *buf, size len, size offset)
 static int socket_close(object_t *obj) {
     tcp_conn_t *conn = (tcp_conn_t *)obj->data;
     if (conn) {
+        port_observers_detach(&conn->observers);
         tcp_close(conn);
     }
     return 0;
 }
 
+port_observers_t *socket_port_observers(object_t *obj, uint32 *level) {
+    tcp_conn_t *conn = (tcp_conn_t *)obj->data;
+    *level = tcp_poll_signals(conn);
+    return conn ? &conn->observers : NULL;
+}
+
 static object_ops_t socket_ops = {
     .read    = socket_read,
     .write   = socket_write,
@@ -60,6 +81,7 @@ static object_ops_t socket_ops = {
     .lookup  = NULL,
     .stat    = NULL,
     .get_info = NULL,
+    .read_user = socket_read_user,
 };
 
 handle_t socket_object_create(tcp_conn_t *conn) {
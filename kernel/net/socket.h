@@ -8,4 +8,7 @@
 //create a socket object from a TCP connection, returns a handle
 handle_t socket_object_create(tcp_conn_t *conn);
 
+//port source hook: observer list and current PORT_SIGNAL_* level of a socket
+port_observers_t *socket_port_observers(object_t *obj, uint32 *level);
+
 #endif
@@ -13,9 +13,11 @@
 #include <arch/timer.h>
 #include <proc/sched.h>
 #include <proc/event.h>
+#include <syscall/syscall.h>
 
 static tcp_conn_t connections[TCP_MAX_CONNECTIONS];
-static spinlock_irq_t tcp_lock = SPINLOCK_IRQ_INIT;
+static spinlock_stats_t tcp_lock_stats = SPINLOCK_STATS_INIT("tcp");
+static spinlock_irq_t tcp_lock = SPINLOCK_IRQ_INIT_STATS(&tcp_lock_stats);
 
 typedef struct __attribute__((packed)) {
     uint32 src_ip;
@@ -102,6 +104,8 @@ static inline uint32 tcp_read_u32(const uint8 *p) {
 }
 
 void tcp_init(void) {
+    spinlock_stats_register(&tcp_lock_stats);
+
     memset(connections, 0, sizeof(connections));
 }
 
@@ -321,8 +325,9 @@ static void tcp_send_rst(netif_t *nif, const net_addr_t *src_addr,
     }
 }
 
-static void tcp_recv_common(netif_t *nif, const net_addr_t *src_addr,
-                            const net_addr_t *dst_addr, void *data, size len) {
+static void tcp_recv_segment(netif_t *nif, const net_addr_t *src_addr,
+                             const net_addr_t *dst_addr, void *data, size len,
+                             tcp_conn_t **touched) {
     if (len < sizeof(tcp_header_t)) return;
 
     //verify checksum
@@ -351,6 +356,7 @@ static void tcp_recv_common(netif_t *nif, const net_addr_t *src_addr,
 
     irq_state_t lock_flags = spinlock_irq_acquire(&tcp_lock);
     tcp_conn_t *conn = tcp_find_conn(dst_addr, dst_port, src_addr, src_port);
+    *touched = conn;
 
     if (!conn) {
         //check for listening sockets on this port
@@ -520,6 +526,72 @@ static void tcp_recv_common(netif_t *nif, const net_addr_t *src_addr,
     spinlock_irq_release(&tcp_lock, lock_flags);
 }
 
+//does the listener have a completed handshake waiting, caller holds tcp_lock
+static tcp_conn_t *tcp_find_acceptable_locked(tcp_conn_t *listener) {
+    for (int i = 0; i < TCP_MAX_CONNECTIONS; i++) {
+        tcp_conn_t *c = &connections[i];
+        if (c->active && !c->listening && !c->accepted &&
+            c->local_port == listener->local_port &&
+            (tcp_addr_is_unspecified(&listener->local_addr) ||
+             tcp_addr_equal(&c->local_addr, &listener->local_addr)) &&
+            c->state == TCP_STATE_ESTABLISHED) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+uint32 tcp_poll_signals(tcp_conn_t *conn) {
+    if (!conn) return PORT_SIGNAL_PEER_CLOSED;
+
+    uint32 signals = 0;
+    irq_state_t flags = spinlock_irq_acquire(&tcp_lock);
+    if (conn->listening) {
+        if (tcp_find_acceptable_locked(conn)) signals |= PORT_SIGNAL_READABLE;
+    } else {
+        if (conn->rx_len > 0) signals |= PORT_SIGNAL_READABLE;
+        switch (conn->state) {
+            case TCP_STATE_SYN_SENT:
+            case TCP_STATE_SYN_RECEIVED:
+            case TCP_STATE_ESTABLISHED:
+            case TCP_STATE_FIN_WAIT_1:
+            case TCP_STATE_FIN_WAIT_2:
+                break;
+            default:
+                signals |= PORT_SIGNAL_PEER_CLOSED;
+                break;
+        }
+    }
+    spinlock_irq_release(&tcp_lock, flags);
+    return signals;
+}
+
+//tell ports about a connection a segment just touched
+static void tcp_notify(tcp_conn_t *conn) {
+    port_observers_signal(&conn->observers, tcp_poll_signals(conn));
+
+    //a finished handshake makes its listener acceptable
+    if (conn->state != TCP_STATE_ESTABLISHED || conn->accepted) return;
+    irq_state_t flags = spinlock_irq_acquire(&tcp_lock);
+    tcp_conn_t *listener = NULL;
+    for (int i = 0; i < TCP_MAX_CONNECTIONS; i++) {
+        tcp_conn_t *l = &connections[i];
+        if (tcp_listener_matches(l, &conn->local_addr, conn->local_port)) {
+            listener = l;
+            break;
+        }
+    }
+    spinlock_irq_release(&tcp_lock, flags);
+    if (listener) port_observers_signal(&listener->observers, PORT_SIGNAL_READABLE);
+}
+
+static void tcp_recv_common(netif_t *nif, const net_addr_t *src_addr,
+                            const net_addr_t *dst_addr, void *data, size len) {
+    tcp_conn_t *conn = NULL;
+    tcp_recv_segment(nif, src_addr, dst_addr, data, len, &conn);
+    if (conn) tcp_notify(conn);
+}
+
 void tcp_recv(netif_t *nif, uint32 src_ip, uint32 dst_ip, void *data, size len) {
     net_addr_t src_addr;
     net_addr_t dst_addr;
@@ -647,7 +719,7 @@ int tcp_send(tcp_conn_t *conn, const void *data, size len) {
     return 0;
 }
 
-int tcp_read(tcp_conn_t *conn, void *buf, size len) {
+static int tcp_read_common(tcp_conn_t *conn, void *buf, size len, bool user) {
     if (!conn) return -1;
 
     uint32 freq = arch_timer_getfreq();
@@ -683,7 +755,14 @@ int tcp_read(tcp_conn_t *conn, void *buf, size len) {
     }
 
     size copy = (conn->rx_len < len) ? conn->rx_len : len;
-    memcpy(buf, conn->rx_buf, copy);
+    if (user) {
+        if (copy_to_user_bytes(buf, conn->rx_buf, copy) != 0) {
+            spinlock_irq_release(&tcp_lock, flags);
+            return -1;
+        }
+    } else {
+        memcpy(buf, conn->rx_buf, copy);
+    }
 
     //shift remaining data
     if (copy < conn->rx_len) {
@@ -695,6 +774,14 @@ int tcp_read(tcp_conn_t *conn, void *buf, size len) {
     return (int)copy;
 }
 
+int tcp_read(tcp_conn_t *conn, void *buf, size len) {
+    return tcp_read_common(conn, buf, len, false);
+}
+
+int tcp_read_user(tcp_conn_t *conn, void *ubuf, size len) {
+    return tcp_read_common(conn, ubuf, len, true);
+}
+
 int tcp_close(tcp_conn_t *conn) {
     if (!conn) return -1;
 
@@ -753,17 +840,11 @@ tcp_conn_t *tcp_accept(tcp_conn_t *listener) {
         }
 
         //scan for connections on this port that completed handshake
-        for (int i = 0; i < TCP_MAX_CONNECTIONS; i++) {
-            tcp_conn_t *c = &connections[i];
-            if (c->active && !c->listening && !c->accepted &&
-                c->local_port == listener->local_port &&
-                (tcp_addr_is_unspecified(&listener->local_addr) ||
-                 tcp_addr_equal(&c->local_addr, &listener->local_addr)) &&
-                c->state == TCP_STATE_ESTABLISHED) {
-                c->accepted = true;
-                spinlock_irq_release(&tcp_lock, scan_flags);
-                return c;
-            }
+        tcp_conn_t *c = tcp_find_acceptable_locked(listener);
+        if (c) {
+            c->accepted = true;
+            spinlock_irq_release(&tcp_lock, scan_flags);
+            return c;
         }
         spinlock_irq_release(&tcp_lock, scan_flags);
 
@@ -4,6 +4,7 @@
 #include <arch/types.h>
 #include <net/net.h>
 #include <arch/timer.h>
+#include <ipc/port.h>
 
 //TCP flags
 #define TCP_FIN  0x01
@@ -79,6 +80,9 @@ typedef struct tcp_conn {
     bool active;
     bool listening;         //true if this is a listening socket
     bool accepted;          //true if this connection has been returned by tcp_accept
+
+    //ports watching the socket wrapping this connection
+    port_observers_t observers;
 } tcp_conn_t;
 
 //receive a TCP segment (called from IPv4/IPv6 layers)
@@ -96,6 +100,9 @@ int tcp_send(tcp_conn_t *conn, const void *data, size len);
 //read received data from a connection
 int tcp_read(tcp_conn_t *conn, void *buf, size len);
 
+//same, copying straight into a user buffer (nothing is consumed if the copy faults)
+int tcp_read_user(tcp_conn_t *conn, void *ubuf, size len);
+
 //close a connection (graceful)
 int tcp_close(tcp_conn_t *conn);
 
@@ -105,6 +112,9 @@ tcp_conn_t *tcp_listen_addr(netif_t *nif, const net_addr_t *local_addr, uint16 p
 //accept an incoming connection on a listening socket
 tcp_conn_t *tcp_accept(tcp_conn_t *listener);
 
+//current PORT_SIGNAL_* level: data or a pending accept, remote side gone
+uint32 tcp_poll_signals(tcp_conn_t *conn);
+
 //initialize TCP subsystem
 void tcp_init(void);
 
@@ -7,6 +7,8 @@
 #include <lib/io.h>
 #include <lib/path.h>
 #include <fs/mount.h>
+#include <mm/kheap.h>
+#include <syscall/syscall.h>
 
 
 static process_t *get_handle_owner(void) {
@@ -168,23 +170,56 @@ handle_t handle_duplicate(handle_t h, handle_rights_t new_rights) {
     return process_duplicate_handle(proc, h, new_rights);
 }
 
-ssize handle_read(handle_t h, void *buf, size len) {
+#define HANDLE_BOUNCE_MAX (1u << 20)
+
+//move a user buffer through a kernel bounce buffer for objects without user ops
+static ssize handle_bounce(object_t *obj, uint8 *ubuf, size len, size offset, bool write) {
+    size total = 0;
+    while (total < len) {
+        size chunk = len - total > HANDLE_BOUNCE_MAX ? HANDLE_BOUNCE_MAX : len - total;
+        void *kbuf = kmalloc(chunk);
+        if (!kbuf) break;
+
+        ssize r;
+        if (write) {
+            r = copy_user_bytes(ubuf + total, kbuf, chunk) != 0 ? -1
+                : obj->ops->write(obj, kbuf, chunk, offset + total);
+        } else {
+            r = obj->ops->read(obj, kbuf, chunk, offset + total);
+            if (r > 0 && copy_to_user_bytes(ubuf + total, kbuf, (size)r) != 0) r = -1;
+        }
+        kfree(kbuf);
+
+        if (r <= 0) return total > 0 ? (ssize)total : r;
+        total += (size)r;
+        if ((size)r < chunk) break;
+    }
+    return total > 0 ? (ssize)total : -1;
+}
+
+//reserve the handle offset, run the op without the table lock and give back what was not used
+static ssize handle_rw(handle_t h, void *buf, size len, bool write, ssize no_entry, ssize no_op) {
     process_t *proc = get_handle_owner();
     if (!proc) return -1;
 
     //ref the object before releasing the lock to avoid concurrent close UAF
     spinlock_acquire(&proc->lock);
     proc_handle_t *entry = process_get_handle_entry(proc, h);
-    if (!entry) { spinlock_release(&proc->lock); return -2; }
-    if (!rights_has(entry->rights, HANDLE_RIGHT_READ)) { spinlock_release(&proc->lock); return -2; }
-    if (!entry->obj->ops || !entry->obj->ops->read) { spinlock_release(&proc->lock); return -3; }
+    if (!entry) { spinlock_release(&proc->lock); return no_entry; }
+    handle_rights_t need = write ? HANDLE_RIGHT_WRITE : HANDLE_RIGHT_READ;
+    if (!rights_has(entry->rights, need)) { spinlock_release(&proc->lock); return -2; }
+    object_ops_t *ops = entry->obj->ops;
+    if (!ops || !(write ? ops->write != NULL : ops->read != NULL)) {
+        spinlock_release(&proc->lock);
+        return no_op;
+    }
     object_t *obj = entry->obj;
     size offset = entry->offset;
     entry->offset += len; //reserve offset
     object_ref(obj);
     spinlock_release(&proc->lock);
 
-    ssize result = obj->ops->read(obj, buf, len, offset);
+    ssize result = write ? ops->write(obj, buf, len, offset) : ops->read(obj, buf, len, offset);
     
     spinlock_acquire(&proc->lock);
     proc_handle_t *e2 = process_get_handle_entry(proc, h);
@@ -200,38 +235,105 @@ ssize handle_read(handle_t h, void *buf, size len) {
     return result;
 }
 
+ssize handle_read(handle_t h, void *buf, size len) {
+    return handle_rw(h, buf, len, false, -2, -3);
+}
+
 ssize handle_write(handle_t h, const void *buf, size len) {
+    return handle_rw(h, (void *)buf, len, true, -1, -1);
+}
+
+//walk the segments one at a time, stopping at the first short transfer
+static ssize handle_rwv_split(object_t *obj, const io_vec_t *iov, uint32 count,
+                              size offset, bool write) {
+    object_ops_t *ops = obj->ops;
+    size total = 0;
+    for (uint32 i = 0; i < count; i++) {
+        if (iov[i].len == 0) continue;
+        ssize r;
+        if (write && ops->write_user) {
+            r = ops->write_user(obj, iov[i].base, iov[i].len, offset + total);
+        } else if (!write && ops->read_user) {
+            r = ops->read_user(obj, iov[i].base, iov[i].len, offset + total);
+        } else {
+            r = handle_bounce(obj, iov[i].base, iov[i].len, offset + total, write);
+        }
+        if (r <= 0) return total > 0 ? (ssize)total : r;
+        total += (size)r;
+        if ((size)r < iov[i].len) break;
+    }
+    return (ssize)total;
+}
+
+//user buffer scatter/gather, pos < 0 uses and advances the handle offset
+//the segments are already range checked, the object handles any fault in them
+static ssize handle_rwv_user(handle_t h, const io_vec_t *iov, uint32 count, int64 pos,
+                             bool write, ssize no_entry, ssize no_op) {
     process_t *proc = get_handle_owner();
     if (!proc) return -1;
 
-    //ref the object before releasing the lock to avoid concurrent close UAF
+    size len = 0;
+    for (uint32 i = 0; i < count; i++) {
+        if (iov[i].len > SIZE_MAX - len) return -1;
+        len += iov[i].len;
+    }
+
     spinlock_acquire(&proc->lock);
     proc_handle_t *entry = process_get_handle_entry(proc, h);
-    if (!entry) { spinlock_release(&proc->lock); return -1; }
-    if (!rights_has(entry->rights, HANDLE_RIGHT_WRITE)) { spinlock_release(&proc->lock); return -2; }
-    if (!entry->obj->ops || !entry->obj->ops->write) { spinlock_release(&proc->lock); return -1; }
+    if (!entry) { spinlock_release(&proc->lock); return no_entry; }
+    handle_rights_t need = write ? HANDLE_RIGHT_WRITE : HANDLE_RIGHT_READ;
+    if (!rights_has(entry->rights, need)) { spinlock_release(&proc->lock); return -2; }
+    object_ops_t *ops = entry->obj->ops;
+    bool has_op = ops && (write ? (ops->writev_user || ops->write_user || ops->write)
+                                : (ops->readv_user || ops->read_user || ops->read));
+    if (!has_op) { spinlock_release(&proc->lock); return no_op; }
     object_t *obj = entry->obj;
-    size offset = entry->offset;
-    entry->offset += len; //reserve offset
+    size offset = pos < 0 ? entry->offset : (size)pos;
+    if (pos < 0) entry->offset += len; //reserve offset
     object_ref(obj);
     spinlock_release(&proc->lock);
 
-    ssize result = obj->ops->write(obj, buf, len, offset);
-    
-    spinlock_acquire(&proc->lock);
-    proc_handle_t *e2 = process_get_handle_entry(proc, h);
-    if (e2 && e2->obj == obj) {
-        if (result > 0) {
-            e2->offset -= (len - (size)result);
-        } else {
-            e2->offset -= len;
+    ssize result;
+    if (len == 0) {
+        result = 0;
+    } else if (write && ops->writev_user) {
+        result = ops->writev_user(obj, iov, count, offset);
+    } else if (!write && ops->readv_user) {
+        result = ops->readv_user(obj, iov, count, offset);
+    } else {
+        result = handle_rwv_split(obj, iov, count, offset, write);
+    }
+
+    if (pos < 0) {
+        spinlock_acquire(&proc->lock);
+        proc_handle_t *e2 = process_get_handle_entry(proc, h);
+        if (e2 && e2->obj == obj) {
+            e2->offset -= result > 0 ? len - (size)result : len;
         }
+        spinlock_release(&proc->lock);
     }
-    spinlock_release(&proc->lock);
     object_deref(obj);
     return result;
 }
 
+ssize handle_read_user(handle_t h, void *ubuf, size len) {
+    io_vec_t iov = { ubuf, len };
+    return handle_rwv_user(h, &iov, 1, -1, false, -2, -3);
+}
+
+ssize handle_write_user(handle_t h, const void *ubuf, size len) {
+    io_vec_t iov = { (void *)ubuf, len };
+    return handle_rwv_user(h, &iov, 1, -1, true, -1, -1);
+}
+
+ssize handle_readv_user(handle_t h, const io_vec_t *iov, uint32 count, int64 pos) {
+    return handle_rwv_user(h, iov, count, pos, false, -2, -3);
+}
+
+ssize handle_writev_user(handle_t h, const io_vec_t *iov, uint32 count, int64 pos) {
+    return handle_rwv_user(h, iov, count, pos, true, -1, -1);
+}
+
 ssize handle_seek(handle_t h, ssize offset, int whence) {
     process_t *proc = get_handle_owner();
     if (!proc) return -1;
@@ -40,6 +40,18 @@ ssize handle_read(handle_t h, void *buf, size len);
 //write to handle (requires HANDLE_RIGHT_WRITE)
 ssize handle_write(handle_t h, const void *buf, size len);
 
+//same with a range checked user buffer, served by read_user/write_user or
+//through a kernel bounce buffer when the object has neither
+ssize handle_read_user(handle_t h, void *ubuf, size len);
+ssize handle_write_user(handle_t h, const void *ubuf, size len);
+
+//scatter/gather over range checked user segments (same rights and errors as above)
+//pos < 0 uses and advances the handle offset, otherwise reads/writes at pos and
+//leaves the handle offset alone. objects without readv_user/writev_user are
+//served one segment at a time like handle_read_user/handle_write_user
+ssize handle_readv_user(handle_t h, const io_vec_t *iov, uint32 count, int64 pos);
+ssize handle_writev_user(handle_t h, const io_vec_t *iov, uint32 count, int64 pos);
+
 //seek
 ssize handle_seek(handle_t h, ssize offset, int whence);
 
@@ -2,6 +2,8 @@
 #include <syscall/syscall.h>
 #include <mm/pmm.h>
 #include <mm/kheap.h>
+#include <mm/ksm.h>
+#include <lib/spinlock.h>
 #include <arch/timer.h>
 #include <drivers/rtc.h>
 #include <boot/db.h>
@@ -110,6 +112,16 @@ static intptr system_get_info(object_t *obj, uint32 topic, void *buf, size len)
         
         memcpy(buf, &st, sizeof(st));
         return 0;
+    } else if (topic == OBJ_INFO_KSM_STATS) {
+        if (len < sizeof(ksm_stats_t)) return -1;
+        ksm_stats_t st;
+        ksm_get_stats(&st);
+        memcpy(buf, &st, sizeof(st));
+        return 0;
+    } else if (topic == OBJ_INFO_LOCK_STATS) {
+        uint32 max = len / sizeof(lock_stats_t);
+        if (max == 0) return -1;
+        return (intptr)spinlock_stats_snapshot((lock_stats_t *)buf, max);
     } else if (topic == OBJ_INFO_BOOT_CMDLINE) {
         if (len == 0) return -1;
 
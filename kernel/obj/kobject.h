@@ -19,6 +19,8 @@
 #define OBJECT_NS_DIR   17   //namespace directory
 #define OBJECT_INFO     18   //kernel info object
 #define OBJECT_SOCKET   19   //network socket (TCP connection)
+#define OBJECT_DOORBELL 20   //shared-memory ring doorbell
+#define OBJECT_IORING   21   //asynchronous I/O submission/completion ring
 
 //type name helper
 static inline const char *object_type_name(uint32 type) {
@@ -38,6 +40,8 @@ static inline const char *object_type_name(uint32 type) {
         case 17: return "ns_dir";
         case 18: return "info";
         case 19: return "socket";
+        case 20: return "doorbell";
+        case 21: return "ioring";
         default: return "unknown";
     }
 }
@@ -2,7 +2,7 @@
 #include <mm/kheap.h>
 #include <lib/string.h>
 #include <lib/io.h>
-#include <lib/spinlock.h>
+#include <lib/rwlock.h>
 #include <fs/fs.h>
 
 //namespace tree node
@@ -18,7 +18,8 @@ typedef struct ns_node {
 
 //hidden root sentinel - has no name or object, its children are the top-level entries
 static ns_node_t  ns_root = {0};
-static spinlock_t ns_lock = {0};
+//lookups vastly outnumber registrations so readers share the lock
+static rwlock_t ns_lock = RWLOCK_INIT;
 
 void ns_init(void) {
     //root is statically allocated; nothing to initialise
@@ -54,7 +55,7 @@ static ns_node_t *ns_create_child(ns_node_t *parent, const char *name, size len)
 
 //walk path components split by '/' and optionally creating missing intermediate nodes
 //returns the leaf node, or NULL if a component is missing (create=false) or OOM (create=true)
-//must be called with ns_lock held
+//must be called with ns_lock held (for writing when create is true)
 static ns_node_t *ns_walk(const char *path, bool create) {
     ns_node_t  *cur = &ns_root;
     const char *p   = path;
@@ -101,7 +102,7 @@ static int ns_tree_dir_readdir(object_t *obj, void *entries_ptr, uint32 count, u
     uint32     skip    = *index;
     uint32     seen    = 0;
 
-    spinlock_acquire(&ns_lock);
+    rwlock_read_acquire(&ns_lock);
     for (ns_node_t *c = node->first_child; c && filled < count; c = c->next_sibling) {
         if (seen >= skip) {
             strncpy(entries[filled].name, c->name, sizeof(entries[filled].name) - 1);
@@ -111,7 +112,7 @@ static int ns_tree_dir_readdir(object_t *obj, void *entries_ptr, uint32 count, u
         }
         seen++;
     }
-    spinlock_release(&ns_lock);
+    rwlock_read_release(&ns_lock);
 
     *index = seen;
     return (int)filled;
@@ -131,14 +132,14 @@ static object_t *ns_make_dir_obj(ns_node_t *node) {
 int ns_register(const char *name, object_t *obj, handle_rights_t max_rights) {
     if (!name || !obj) return -1;
 
-    spinlock_acquire(&ns_lock);
+    rwlock_write_acquire(&ns_lock);
 
     ns_node_t *node = ns_walk(name, /*create=*/true);
-    if (!node) { spinlock_release(&ns_lock); return -1; }
+    if (!node) { rwlock_write_release(&ns_lock); return -1; }
 
     if (node->obj) {
         //already registered - refuse to overwrite silently
-        spinlock_release(&ns_lock);
+        rwlock_write_release(&ns_lock);
         return -1;
     }
 
@@ -146,18 +147,18 @@ int ns_register(const char *name, object_t *obj, handle_rights_t max_rights) {
     node->max_rights = max_rights;
     object_ref(obj);
 
-    spinlock_release(&ns_lock);
+    rwlock_write_release(&ns_lock);
     return 0;
 }
 
 int ns_unregister(const char *name) {
     if (!name) return -1;
 
-    spinlock_acquire(&ns_lock);
+    rwlock_write_acquire(&ns_lock);
 
     ns_node_t *node = ns_walk(name, /*create=*/false);
     if (!node || !node->obj) {
-        spinlock_release(&ns_lock);
+        rwlock_write_release(&ns_lock);
         return -1;
     }
 
@@ -165,14 +166,14 @@ int ns_unregister(const char *name) {
     node->obj        = NULL;
     node->max_rights = HANDLE_RIGHTS_ALL;
 
-    spinlock_release(&ns_lock);
+    rwlock_write_release(&ns_lock);
     return 0;
 }
 
 object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
     if (!name) return NULL;
 
-    spinlock_acquire(&ns_lock);
+    rwlock_read_acquire(&ns_lock);
 
     ns_node_t  *cur = &ns_root;
     const char *p   = name;
@@ -187,7 +188,7 @@ object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
 
         ns_node_t *child = ns_find_child(cur, p, len);
         if (!child) {
-            spinlock_release(&ns_lock);
+            rwlock_read_release(&ns_lock);
             return NULL;
         }
 
@@ -205,7 +206,7 @@ object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
             object_t       *factory   = cur->obj;
             handle_rights_t ceiling   = cur->max_rights;
             object_ref(factory);
-            spinlock_release(&ns_lock);
+            rwlock_read_release(&ns_lock);
 
             object_t *result = factory->ops->lookup(factory, remaining);
             object_deref(factory);
@@ -217,7 +218,7 @@ object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
 
     //guard against the empty-path case (ns_walk would return NULL but we loop differently here)
     if (cur == &ns_root) {
-        spinlock_release(&ns_lock);
+        rwlock_read_release(&ns_lock);
         return NULL;
     }
 
@@ -226,7 +227,7 @@ object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
         object_t       *obj    = cur->obj;
         handle_rights_t rights = cur->max_rights;
         object_ref(obj);
-        spinlock_release(&ns_lock);
+        rwlock_read_release(&ns_lock);
         if (max_rights_out) *max_rights_out = rights;
         return obj;
     }
@@ -235,14 +236,14 @@ object_t *ns_lookup_ex(const char *name, handle_rights_t *max_rights_out) {
     //if it has children synthesise a directory object so callers can list it
     if (cur->first_child) {
         ns_node_t *node = cur;
-        spinlock_release(&ns_lock);
+        rwlock_read_release(&ns_lock);
         //allocate outside the lock (kzalloc not allowed under spinlock)
         object_t *dir_obj = ns_make_dir_obj(node);
         if (dir_obj && max_rights_out) *max_rights_out = HANDLE_RIGHTS_ALL;
         return dir_obj;
     }
 
-    spinlock_release(&ns_lock);
+    rwlock_read_release(&ns_lock);
     return NULL;
 }
 
@@ -254,7 +255,7 @@ int ns_list(void *entries_ptr, uint32 count, uint32 *index) {
     uint32    skip    = *index;
     uint32    seen    = 0;
 
-    spinlock_acquire(&ns_lock);
+    rwlock_read_acquire(&ns_lock);
     for (ns_node_t *c = ns_root.first_child; c && filled < count; c = c->next_sibling) {
         if (seen >= skip) {
             strncpy(entries[filled].name, c->name, sizeof(entries[filled].name) - 1);
@@ -264,7 +265,7 @@ int ns_list(void *entries_ptr, uint32 count, uint32 *index) {
         }
         seen++;
     }
-    spinlock_release(&ns_lock);
+    rwlock_read_release(&ns_lock);
 
     *index = seen;
     return (int)filled;
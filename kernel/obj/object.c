@@ -1,6 +1,7 @@
 #include <obj/object.h>
 #include <mm/kheap.h>
 #include <lib/io.h>
+#include <syscall/syscall.h>
 
 object_t *object_create(uint32 type, object_ops_t *ops, void *data) {
     object_t *obj = kmalloc(sizeof(object_t));
@@ -57,3 +58,22 @@ const char *object_get_type_name(object_t *obj) {
     if (!obj) return "null";
     return object_type_name(obj->type);
 }
+
+int io_vec_copy(const io_vec_t *iov, uint32 count, size skip, void *kbuf, size len, bool to_user) {
+    uint8 *k = (uint8 *)kbuf;
+    for (uint32 i = 0; i < count && len > 0; i++) {
+        if (skip >= iov[i].len) {
+            skip -= iov[i].len;
+            continue;
+        }
+        size n = iov[i].len - skip;
+        if (n > len) n = len;
+        uint8 *u = (uint8 *)iov[i].base + skip;
+        int r = to_user ? copy_to_user_bytes(u, k, n) : copy_user_bytes(u, k, n);
+        if (r != 0) return -1;
+        k += n;
+        len -= n;
+        skip = 0;
+    }
+    return len == 0 ? 0 : -1;
+}
@@ -24,6 +24,18 @@ struct stat;
 
 struct object;
 
+//one segment of a scatter/gather request, layout shared with userspace
+typedef struct io_vec {
+    void *base;
+    size len;
+} io_vec_t;
+
+#define IO_VEC_MAX 64
+
+//copy len bytes starting skip bytes into the (range checked) user segments
+//to or from kbuf, returns 0 or -1 if a segment faults or the list is too short
+int io_vec_copy(const io_vec_t *iov, uint32 count, size skip, void *kbuf, size len, bool to_user);
+
 //polymorphic operations for objects
 typedef struct object_ops {
     ssize (*read)(struct object *obj, void *buf, size len, size offset);
@@ -33,6 +45,16 @@ typedef struct object_ops {
     struct object *(*lookup)(struct object *obj, const char *name);  //find child by name
     int   (*stat)(struct object *obj, struct stat *st);
     intptr (*get_info)(struct object *obj, uint32 topic, void *buf, size len);
+    //optional read/write straight to or from a user buffer (range checked only)
+    //the object copies with copy_to_user_bytes/copy_user_bytes where the data lives
+    //so nothing is bounced through the kernel heap, a faulting copy returns -1
+    ssize (*read_user)(struct object *obj, void *ubuf, size len, size offset);
+    ssize (*write_user)(struct object *obj, const void *ubuf, size len, size offset);
+    //optional scatter/gather over user segments starting at offset, served as one
+    //request (one lock hold, device transfers not cut at segment boundaries).
+    //returns bytes moved like read_user
+    ssize (*readv_user)(struct object *obj, const io_vec_t *iov, uint32 count, size offset);
+    ssize (*writev_user)(struct object *obj, const io_vec_t *iov, uint32 count, size offset);
 } object_ops_t;
 
 //base object structure
@@ -0,0 +1,121 @@
+#include <proc/futex.h>
+#include <proc/process.h>
+#include <proc/event.h>
+#include <proc/wait.h>
+#include <syscall/syscall.h>
+#include <errno.h>
+
+//on-stack record for one sleeping thread, linked into its bucket
+typedef struct futex_waiter {
+    wait_queue_t wq;
+    struct process *proc;
+    uintptr addr;
+    struct futex_waiter *next;
+    uint8 woken;
+} futex_waiter_t;
+
+typedef struct {
+    spinlock_irq_t lock;
+    futex_waiter_t *head;
+} futex_bucket_t;
+
+static futex_bucket_t buckets[FUTEX_BUCKETS];
+
+static futex_bucket_t *futex_bucket(process_t *proc, uintptr addr) {
+    //words sit 4 bytes apart and processes are separate kernel allocations
+    uint64 h = (addr >> 2) ^ ((uintptr)proc >> 4);
+    h *= 0x9E3779B97F4A7C15ULL;
+    return &buckets[h >> (64 - FUTEX_BUCKET_SHIFT)];
+}
+
+static void futex_unlink(futex_bucket_t *b, futex_waiter_t *w) {
+    futex_waiter_t **pp = &b->head;
+    while (*pp) {
+        if (*pp == w) {
+            *pp = w->next;
+            return;
+        }
+        pp = &(*pp)->next;
+    }
+}
+
+int futex_wait(process_t *proc, volatile uint32 *word, uint32 expected, uint64 deadline) {
+    if (!proc || !word) return -1;
+
+    if (proc_current_should_abort_blocking()) return -9;
+
+    //fault the page in before the bucket lock disables interrupts, both loads
+    //are fault-safe since the word may be unreadable or unmapped under us
+    uint32 current;
+    if (copy_user_bytes((const void *)word, &current, sizeof(current)) != 0) return -EFAULT;
+    if (current != expected) return -3;
+
+    futex_waiter_t w;
+    wait_queue_init(&w.wq);
+    w.proc = proc;
+    w.addr = (uintptr)word;
+    w.next = NULL;
+    w.woken = 0;
+
+    futex_bucket_t *b = futex_bucket(proc, w.addr);
+    irq_state_t flags = spinlock_irq_acquire(&b->lock);
+
+    //a waker stores the new value before taking this lock
+    //so if the word still matches no wakeup can have been missed
+    if (copy_user_bytes((const void *)word, &current, sizeof(current)) != 0) {
+        spinlock_irq_release(&b->lock, flags);
+        return -EFAULT;
+    }
+    if (current != expected) {
+        spinlock_irq_release(&b->lock, flags);
+        return -3;
+    }
+
+    w.next = b->head;
+    b->head = &w;
+
+    int timed_out = 0;
+    while (!w.woken) {
+        if (thread_sleep_locked_irq_timeout(&w.wq, &b->lock, &flags, deadline) < 0) {
+            timed_out = 1;
+            break;
+        }
+        //process events pull us off the queue without a futex wake
+        if (!w.woken && proc_current_should_abort_blocking()) break;
+    }
+
+    int result = 0;
+    if (!w.woken) {
+        futex_unlink(b, &w);
+        result = timed_out ? -2 : -9;
+    }
+    spinlock_irq_release(&b->lock, flags);
+
+    return result;
+}
+
+int futex_wake(process_t *proc, volatile uint32 *word, uint32 count) {
+    if (!proc || !word || count == 0) return 0;
+
+    uintptr addr = (uintptr)word;
+    futex_bucket_t *b = futex_bucket(proc, addr);
+    int woken = 0;
+
+    irq_state_t flags = spinlock_irq_acquire(&b->lock);
+    futex_waiter_t **pp = &b->head;
+    while (*pp && (uint32)woken < count) {
+        futex_waiter_t *w = *pp;
+        if (w->proc != proc || w->addr != addr) {
+            pp = &w->next;
+            continue;
+        }
+        *pp = w->next;
+        w->woken = 1;
+        //the waiter's stack frame stays valid until it retakes the bucket lock
+        thread_wake_one(&w->wq);
+        woken++;
+    }
+    spinlock_irq_release(&b->lock, flags);
+
+    return woken;
+}
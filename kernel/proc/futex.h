@@ -0,0 +1,34 @@
+#ifndef PROC_FUTEX_H
+#define PROC_FUTEX_H
+
+#include <arch/types.h>
+
+struct process;
+
+/*
+ *fast userspace mutexes
+ *
+ *the uncontended path never enters the kernel, userspace only calls in to
+ *sleep while a 32 bit word still holds the value it last saw or to wake the
+ *threads sleeping on it
+ *
+ *waiters are keyed by (process, virtual address) rather than physical frame
+ *since KSM may fold or split the page under a word between wait and wake
+*/
+
+//hash buckets shared by every process
+#define FUTEX_BUCKET_SHIFT  6
+#define FUTEX_BUCKETS       (1u << FUTEX_BUCKET_SHIFT)
+
+//wake every waiter
+#define FUTEX_WAKE_ALL  0xFFFFFFFF
+
+//sleep while *word == expected, deadline is in timer ticks (0 = no deadline)
+//returns 0 when woken, -3 if the word changed, -2 on timeout, -9 if interrupted
+//and -EFAULT if the word cannot be read
+int futex_wait(struct process *proc, volatile uint32 *word, uint32 expected, uint64 deadline);
+
+//wake up to count threads sleeping on word, returns the number woken
+int futex_wake(struct process *proc, volatile uint32 *word, uint32 count);
+
+#endif
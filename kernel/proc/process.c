@@ -3,6 +3,7 @@
 #include <mm/pmm.h>
 #include <mm/kheap.h>
 #include <mm/mm.h>
+#include <mm/ksm.h>
 #include <arch/mmu.h>
 #include <arch/cpu.h>
 #include <lib/string.h>
@@ -12,6 +13,7 @@
 #include <lib/spinlock.h>
 #include <arch/percpu.h>
 #include <syscall/syscall.h>
+#include <syscall/trace.h>
 
 
 static uint64 next_pid = 1;
@@ -19,7 +21,8 @@ static process_t *process_list = NULL;
 static process_t *kernel_process = NULL;
 
 
-static spinlock_t proc_lock = SPINLOCK_INIT;
+static spinlock_stats_t proc_lock_stats = SPINLOCK_STATS_INIT("proc");
+static spinlock_t proc_lock = SPINLOCK_INIT_STATS(&proc_lock_stats);
 static spinlock_t pid_lock = SPINLOCK_INIT;
 
 static void process_free(process_t *proc);
@@ -67,56 +70,59 @@ static object_ops_t process_object_ops = {
 };
 
 process_t *process_find(uint64 pid) {
-    spinlock_acquire(&proc_lock);
-    process_t *p = process_list;
-    while (p) {
+    rcu_read_lock();
+    for (process_t *p = rcu_dereference(process_list); p; p = rcu_dereference(p->next)) {
         if (p->pid == pid && !p->destroying) {
-            spinlock_release(&proc_lock);
+            rcu_read_unlock();
             return p;
         }
-        p = p->next;
     }
-    spinlock_release(&proc_lock);
+    rcu_read_unlock();
     return NULL;
 }
 
 void process_ref(process_t *proc) {
     if (!proc) return;
 
-    spinlock_acquire(&proc_lock);
-    proc->refcount++;
-    spinlock_release(&proc_lock);
+    __atomic_add_fetch(&proc->refcount, 1, __ATOMIC_ACQ_REL);
 }
 
-void process_unref(process_t *proc) {
-    int do_free = 0;
+static void process_free_rcu(rcu_head_t *head) {
+    process_free((process_t *)((char *)head - __builtin_offsetof(process_t, rcu)));
+}
 
+void process_unref(process_t *proc) {
     if (!proc) return;
 
-    spinlock_acquire(&proc_lock);
-    if (proc->refcount > 0) {
-        proc->refcount--;
-    }
-    do_free = (proc->refcount == 0);
-    spinlock_release(&proc_lock);
+    uint32 old = __atomic_load_n(&proc->refcount, __ATOMIC_RELAXED);
+    do {
+        if (old == 0) return;
+    } while (!__atomic_compare_exchange_n(&proc->refcount, &old, old - 1, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
 
-    if (do_free) {
-        process_free(proc);
+    //lock-free lookups may still be walking past this entry
+    if (old == 1) {
+        call_rcu(&proc->rcu, process_free_rcu);
     }
 }
 
 process_t *process_find_ref(uint64 pid) {
-    spinlock_acquire(&proc_lock);
-    process_t *p = process_list;
-    while (p) {
-        if (p->pid == pid && !p->destroying) {
-            p->refcount++;
-            spinlock_release(&proc_lock);
-            return p;
+    rcu_read_lock();
+    for (process_t *p = rcu_dereference(process_list); p; p = rcu_dereference(p->next)) {
+        if (p->pid != pid || p->destroying) continue;
+
+        //only take a reference while the last one has not been dropped yet
+        uint32 old = __atomic_load_n(&p->refcount, __ATOMIC_RELAXED);
+        while (old != 0) {
+            if (__atomic_compare_exchange_n(&p->refcount, &old, old + 1, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                rcu_read_unlock();
+                return p;
+            }
         }
-        p = p->next;
+        break;
     }
-    spinlock_release(&proc_lock);
+    rcu_read_unlock();
     return NULL;
 }
 
@@ -175,7 +181,7 @@ process_t *process_create(const char *name) {
     //add to process list
     spinlock_acquire(&proc_lock);
     proc->next = process_list;
-    process_list = proc;
+    rcu_assign_pointer(process_list, proc);
     spinlock_release(&proc_lock);
     
     return proc;
@@ -211,22 +217,24 @@ void process_destroy(process_t *proc) {
         spinlock_release(&proc_lock);
         return;
     }
+    //leave proc->next intact so concurrent RCU readers can walk past us
     process_t **pp = &process_list;
     while (*pp) {
         if (*pp == proc) {
-            *pp = proc->next;
+            rcu_assign_pointer(*pp, proc->next);
             break;
         }
         pp = &(*pp)->next;
     }
     proc->destroying = 1;
-    proc->next = NULL;
     spinlock_release(&proc_lock);
 
     proc_clear_console_foreground_if_owner(proc->pid);
     
     //wake any threads waiting for this process to exit
     thread_wake_all(&proc->exit_wait);
+    port_observers_signal(&proc->observers, PORT_SIGNAL_EXITED);
+    port_observers_detach(&proc->observers);
     
     //close all handles
     for (uint32 i = 0; i < proc->handle_capacity; i++) {
@@ -236,11 +244,20 @@ void process_destroy(process_t *proc) {
     }
     kfree(proc->handles);
     proc_context_destroy(&proc->context);
+    syscall_trace_destroy(proc);
     
     //free user address space if present
-    if (proc->pagemap) {
+    //detach the address space under proc->lock so the KSM scanner either
+    //finishes with it first or sees it gone
+    spinlock_acquire(&proc->lock);
+    pagemap_t *pagemap = proc->pagemap;
+    proc_vma_t *vma = proc->vma_list;
+    proc->pagemap = NULL;
+    proc->vma_list = NULL;
+    spinlock_release(&proc->lock);
+
+    if (pagemap) {
         //first, free all VMAs and their physical memory
-        proc_vma_t *vma = proc->vma_list;
         while (vma) {
             proc_vma_t *next = vma->next;
             
@@ -251,11 +268,12 @@ void process_destroy(process_t *proc) {
                 //since we don't track phys addresses in VMA directly for all types
                 //we have to use the pagemap to find them or walk the range
                 for (uintptr addr = vma->start; addr < vma->start + vma->length; addr += 4096) {
-                    uintptr phys = mmu_virt_to_phys(proc->pagemap, addr);
+                    uintptr phys = mmu_virt_to_phys(pagemap, addr);
                     if (phys) {
                         //unmap first to prevent double-free via overlapping VMAs
-                        mmu_unmap_range(proc->pagemap, addr, 1);
-                        pmm_free((void *)phys, 1);
+                        mmu_unmap_range(pagemap, addr, 1);
+                        //merged pages are refcounted by KSM
+                        if (!ksm_release_page(phys)) pmm_free((void *)phys, 1);
                     }
                 }
             }
@@ -264,10 +282,8 @@ void process_destroy(process_t *proc) {
             kfree(vma);
             vma = next;
         }
-        proc->vma_list = NULL;
 
-        mmu_pagemap_destroy(proc->pagemap);
-        proc->pagemap = NULL;
+        mmu_pagemap_destroy(pagemap);
     }
     
     //free the process object
@@ -291,12 +307,27 @@ void process_exit(process_t *proc, int code) {
     proc->state = PROC_STATE_DEAD;
     spinlock_release(&proc->lock);
 
+    port_observers_signal(&proc->observers, PORT_SIGNAL_EXITED);
+
     //make sibling threads observe process teardown and terminate on their next
     //wake/schedule path instead of continuing to run under a dead process
     proc_post_event(proc, PROC_EVENT_TERMINATE);
     proc_post_event(proc, PROC_EVENT_WAKE);
 }
 
+port_observers_t *process_port_observers(object_t *obj, uint32 *level) {
+    //called under rcu_read_lock, destroying is set before observers are detached
+    process_t *proc = (process_t *)obj->data;
+    if (!proc || proc->destroying) {
+        *level = PORT_SIGNAL_EXITED;
+        return NULL;
+    }
+
+    *level = (proc->state == PROC_STATE_DEAD || proc->state == PROC_STATE_ZOMBIE) ?
+             PORT_SIGNAL_EXITED : 0;
+    return &proc->observers;
+}
+
 object_t *process_get_object(process_t *proc) {
     if (!proc) return NULL;
     return proc->obj;
@@ -437,6 +468,8 @@ process_t *process_get_kernel(void) {
 }
 
 void proc_init(void) {
+    spinlock_stats_register(&proc_lock_stats);
+
     //create kernel process (PID 0)
     process_t *kproc = process_create("kernel");
     if (!kproc) {
@@ -591,6 +624,25 @@ proc_vma_t *process_vma_find(process_t *proc, uintptr addr) {
     return NULL;
 }
 
+object_t *process_vma_pin(process_t *proc, uintptr addr, size len, uint32 need_flags, size *offset_out) {
+    if (!proc || len == 0 || addr + len < addr) return NULL;
+
+    object_t *obj = NULL;
+    spinlock_acquire(&proc->lock);
+    for (proc_vma_t *vma = proc->vma_list; vma; vma = vma->next) {
+        if (addr < vma->start || addr >= vma->start + vma->length) continue;
+        if (vma->obj && len <= vma->start + vma->length - addr &&
+            (vma->flags & need_flags) == need_flags) {
+            obj = vma->obj;
+            object_ref(obj);
+            if (offset_out) *offset_out = vma->obj_offset + (addr - vma->start);
+        }
+        break;
+    }
+    spinlock_release(&proc->lock);
+    return obj;
+}
+
 uintptr process_setup_user_stack(uintptr stack_phys, uintptr stack_base, 
                                   size stack_size, int argc, char *argv[]) {
     //write to physical memory since user pagemap isn't active
@@ -704,11 +756,10 @@ uintptr process_setup_user_stack_dynamic(uintptr stack_phys, uintptr stack_base,
 }
 
 void process_iterate(void (*cb)(process_t *proc, void *data), void *data) {
-    spinlock_acquire(&proc_lock);
-    process_t *p = process_list;
-    while (p) {
+    //cb runs inside the read-side section and must not block or yield
+    rcu_read_lock();
+    for (process_t *p = rcu_dereference(process_list); p; p = rcu_dereference(p->next)) {
         cb(p, data);
-        p = p->next;
     }
-    spinlock_release(&proc_lock);
+    rcu_read_unlock();
 }
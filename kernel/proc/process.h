@@ -4,10 +4,12 @@
 #include <arch/types.h>
 #include <obj/object.h>
 #include <obj/rights.h>
+#include <ipc/port.h>
 #include <proc/context.h>
 #include <proc/event.h>
 #include <proc/wait.h>
 #include <lib/spinlock.h>
+#include <proc/rcu.h>
 
 
 //process states
@@ -70,9 +72,12 @@ typedef struct process {
     
     int64 exit_code;
     wait_queue_t exit_wait;
-    //protected by proc_lock process_find_ref process_ref and process_unref
+    port_observers_t observers; //ports waiting for this process to exit
+    //atomic, taken by process_find_ref process_ref and dropped by process_unref
     //keeps raw process_t users stable after lookup until process_unref()
+    //the final unref frees the process after an RCU grace period
     uint32 refcount;
+    rcu_head_t rcu;
     //protected by proc_lock so process lookup and teardown agree
     //set once the process leaves process_list so new lookups ignore it
     uint8 destroying;
@@ -81,7 +86,10 @@ typedef struct process {
     proc_event_mask_t pending_events;
     proc_event_action_t event_actions[PROC_EVENT_COUNT];
     
-    //linked list for scheduler
+    //syscall counters and trace stream, NULL until tracing is first enabled
+    struct syscall_trace *trace;
+
+    //process_list link, read under RCU and written under proc_lock
     struct process *next;
 
     //always acquire lock before event_lock when both are needed
@@ -105,6 +113,9 @@ void process_exit(process_t *proc, int code);
 //create a new process
 process_t *process_create(const char *name);
 
+//port source hook: observer list and PORT_SIGNAL_EXITED level of a process object
+port_observers_t *process_port_observers(object_t *obj, uint32 *level);
+
 //create a new userspace process (with address space)
 process_t *process_create_user(const char *name);
 
@@ -170,6 +181,11 @@ int process_vma_remove(process_t *proc, uintptr start);
 //find VMA containing the given address
 proc_vma_t *process_vma_find(process_t *proc, uintptr addr);
 
+//object backing [addr, addr + len) with +1 ref, so its memory outlives an unmap
+//NULL unless a single VMA with all of need_flags covers the range
+//offset_out receives the offset of addr into the object
+object_t *process_vma_pin(process_t *proc, uintptr addr, size len, uint32 need_flags, size *offset_out);
+
 //setup user stack with argc/argv
 //returns adjusted stack pointer to use for thread creation
 uintptr process_setup_user_stack(uintptr stack_phys, uintptr stack_base,
@@ -0,0 +1,109 @@
+#include <proc/rcu.h>
+#include <proc/process.h>
+#include <proc/thread.h>
+#include <proc/sched.h>
+#include <proc/wait.h>
+#include <arch/cpu.h>
+#include <arch/percpu.h>
+#include <lib/spinlock.h>
+#include <lib/io.h>
+
+//grace period counter, a CPU is done with period N once its rcu_qs_seq >= N
+static volatile uint64 rcu_gp_seq = 0;
+
+//callbacks waiting for the worker, pushed from any context
+static spinlock_irq_t rcu_cb_lock = SPINLOCK_IRQ_INIT;
+static rcu_head_t *rcu_cb_head = NULL;
+static rcu_head_t *rcu_cb_tail = NULL;
+static wait_queue_t rcu_wait;
+static bool rcu_started = false;
+
+void rcu_note_quiescent(void) {
+    percpu_t *pc = percpu_get();
+    uint64 seq = __atomic_load_n(&rcu_gp_seq, __ATOMIC_ACQUIRE);
+    if (pc->rcu_qs_seq != seq) {
+        __atomic_store_n(&pc->rcu_qs_seq, seq, __ATOMIC_RELEASE);
+    }
+}
+
+static bool rcu_cpu_passed(percpu_t *pc, uint64 seq) {
+    //CPUs that are not scheduling yet cannot be inside a read-side section
+    if (!pc->started || !pc->sched_running) return true;
+    return __atomic_load_n(&pc->rcu_qs_seq, __ATOMIC_ACQUIRE) >= seq;
+}
+
+void synchronize_rcu(void) {
+    uint64 seq = __atomic_add_fetch(&rcu_gp_seq, 1, __ATOMIC_ACQ_REL);
+    percpu_t *self = percpu_get();
+    uint32 count = percpu_cpu_count();
+
+    //the caller is not a reader itself
+    rcu_note_quiescent();
+
+    for (uint32 i = 0; i < count; i++) {
+        percpu_t *pc = percpu_get_by_index(i);
+        if (!pc || pc == self) continue;
+
+        while (!rcu_cpu_passed(pc, seq)) {
+            if (self->sched_running) {
+                sched_yield();
+            } else {
+                arch_pause();
+            }
+        }
+    }
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head)) {
+    if (!head || !func) return;
+
+    head->func = func;
+    head->next = NULL;
+
+    irq_state_t flags = spinlock_irq_acquire(&rcu_cb_lock);
+    if (rcu_cb_tail) {
+        rcu_cb_tail->next = head;
+    } else {
+        rcu_cb_head = head;
+    }
+    rcu_cb_tail = head;
+    spinlock_irq_release(&rcu_cb_lock, flags);
+
+    if (rcu_started) thread_wake_one(&rcu_wait);
+}
+
+static void rcu_worker(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        irq_state_t flags = spinlock_irq_acquire(&rcu_cb_lock);
+        while (!rcu_cb_head) {
+            thread_sleep_locked_irq(&rcu_wait, &rcu_cb_lock, &flags);
+        }
+        //detach the whole batch, one grace period covers all of it
+        rcu_head_t *batch = rcu_cb_head;
+        rcu_cb_head = NULL;
+        rcu_cb_tail = NULL;
+        spinlock_irq_release(&rcu_cb_lock, flags);
+
+        synchronize_rcu();
+
+        while (batch) {
+            rcu_head_t *next = batch->next;
+            batch->func(batch);
+            batch = next;
+        }
+    }
+}
+
+void rcu_init(void) {
+    wait_queue_init(&rcu_wait);
+
+    thread_t *thread = thread_create(process_get_kernel(), rcu_worker, NULL);
+    if (!thread) {
+        printf("[rcu] ERR: failed to create callback worker\n");
+        return;
+    }
+    sched_add(thread);
+    rcu_started = true;
+}
@@ -0,0 +1,51 @@
+#ifndef PROC_RCU_H
+#define PROC_RCU_H
+
+#include <arch/types.h>
+
+/*
+ *read-copy-update for read-mostly kernel tables
+ *
+ *kernel code is never preempted (sched_tick only preempts user mode) so a
+ *read-side section is any stretch of code between rcu_read_lock() and
+ *rcu_read_unlock() that does not block or yield
+ *
+ *a CPU passes a quiescent state whenever it goes through schedule(), takes a
+ *timer tick in user mode, parks in the idle loop or waits in sleep()/usleep();
+ *once every running CPU has done so after a grace period started no reader
+ *can still hold a pointer that was unlinked before it
+*/
+
+typedef struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+} rcu_head_t;
+
+static inline void rcu_read_lock(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline void rcu_read_unlock(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+//load a pointer published with rcu_assign_pointer()
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+//publish a fully initialised object to concurrent readers
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+//record a quiescent state for the current CPU (scheduler hook)
+void rcu_note_quiescent(void);
+
+//wait until every reader that could still see an unlinked object is done
+//may yield so it must not be called from IRQ context or under a spinlock
+void synchronize_rcu(void);
+
+//run func(head) from the RCU worker after a grace period, safe from any context
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+//start the callback worker (after sched_init)
+void rcu_init(void);
+
+#endif
@@ -11,6 +11,9 @@
 #include <arch/percpu.h>
 #include <arch/smp.h>
 #include <proc/bottom_half.h>
+#include <proc/rcu.h>
+#include <proc/wait.h>
+#include <arch/timer.h>
 
 #define KERNEL_STACK_SIZE 16384  //16KB
 
@@ -75,7 +78,31 @@ void sched_reap(void) {
     spinlock_irq_release(&dead_lock, flags);
 }
 
-//idle thread entry - just halts forever
+//sleep until an interrupt or, with a doorbell, until another CPU rings it
+static void sched_idle_wait(percpu_t *pc) {
+    if (!arch_idle_has_doorbell()) {
+        arch_halt();
+        return;
+    }
+
+    uint64 start = arch_rdtsc();
+
+    //publish that we are waiting before the final run queue check so a
+    //remote sched_add_cpu() either sees us waiting or we see its thread
+    __atomic_store_n(&pc->idle_waiting, 1, __ATOMIC_RELAXED);
+    arch_idle_arm(&pc->idle_doorbell);
+    arch_mb();
+    if (!pc->run_queue_head && !pc->idle_doorbell) {
+        arch_idle_sleep(pc->idle_predict);
+    }
+    __atomic_store_n(&pc->idle_waiting, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pc->idle_doorbell, 0, __ATOMIC_RELAXED);
+
+    uint64 slept = arch_rdtsc() - start;
+    pc->idle_predict = (pc->idle_predict * 7 + slept) / 8;
+}
+
+//idle thread entry - sleeps until there is work
 static void idle_thread_entry(void *arg) {
     (void)arg;
     
@@ -84,7 +111,8 @@ static void idle_thread_entry(void *arg) {
         //that schedule bottom halves can still make progress even when the
         //system is otherwise idle or only running kernel code
         bottom_half_run_budget(32);
-        arch_halt();
+        rcu_note_quiescent();
+        sched_idle_wait(percpu_get());
         sched_yield();
     }
 }
@@ -158,10 +186,33 @@ void sched_add_cpu(thread_t *thread, uint32 cpu_index) {
 
     //notify target CPU if it's not us
     if (pc != percpu_get()) {
-        arch_smp_send_resched(pc->cpu_index);
+        //an idle CPU parked on its doorbell wakes on a plain store, busy ones
+        //still need the IPI so user code gets preempted
+        arch_mb();
+        if (__atomic_load_n(&pc->idle_waiting, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&pc->idle_doorbell, 1, __ATOMIC_RELEASE);
+        } else {
+            arch_smp_send_resched(pc->cpu_index);
+        }
     }
 }
 
+void sched_add_front(thread_t *thread) {
+    if (!thread) return;
+
+    percpu_t *pc = percpu_get();
+    if (thread == pc->idle_thread) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&pc->sched_lock);
+
+    thread->sched_next = pc->run_queue_head;
+    pc->run_queue_head = thread;
+    if (!pc->run_queue_tail) pc->run_queue_tail = thread;
+    thread->state = THREAD_STATE_READY;
+
+    spinlock_irq_release(&pc->sched_lock, flags);
+}
+
 void sched_add(thread_t *thread) {
     if (!thread) return;
 
@@ -223,6 +274,9 @@ static void sched_activate(thread_t *next) {
     void *kernel_stack_top = (char *)next->kernel_stack + next->kernel_stack_size;
     arch_set_kernel_stack(kernel_stack_top);
 
+    //threads of one process share the address space but not their TLS block
+    if (next_proc && next_proc->pagemap) arch_set_user_tls(next->tls_base);
+
     //use TS to defer FP state work until the thread actually executes FP code
     arch_fpu_activate_thread(next);
 }
@@ -294,6 +348,9 @@ static void schedule(void) {
     
     //reap any dead threads before scheduling
     sched_reap();
+
+    //nothing in kernel code holds an RCU reference across a reschedule
+    rcu_note_quiescent();
     
     //SAFE POINT: We just entered schedule. If there was a prev_thread,
     //it means the PREVIOUS context switch COMPLETED and we are now running
@@ -418,11 +475,15 @@ void sched_tick(int from_usermode) {
     //don't preempt before the scheduler is fully started
     if (!pc->sched_running) return;
     
-    //only BSP reaps for now to avoid redundant lock contention
+    //only BSP reaps and expires timed sleeps for now to avoid redundant lock contention
     if (pc->cpu_index == 0) {
         sched_reap();
+        wait_expire_timeouts(arch_timer_get_ticks());
     }
     
+    //user code is never inside an RCU read-side section
+    if (from_usermode) rcu_note_quiescent();
+
     pc->tick_count++;
     if (from_usermode && pc->tick_count >= time_slice) {
         pc->tick_count = 0;
@@ -467,6 +528,7 @@ void sched_start(void) {
     //set kernel stack for ring 3 -> ring 0 transitions
     void *kernel_stack_top = (char *)first->kernel_stack + first->kernel_stack_size;
     arch_set_kernel_stack(kernel_stack_top);
+    arch_set_user_tls(first->tls_base);
 
     //defer FP state work until the thread actually needs it
     arch_fpu_activate_thread(first);
@@ -13,6 +13,11 @@ void sched_init_ap(void);
 void sched_add(thread_t *thread);
 void sched_add_cpu(thread_t *thread, uint32 cpu_index);
 
+//put a woken thread at the head of this CPU's run queue so it runs at the
+//next reschedule, inheriting what is left of the current time slice
+//the thread must not still be switching out on another CPU
+void sched_add_front(thread_t *thread);
+
 //remove thread from run queue
 void sched_remove(thread_t *thread);
 
@@ -2,6 +2,7 @@
 #include <proc/event.h>
 #include <proc/process.h>
 #include <proc/sched.h>
+#include <proc/wait.h>
 #include <arch/context.h>
 #include <arch/interrupts.h>
 #include <mm/kheap.h>
@@ -115,14 +116,22 @@ void thread_destroy(thread_t *thread) {
         spinlock_release(&proc->lock);
     }
     
+    //a thread killed mid timed sleep never returns to cancel its deadline
+    wait_timeout_cancel(thread);
+
     //free the thread object
     if (thread->obj) {
         thread->obj->data = NULL;  //clear back-pointer
         object_deref(thread->obj);
     }
     
+    void (*on_reap)(void *) = thread->on_reap;
+    void *reap_arg = thread->reap_arg;
+
     kfree(thread->kernel_stack);
     kfree(thread);
+
+    if (on_reap) on_reap(reap_arg);
     
     //if this was the last thread, leave the process as a zombie until waited on
     if (proc) {
@@ -174,6 +183,10 @@ static void user_thread_trampoline(void *thread_ptr) {
 }
 
 thread_t *thread_create_user(process_t *proc, void *entry, void *user_stack) {
+    return thread_create_user_arg(proc, entry, user_stack, NULL);
+}
+
+thread_t *thread_create_user_arg(process_t *proc, void *entry, void *user_stack, void *arg) {
     if (!proc) return NULL;
     
     thread_t *thread = kzalloc(sizeof(thread_t));
@@ -210,7 +223,7 @@ thread_t *thread_create_user(process_t *proc, void *entry, void *user_stack) {
     arch_fpu_init_thread(&thread->fpu_state);
     
     //setup usermode state in user_context
-    arch_context_init_user(&thread->user_context, user_stack, entry, NULL);
+    arch_context_init_user(&thread->user_context, user_stack, entry, arg);
     
     //setup initial KERNEL context to run the trampoline
     void *stack_top = (char *)thread->kernel_stack + KERNEL_STACK_SIZE;
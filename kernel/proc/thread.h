@@ -82,6 +82,20 @@ typedef struct thread {
     //wait queue link (for blocking)
     struct thread *wait_next;
     struct wait_queue *blocked_on;
+
+    //timed sleeps: tick deadline and link in the global timeout list
+    uint64 wake_deadline;
+    struct thread *timeout_next;
+    uint8 timeout_queued;
+    uint8 timed_out;
+
+    //user thread pointer, loaded into FS base whenever the thread is switched in
+    uint64 tls_base;
+
+    //run with reap_arg when the thread is destroyed, whether it returned or was
+    //reaped with its dead process without running again
+    void (*on_reap)(void *);
+    void *reap_arg;
 } thread_t;
 
 //create a thread in a process
@@ -96,6 +110,9 @@ object_t *thread_get_object(thread_t *thread);
 //create a usermode thread (entry/stack are in user address space)
 thread_t *thread_create_user(struct process *proc, void *entry, void *user_stack);
 
+//same, passing arg to entry in the first argument register
+thread_t *thread_create_user_arg(struct process *proc, void *entry, void *user_stack, void *arg);
+
 //exit current thread (never returns)
 void thread_exit(void);
 
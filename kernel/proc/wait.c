@@ -49,7 +49,7 @@ void thread_sleep(wait_queue_t *wq) {
     current->blocked_on = NULL;
 }
 
-void thread_wake_one(wait_queue_t *wq) {
+static void wake_one_common(wait_queue_t *wq, bool direct) {
     irq_state_t flags = spinlock_irq_acquire(&wq->lock);
 
     thread_t *thread = wq->head;
@@ -67,17 +67,34 @@ void thread_wake_one(wait_queue_t *wq) {
             thread->wait_cpu = -1;
             sched_queue_dead(thread);
         } else {
+            uint32 this_cpu = percpu_get()->cpu_index;
+            int on_cpu = __atomic_load_n(&thread->cpu_id, __ATOMIC_ACQUIRE);
+
             thread->state = THREAD_STATE_READY;
-            uint32 target_cpu = (thread->wait_cpu >= 0) ? (uint32)thread->wait_cpu
-                                                        : percpu_get()->cpu_index;
-            thread->wait_cpu = -1;
-            sched_add_cpu(thread, target_cpu);
+            //a thread still switching out elsewhere has to be resumed by that CPU
+            if (direct && thread != thread_current() &&
+                (on_cpu < 0 || on_cpu == (int)this_cpu)) {
+                thread->wait_cpu = -1;
+                sched_add_front(thread);
+            } else {
+                uint32 target_cpu = (thread->wait_cpu >= 0) ? (uint32)thread->wait_cpu : this_cpu;
+                thread->wait_cpu = -1;
+                sched_add_cpu(thread, target_cpu);
+            }
         }
     }
 
     spinlock_irq_release(&wq->lock, flags);
 }
 
+void thread_wake_one(wait_queue_t *wq) {
+    wake_one_common(wq, false);
+}
+
+void thread_wake_one_direct(wait_queue_t *wq) {
+    wake_one_common(wq, true);
+}
+
 void thread_wake_all(wait_queue_t *wq) {
     irq_state_t flags = spinlock_irq_acquire(&wq->lock);
 
@@ -138,9 +155,26 @@ void thread_sleep_locked(wait_queue_t *wq, spinlock_t *lock) {
     current->blocked_on = NULL;
 }
 
-void thread_sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t *flags) {
+//threads in timed sleeps, sorted by deadline so the tick only looks at the head
+static thread_t *timeout_head = NULL;
+static spinlock_irq_t timeout_lock = SPINLOCK_IRQ_INIT;
+
+static void timeout_insert(thread_t *thread, uint64 deadline) {
+    irq_state_t flags = spinlock_irq_acquire(&timeout_lock);
+    thread->wake_deadline = deadline;
+    thread_t **tp = &timeout_head;
+    while (*tp && (*tp)->wake_deadline <= deadline) {
+        tp = &(*tp)->timeout_next;
+    }
+    thread->timeout_next = *tp;
+    *tp = thread;
+    thread->timeout_queued = 1;
+    spinlock_irq_release(&timeout_lock, flags);
+}
+
+static void sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t *flags,
+                             uint64 deadline) {
     thread_t *current = thread_current();
-    if (!current || !flags) return;
 
     //caller holds lock with interrupts disabled via spinlock_irq_acquire()
     irq_state_t wq_flags = spinlock_irq_acquire(&wq->lock);
@@ -156,6 +190,9 @@ void thread_sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t
     wq->tail = current;
     spinlock_irq_release(&wq->lock, wq_flags);
 
+    //arm the deadline only once we are on the queue so expiry always finds us there
+    if (deadline) timeout_insert(current, deadline);
+
     //atomically drop the lock, then restore interrupt state and sleep
     spinlock_release(&lock->lock);
     arch_irq_restore(*flags);
@@ -173,6 +210,11 @@ void thread_sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t
     current->blocked_on = NULL;
 }
 
+void thread_sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t *flags) {
+    if (!thread_current() || !flags) return;
+    sleep_locked_irq(wq, lock, flags, 0);
+}
+
 void thread_wake_thread(thread_t *thread) {
     if (!thread) return;
 
@@ -228,3 +270,47 @@ void thread_wake_thread(thread_t *thread) {
     }
     spinlock_irq_release(&wq->lock, wq_flags);
 }
+
+void wait_timeout_cancel(thread_t *thread) {
+    if (!thread || !thread->timeout_queued) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&timeout_lock);
+    if (thread->timeout_queued) {
+        thread_t **tp = &timeout_head;
+        while (*tp && *tp != thread) tp = &(*tp)->timeout_next;
+        if (*tp) *tp = thread->timeout_next;
+        thread->timeout_next = NULL;
+        thread->timeout_queued = 0;
+    }
+    spinlock_irq_release(&timeout_lock, flags);
+}
+
+void wait_expire_timeouts(uint64 now) {
+    if (!timeout_head) return;
+
+    irq_state_t flags = spinlock_irq_acquire(&timeout_lock);
+    while (timeout_head && timeout_head->wake_deadline <= now) {
+        thread_t *thread = timeout_head;
+        timeout_head = thread->timeout_next;
+        thread->timeout_next = NULL;
+        thread->timeout_queued = 0;
+        thread->timed_out = 1;
+        //wake under timeout_lock so the sleeper cannot have moved on to
+        //another wait queue yet, thread_wake_thread ignores it if already woken
+        thread_wake_thread(thread);
+    }
+    spinlock_irq_release(&timeout_lock, flags);
+}
+
+int thread_sleep_locked_irq_timeout(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t *flags,
+                                    uint64 deadline) {
+    thread_t *current = thread_current();
+    if (!current || !flags) return -1;
+
+    current->timed_out = 0;
+    sleep_locked_irq(wq, lock, flags, deadline);
+    wait_timeout_cancel(current);
+
+    //timed_out is only set by the expiry path, a regular wakeup that raced it still counts
+    return current->timed_out ? -1 : 0;
+}
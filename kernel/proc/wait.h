@@ -24,6 +24,10 @@ void thread_sleep(wait_queue_t *wq);
 //removes from wait queue, adds to run queue
 void thread_wake_one(wait_queue_t *wq);
 
+//like thread_wake_one but hands the woken thread this CPU's next slot
+//falls back to a normal wakeup when the thread is still leaving another CPU
+void thread_wake_one_direct(wait_queue_t *wq);
+
 //wake all threads from wait queue
 void thread_wake_all(wait_queue_t *wq);
 
@@ -36,4 +40,15 @@ void thread_sleep_locked_irq(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t
 
 void thread_wake_thread(struct thread *thread);
 
+//like thread_sleep_locked_irq but gives up at tick deadline (0 = no deadline)
+//returns 0 when woken, -1 when the deadline passed first
+int thread_sleep_locked_irq_timeout(wait_queue_t *wq, spinlock_irq_t *lock, irq_state_t *flags,
+                                    uint64 deadline);
+
+//wake sleepers whose deadline has passed (called from the timer tick)
+void wait_expire_timeouts(uint64 now);
+
+//drop a thread from the timeout list before it is destroyed
+void wait_timeout_cancel(struct thread *thread);
+
 #endif
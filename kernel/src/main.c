@@ -10,6 +10,7 @@
 #include <mm/pmm.h>
 #include <mm/mm.h>
 #include <mm/kheap.h>
+#include <mm/ksm.h>
 #include <obj/handle.h>
 #include <obj/namespace.h>
 #include <obj/kernel_info.h>
@@ -18,8 +19,10 @@
 #include <proc/process.h>
 #include <proc/thread.h>
 #include <proc/sched.h>
+#include <proc/rcu.h>
 #include <fs/tmpfs.h>
 #include <fs/initrd.h>
+#include <fs/bcache.h>
 #include <kernel/elf64.h>
 #include <drivers/usb/xhci.h>
 #include <drivers/keyboard.h>
@@ -260,6 +263,8 @@ void parse_cmdline(const char *cmdline) {
         } else if (strcmp(arg, "nox2apic") == 0 || strcmp(arg, "noiommu") == 0 ||
                    strcmp(arg, "noapic") == 0 || strcmp(arg, "nointremap") == 0) {
             //already handled by arch_init(); keep kernel_main quiet about them
+        } else if (strcmp(arg, "ksm") == 0) {
+            ksm_set_enabled(true);
         } else if (strncmp(arg, "console=", 8) == 0) {
             //console selection is consumed by the bootloader / early init path
         } else if (strncmp(arg, "init=", 5) == 0) {
@@ -296,6 +301,9 @@ void kernel_main(const char *cmdline) {
     //initialize scheduler (creates idle thread)
     sched_init();
 
+    //deferred frees for RCU-protected tables
+    rcu_init();
+
     bottom_half_init();
 
     keyboard_start();
@@ -310,6 +318,12 @@ void kernel_main(const char *cmdline) {
     //initialize networking in the background so DHCP/NDP don't block boot
     net_init();
 
+    //block cache write-back
+    bcache_start();
+
+    //same-page merging scanner (opt-in via "ksm")
+    ksm_start();
+
     syscall_init();
 
     //spawn init process
@@ -11,70 +11,44 @@
 #include <errno.h>
 #include <atomic.h>
 
-#define MAX_HANDLE_IO (1u << 20)
+static bool user_range_ok(const void *buf, size len) {
+    uintptr start = (uintptr)buf;
+    if (start < USER_SPACE_START || start >= USER_SPACE_END) return false;
+    return len <= (size)(USER_SPACE_END - start);
+}
 
 intptr sys_handle_read(handle_t h, void *buf, size len) {
     if (!buf || len == 0) return -1;
-
-    intptr total = 0;
-    uint8 *ubuf = (uint8*)buf;
-
-    while (len > 0) {
-        size chunk = len > MAX_HANDLE_IO ? MAX_HANDLE_IO : len;
-
-        void *kbuf = kmalloc(chunk);
-        if (!kbuf) return total > 0 ? total : -1;
-
-        ssize r = handle_read(h, kbuf, chunk);
-        if (r <= 0) {
-            kfree(kbuf);
-            return total > 0 ? total : r;
-        }
-
-        if (copy_to_user_bytes(ubuf + total, kbuf, (size)r) != 0) {
-            kfree(kbuf);
-            return total > 0 ? total : -1;
-        }
-
-        kfree(kbuf);
-        total += r;
-        if ((size)r < chunk) break;
-        len -= r;
-    }
-
-    return total;
+    if (!user_range_ok(buf, len)) return -1;
+    return handle_read_user(h, buf, len);
 }
 
 intptr sys_handle_write(handle_t h, const void *buf, size len) {
     if (!buf || len == 0) return -1;
+    if (!user_range_ok(buf, len)) return -1;
+    return handle_write_user(h, buf, len);
+}
 
-    intptr total = 0;
-    const uint8 *ubuf = (const uint8*)buf;
-
-    while (len > 0) {
-        size chunk = len > MAX_HANDLE_IO ? MAX_HANDLE_IO : len;
-
-        void *kbuf = kmalloc(chunk);
-        if (!kbuf) return total > 0 ? total : -1;
-
-        if (copy_user_bytes(ubuf + total, kbuf, chunk) != 0) {
-            kfree(kbuf);
-            return total > 0 ? total : -1;
-        }
-
-        intptr r = handle_write(h, kbuf, chunk);
-        kfree(kbuf);
-
-        if (r <= 0) {
-            return total > 0 ? total : r;
-        }
-
-        total += r;
-        if ((size)r < chunk) break;
-        len -= r;
+int copy_user_iov(const io_vec_t *uiov, uint32 count, io_vec_t *kiov) {
+    if (!uiov || count == 0 || count > IO_VEC_MAX) return -1;
+    if (copy_user_bytes(uiov, kiov, count * sizeof(io_vec_t)) != 0) return -1;
+    for (uint32 i = 0; i < count; i++) {
+        if (kiov[i].len == 0) continue;
+        if (!user_range_ok(kiov[i].base, kiov[i].len)) return -1;
     }
+    return 0;
+}
+
+intptr sys_handle_readv(handle_t h, const io_vec_t *iov, uint32 count, int64 offset) {
+    io_vec_t kiov[IO_VEC_MAX];
+    if (copy_user_iov(iov, count, kiov) != 0) return -1;
+    return handle_readv_user(h, kiov, count, offset);
+}
 
-    return total;
+intptr sys_handle_writev(handle_t h, const io_vec_t *iov, uint32 count, int64 offset) {
+    io_vec_t kiov[IO_VEC_MAX];
+    if (copy_user_iov(iov, count, kiov) != 0) return -1;
+    return handle_writev_user(h, kiov, count, offset);
 }
 
 intptr sys_handle_seek(handle_t h, size offset, int mode) {
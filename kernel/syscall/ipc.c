@@ -1,8 +1,24 @@
 #include <syscall/syscall.h>
 #include <ipc/channel.h>
+#include <ipc/ring.h>
+#include <ipc/doorbell.h>
+#include <ipc/port.h>
+#include <ipc/pipe.h>
+#include <ipc/ioring.h>
+#include <arch/timer.h>
 #include <proc/process.h>
 #include <mm/kheap.h>
+#include <mm/vmo.h>
+#include <mm/pmm.h>
+#include <arch/mmu.h>
 #include <lib/string.h>
+#include <errno.h>
+
+static bool user_range_ok(const void *buf, size len) {
+    uintptr start = (uintptr)buf;
+    if (start < USER_SPACE_START || start >= USER_SPACE_END) return false;
+    return len <= (size)(USER_SPACE_END - start);
+}
 
 intptr sys_channel_create(int32 *ep0_out, int32 *ep1_out) {
     if (!ep0_out || !ep1_out) return -1;
@@ -13,7 +29,19 @@ intptr sys_channel_create(int32 *ep0_out, int32 *ep1_out) {
     return channel_create(proc, HANDLE_RIGHTS_DEFAULT, ep0_out, ep1_out);
 }
 
-intptr sys_channel_send(handle_t ep, const void *data, size len) {
+//absolute tick deadline timeout_ms from now, never 0 so it cannot mean "forever"
+static uint64 ipc_deadline_from_ms(uint64 timeout_ms) {
+    uint32 freq = arch_timer_getfreq();
+    if (freq == 0) freq = 1000;
+    uint64 ticks = (timeout_ms * freq + 999) / 1000;
+    if (ticks == 0) ticks = 1;
+    return arch_timer_get_ticks() + ticks;
+}
+
+//block selects channel_send_blocking, deadline 0 then waits forever
+//a non-zero txid sends the reply to that channel_call request
+static intptr channel_send_user(handle_t ep, const void *data, size len, uint32 txid,
+                                bool block, uint64 deadline) {
     if (!data && len > 0) return -1;
     if (len > CHANNEL_MAX_MSG_SIZE) return -2;
     
@@ -28,17 +56,41 @@ intptr sys_channel_send(handle_t ep, const void *data, size len) {
     }
     
     channel_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
     msg.data = kbuf;
     msg.data_len = len;
-    msg.handles = NULL;
-    msg.handle_count = 0;
+    msg.txid = txid;
+    msg.is_reply = txid != 0;
     
-    int result = channel_send(proc, ep, &msg);
+    int result = block ? channel_send_blocking(proc, ep, &msg, deadline)
+                       : channel_send(proc, ep, &msg);
     if (kbuf) kfree(kbuf);
     
     return result;
 }
 
+intptr sys_channel_send(handle_t ep, const void *data, size len) {
+    return channel_send_user(ep, data, len, 0, false, 0);
+}
+
+intptr sys_channel_send_timeout(handle_t ep, const void *data, size len, int64 timeout_ms) {
+    //negative waits for room forever, zero behaves like channel_send
+    if (timeout_ms == 0) return channel_send_user(ep, data, len, 0, false, 0);
+    uint64 deadline = timeout_ms < 0 ? 0 : ipc_deadline_from_ms((uint64)timeout_ms);
+    return channel_send_user(ep, data, len, 0, true, deadline);
+}
+
+intptr sys_channel_reply(handle_t ep, uint32 txid, const void *data, size len) {
+    if (txid == 0) return -1;
+    return channel_send_user(ep, data, len, txid, false, 0);
+}
+
+intptr sys_channel_set_queue_depth(handle_t ep, uint32 depth) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    return channel_set_queue_depth(proc, ep, depth);
+}
+
 intptr sys_channel_recv(handle_t ep, void *buf, size buflen) {
     if (!buf && buflen > 0) return -1;
     
@@ -49,6 +101,7 @@ intptr sys_channel_recv(handle_t ep, void *buf, size buflen) {
     memset(&msg, 0, sizeof(msg));
     int result = channel_recv(proc, ep, &msg);
     if (result != 0) return result;
+    channel_msg_drop_loan(&msg);  //no place to map it
     
     size to_copy = msg.data_len < buflen ? msg.data_len : buflen;
     if (to_copy > 0 && msg.data) {
@@ -65,6 +118,37 @@ intptr sys_channel_recv(handle_t ep, void *buf, size buflen) {
     return (intptr)msg.data_len;
 }
 
+//hand a received message to user buffers and free it
+//handles that do not fit are closed, data past data_len is dropped
+static void channel_msg_copy_out(process_t *proc, channel_msg_t *msg, void *data_buf, size data_len,
+                                 int32 *handles_buf, uint32 handles_len,
+                                 channel_recv_result_t *result_out) {
+    channel_msg_drop_loan(msg);  //no place to map it
+    
+    size to_copy = msg->data_len < data_len ? msg->data_len : data_len;
+    if (to_copy > 0 && msg->data && data_buf) {
+        memcpy(data_buf, msg->data, to_copy);
+    }
+    
+    uint32 handles_to_copy = msg->handle_count < handles_len ? msg->handle_count : handles_len;
+    if (handles_to_copy > 0 && msg->handles && handles_buf) {
+        memcpy(handles_buf, msg->handles, handles_to_copy * sizeof(int32));
+    }
+    
+    for (uint32 i = handles_to_copy; i < msg->handle_count; i++) {
+        process_close_handle(proc, msg->handles[i]);
+    }
+    
+    result_out->data_len = msg->data_len;
+    result_out->handle_count = msg->handle_count;
+    result_out->sender_pid = msg->sender_pid;
+    result_out->txid = msg->is_reply ? 0 : msg->txid;
+    result_out->reserved = 0;
+    
+    if (msg->data) kfree(msg->data);
+    if (msg->handles) kfree(msg->handles);
+}
+
 intptr sys_channel_recv_msg(handle_t ep, void *data_buf, size data_len,
                                    int32 *handles_buf, uint32 handles_len,
                                    channel_recv_result_t *result_out) {
@@ -76,28 +160,7 @@ intptr sys_channel_recv_msg(handle_t ep, void *data_buf, size data_len,
     memset(&msg, 0, sizeof(msg));
     int result = channel_recv(proc, ep, &msg);
     if (result != 0) return result;
-    
-    size to_copy = msg.data_len < data_len ? msg.data_len : data_len;
-    if (to_copy > 0 && msg.data && data_buf) {
-        memcpy(data_buf, msg.data, to_copy);
-    }
-    
-    uint32 handles_to_copy = msg.handle_count < handles_len ? msg.handle_count : handles_len;
-    if (handles_to_copy > 0 && msg.handles && handles_buf) {
-        memcpy(handles_buf, msg.handles, handles_to_copy * sizeof(int32));
-    }
-    
-    for (uint32 i = handles_to_copy; i < msg.handle_count; i++) {
-        process_close_handle(proc, msg.handles[i]);
-    }
-    
-    result_out->data_len = msg.data_len;
-    result_out->handle_count = msg.handle_count;
-    result_out->sender_pid = msg.sender_pid;
-    
-    if (msg.data) kfree(msg.data);
-    if (msg.handles) kfree(msg.handles);
-    
+    channel_msg_copy_out(proc, &msg, data_buf, data_len, handles_buf, handles_len, result_out);
     return 0;
 }
 
@@ -111,6 +174,7 @@ intptr sys_channel_try_recv(handle_t ep, void *buf, size buflen) {
     memset(&msg, 0, sizeof(msg));
     int result = channel_try_recv(proc, ep, &msg);
     if (result != 0) return result;
+    channel_msg_drop_loan(&msg);  //no place to map it
     
     size to_copy = msg.data_len < buflen ? msg.data_len : buflen;
     if (to_copy > 0 && msg.data) {
@@ -138,27 +202,446 @@ intptr sys_channel_try_recv_msg(handle_t ep, void *data_buf, size data_len,
     memset(&msg, 0, sizeof(msg));
     int result = channel_try_recv(proc, ep, &msg);
     if (result != 0) return result;
-    
+    channel_msg_copy_out(proc, &msg, data_buf, data_len, handles_buf, handles_len, result_out);
+    return 0;
+}
+
+intptr sys_channel_call(handle_t ep, const channel_call_args_t *args,
+                        channel_recv_result_t *result_out) {
+    if (!args || !result_out) return -1;
+    if (!args->wr_data && args->wr_len > 0) return -1;
+    if (args->wr_len > CHANNEL_MAX_MSG_SIZE) return -2;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    void *kbuf = NULL;
+    if (args->wr_len > 0) {
+        kbuf = kmalloc(args->wr_len);
+        if (!kbuf) return -3;
+        memcpy(kbuf, args->wr_data, args->wr_len);
+    }
+
+    channel_msg_t request;
+    memset(&request, 0, sizeof(request));
+    request.data = kbuf;
+    request.data_len = args->wr_len;
+
+    channel_msg_t reply;
+    memset(&reply, 0, sizeof(reply));
+    int result = channel_call(proc, ep, &request, &reply);
+    if (kbuf) kfree(kbuf);
+    if (result != 0) return result;
+
+    channel_msg_copy_out(proc, &reply, args->rd_data, args->rd_len,
+                         args->rd_handles, args->rd_handles_len, result_out);
+    return 0;
+}
+
+//resolve a loan descriptor to a referenced VMO and offset
+static vmo_t *channel_loan_resolve(process_t *proc, const channel_loan_t *loan, size *offset_out) {
+    bool writable = (loan->flags & CHANNEL_LOAN_WRITE) != 0;
+    vmo_t *vmo;
+    size offset;
+
+    if (loan->addr) {
+        //lend straight out of an existing mapping, it must be one VMO
+        if (loan->addr & (PAGE_SIZE - 1)) return NULL;
+        proc_vma_t *vma = process_vma_find(proc, loan->addr);
+        if (!vma || !vma->obj || vma->obj->type != OBJECT_VMO) return NULL;
+        if (loan->len > vma->start + vma->length - loan->addr) return NULL;
+        if (writable && !(vma->flags & MMU_FLAG_WRITE)) return NULL;
+        vmo = (vmo_t *)vma->obj;
+        offset = vma->obj_offset + (loan->addr - vma->start);
+    } else {
+        proc_handle_t *he = process_get_handle_entry(proc, loan->vmo);
+        if (!he || !he->obj || he->obj->type != OBJECT_VMO) return NULL;
+        if (!(he->rights & HANDLE_RIGHT_MAP)) return NULL;
+        if (writable && !(he->rights & HANDLE_RIGHT_WRITE)) return NULL;
+        vmo = (vmo_t *)he->obj;
+        offset = loan->offset;
+    }
+
+    if (offset & (PAGE_SIZE - 1)) return NULL;
+    if (offset >= vmo->size || loan->len > vmo->size - offset) return NULL;
+
+    object_ref(&vmo->obj);
+    *offset_out = offset;
+    return vmo;
+}
+
+intptr sys_channel_send_loan(handle_t ep, const void *data, size len, const channel_loan_t *loan) {
+    if (!data && len > 0) return -1;
+    if (!loan) return -1;
+    if (len > CHANNEL_MAX_MSG_SIZE) return -2;
+    if (loan->len == 0 || loan->len > CHANNEL_MAX_LOAN_SIZE) return -2;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    size offset;
+    vmo_t *vmo = channel_loan_resolve(proc, loan, &offset);
+    if (!vmo) return -9;
+
+    void *kbuf = NULL;
+    if (len > 0) {
+        kbuf = kmalloc(len);
+        if (!kbuf) {
+            object_deref(&vmo->obj);
+            return -3;
+        }
+        memcpy(kbuf, data, len);
+    }
+
+    channel_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.data = kbuf;
+    msg.data_len = len;
+    msg.loan_obj = &vmo->obj;
+    msg.loan_offset = offset;
+    msg.loan_len = loan->len;
+    msg.loan_flags = loan->flags & CHANNEL_LOAN_WRITE;
+
+    int result = channel_send(proc, ep, &msg);
+    if (kbuf) kfree(kbuf);
+    channel_msg_drop_loan(&msg);  //still ours if the send failed
+
+    return result;
+}
+
+intptr sys_channel_recv_loan(handle_t ep, void *data_buf, size data_len,
+                             channel_loan_result_t *result_out, uint32 flags) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!result_out) return -1;
+
+    channel_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    int result = (flags & CHANNEL_RECV_NONBLOCK) ? channel_try_recv(proc, ep, &msg)
+                                                 : channel_recv(proc, ep, &msg);
+    if (result != 0) return result;
+
+    //map the loaned frames before touching anything else, on failure the message
+    //goes back to the head of the queue so a retry can still get it
+    uintptr loan_addr = 0;
+    if (msg.loan_obj) {
+        handle_rights_t map_rights = HANDLE_RIGHT_READ;
+        if (msg.loan_flags & CHANNEL_LOAN_WRITE) map_rights |= HANDLE_RIGHT_WRITE;
+        void *va = vmo_map_object(proc, (vmo_t *)msg.loan_obj, NULL,
+                                  msg.loan_offset, msg.loan_len, map_rights);
+        if (!va) {
+            result = -9;
+            if (channel_requeue(proc, ep, &msg) == 0) return result;
+        } else {
+            loan_addr = (uintptr)va;
+        }
+    }
+
     size to_copy = msg.data_len < data_len ? msg.data_len : data_len;
-    if (to_copy > 0 && msg.data && data_buf) {
+    if (result == 0 && to_copy > 0 && msg.data && data_buf) {
         memcpy(data_buf, msg.data, to_copy);
     }
-    
-    uint32 handles_to_copy = msg.handle_count < handles_len ? msg.handle_count : handles_len;
-    if (handles_to_copy > 0 && msg.handles && handles_buf) {
-        memcpy(handles_buf, msg.handles, handles_to_copy * sizeof(int32));
-    }
-    
-    for (uint32 i = handles_to_copy; i < msg.handle_count; i++) {
+
+    //this call has no handle buffer, close anything that came along
+    for (uint32 i = 0; i < msg.handle_count; i++) {
         process_close_handle(proc, msg.handles[i]);
     }
-    
-    result_out->data_len = msg.data_len;
-    result_out->handle_count = msg.handle_count;
-    result_out->sender_pid = msg.sender_pid;
-    
+
+    if (result == 0) {
+        result_out->data_len = msg.data_len;
+        result_out->sender_pid = msg.sender_pid;
+        result_out->loan_flags = msg.loan_obj ? msg.loan_flags : 0;
+        result_out->loan_addr = loan_addr;
+        result_out->loan_len = msg.loan_obj ? msg.loan_len : 0;
+    }
+
+    //the mapping holds its own reference on the VMO
+    channel_msg_drop_loan(&msg);
     if (msg.data) kfree(msg.data);
     if (msg.handles) kfree(msg.handles);
-    
+
+    return result;
+}
+
+intptr sys_channel_send_batch(handle_t ep, const channel_iov_t *msgs, uint32 count) {
+    if (!msgs && count > 0) return -1;
+    if (count > CHANNEL_MAX_BATCH) return -5;  //same as channel_send_batch
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    //snapshot the descriptors, the payloads are copied once straight into queue entries
+    channel_iov_t iov[CHANNEL_MAX_BATCH];
+    if (count > 0 && copy_user_bytes(msgs, iov, count * sizeof(channel_iov_t)) != 0) return -EFAULT;
+
+    return channel_send_batch(proc, ep, iov, count);
+}
+
+intptr sys_channel_recv_batch(handle_t ep, channel_recv_slot_t *slots, uint32 max, uint32 flags) {
+    if (!slots || max == 0) return -1;
+    if (max > CHANNEL_MAX_BATCH) max = CHANNEL_MAX_BATCH;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    //every slot is checked before anything is dequeued
+    channel_recv_slot_t *kslots = kmalloc(max * sizeof(channel_recv_slot_t));
+    if (!kslots) return -1;
+    if (copy_user_bytes(slots, kslots, max * sizeof(channel_recv_slot_t)) != 0) {
+        kfree(kslots);
+        return -EFAULT;
+    }
+    for (uint32 i = 0; i < max; i++) {
+        if (kslots[i].buf_len > 0 && !user_range_ok(kslots[i].buf, kslots[i].buf_len)) {
+            kfree(kslots);
+            return -EFAULT;
+        }
+    }
+
+    channel_msg_t *msgs = kmalloc(max * sizeof(channel_msg_t));
+    if (!msgs) {
+        kfree(kslots);
+        return -1;
+    }
+    memset(msgs, 0, max * sizeof(channel_msg_t));
+
+    int got = channel_recv_batch(proc, ep, msgs, max, !(flags & CHANNEL_RECV_NONBLOCK));
+    int result = got;
+
+    for (int i = 0; i < got; i++) {
+        channel_msg_t *msg = &msgs[i];
+        channel_msg_drop_loan(msg);  //no place to map it
+
+        //a slot unmapped since the check loses its message
+        size to_copy = msg->data_len < kslots[i].buf_len ? msg->data_len : kslots[i].buf_len;
+        if (to_copy > 0 && msg->data && copy_to_user_bytes(kslots[i].buf, msg->data, to_copy) != 0) {
+            result = -EFAULT;
+        }
+        kslots[i].data_len = msg->data_len;
+        kslots[i].sender_pid = msg->sender_pid;
+        if (copy_to_user_bytes(&slots[i], &kslots[i], sizeof(channel_recv_slot_t)) != 0) result = -EFAULT;
+
+        //batches carry data only, close anything that came along
+        for (uint32 j = 0; j < msg->handle_count; j++) {
+            process_close_handle(proc, msg->handles[j]);
+        }
+        if (msg->data) kfree(msg->data);
+        if (msg->handles) kfree(msg->handles);
+    }
+
+    kfree(msgs);
+    kfree(kslots);
+    return result;
+}
+
+intptr sys_ring_create(uint32 slot_size, uint32 slot_count, uint32 flags,
+                       int32 *vmo_out, int32 *bell_out) {
+    if (!vmo_out || !bell_out) return -1;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    return ring_create(proc, slot_size, slot_count, flags, vmo_out, bell_out);
+}
+
+intptr sys_doorbell_create(void) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    return doorbell_create(proc, HANDLE_RIGHTS_DEFAULT);
+}
+
+intptr sys_doorbell_ring(handle_t h) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, h, HANDLE_RIGHT_WRITE)) return -8;
+
+    doorbell_t *db = doorbell_get(proc, h);
+    if (!db) return -1;
+
+    doorbell_ring(db);
     return 0;
 }
+
+intptr sys_doorbell_wait(handle_t h, const volatile uint32 *word, uint32 expected) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, h, HANDLE_RIGHT_READ)) return -8;
+
+    doorbell_t *db = doorbell_get(proc, h);
+    if (!db) return -1;
+
+    //doorbell_wait reads the word with a fault-safe load under the doorbell lock
+    if (!word || ((uintptr)word & 3)) return -1;
+
+    return doorbell_wait(db, word, expected);
+}
+
+intptr sys_port_create(void) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    return port_create(proc, HANDLE_RIGHTS_DEFAULT);
+}
+
+intptr sys_port_bind(handle_t port_h, handle_t h, uint64 key, uint32 signals) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, port_h, HANDLE_RIGHT_WRITE)) return -8;
+
+    port_t *port = port_get(proc, port_h);
+    if (!port) return -1;
+
+    object_t *obj = process_get_handle(proc, h);
+    if (!obj) return -6;  //invalid handle
+    //watching data arrive is a form of reading, exit status is not
+    if (obj->type != OBJECT_PROCESS && !process_handle_has_rights(proc, h, HANDLE_RIGHT_READ)) {
+        return -8;
+    }
+
+    object_ref(obj);
+    int result = port_bind(port, obj, key, signals);
+    object_deref(obj);
+    return result;
+}
+
+intptr sys_port_unbind(handle_t port_h, uint64 key) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, port_h, HANDLE_RIGHT_WRITE)) return -8;
+
+    port_t *port = port_get(proc, port_h);
+    if (!port) return -1;
+
+    return port_unbind(port, key);
+}
+
+intptr sys_port_set_timer(handle_t port_h, uint64 key, uint64 timeout_ms) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, port_h, HANDLE_RIGHT_WRITE)) return -8;
+
+    port_t *port = port_get(proc, port_h);
+    if (!port) return -1;
+
+    return port_set_timer(port, key, ipc_deadline_from_ms(timeout_ms));
+}
+
+intptr sys_port_wait(handle_t port_h, port_packet_t *out, uint32 max, int64 timeout_ms) {
+    if (!out || max == 0) return -1;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, port_h, HANDLE_RIGHT_READ)) return -8;
+
+    port_t *port = port_get(proc, port_h);
+    if (!port) return -1;
+
+    if (max > PORT_WAIT_MAX_PACKETS) max = PORT_WAIT_MAX_PACKETS;
+    //waiting consumes the packets, a bad buffer has to fail before that
+    if (!user_range_ok(out, (size)max * sizeof(port_packet_t))) return -EFAULT;
+    bool poll = timeout_ms == 0;
+    uint64 deadline = timeout_ms > 0 ? ipc_deadline_from_ms((uint64)timeout_ms) : 0;
+
+    //packets are gathered under the port lock, copy out once it is dropped
+    port_packet_t packets[PORT_WAIT_MAX_PACKETS];
+    object_ref(&port->obj);
+    int n = port_wait(port, packets, max, deadline, poll);
+    object_deref(&port->obj);
+
+    if (n > 0 && copy_to_user_bytes(out, packets, (size)n * sizeof(port_packet_t)) != 0) return -EFAULT;
+    return n;
+}
+
+intptr sys_pipe_create(int32 *read_out, int32 *write_out) {
+    if (!read_out || !write_out) return -1;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    return pipe_create(proc, read_out, write_out);
+}
+
+//at least one side has to be a pipe, the other may be any readable or writable handle
+intptr sys_splice(handle_t in, handle_t out, size len, uint32 flags) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (len == 0) return 0;
+    if (len > PIPE_MAX_SPLICE) len = PIPE_MAX_SPLICE;
+
+    if (!process_handle_has_rights(proc, in, HANDLE_RIGHT_READ)) return -8;
+    if (!process_handle_has_rights(proc, out, HANDLE_RIGHT_WRITE)) return -8;
+
+    //the ends stay referenced across the blocking transfer in case another thread closes a handle
+    pipe_end_t *src = pipe_get(proc, in);
+    pipe_end_t *dst = pipe_get(proc, out);
+
+    ssize r;
+    if ((src && src->end != PIPE_END_READ) || (dst && dst->end != PIPE_END_WRITE)) {
+        r = -2;
+    } else if (src && dst) {
+        r = pipe_splice_pipes(src->pipe, dst->pipe, len, flags);
+    } else if (src) {
+        r = pipe_splice_to(src->pipe, out, len, flags);
+    } else if (dst) {
+        r = pipe_splice_from(in, dst->pipe, len, flags);
+    } else {
+        r = -2;
+    }
+
+    if (src) object_deref(&src->obj);
+    if (dst) object_deref(&dst->obj);
+    return r;
+}
+
+intptr sys_tee(handle_t in, handle_t out, size len, uint32 flags) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (len == 0) return 0;
+    if (len > PIPE_MAX_SPLICE) len = PIPE_MAX_SPLICE;
+
+    if (!process_handle_has_rights(proc, in, HANDLE_RIGHT_READ)) return -8;
+    if (!process_handle_has_rights(proc, out, HANDLE_RIGHT_WRITE)) return -8;
+
+    pipe_end_t *src = pipe_get(proc, in);
+    pipe_end_t *dst = pipe_get(proc, out);
+    ssize r = -2;
+    if (src && dst && src->end == PIPE_END_READ && dst->end == PIPE_END_WRITE) {
+        r = pipe_tee(src->pipe, dst->pipe, len, flags);
+    }
+    if (src) object_deref(&src->obj);
+    if (dst) object_deref(&dst->obj);
+    return r;
+}
+
+intptr sys_ioring_create(uint32 entries, uint32 flags, int32 *vmo_out) {
+    if (!vmo_out) return -1;
+
+    process_t *proc = process_current();
+    if (!proc) return -1;
+
+    int32 vh;
+    int32 h = ioring_create(proc, entries, flags, &vh);
+    if (h < 0) return h;
+    if (copy_to_user_bytes(vmo_out, &vh, sizeof(vh)) != 0) {
+        process_close_handle(proc, h);
+        process_close_handle(proc, vh);
+        return -1;
+    }
+    return h;
+}
+
+intptr sys_ioring_enter(handle_t h, uint32 to_submit, uint32 min_complete, uint32 flags) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!process_handle_has_rights(proc, h, HANDLE_RIGHT_WRITE)) return -8;
+
+    //the workers run in the creating process and use its handle table
+    ioring_t *ring = ioring_get(proc, h);
+    if (!ring || ring->proc != proc) return -1;
+
+    object_ref(&ring->obj);
+    int r = ioring_enter(ring, to_submit, min_complete, flags);
+    object_deref(&ring->obj);
+    return r;
+}
@@ -65,6 +65,18 @@ intptr sys_object_get_info(handle_t h, uint32 topic, void *ptr, size len) {
         return 0;
     }
 
+    if (topic == OBJ_INFO_BLOCK_DISCARD || topic == OBJ_INFO_BLOCK_ZERO ||
+        topic == OBJ_INFO_BLOCK_PREFETCH) {
+        //discard and zero change the contents like a write does
+        handle_rights_t need = topic == OBJ_INFO_BLOCK_PREFETCH ? HANDLE_RIGHT_READ : HANDLE_RIGHT_WRITE;
+        if (!handle_has_rights(h, need)) return -1;
+        if (!ptr || len < sizeof(block_range_t)) return -1;
+
+        block_range_t range;
+        if (copy_user_bytes(ptr, &range, sizeof(range)) != 0) return -EFAULT;
+        return object_get_info(obj, topic, &range, sizeof(range));
+    }
+
     if (topic == OBJ_INFO_VT_STATE) {
         if (!ptr || len < sizeof(vt_info_t)) return -1;
 
@@ -1,12 +1,24 @@
 #include <syscall/syscall.h>
 #include <arch/power.h>
+#include <fs/bcache.h>
+#include <fs/mount.h>
 
 intptr sys_reboot(void) {
+    fs_sync_all();
+    bcache_sync(NULL);
     arch_power_reboot();
     return 0;
 }
 
 intptr sys_shutdown(void) {
+    fs_sync_all();
+    bcache_sync(NULL);
     arch_power_shutdown();
     return 0;
 }
+
+intptr sys_sync(void) {
+    int rc = fs_sync_all();
+    if (bcache_sync(NULL) < 0) rc = -1;
+    return rc;
+}
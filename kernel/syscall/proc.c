@@ -4,12 +4,16 @@
 #include <proc/bottom_half.h>
 #include <proc/thread.h>
 #include <proc/sched.h>
+#include <proc/futex.h>
+#include <arch/timer.h>
 #include <kernel/elf64.h>
 #include <mm/pmm.h>
 #include <mm/kheap.h>
 #include <lib/string.h>
 #include <lib/io.h>
 #include <obj/handle.h>
+#include <syscall/trace.h>
+#include <ipc/channel.h>
 
 //strings are copied through this temporary kernel buffer limit before they are
 //duplicated again into the destination process cotext
@@ -495,6 +499,84 @@ intptr sys_process_start(handle_t proc_h, uintptr entry, uintptr stack) {
     return (intptr)target->pid;
 }
 
+//user words handed to the futex calls must be aligned and inside a mapping
+static int futex_word_valid(process_t *proc, volatile uint32 *word) {
+    if (!word || ((uintptr)word & 3)) return 0;
+    return process_vma_find(proc, (uintptr)word) != NULL;
+}
+
+//the word a thread clears on exit also has to be in a writable mapping
+static int futex_word_writable(process_t *proc, volatile uint32 *word) {
+    if (!futex_word_valid(proc, word)) return 0;
+    proc_vma_t *vma = process_vma_find(proc, (uintptr)word);
+    return vma && (vma->flags & MMU_FLAG_WRITE);
+}
+
+intptr sys_thread_create(uintptr entry, uintptr stack, uintptr arg, uintptr tls) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!entry || !stack) return -1;
+
+    //the first push lands just below the top so the slot under it must be mapped
+    if (!process_vma_find(proc, stack - 8)) return -2;
+
+    thread_t *thread = thread_create_user_arg(proc, (void *)entry, (void *)stack, (void *)arg);
+    if (!thread) return -4;
+    thread->tls_base = tls;
+
+    sched_add(thread);
+    return (intptr)thread->tid;
+}
+
+intptr sys_thread_exit(volatile uint32 *clear_word) {
+    process_t *proc = process_current();
+
+    //lets a joiner sleep on the word until the thread is really gone
+    //the store is fault-safe, the mapping may still go away under us
+    uint32 zero = 0;
+    if (proc && futex_word_writable(proc, clear_word) &&
+        copy_to_user_bytes((void *)clear_word, &zero, sizeof(zero)) == 0) {
+        futex_wake(proc, clear_word, FUTEX_WAKE_ALL);
+    }
+
+    thread_exit();
+    return 0;
+}
+
+intptr sys_set_tls(uintptr base) {
+    thread_t *current = thread_current();
+    if (!current || !current->process) return -1;
+
+    current->tls_base = base;
+    arch_set_user_tls(base);
+    return 0;
+}
+
+intptr sys_futex_wait(volatile uint32 *word, uint32 expected, int64 timeout_ms) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!futex_word_valid(proc, word)) return -1;
+
+    uint64 deadline = 0;
+    if (timeout_ms >= 0) {
+        uint32 freq = arch_timer_getfreq();
+        if (freq == 0) freq = 1000;
+        uint64 ticks = ((uint64)timeout_ms * freq + 999) / 1000;
+        if (ticks == 0) ticks = 1;
+        deadline = arch_timer_get_ticks() + ticks;
+    }
+
+    return futex_wait(proc, word, expected, deadline);
+}
+
+intptr sys_futex_wake(volatile uint32 *word, uint32 count) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    if (!futex_word_valid(proc, word)) return -1;
+
+    return futex_wake(proc, word, count);
+}
+
 //check if caller has permission to signal target process
 static int check_signal_permission(process_t *caller, process_t *target) {
     //a process can always send signals/events to itself
@@ -649,3 +731,58 @@ intptr sys_proc_set_console_foreground(uintptr pid) {
     if (!current) return -1;
     return proc_set_console_foreground(current, pid);
 }
+
+//tracing another process needs the same permission as signalling it, pid 0 is the caller
+static process_t *trace_target_ref(process_t *caller, uintptr pid) {
+    process_t *target = process_find_ref(pid ? pid : caller->pid);
+    if (!target) return NULL;
+    if (!check_signal_permission(caller, target)) {
+        process_unref(target);
+        return NULL;
+    }
+    return target;
+}
+
+intptr sys_syscall_trace(uintptr pid, uint32 flags, handle_t stream) {
+    process_t *caller = process_current();
+    if (!caller) return -1;
+
+    //the stream endpoint is looked up in the tracer's table, records go to its peer
+    channel_endpoint_t *ep = NULL;
+    if (flags & SYSCALL_TRACE_STREAM) {
+        if (!process_handle_has_rights(caller, stream, HANDLE_RIGHT_WRITE)) return -8;
+        ep = channel_get_endpoint(caller, stream);
+        if (!ep) return -1;
+    }
+
+    process_t *target = trace_target_ref(caller, pid);
+    if (!target) return -1;
+    int r = syscall_trace_set(target, flags, ep);
+    process_unref(target);
+    return r;
+}
+
+intptr sys_syscall_stats(uintptr pid, syscall_stat_t *buf, uint32 max, uint64 *dropped_out) {
+    process_t *caller = process_current();
+    if (!caller) return -1;
+    if (!buf && max > 0) return -1;
+    if (max > SYSCALL_TRACE_MAX) max = SYSCALL_TRACE_MAX;
+
+    syscall_stat_t *kbuf = max ? kmalloc((size)max * sizeof(syscall_stat_t)) : NULL;
+    if (max && !kbuf) return -1;
+
+    process_t *target = trace_target_ref(caller, pid);
+    if (!target) {
+        if (kbuf) kfree(kbuf);
+        return -1;
+    }
+    uint64 dropped;
+    uint32 n = syscall_trace_snapshot(target, kbuf, max, &dropped);
+    process_unref(target);
+
+    intptr r = (intptr)n;
+    if (n > 0 && copy_to_user_bytes(buf, kbuf, (size)n * sizeof(syscall_stat_t)) != 0) r = -1;
+    if (r >= 0 && dropped_out && copy_to_user_bytes(dropped_out, &dropped, sizeof(dropped)) != 0) r = -1;
+    if (kbuf) kfree(kbuf);
+    return r;
+}
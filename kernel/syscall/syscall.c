@@ -1,8 +1,10 @@
 #include <syscall/syscall.h>
+#include <syscall/trace.h>
+#include <proc/process.h>
 #include <arch/timer.h>
 
-intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
-                       uintptr arg4, uintptr arg5, uintptr arg6) {
+static intptr syscall_invoke(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
+                             uintptr arg4, uintptr arg5, uintptr arg6) {
     (void)arg4; (void)arg5; (void)arg6; //suppress unused parameter warnings
     switch (num) {
         case SYS_EXIT: return sys_exit((intptr)arg1);
@@ -15,6 +17,8 @@ intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
         case SYS_GET_OBJ: return sys_get_obj((handle_t)arg1, (const char *)arg2, (handle_rights_t)arg3);
         case SYS_HANDLE_READ: return sys_handle_read((handle_t)arg1, (void *)arg2, (size)arg3);
         case SYS_HANDLE_WRITE: return sys_handle_write((handle_t)arg1, (const void *)arg2, (size)arg3);
+        case SYS_HANDLE_READV: return sys_handle_readv((handle_t)arg1, (const io_vec_t *)arg2, (uint32)arg3, (int64)arg4);
+        case SYS_HANDLE_WRITEV: return sys_handle_writev((handle_t)arg1, (const io_vec_t *)arg2, (uint32)arg3, (int64)arg4);
         case SYS_HANDLE_SEEK: return sys_handle_seek((handle_t)arg1, (size)arg2, (int)arg3);
         case SYS_HANDLE_CLOSE: return sys_handle_close((handle_t)arg1);
         case SYS_HANDLE_DUP: return sys_handle_dup((handle_t)arg1, (handle_rights_t)arg2);
@@ -31,6 +35,35 @@ intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
         case SYS_CHANNEL_TRY_RECV_MSG: return sys_channel_try_recv_msg((handle_t)arg1, (void *)arg2, (size)arg3,
                                                                 (int32 *)arg4, (uint32)arg5,
                                                                 (channel_recv_result_t *)arg6);
+        case SYS_CHANNEL_SEND_LOAN: return sys_channel_send_loan((handle_t)arg1, (const void *)arg2, (size)arg3,
+                                                                  (const channel_loan_t *)arg4);
+        case SYS_CHANNEL_RECV_LOAN: return sys_channel_recv_loan((handle_t)arg1, (void *)arg2, (size)arg3,
+                                                                  (channel_loan_result_t *)arg4, (uint32)arg5);
+        case SYS_RING_CREATE: return sys_ring_create((uint32)arg1, (uint32)arg2, (uint32)arg3,
+                                                      (int32 *)arg4, (int32 *)arg5);
+        case SYS_DOORBELL_CREATE: return sys_doorbell_create();
+        case SYS_DOORBELL_RING: return sys_doorbell_ring((handle_t)arg1);
+        case SYS_DOORBELL_WAIT: return sys_doorbell_wait((handle_t)arg1, (const volatile uint32 *)arg2, (uint32)arg3);
+        case SYS_PORT_CREATE: return sys_port_create();
+        case SYS_PORT_BIND: return sys_port_bind((handle_t)arg1, (handle_t)arg2, (uint64)arg3, (uint32)arg4);
+        case SYS_PORT_UNBIND: return sys_port_unbind((handle_t)arg1, (uint64)arg2);
+        case SYS_PORT_SET_TIMER: return sys_port_set_timer((handle_t)arg1, (uint64)arg2, (uint64)arg3);
+        case SYS_CHANNEL_SEND_TIMEOUT: return sys_channel_send_timeout((handle_t)arg1, (const void *)arg2,
+                                                                       (size)arg3, (int64)arg4);
+        case SYS_CHANNEL_SET_DEPTH: return sys_channel_set_queue_depth((handle_t)arg1, (uint32)arg2);
+        case SYS_CHANNEL_SEND_BATCH: return sys_channel_send_batch((handle_t)arg1, (const channel_iov_t *)arg2,
+                                                                   (uint32)arg3);
+        case SYS_CHANNEL_RECV_BATCH: return sys_channel_recv_batch((handle_t)arg1, (channel_recv_slot_t *)arg2,
+                                                                   (uint32)arg3, (uint32)arg4);
+        case SYS_CHANNEL_CALL: return sys_channel_call((handle_t)arg1, (const channel_call_args_t *)arg2,
+                                                       (channel_recv_result_t *)arg3);
+        case SYS_CHANNEL_REPLY: return sys_channel_reply((handle_t)arg1, (uint32)arg2, (const void *)arg3, (size)arg4);
+        case SYS_PIPE_CREATE: return sys_pipe_create((int32 *)arg1, (int32 *)arg2);
+        case SYS_SPLICE: return sys_splice((handle_t)arg1, (handle_t)arg2, (size)arg3, (uint32)arg4);
+        case SYS_TEE: return sys_tee((handle_t)arg1, (handle_t)arg2, (size)arg3, (uint32)arg4);
+        case SYS_IORING_CREATE: return sys_ioring_create((uint32)arg1, (uint32)arg2, (int32 *)arg3);
+        case SYS_IORING_ENTER: return sys_ioring_enter((handle_t)arg1, (uint32)arg2, (uint32)arg3, (uint32)arg4);
+        case SYS_PORT_WAIT: return sys_port_wait((handle_t)arg1, (port_packet_t *)arg2, (uint32)arg3, (int64)arg4);
         case SYS_VMO_MAP: return sys_vmo_map((handle_t)arg1, (uintptr)arg2, (size)arg3, (size)arg4, (uint32)arg5);
         case SYS_VMO_UNMAP: return sys_vmo_unmap((uintptr)arg1, (size)arg2);
         case SYS_NS_REGISTER: return sys_ns_register((const char *)arg1, (handle_t)arg2, (handle_rights_t)arg3);
@@ -41,6 +74,11 @@ intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
         case SYS_PROCESS_CREATE: return sys_process_create((const char *)arg1);
         case SYS_HANDLE_GRANT: return sys_handle_grant((handle_t)arg1, (handle_t)arg2, (handle_rights_t)arg3);
         case SYS_PROCESS_START: return sys_process_start((handle_t)arg1, arg2, arg3);
+        case SYS_THREAD_CREATE: return sys_thread_create(arg1, arg2, arg3, arg4);
+        case SYS_THREAD_EXIT: return sys_thread_exit((volatile uint32 *)arg1);
+        case SYS_SET_TLS: return sys_set_tls(arg1);
+        case SYS_FUTEX_WAIT: return sys_futex_wait((volatile uint32 *)arg1, (uint32)arg2, (int64)arg3);
+        case SYS_FUTEX_WAKE: return sys_futex_wake((volatile uint32 *)arg1, (uint32)arg2);
         
         case SYS_VMO_RESIZE: return sys_vmo_resize((handle_t)arg1, (size)arg2);
         case SYS_READDIR: return sys_readdir((handle_t)arg1, (dirent_t *)arg2, (uint32)arg3, (uint32 *)arg4);
@@ -53,6 +91,7 @@ intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
         case SYS_FSTAT: return sys_fstat((handle_t)arg1, (stat_t *)arg2);
         case SYS_REBOOT: return sys_reboot();
         case SYS_SHUTDOWN: return sys_shutdown();
+        case SYS_SYNC: return sys_sync();
         case SYS_OBJECT_GET_INFO: return sys_object_get_info((handle_t)arg1, (uint32)arg2, (void *)arg3, (size)arg4);
         case SYS_PING: return sys_ping((uint32)arg1, (const void *)arg2, (uint32)arg3, (uint32)arg4);
         case SYS_DNS_RESOLVE: return sys_dns_resolve((const char *)arg1, (uint32 *)arg2);
@@ -74,7 +113,27 @@ intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
         case SYS_PROC_GET_PENDING_EVENTS: return sys_proc_get_pending_events((uint64 *)arg1);
         case SYS_PROC_EVENT_RETURN: return sys_proc_event_return();
         case SYS_PROC_SET_CONSOLE_FOREGROUND: return sys_proc_set_console_foreground((uintptr)arg1);
+        case SYS_SYSCALL_TRACE: return sys_syscall_trace((uintptr)arg1, (uint32)arg2, (handle_t)arg3);
+        case SYS_SYSCALL_STATS: return sys_syscall_stats((uintptr)arg1, (syscall_stat_t *)arg2,
+                                                         (uint32)arg3, (uint64 *)arg4);
         
         default: return -1;
     }
 }
+
+intptr syscall_dispatch(uintptr num, uintptr arg1, uintptr arg2, uintptr arg3,
+                       uintptr arg4, uintptr arg5, uintptr arg6) {
+    //untraced processes only pay for this test
+    process_t *proc = process_current();
+    if (!proc || !proc->trace || !proc->trace->flags) {
+        return syscall_invoke(num, arg1, arg2, arg3, arg4, arg5, arg6);
+    }
+
+    uint64 start = arch_rdtsc();
+    intptr result = syscall_invoke(num, arg1, arg2, arg3, arg4, arg5, arg6);
+    uint64 end = arch_rdtsc();
+
+    uintptr args[6] = { arg1, arg2, arg3, arg4, arg5, arg6 };
+    syscall_trace_record(proc, num, args, result, start, end);
+    return result;
+}
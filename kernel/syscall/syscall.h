@@ -5,6 +5,9 @@
 #include <obj/handle.h>
 #include <fs/fs.h>
 #include <sys/sysnums.h>
+#include <ipc/port.h>
+#include <ipc/channel.h>
+#include <syscall/trace.h>
 
 //object info topics
 typedef enum {
@@ -17,7 +20,13 @@ typedef enum {
     OBJ_INFO_BOOT_CMDLINE = 6,  //boot cmdline string (requires system handle)
     OBJ_INFO_BLOCK_DEVICE = 7,  //block_device_info_t (requires device handle)
     OBJ_INFO_VT_STATE = 8,      //vt_info_t (requires vt device handle)
-    OBJ_INFO_BLOCK_RESCAN = 9   //trigger partition rescan (requires device handle)
+    OBJ_INFO_BLOCK_RESCAN = 9,  //trigger partition rescan (requires device handle)
+    OBJ_INFO_KSM_STATS = 10,    //ksm_stats_t (requires system handle)
+    OBJ_INFO_LOCK_STATS = 11,   //lock_stats_t array, returns entry count (requires system handle)
+    OBJ_INFO_BLOCK_FLUSH = 12,  //write back cached data and flush the device (requires device handle)
+    OBJ_INFO_BLOCK_DISCARD = 13, //block_range_t to discard (requires writable device handle)
+    OBJ_INFO_BLOCK_ZERO = 14,   //block_range_t to zero (requires writable device handle)
+    OBJ_INFO_BLOCK_PREFETCH = 15 //block_range_t to load into the block cache in the background
 } object_info_topic_t;
 
 //info structures
@@ -55,6 +64,12 @@ typedef struct {
     uint64 sector_count;
 } block_device_info_t;
 
+//byte range of a block device, both sector aligned
+typedef struct {
+    uint64 offset;
+    uint64 len;
+} block_range_t;
+
 typedef struct {
     uint32 cols;
     uint32 rows;
@@ -72,13 +87,64 @@ typedef struct {
     char cpu_brand[48];     //CPU brand string (e.g. "Intel Core i7...")
 } system_stats_t;
 
+typedef struct lock_stats {
+    char name[32];
+    uint64 acquisitions;
+    uint64 contended;       //acquisitions that had to wait
+    uint64 spin_cycles;     //TSC cycles spent waiting
+    uint64 max_hold_cycles; //longest critical section seen
+} lock_stats_t;
+
 //result struct for channel_recv_msg
 typedef struct {
     size data_len;       //actual bytes of data received
     uint32 handle_count; //number of handles received
     uint32 sender_pid;   //PID of the process that sent this message (0 if kernel)
+    uint32 txid;         //channel_call request to answer with channel_reply (0 if none)
+    uint32 reserved;
 } channel_recv_result_t;
 
+//request and reply buffers for channel_call
+typedef struct {
+    const void *wr_data;    //request bytes
+    size wr_len;
+    void *rd_data;          //reply bytes, truncated to rd_len
+    size rd_len;
+    int32 *rd_handles;      //reply handles, extras are closed
+    uint32 rd_handles_len;
+    uint32 reserved;
+} channel_call_args_t;
+
+//page loan descriptor for channel_send_loan
+//the range is named either by a user address inside a mapped VMO or by a VMO handle
+typedef struct {
+    uintptr addr;        //page aligned address, 0 to use vmo + offset instead
+    int32 vmo;           //VMO handle (when addr is 0)
+    uint32 flags;        //CHANNEL_LOAN_*
+    size offset;         //page aligned offset into the VMO (when addr is 0)
+    size len;            //bytes to lend
+} channel_loan_t;
+
+//result struct for channel_recv_loan
+typedef struct {
+    size data_len;       //actual bytes of inline data received
+    uint32 sender_pid;   //PID of the process that sent this message (0 if kernel)
+    uint32 loan_flags;   //CHANNEL_LOAN_* of the mapped loan
+    uintptr loan_addr;   //where the loan was mapped (0 if the message had none)
+    size loan_len;       //length of the mapping, release with vmo_unmap
+} channel_loan_result_t;
+
+#define CHANNEL_RECV_NONBLOCK (1 << 0)
+
+//one message slot of channel_recv_batch
+typedef struct {
+    void *buf;           //where to copy the message
+    size buf_len;        //capacity of buf
+    size data_len;       //out: full message length, the copy is truncated to buf_len
+    uint32 sender_pid;   //out: PID of the sender (0 if kernel)
+    uint32 reserved;
+} channel_recv_slot_t;
+
 typedef enum {
     CONTEXT_VALUE_STRING = 1,
     CONTEXT_VALUE_I64 = 2,
@@ -120,12 +186,22 @@ intptr sys_wait(uintptr pid);
 intptr sys_process_create(const char *name);
 intptr sys_handle_grant(handle_t proc_h, handle_t local_h, handle_rights_t rights);
 intptr sys_process_start(handle_t proc_h, uintptr entry, uintptr stack);
+intptr sys_thread_create(uintptr entry, uintptr stack, uintptr arg, uintptr tls);
+intptr sys_thread_exit(volatile uint32 *clear_word);
+intptr sys_set_tls(uintptr base);
+intptr sys_futex_wait(volatile uint32 *word, uint32 expected, int64 timeout_ms);
+intptr sys_futex_wake(volatile uint32 *word, uint32 count);
 intptr sys_get_obj(handle_t parent, const char *path, handle_rights_t rights);
 intptr sys_handle_close(handle_t h);
 intptr sys_handle_dup(handle_t h, handle_rights_t new_rights);
 intptr sys_ns_register(const char *path, handle_t h, handle_rights_t max_rights);
 
 intptr sys_channel_create(int32 *ep0_out, int32 *ep1_out);
+intptr sys_pipe_create(int32 *read_out, int32 *write_out);
+intptr sys_splice(handle_t in, handle_t out, size len, uint32 flags);
+intptr sys_tee(handle_t in, handle_t out, size len, uint32 flags);
+intptr sys_ioring_create(uint32 entries, uint32 flags, int32 *vmo_out);
+intptr sys_ioring_enter(handle_t h, uint32 to_submit, uint32 min_complete, uint32 flags);
 intptr sys_channel_send(handle_t ep, const void *data, size len);
 intptr sys_channel_recv(handle_t ep, void *buf, size buflen);
 intptr sys_channel_try_recv(handle_t ep, void *buf, size buflen);
@@ -135,6 +211,26 @@ intptr sys_channel_recv_msg(handle_t ep, void *data_buf, size data_len,
 intptr sys_channel_try_recv_msg(handle_t ep, void *data_buf, size data_len,
                                int32 *handles_buf, uint32 handles_len,
                                channel_recv_result_t *result_out);
+intptr sys_channel_send_timeout(handle_t ep, const void *data, size len, int64 timeout_ms);
+intptr sys_channel_set_queue_depth(handle_t ep, uint32 depth);
+intptr sys_channel_send_batch(handle_t ep, const channel_iov_t *msgs, uint32 count);
+intptr sys_channel_recv_batch(handle_t ep, channel_recv_slot_t *slots, uint32 max, uint32 flags);
+intptr sys_channel_call(handle_t ep, const channel_call_args_t *args,
+                        channel_recv_result_t *result_out);
+intptr sys_channel_reply(handle_t ep, uint32 txid, const void *data, size len);
+intptr sys_channel_send_loan(handle_t ep, const void *data, size len, const channel_loan_t *loan);
+intptr sys_channel_recv_loan(handle_t ep, void *data_buf, size data_len,
+                             channel_loan_result_t *result_out, uint32 flags);
+intptr sys_ring_create(uint32 slot_size, uint32 slot_count, uint32 flags,
+                       int32 *vmo_out, int32 *bell_out);
+intptr sys_doorbell_create(void);
+intptr sys_doorbell_ring(handle_t h);
+intptr sys_doorbell_wait(handle_t h, const volatile uint32 *word, uint32 expected);
+intptr sys_port_create(void);
+intptr sys_port_bind(handle_t port, handle_t h, uint64 key, uint32 signals);
+intptr sys_port_unbind(handle_t port, uint64 key);
+intptr sys_port_set_timer(handle_t port, uint64 key, uint64 timeout_ms);
+intptr sys_port_wait(handle_t port, port_packet_t *out, uint32 max, int64 timeout_ms);
 intptr sys_vmo_create(size sz, uint32 flags, handle_rights_t rights);
 intptr sys_vmo_read(handle_t h, void *buf, size len, size offset);
 intptr sys_vmo_write(handle_t h, const void *buf, size len, size offset);
@@ -151,11 +247,14 @@ intptr sys_mknode(const char *path, uint32 type);
 intptr sys_remove(const char *path);
 intptr sys_handle_read(handle_t h, void *buf, size len);
 intptr sys_handle_write(handle_t h, const void *buf, size len);
+intptr sys_handle_readv(handle_t h, const io_vec_t *iov, uint32 count, int64 offset);
+intptr sys_handle_writev(handle_t h, const io_vec_t *iov, uint32 count, int64 offset);
 intptr sys_handle_seek(handle_t h, size offset, int mode);
 intptr sys_debug_write(const char *buf, size count);
 intptr sys_get_ticks(void);
 intptr sys_reboot(void);
 intptr sys_shutdown(void);
+intptr sys_sync(void);
 intptr sys_object_get_info(handle_t h, uint32 topic, void *ptr, size len);
 intptr sys_ping(uint32 family, const void *dst_addr, uint32 addr_len, uint32 count);
 intptr sys_dns_resolve(const char *hostname, uint32 *ip_out);
@@ -175,10 +274,15 @@ intptr sys_proc_unmask_events(uint64 mask);
 intptr sys_proc_get_pending_events(uint64 *out_mask);
 intptr sys_proc_event_return(void);
 intptr sys_proc_set_console_foreground(uintptr pid);
+intptr sys_syscall_trace(uintptr pid, uint32 flags, handle_t stream);
+intptr sys_syscall_stats(uintptr pid, syscall_stat_t *buf, uint32 max, uint64 *dropped_out);
 
 //helper for safe user-space copies
 int copy_user_bytes(const void *user_ptr, void *kernel_buf, size len);
 int copy_user_cstr(const char *user_str, char *kernel_buf, size kernel_len);
 int copy_to_user_bytes(void *user_ptr, const void *kernel_buf, size len);
 
+//copy a user io_vec_t list (1..IO_VEC_MAX entries) in and range check every segment
+int copy_user_iov(const io_vec_t *user_iov, uint32 count, io_vec_t *kernel_iov);
+
 #endif
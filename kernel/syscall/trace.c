@@ -0,0 +1,122 @@
+#include <syscall/trace.h>
+#include <ipc/channel.h>
+#include <proc/process.h>
+#include <proc/thread.h>
+#include <mm/kheap.h>
+#include <lib/string.h>
+
+static inline uint32 trace_bucket(uint64 cycles) {
+    if (cycles == 0) return 0;
+    uint32 b = 63 - (uint32)__builtin_clzll(cycles);
+    return b < SYSCALL_TRACE_BUCKETS ? b : SYSCALL_TRACE_BUCKETS - 1;
+}
+
+int syscall_trace_set(process_t *proc, uint32 flags, channel_endpoint_t *stream) {
+    if (!proc) return -1;
+    if (flags & ~(SYSCALL_TRACE_STATS | SYSCALL_TRACE_STREAM | SYSCALL_TRACE_RESET)) return -2;
+    if ((flags & SYSCALL_TRACE_STREAM) && !stream) return -2;
+
+    //the state is allocated once and lives until the process is destroyed
+    //so a thread still inside syscall_trace_record never sees it freed
+    spinlock_acquire(&proc->lock);
+    syscall_trace_t *tr = proc->trace;
+    spinlock_release(&proc->lock);
+    if (!tr) {
+        if (!(flags & ~SYSCALL_TRACE_RESET)) return 0;
+        syscall_trace_t *fresh = kzalloc(sizeof(syscall_trace_t));
+        if (!fresh) return -1;
+        spinlock_irq_init(&fresh->lock);
+
+        spinlock_acquire(&proc->lock);
+        if (!proc->trace) {
+            proc->trace = fresh;
+            fresh = NULL;
+        }
+        tr = proc->trace;
+        spinlock_release(&proc->lock);
+        if (fresh) kfree(fresh);
+    }
+
+    if (flags & SYSCALL_TRACE_RESET) {
+        memset(tr->stats, 0, sizeof(tr->stats));
+        tr->dropped = 0;
+    }
+
+    if (stream && (flags & SYSCALL_TRACE_STREAM)) object_ref(&stream->obj);
+    irq_state_t irq = spinlock_irq_acquire(&tr->lock);
+    channel_endpoint_t *old = tr->stream;
+    tr->stream = (flags & SYSCALL_TRACE_STREAM) ? stream : NULL;
+    __atomic_store_n(&tr->flags, flags & (SYSCALL_TRACE_STATS | SYSCALL_TRACE_STREAM),
+                     __ATOMIC_RELEASE);
+    spinlock_irq_release(&tr->lock, irq);
+    if (old) object_deref(&old->obj);
+    return 0;
+}
+
+void syscall_trace_record(process_t *proc, uint64 num, const uintptr *args,
+                          intptr result, uint64 start_tsc, uint64 end_tsc) {
+    syscall_trace_t *tr = proc->trace;
+    uint32 flags = __atomic_load_n(&tr->flags, __ATOMIC_ACQUIRE);
+    uint64 cycles = end_tsc - start_tsc;
+
+    //threads of one process update the same counters, relaxed atomics are enough
+    if ((flags & SYSCALL_TRACE_STATS) && num < SYSCALL_TRACE_MAX) {
+        syscall_stat_t *st = &tr->stats[num];
+        __atomic_fetch_add(&st->count, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&st->total_cycles, cycles, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&st->hist[trace_bucket(cycles)], 1, __ATOMIC_RELAXED);
+        uint64 max = __atomic_load_n(&st->max_cycles, __ATOMIC_RELAXED);
+        while (cycles > max &&
+               !__atomic_compare_exchange_n(&st->max_cycles, &max, cycles, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    if (!(flags & SYSCALL_TRACE_STREAM)) return;
+
+    irq_state_t irq = spinlock_irq_acquire(&tr->lock);
+    channel_endpoint_t *stream = tr->stream;
+    if (stream) object_ref(&stream->obj);
+    spinlock_irq_release(&tr->lock, irq);
+    if (!stream) return;
+
+    thread_t *thread = thread_current();
+    syscall_trace_record_t rec;
+    rec.tsc = start_tsc;
+    rec.cycles = cycles;
+    rec.pid = (uint32)proc->pid;
+    rec.tid = thread ? (uint32)thread->tid : 0;
+    rec.num = (uint32)num;
+    rec.reserved = 0;
+    for (int i = 0; i < 6; i++) rec.args[i] = args[i];
+    rec.result = result;
+
+    if (channel_post(stream, &rec, sizeof(rec)) != 0) {
+        __atomic_fetch_add(&tr->dropped, 1, __ATOMIC_RELAXED);
+    }
+    object_deref(&stream->obj);
+}
+
+uint32 syscall_trace_snapshot(process_t *proc, syscall_stat_t *out, uint32 max, uint64 *dropped) {
+    syscall_trace_t *tr = proc ? proc->trace : NULL;
+    if (dropped) *dropped = tr ? __atomic_load_n(&tr->dropped, __ATOMIC_RELAXED) : 0;
+    if (!tr || !out) return 0;
+
+    uint32 n = 0;
+    for (uint32 i = 0; i < SYSCALL_TRACE_MAX && n < max; i++) {
+        if (__atomic_load_n(&tr->stats[i].count, __ATOMIC_RELAXED) == 0) continue;
+        out[n] = tr->stats[i];
+        out[n].num = i;
+        n++;
+    }
+    return n;
+}
+
+void syscall_trace_destroy(process_t *proc) {
+    syscall_trace_t *tr = proc->trace;
+    if (!tr) return;
+
+    proc->trace = NULL;
+    if (tr->stream) object_deref(&tr->stream->obj);
+    kfree(tr);
+}
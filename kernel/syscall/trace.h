@@ -0,0 +1,76 @@
+#ifndef SYSCALL_TRACE_H
+#define SYSCALL_TRACE_H
+
+#include <arch/types.h>
+#include <lib/spinlock.h>
+
+/*
+ *syscall tracing
+ *
+ *opt-in per process. with SYSCALL_TRACE_STATS syscall_dispatch keeps a call
+ *count, total and worst case TSC cycles and a log2 cycle histogram for every
+ *syscall number. with SYSCALL_TRACE_STREAM every completed call is also
+ *posted as a syscall_trace_record_t on a channel endpoint handed in by the
+ *tracer, which reads the records from the other end. records that do not fit
+ *the tracer's queue are dropped and counted rather than slowing the tracee
+ *
+ *an untraced process pays one pointer test per syscall
+ *
+ *the records and stats below are ABI and mirrored in user/libc/include/system.h
+*/
+
+#define SYSCALL_TRACE_MAX       128     //syscall numbers tracked
+#define SYSCALL_TRACE_BUCKETS   32      //bucket i counts calls of [2^i, 2^(i+1)) cycles
+
+//flags for SYS_SYSCALL_TRACE, 0 stops tracing
+#define SYSCALL_TRACE_STATS     (1 << 0)
+#define SYSCALL_TRACE_STREAM    (1 << 1)
+#define SYSCALL_TRACE_RESET     (1 << 2)    //clear the counters first
+
+typedef struct {
+    uint64 tsc;                 //TSC at syscall entry
+    uint64 cycles;              //TSC cycles spent in the kernel
+    uint32 pid;
+    uint32 tid;
+    uint32 num;
+    uint32 reserved;
+    uint64 args[6];
+    int64 result;
+} syscall_trace_record_t;
+
+typedef struct {
+    uint32 num;
+    uint32 reserved;
+    uint64 count;
+    uint64 total_cycles;
+    uint64 max_cycles;
+    uint32 hist[SYSCALL_TRACE_BUCKETS];
+} syscall_stat_t;
+
+struct process;
+struct channel_endpoint;
+
+typedef struct syscall_trace {
+    volatile uint32 flags;          //SYSCALL_TRACE_*
+    spinlock_irq_t lock;            //protects stream
+    struct channel_endpoint *stream; //ref held while streaming
+    uint64 dropped;                 //records lost to a full or closed stream
+    syscall_stat_t stats[SYSCALL_TRACE_MAX];
+} syscall_trace_t;
+
+//start, change or stop (flags 0) tracing proc, stream is the endpoint the
+//records are posted on (needed with SYSCALL_TRACE_STREAM, NULL otherwise)
+int syscall_trace_set(struct process *proc, uint32 flags, struct channel_endpoint *stream);
+
+//record one finished syscall of the current process
+void syscall_trace_record(struct process *proc, uint64 num, const uintptr *args,
+                          intptr result, uint64 start_tsc, uint64 end_tsc);
+
+//copy the stats of every syscall proc made (count > 0), returns the entry count
+//dropped (optional) receives the number of stream records lost so far
+uint32 syscall_trace_snapshot(struct process *proc, syscall_stat_t *out, uint32 max, uint64 *dropped);
+
+//free the trace state of a process being destroyed
+void syscall_trace_destroy(struct process *proc);
+
+#endif
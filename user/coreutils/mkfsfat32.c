@@ -90,6 +90,13 @@ static int write_sector(handle_t h, uint64 sector_size, uint64 lba, const void *
     return write_all(h, buf, (size)sector_size);
 }
 
+//have the device zero count sectors at lba without sending the data
+//fails when neither the device nor the kernel can do that
+static int zero_range(handle_t h, uint64 sector_size, uint64 lba, uint64 count) {
+    block_range_t range = { .offset = lba * sector_size, .len = count * sector_size };
+    return object_get_info(h, OBJ_INFO_BLOCK_ZERO, &range, sizeof(range)) < 0 ? -1 : 0;
+}
+
 static void write_u32_le(uint8 *dst, uint32 value) {
     dst[0] = (uint8)(value & 0xFF);
     dst[1] = (uint8)((value >> 8) & 0xFF);
@@ -187,6 +194,15 @@ static int format_fat32(handle_t dev, uint32 sector_size, uint64 sector_count, c
 
     int rc = -1;
 
+    //the old contents are garbage now, let the device know (only a hint)
+    block_range_t whole = { .offset = 0, .len = sector_count * sector_size };
+    object_get_info(dev, OBJ_INFO_BLOCK_DISCARD, &whole, sizeof(whole));
+
+    //both fats and the root cluster follow each other, zero them in one go
+    //so only the few sectors holding nonzero entries have to be written
+    uint64 root_lba = reserved_sectors + (uint64)fat_count * fat_sectors + (uint64)(root_cluster - 2u) * spc;
+    bool zeroed = zero_range(dev, sector_size, reserved_sectors, root_lba + spc - reserved_sectors) == 0;
+
     //boot sector and backup copy
     memset(sector, 0, sector_size);
     fat32_boot_sector_t *bpb = (fat32_boot_sector_t *)sector;
@@ -238,6 +254,7 @@ static int format_fat32(handle_t dev, uint32 sector_size, uint64 sector_count, c
     for (uint32 fat_copy = 0; fat_copy < fat_count; fat_copy++) {
         for (uint32 sec = 0; sec < fat_sectors; sec++) {
             memset(fat_sector, 0, sector_size);
+            bool blank = true;
             uint32 base_entry = sec * entries_per_sector;
             for (uint32 i = 0; i < entries_per_sector; i++) {
                 uint32 idx = base_entry + i;
@@ -253,7 +270,9 @@ static int format_fat32(handle_t dev, uint32 sector_size, uint64 sector_count, c
                     value = 0x0FFFFFFFu;
                 }
                 write_fat_entry(fat_sector, i, value);
+                if (value) blank = false;
             }
+            if (blank && zeroed) continue;
 
             uint64 lba = reserved_sectors + (uint64)fat_copy * fat_sectors + sec;
             if (write_sector(dev, sector_size, lba, fat_sector) < 0) goto cleanup;
@@ -262,11 +281,13 @@ static int format_fat32(handle_t dev, uint32 sector_size, uint64 sector_count, c
 
     //zero the root directory cluster
     memset(zero, 0, sector_size);
-    uint64 root_lba = reserved_sectors + (uint64)fat_count * fat_sectors + (uint64)(root_cluster - 2u) * spc;
-    for (uint32 sec = 0; sec < spc; sec++) {
+    for (uint32 sec = 0; sec < spc && !zeroed; sec++) {
         if (write_sector(dev, sector_size, root_lba + sec, zero) < 0) goto cleanup;
     }
 
+    //make the new filesystem durable before reporting success
+    object_get_info(dev, OBJ_INFO_BLOCK_FLUSH, NULL, 0);
+
     printf("mkfsfat32: formatted %llu sectors at %u bytes/sector, %u sectors/cluster\n",
            sector_count, sector_size, spc);
     printf("mkfsfat32: FAT size %u sectors, clusters %u, label '%s'\n",
@@ -19,11 +19,17 @@ int main(int argc, char *argv[]) {
 	add_new_line = true;
     }
     
-    char buf[512];
-    int len;
-    while ((len = handle_read(file, buf, sizeof(buf))) > 0) {
-        for (int i = 0; i < len; i++) {
-            putc(buf[i]);
+    //when stdout is a pipe the file streams into it without passing through us
+    int64 moved;
+    while ((moved = splice(file, __stdout, 64 * 1024, 0)) > 0) {}
+
+    if (moved == -2) {
+        char buf[512];
+        int len;
+        while ((len = handle_read(file, buf, sizeof(buf))) > 0) {
+            for (int i = 0; i < len; i++) {
+                putc(buf[i]);
+            }
         }
     }
 
@@ -3,6 +3,13 @@
 #include <io.h>
 #include <string.h>
 
+//surface messages wait this long for room instead of being dropped
+#define COMP_SEND_TIMEOUT_MS 100
+
+static void comp_send(handle_t ch, const comp_msg_t *msg) {
+    channel_send_timeout(ch, msg, sizeof(*msg), COMP_SEND_TIMEOUT_MS);
+}
+
 handle_t comp_connect(void) {
     handle_t h = INVALID_HANDLE;
     for (int i = 0; i < 50; i++) {
@@ -166,13 +173,13 @@ bool comp_create_surface(handle_t server_ch, uint16 w, uint16 h, surface_id_t *o
 void comp_commit(handle_t surface_ch, surface_id_t id) {
     if (surface_ch == INVALID_HANDLE) return;
     comp_msg_t msg = { .type = MSG_COMMIT, .u.commit.id = id };
-    channel_send(surface_ch, &msg, sizeof(msg));
+    comp_send(surface_ch, &msg);
 }
 
 void comp_destroy_surface(handle_t surface_ch, surface_id_t id) {
     if (surface_ch == INVALID_HANDLE) return;
     comp_msg_t msg = { .type = MSG_DESTROY_SURFACE, .u.destroy_surface.id = id };
-    channel_send(surface_ch, &msg, sizeof(msg));
+    comp_send(surface_ch, &msg);
 }
 
 void comp_resize_surface(handle_t surface_ch, surface_id_t id, uint16 w, uint16 h) {
@@ -181,7 +188,7 @@ void comp_resize_surface(handle_t surface_ch, surface_id_t id, uint16 w, uint16
         .type = MSG_RESIZE_SURFACE,
         .u.resize_surface = { .id = id, .w = w, .h = h }
     };
-    channel_send(surface_ch, &msg, sizeof(msg));
+    comp_send(surface_ch, &msg);
 }
 
 void comp_set_title(handle_t surface_ch, surface_id_t id, const char *title) {
@@ -193,5 +200,5 @@ void comp_set_title(handle_t surface_ch, surface_id_t id, const char *title) {
         k++;
     }
     msg.u.set_title.text[k] = '\0';
-    channel_send(surface_ch, &msg, sizeof(msg));
+    comp_send(surface_ch, &msg);
 }
@@ -88,6 +88,21 @@ int32 process_create(const char *name);              //create suspended process,
 int handle_grant(int32 proc_h, int32 local_h, uint32 rights);  //inject handle into child
 int process_start(int32 proc_h, uint64 entry, uint64 stack);   //start first thread
 
+//raw threads, see thread.h for the library built on top
+//entry is the address of a function run as entry(arg) on stack_top with FS base
+//= tls that must never return
+int thread_create(uintptr entry, void *stack_top, void *arg, void *tls);  //returns thread id
+//stores 0 to clear_word (if not NULL) and futex-wakes it, then exits the thread
+__attribute__((noreturn)) void thread_exit(volatile uint32 *clear_word);
+int thread_set_tls(void *tls);
+
+//futexes: sleep while *word == expected (timeout_ms < 0 waits forever)
+//wait returns 0 when woken, -3 if the word already changed, -2 on timeout,
+//-14 if the word cannot be read
+#define FUTEX_WAKE_ALL  0xFFFFFFFF
+int futex_wait(volatile uint32 *word, uint32 expected, int64 timeout_ms);
+int futex_wake(volatile uint32 *word, uint32 count);    //returns the number woken
+
 //capability-based object access
 handle_t get_obj(handle_t parent, const char *path, uint32 rights);
 int handle_read(handle_t h, void *buf, int len);
@@ -102,8 +117,39 @@ char* handle_getstr(char* buf, int bufsz, handle_t f);
 #define HANDLE_SEEK_END     2
 int handle_seek(handle_t h, size offset, int mode);
 
+//scatter/gather and positional I/O, served by the object as one request
+//the v variants take up to IO_VEC_MAX segments and stop at the first short one
+//the p variants read/write at offset and leave the handle position alone
+typedef struct io_vec {
+    void *base;
+    size len;
+} io_vec_t;
+
+#define IO_VEC_MAX 64
+
+long readv(handle_t h, const io_vec_t *iov, int count);
+long writev(handle_t h, const io_vec_t *iov, int count);
+long preadv(handle_t h, const io_vec_t *iov, int count, size offset);
+long pwritev(handle_t h, const io_vec_t *iov, int count, size offset);
+long pread(handle_t h, void *buf, size len, size offset);
+long pwrite(handle_t h, const void *buf, size len, size offset);
+
+//write back disk blocks the kernel still holds in its cache
+int sync(void);
+
 //channel IPC
 int channel_create(handle_t *ep0, handle_t *ep1);
+
+//pipes: byte streams read with handle_read and written with handle_write
+//reads return what is queued (0 once every writer is gone), writes block while full
+//splice moves bytes between a pipe and any handle (or another pipe) in the kernel
+//and tee copies queued bytes between two pipes without consuming them
+//both return bytes moved, 0 at end of file, -3 when SPLICE_NONBLOCK would wait
+//and -4 once the destination pipe has no reader
+#define SPLICE_NONBLOCK (1 << 0)
+int pipe_create(handle_t *read_end, handle_t *write_end);
+int64 splice(handle_t in, handle_t out, uint64 len, uint32 flags);
+int64 tee(handle_t in, handle_t out, uint64 len, uint32 flags);
 int channel_send(handle_t ep, const void *data, int len);
 int channel_recv(handle_t ep, void *buf, int buflen);
 int channel_try_recv(handle_t ep, void *buf, int buflen);
@@ -129,6 +175,8 @@ typedef struct {
     uint64 data_len;     //actual bytes of data received
     uint32 handle_count; //number of handles received
     uint32 sender_pid;   //PID of the process that sent this message (0 if kernel)
+    uint32 txid;         //channel_call request to answer with channel_reply (0 if none)
+    uint32 reserved;
 } channel_recv_result_t;
 
 int channel_recv_msg(handle_t ep, void *data_buf, int data_len,
@@ -138,6 +186,285 @@ int channel_try_recv_msg(handle_t ep, void *data_buf, int data_len,
                      int32 *handles_buf, uint32 handles_len,
                      channel_recv_result_t *result);
 
+//flow control: channel_send fails with -3 when the peer queue is full
+//channel_send_timeout sleeps for room instead (timeout_ms < 0 waits forever)
+//and returns -3 if the queue is still full when the timeout passes or the wait
+//is interrupted
+int channel_send_timeout(handle_t ep, const void *data, int len, int64 timeout_ms);
+//how many messages may queue for this endpoint before senders block (default 16, max 1024)
+int channel_set_queue_depth(handle_t ep, uint32 depth);
+
+//batched transfers: up to CHANNEL_MAX_BATCH data-only messages per syscall
+//send returns how many were queued (it stops when the peer queue fills),
+//-5 if count is over CHANNEL_MAX_BATCH, -14 if msgs or a payload is unreadable
+//recv returns how many slots were filled, handles in received messages are closed.
+//it returns -14 without receiving if a slot or its buf is not user memory, and
+//-14 after receiving if a slot went away meanwhile (those messages are lost)
+#define CHANNEL_MAX_BATCH 64
+
+typedef struct {
+    const void *data;
+    uint64 len;
+} channel_iov_t;
+
+typedef struct {
+    void *buf;          //where to copy the message
+    uint64 buf_len;     //capacity of buf
+    uint64 data_len;    //out: full message length, the copy is truncated to buf_len
+    uint32 sender_pid;  //out: PID of the sender (0 if kernel)
+    uint32 reserved;
+} channel_recv_slot_t;
+
+int channel_send_batch(handle_t ep, const channel_iov_t *msgs, uint32 count);
+//flags: CHANNEL_RECV_NONBLOCK to return -3 instead of waiting for the first message
+int channel_recv_batch(handle_t ep, channel_recv_slot_t *slots, uint32 max, uint32 flags);
+
+//synchronous call: send a request and block for the reply on the same channel
+//the server sees the request's transaction id in channel_recv_result_t.txid and
+//answers with channel_reply, that message is returned to the caller (the
+//request bytes are passed through untouched)
+//a server blocked in channel_recv runs immediately on the caller's time slice
+typedef struct {
+    const void *wr_data;    //request bytes
+    uint64 wr_len;
+    void *rd_data;          //reply bytes, truncated to rd_len
+    uint64 rd_len;
+    int32 *rd_handles;      //reply handles, extras are closed
+    uint32 rd_handles_len;
+    uint32 reserved;
+} channel_call_args_t;
+
+int channel_call(handle_t ep, const channel_call_args_t *args, channel_recv_result_t *result);
+//send data as the reply to request txid, a reply nobody waits for anymore is
+//queued like a plain message
+int channel_reply(handle_t ep, uint32 txid, const void *data, int len);
+
+//zero-copy page loans: lend a page aligned VMO range along with a message
+//the receiver maps the same frames, the sender must not reuse them until told
+#define CHANNEL_LOAN_WRITE      (1 << 0)    //receiver may write to the loan
+#define CHANNEL_RECV_NONBLOCK   (1 << 0)
+
+typedef struct {
+    uint64 addr;        //page aligned address in a VMO mapping, 0 to use vmo + offset
+    int32 vmo;          //VMO handle (when addr is 0)
+    uint32 flags;       //CHANNEL_LOAN_*
+    uint64 offset;      //page aligned offset into the VMO (when addr is 0)
+    uint64 len;         //bytes to lend
+} channel_loan_t;
+
+typedef struct {
+    uint64 data_len;    //actual bytes of inline data received
+    uint32 sender_pid;  //PID of the sender (0 if kernel)
+    uint32 loan_flags;  //CHANNEL_LOAN_* of the mapped loan
+    uint64 loan_addr;   //where the loan was mapped (0 if none), release with vmo_unmap
+    uint64 loan_len;    //length of the loan
+} channel_loan_result_t;
+
+int channel_send_loan(handle_t ep, const void *data, int len, const channel_loan_t *loan);
+//-9 if the loan can't be mapped, the message then stays at the head of the queue
+int channel_recv_loan(handle_t ep, void *data_buf, int data_len,
+                      channel_loan_result_t *result, uint32 flags);
+
+//shared-memory rings: a kernel-built VMO of fixed size slots plus a doorbell
+//messages move with plain loads and stores, a syscall is only made to sleep
+//or to wake a peer that announced it is sleeping
+#define RING_MAGIC          0x474e4952
+#define RING_FLAG_MPSC      (1 << 0)    //several producers share the ring
+#define RING_HEADER_SIZE    256
+#define RING_MAX_SLOTS      4096
+#define RING_MAX_SLOT_SIZE  (64 * 1024)
+#define RING_NONBLOCK       (1 << 0)    //ring_send/ring_recv return -3 instead of sleeping
+
+typedef struct {
+    uint32 magic;
+    uint32 flags;
+    uint32 slot_size;
+    uint32 slot_count;
+    uint32 slot_stride;
+    uint32 reserved[11];
+    volatile uint64 head;
+    uint8 pad0[56];
+    volatile uint64 tail;
+    uint8 pad1[56];
+    volatile uint32 consumer_waiting;
+    volatile uint32 producer_waiting;
+    uint8 pad2[56];
+} ring_header_t;
+
+typedef struct {
+    volatile uint64 seq;
+    uint32 len;
+    uint32 reserved;
+} ring_slot_t;
+
+typedef struct {
+    ring_header_t *hdr;
+    char *slots;
+    handle_t vmo;
+    handle_t bell;
+    uint64 map_len;
+} ring_t;
+
+int ring_create(uint32 slot_size, uint32 slot_count, uint32 flags,
+                handle_t *vmo_out, handle_t *bell_out);
+int ring_attach(ring_t *ring, handle_t vmo, handle_t bell);
+void ring_detach(ring_t *ring);
+int ring_send(ring_t *ring, const void *data, uint32 len, uint32 flags);
+int ring_recv(ring_t *ring, void *buf, uint32 buflen, uint32 flags);
+
+handle_t doorbell_create(void);
+int doorbell_ring(handle_t bell);
+int doorbell_wait(handle_t bell, const volatile uint32 *word, uint32 expected);
+
+//asynchronous I/O rings: queue read/write/recv/send/channel operations in a
+//shared submission queue, the kernel runs them on worker threads and posts a
+//completion with the entry's user_data. IOSQE_LINK runs the next entry only
+//if this one succeeded, IORING_SETUP_SQPOLL lets a kernel thread pick up
+//entries without any syscall while the ring is busy
+#define IORING_MAGIC            0x474e5249
+#define IORING_HEADER_SIZE      256
+#define IORING_MAX_ENTRIES      256
+#define IORING_SETUP_SQPOLL     (1 << 0)
+#define IORING_SQ_NEED_WAKEUP   (1 << 0)
+#define IORING_ENTER_GETEVENTS  (1 << 0)
+#define IORING_ENTER_SQ_WAKEUP  (1 << 1)
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1
+#define IORING_OP_WRITE         2
+#define IORING_OP_READV         3   //addr is an io_vec_t array, len its entry count
+#define IORING_OP_WRITEV        4
+#define IORING_OP_RECV          5   //stream read, offset ignored
+#define IORING_OP_SEND          6
+#define IORING_OP_CHANNEL_SEND  7
+#define IORING_OP_CHANNEL_RECV  8   //res is the full message length
+#define IOSQE_LINK              (1 << 0)
+#define IORING_OFFSET_CURRENT   (~0ULL) //use and advance the handle position
+#define IORING_RES_CANCELED     (-125)  //an earlier linked entry failed
+
+typedef struct {
+    uint8 opcode;
+    uint8 flags;
+    uint16 reserved0;
+    int32 handle;
+    uint64 offset;
+    uint64 addr;
+    uint32 len;
+    uint32 reserved1;
+    uint64 user_data;
+    uint64 reserved2[3];
+} ioring_sqe_t;
+
+typedef struct {
+    uint64 user_data;
+    int32 res;
+    uint32 flags;
+} ioring_cqe_t;
+
+typedef struct {
+    uint32 magic;
+    uint32 flags;
+    uint32 sq_entries;
+    uint32 cq_entries;
+    uint32 sq_off;
+    uint32 cq_off;
+    uint32 reserved[10];
+    volatile uint32 sq_head;
+    volatile uint32 sq_tail;
+    uint8 pad0[56];
+    volatile uint32 cq_head;
+    volatile uint32 cq_tail;
+    volatile uint32 cq_overflow;
+    uint8 pad1[52];
+    volatile uint32 sq_flags;
+    uint8 pad2[60];
+} ioring_header_t;
+
+typedef struct {
+    ioring_header_t *hdr;
+    ioring_sqe_t *sqes;
+    ioring_cqe_t *cqes;
+    handle_t handle;
+    handle_t vmo;
+    uint32 sq_tail;             //entries handed out by ioring_get_sqe, not yet submitted
+    uint64 map_len;
+} ioring_t;
+
+int ioring_setup(uint32 entries, uint32 flags, ioring_t *ring);
+void ioring_teardown(ioring_t *ring);
+int ioring_enter(handle_t ring, uint32 to_submit, uint32 min_complete, uint32 flags);
+//next free SQ entry (zeroed), NULL while the SQ is full
+ioring_sqe_t *ioring_get_sqe(ioring_t *ring);
+void ioring_prep_rw(ioring_sqe_t *sqe, uint8 opcode, handle_t h, const void *addr,
+                    uint32 len, uint64 offset, uint64 user_data);
+//publish prepared entries, returns how many the kernel took
+int ioring_submit(ioring_t *ring);
+int ioring_submit_and_wait(ioring_t *ring, uint32 wait_nr);
+//oldest completion, -3 if none is ready (peek) or nothing is left in flight (wait)
+int ioring_peek_cqe(ioring_t *ring, ioring_cqe_t **cqe_out);
+int ioring_wait_cqe(ioring_t *ring, ioring_cqe_t **cqe_out);
+//release the completion returned by peek/wait
+void ioring_cqe_seen(ioring_t *ring);
+
+//syscall tracing: per-syscall counts and log2 latency histograms (TSC cycles)
+//and optionally one record per call posted on a channel the tracer reads
+//pid 0 is the calling process, others need signal permission
+#define SYSCALL_TRACE_MAX       128
+#define SYSCALL_TRACE_BUCKETS   32      //bucket i counts calls of [2^i, 2^(i+1)) cycles
+#define SYSCALL_TRACE_STATS     (1 << 0)
+#define SYSCALL_TRACE_STREAM    (1 << 1)
+#define SYSCALL_TRACE_RESET     (1 << 2)
+
+typedef struct {
+    uint64 tsc;                 //TSC at syscall entry
+    uint64 cycles;
+    uint32 pid;
+    uint32 tid;
+    uint32 num;
+    uint32 reserved;
+    uint64 args[6];
+    int64 result;
+} syscall_trace_record_t;
+
+typedef struct {
+    uint32 num;
+    uint32 reserved;
+    uint64 count;
+    uint64 total_cycles;
+    uint64 max_cycles;
+    uint32 hist[SYSCALL_TRACE_BUCKETS];
+} syscall_stat_t;
+
+//flags 0 stops tracing, stream is the local end of a channel whose peer
+//receives syscall_trace_record_t messages (only read with SYSCALL_TRACE_STREAM)
+int syscall_trace(uintptr pid, uint32 flags, handle_t stream);
+//fills buf with the syscalls pid made, returns the entry count
+//dropped (optional) receives the number of stream records lost
+int syscall_stats(uintptr pid, syscall_stat_t *buf, uint32 max, uint64 *dropped);
+
+//ports: wait on many handles at once
+//bind channels, sockets and processes under a key, port_wait returns batches
+//of (key, signals) packets. delivery is edge triggered so drain a source
+//(until its try_recv reports empty) before waiting again
+#define PORT_SIGNAL_READABLE    (1 << 0)    //message queued / socket data or pending accept
+#define PORT_SIGNAL_PEER_CLOSED (1 << 1)    //channel peer or socket remote closed
+#define PORT_SIGNAL_EXITED      (1 << 2)    //process exited
+#define PORT_SIGNAL_TIMER       (1 << 3)    //port_set_timer expired
+#define PORT_WAIT_MAX_PACKETS   32
+
+typedef struct {
+    uint64 key;
+    uint32 type;        //kernel object type of the source, 0 for timers
+    uint32 signals;     //PORT_SIGNAL_* raised since the last packet
+} port_packet_t;
+
+handle_t port_create(void);
+int port_bind(handle_t port, handle_t h, uint64 key, uint32 signals);
+int port_unbind(handle_t port, uint64 key);
+int port_set_timer(handle_t port, uint64 key, uint64 timeout_ms);
+//timeout_ms < 0 waits forever, 0 polls; returns packet count, 0 on timeout,
+//-14 if packets is not writable user memory
+int port_wait(handle_t port, port_packet_t *packets, uint32 max, int64 timeout_ms);
+
 //virtual memory objects
 handle_t vmo_create(uint64 size, uint32 flags, uint32 rights);
 int vmo_read(handle_t h, void *buf, uint64 len, uint64 offset);
@@ -172,7 +499,13 @@ typedef enum {
     OBJ_INFO_BOOT_CMDLINE = 6,  //boot cmdline string (requires system handle)
     OBJ_INFO_BLOCK_DEVICE = 7,  //block_device_info_t (requires device handle)
     OBJ_INFO_VT_STATE = 8,      //vt_info_t (requires vt device handle)
-    OBJ_INFO_BLOCK_RESCAN = 9   //trigger partition rescan (requires device handle)
+    OBJ_INFO_BLOCK_RESCAN = 9,  //trigger partition rescan (requires device handle)
+    OBJ_INFO_KSM_STATS = 10,    //ksm_stats_t (requires system handle)
+    OBJ_INFO_LOCK_STATS = 11,   //lock_stats_t array, returns entry count (requires system handle)
+    OBJ_INFO_BLOCK_FLUSH = 12,  //write back cached data and flush the device (requires device handle)
+    OBJ_INFO_BLOCK_DISCARD = 13, //block_range_t to discard (requires writable device handle)
+    OBJ_INFO_BLOCK_ZERO = 14,   //block_range_t to zero (requires writable device handle)
+    OBJ_INFO_BLOCK_PREFETCH = 15 //block_range_t to load into the block cache in the background
 } object_info_topic_t;
 
 typedef struct {
@@ -209,6 +542,12 @@ typedef struct {
     uint64 sector_count;
 } block_device_info_t;
 
+//byte range of a block device, both sector aligned
+typedef struct {
+    uint64 offset;
+    uint64 len;
+} block_range_t;
+
 typedef struct {
     uint32 cols;
     uint32 rows;
@@ -226,6 +565,23 @@ typedef struct {
     char cpu_brand[48];     //CPU brand string (e.g. "Intel Core i7...")
 } system_stats_t;
 
+typedef struct lock_stats {
+    char name[32];
+    uint64 acquisitions;
+    uint64 contended;       //acquisitions that had to wait
+    uint64 spin_cycles;     //TSC cycles spent waiting
+    uint64 max_hold_cycles; //longest critical section seen
+} lock_stats_t;
+
+typedef struct {
+    uint64 pages_shared;    //frames currently backing merged pages
+    uint64 pages_sharing;   //mappings folded onto those frames (memory saved)
+    uint64 pages_scanned;   //candidate pages hashed since boot
+    uint64 full_scans;      //completed passes over every process
+    uint64 cow_breaks;      //private copies made on write
+    uint32 enabled;
+} ksm_stats_t;
+
 int object_get_info(handle_t h, uint32 topic, void *ptr, uint64 len);
 
 //typed process context
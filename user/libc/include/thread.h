@@ -0,0 +1,64 @@
+#ifndef _LIBC_THREAD_H
+#define _LIBC_THREAD_H
+
+#include <types.h>
+#include <system.h>
+
+/*
+ *threads, mutexes and condition variables
+ *
+ *every thread (including main) owns a control block whose first word points
+ *at itself and whose address is the thread's FS base, so thread_self() is a
+ *single load from fs:0. locks only enter the kernel when contended
+*/
+
+#define THREAD_STACK_SIZE   (64 * 1024)
+
+typedef struct thread {
+    struct thread *self;        //fs:0, must stay first
+    volatile uint32 alive;      //cleared and futex-woken by the kernel on exit
+    int tid;
+    void *(*fn)(void *);
+    void *arg;
+    void *result;
+    void *stack;                //NULL for the main thread
+} thread_t;
+
+//start fn(arg) in a new thread, returns NULL on failure
+thread_t *thread_spawn(void *(*fn)(void *), void *arg);
+
+//wait for the thread to finish and release it, result may be NULL
+int thread_join(thread_t *t, void **result);
+
+thread_t *thread_self(void);
+
+//set up the main thread's control block (called from _lib_init)
+void _thread_init(void);
+
+//futex mutex: 0 unlocked, 1 locked, 2 locked with sleepers
+typedef struct {
+    volatile uint32 state;
+} mutex_t;
+
+#define MUTEX_INIT { 0 }
+
+void mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+bool mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+//condition variable: waiters sleep on a sequence word bumped by every signal
+typedef struct {
+    volatile uint32 seq;
+} cond_t;
+
+#define COND_INIT { 0 }
+
+void cond_init(cond_t *c);
+void cond_wait(cond_t *c, mutex_t *m);
+//returns 0 when signalled, -2 on timeout (the mutex is held again either way)
+int cond_timedwait(cond_t *c, mutex_t *m, int64 timeout_ms);
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
+
+#endif
@@ -1,7 +1,9 @@
 extern void _mem_init();
 extern void _io_init();
+extern void _thread_init(void);
 
 void _lib_init(void) {
+    _thread_init();
     _io_init();
     _mem_init();
 }
\ No newline at end of file
@@ -7,7 +7,11 @@ int32 __stdout = INVALID_HANDLE;
 int32 __stdin = INVALID_HANDLE;
 
 void _io_init(void) {
-    //get console handle from devices namespace
-    __stdout = get_obj(INVALID_HANDLE, "$devices/vt0", RIGHT_WRITE);
-    __stdin = get_obj(INVALID_HANDLE, "$devices/keyboard", RIGHT_READ);
+    //a parent may redirect either stream (shell pipelines pass pipe ends)
+    if (context_get_handle("stdout", &__stdout, NULL) < 0) {
+        __stdout = get_obj(INVALID_HANDLE, "$devices/vt0", RIGHT_WRITE);
+    }
+    if (context_get_handle("stdin", &__stdin, NULL) < 0) {
+        __stdin = get_obj(INVALID_HANDLE, "$devices/keyboard", RIGHT_READ);
+    }
 }
\ No newline at end of file
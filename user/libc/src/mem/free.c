@@ -3,7 +3,9 @@
 void free(void *ptr) {
     if (!ptr) return;
 
+    mutex_lock(&_malloc_lock);
     malloc_header_t *header = _malloc_get_header(ptr);
     header->is_free = true;
     _malloc_coalesce(header);
+    mutex_unlock(&_malloc_lock);
 }
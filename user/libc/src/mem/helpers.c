@@ -1,6 +1,7 @@
 #include "internal.h"
 
 malloc_header_t *_malloc_free_list = NULL;
+mutex_t _malloc_lock = MUTEX_INIT;
 
 malloc_header_t *_malloc_find_free_block(size desired_len) {
     malloc_header_t *curr = _malloc_free_list;
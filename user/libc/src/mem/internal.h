@@ -2,6 +2,7 @@
 #define _LIBC_MEM_INTERNAL_H
 
 #include <mem.h>
+#include <thread.h>
 
 typedef struct malloc_header {
     size s;                  
@@ -15,6 +16,9 @@ typedef struct malloc_header {
 
 extern malloc_header_t *_malloc_free_list;
 
+//guards the free list and heap growth, held only inside malloc/free/realloc
+extern mutex_t _malloc_lock;
+
 static inline size _malloc_align_up(size s) {
     return (s + 15) & ~15;
 }
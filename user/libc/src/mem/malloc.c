@@ -7,6 +7,7 @@ void *malloc(size len) {
 
     size aligned_len = _malloc_align_up(len);
 
+    mutex_lock(&_malloc_lock);
     if (!_mem_addr) _mem_init();
 
     malloc_header_t *header = _malloc_find_free_block(aligned_len);
@@ -35,14 +36,19 @@ void *malloc(size len) {
             _malloc_coalesce(new_block);
             
             header = _malloc_find_free_block(aligned_len);
-            if (!header) return NULL;
+            if (!header) {
+                mutex_unlock(&_malloc_lock);
+                return NULL;
+            }
         } else {
+            mutex_unlock(&_malloc_lock);
             return NULL;
         }
     }
 
     header->is_free = false;
     _malloc_split_block(header, aligned_len);
+    mutex_unlock(&_malloc_lock);
 
     return (void *)((char *)header + HEADER_SIZE);
 }
\ No newline at end of file
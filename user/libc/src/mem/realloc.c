@@ -11,8 +11,10 @@ void *realloc(void *ptr, size len) {
     malloc_header_t *header = _malloc_get_header(ptr);
     size aligned_len = _malloc_align_up(len);
 
+    mutex_lock(&_malloc_lock);
     if (header->s >= aligned_len) {
         _malloc_split_block(header, aligned_len);
+        mutex_unlock(&_malloc_lock);
         return ptr;
     }
 
@@ -23,13 +25,17 @@ void *realloc(void *ptr, size len) {
         if (header->next) header->next->prev = header;
         
         _malloc_split_block(header, aligned_len);
+        mutex_unlock(&_malloc_lock);
         return ptr;
     }
+    size old_len = header->s;
+    mutex_unlock(&_malloc_lock);
 
+    //malloc and free take the lock themselves
     void *new_ptr = malloc(len);
     if (!new_ptr) return NULL;
 
-    memcpy(new_ptr, ptr, header->s);
+    memcpy(new_ptr, ptr, old_len);
     free(ptr);
     return new_ptr;
 }
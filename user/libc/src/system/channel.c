@@ -30,3 +30,37 @@ int channel_try_recv_msg(int32 ep, void *data_buf, int data_len,
     return __syscall6(SYS_CHANNEL_TRY_RECV_MSG, ep, (long)data_buf, data_len,
                       (long)handles_buf, handles_len, (long)result);
 }
+
+int channel_send_timeout(int32 ep, const void *data, int len, int64 timeout_ms) {
+    return __syscall4(SYS_CHANNEL_SEND_TIMEOUT, ep, (long)data, len, timeout_ms);
+}
+
+int channel_set_queue_depth(int32 ep, uint32 depth) {
+    return __syscall2(SYS_CHANNEL_SET_DEPTH, ep, depth);
+}
+
+int channel_send_batch(int32 ep, const channel_iov_t *msgs, uint32 count) {
+    return __syscall3(SYS_CHANNEL_SEND_BATCH, ep, (long)msgs, count);
+}
+
+int channel_recv_batch(int32 ep, channel_recv_slot_t *slots, uint32 max, uint32 flags) {
+    return __syscall4(SYS_CHANNEL_RECV_BATCH, ep, (long)slots, max, flags);
+}
+
+int channel_call(int32 ep, const channel_call_args_t *args, channel_recv_result_t *result) {
+    return __syscall3(SYS_CHANNEL_CALL, ep, (long)args, (long)result);
+}
+
+int channel_reply(int32 ep, uint32 txid, const void *data, int len) {
+    return __syscall4(SYS_CHANNEL_REPLY, ep, txid, (long)data, len);
+}
+
+int channel_send_loan(int32 ep, const void *data, int len, const channel_loan_t *loan) {
+    return __syscall4(SYS_CHANNEL_SEND_LOAN, ep, (long)data, len, (long)loan);
+}
+
+int channel_recv_loan(int32 ep, void *data_buf, int data_len,
+                      channel_loan_result_t *result, uint32 flags) {
+    return __syscall5(SYS_CHANNEL_RECV_LOAN, ep, (long)data_buf, data_len,
+                      (long)result, flags);
+}
@@ -28,3 +28,11 @@ int proc_event_return(void) {
 int proc_set_console_foreground(uintptr pid) {
     return (int)__syscall1(SYS_PROC_SET_CONSOLE_FOREGROUND, (long)pid);
 }
+
+int syscall_trace(uintptr pid, uint32 flags, handle_t stream) {
+    return (int)__syscall3(SYS_SYSCALL_TRACE, (long)pid, (long)flags, (long)stream);
+}
+
+int syscall_stats(uintptr pid, syscall_stat_t *buf, uint32 max, uint64 *dropped) {
+    return (int)__syscall4(SYS_SYSCALL_STATS, (long)pid, (long)buf, (long)max, (long)dropped);
+}
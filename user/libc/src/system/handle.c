@@ -25,6 +25,38 @@ int handle_seek(int32 h, size offset, int mode) {
     return __syscall3(SYS_HANDLE_SEEK, (long)h, (long)offset, (long)mode);
 }
 
+//scatter read at the handle position
+long readv(int32 h, const io_vec_t *iov, int count) {
+    return __syscall4(SYS_HANDLE_READV, (long)h, (long)iov, (long)count, -1L);
+}
+
+//gather write at the handle position
+long writev(int32 h, const io_vec_t *iov, int count) {
+    return __syscall4(SYS_HANDLE_WRITEV, (long)h, (long)iov, (long)count, -1L);
+}
+
+//scatter read at offset, the handle position is not moved
+long preadv(int32 h, const io_vec_t *iov, int count, size offset) {
+    if ((long)offset < 0) return -1;
+    return __syscall4(SYS_HANDLE_READV, (long)h, (long)iov, (long)count, (long)offset);
+}
+
+//gather write at offset, the handle position is not moved
+long pwritev(int32 h, const io_vec_t *iov, int count, size offset) {
+    if ((long)offset < 0) return -1;
+    return __syscall4(SYS_HANDLE_WRITEV, (long)h, (long)iov, (long)count, (long)offset);
+}
+
+long pread(int32 h, void *buf, size len, size offset) {
+    io_vec_t iov = { buf, len };
+    return preadv(h, &iov, 1, offset);
+}
+
+long pwrite(int32 h, const void *buf, size len, size offset) {
+    io_vec_t iov = { (void *)buf, len };
+    return pwritev(h, &iov, 1, offset);
+}
+
 //close handle
 int handle_close(int32 h) {
     return __syscall1(SYS_HANDLE_CLOSE, (long)h);
@@ -0,0 +1,122 @@
+#include <system.h>
+#include <string.h>
+#include <sys/syscall.h>
+
+int ioring_enter(int32 ring, uint32 to_submit, uint32 min_complete, uint32 flags) {
+    return __syscall4(SYS_IORING_ENTER, ring, to_submit, min_complete, flags);
+}
+
+int ioring_setup(uint32 entries, uint32 flags, ioring_t *ring) {
+    if (!ring) return -1;
+
+    int32 vmo;
+    int32 h = __syscall3(SYS_IORING_CREATE, entries, flags, (long)&vmo);
+    if (h < 0) return h;
+
+    ioring_header_t *hdr = vmo_map(vmo, NULL, 0, 0, RIGHT_READ | RIGHT_WRITE);
+    if (!hdr) {
+        handle_close(h);
+        handle_close(vmo);
+        return -1;
+    }
+
+    ring->hdr = hdr;
+    ring->sqes = (ioring_sqe_t *)((char *)hdr + hdr->sq_off);
+    ring->cqes = (ioring_cqe_t *)((char *)hdr + hdr->cq_off);
+    ring->handle = h;
+    ring->vmo = vmo;
+    ring->sq_tail = hdr->sq_tail;
+    ring->map_len = hdr->cq_off + (uint64)hdr->cq_entries * sizeof(ioring_cqe_t);
+    return 0;
+}
+
+void ioring_teardown(ioring_t *ring) {
+    if (!ring || !ring->hdr) return;
+    vmo_unmap(ring->hdr, ring->map_len);
+    handle_close(ring->handle);
+    handle_close(ring->vmo);
+    ring->hdr = NULL;
+}
+
+ioring_sqe_t *ioring_get_sqe(ioring_t *ring) {
+    ioring_header_t *hdr = ring->hdr;
+    uint32 head = __atomic_load_n(&hdr->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_tail - head >= hdr->sq_entries) return NULL;
+
+    ioring_sqe_t *sqe = &ring->sqes[ring->sq_tail & (hdr->sq_entries - 1)];
+    ring->sq_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void ioring_prep_rw(ioring_sqe_t *sqe, uint8 opcode, int32 h, const void *addr,
+                    uint32 len, uint64 offset, uint64 user_data) {
+    sqe->opcode = opcode;
+    sqe->handle = h;
+    sqe->addr = (uint64)addr;
+    sqe->len = len;
+    sqe->offset = offset;
+    sqe->user_data = user_data;
+}
+
+//publish the local tail, a sleeping poller has to be woken to see it
+static uint32 ioring_flush(ioring_t *ring, uint32 *enter_flags) {
+    ioring_header_t *hdr = ring->hdr;
+    __atomic_store_n(&hdr->sq_tail, ring->sq_tail, __ATOMIC_SEQ_CST);
+    //entries a full CQ held back last time are submitted again too
+    uint32 pending = ring->sq_tail - __atomic_load_n(&hdr->sq_head, __ATOMIC_ACQUIRE);
+
+    if (hdr->flags & IORING_SETUP_SQPOLL) {
+        if (__atomic_load_n(&hdr->sq_flags, __ATOMIC_SEQ_CST) & IORING_SQ_NEED_WAKEUP) {
+            *enter_flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        return 0;
+    }
+    return pending;
+}
+
+int ioring_submit_and_wait(ioring_t *ring, uint32 wait_nr) {
+    if (!ring || !ring->hdr) return -1;
+
+    uint32 flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    uint32 pending = ioring_flush(ring, &flags);
+    if (pending == 0 && flags == 0) return 0;
+    return ioring_enter(ring->handle, pending, wait_nr, flags);
+}
+
+int ioring_submit(ioring_t *ring) {
+    return ioring_submit_and_wait(ring, 0);
+}
+
+int ioring_peek_cqe(ioring_t *ring, ioring_cqe_t **cqe_out) {
+    ioring_header_t *hdr = ring->hdr;
+    uint32 head = hdr->cq_head;
+    if (head == __atomic_load_n(&hdr->cq_tail, __ATOMIC_ACQUIRE)) return -3;
+
+    *cqe_out = &ring->cqes[head & (hdr->cq_entries - 1)];
+    return 0;
+}
+
+int ioring_wait_cqe(ioring_t *ring, ioring_cqe_t **cqe_out) {
+    if (!ring || !ring->hdr || !cqe_out) return -1;
+
+    for (;;) {
+        if (ioring_peek_cqe(ring, cqe_out) == 0) return 0;
+
+        uint32 flags = IORING_ENTER_GETEVENTS;
+        if ((ring->hdr->flags & IORING_SETUP_SQPOLL) &&
+            (__atomic_load_n(&ring->hdr->sq_flags, __ATOMIC_SEQ_CST) & IORING_SQ_NEED_WAKEUP)) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        int r = ioring_enter(ring->handle, 0, 1, flags);
+        if (r < 0) return r;
+
+        //nothing in flight and nothing posted: waiting longer would never end
+        if (ioring_peek_cqe(ring, cqe_out) == 0) return 0;
+        if (!(ring->hdr->flags & IORING_SETUP_SQPOLL)) return -3;
+    }
+}
+
+void ioring_cqe_seen(ioring_t *ring) {
+    __atomic_store_n(&ring->hdr->cq_head, ring->hdr->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,14 @@
+#include <system.h>
+#include <sys/syscall.h>
+
+int pipe_create(int32 *read_end, int32 *write_end) {
+    return (int)__syscall2(SYS_PIPE_CREATE, (long)read_end, (long)write_end);
+}
+
+int64 splice(int32 in, int32 out, uint64 len, uint32 flags) {
+    return __syscall4(SYS_SPLICE, (long)in, (long)out, (long)len, (long)flags);
+}
+
+int64 tee(int32 in, int32 out, uint64 len, uint32 flags) {
+    return __syscall4(SYS_TEE, (long)in, (long)out, (long)len, (long)flags);
+}
@@ -0,0 +1,22 @@
+#include <system.h>
+#include <sys/syscall.h>
+
+int32 port_create(void) {
+    return __syscall0(SYS_PORT_CREATE);
+}
+
+int port_bind(int32 port, int32 h, uint64 key, uint32 signals) {
+    return __syscall4(SYS_PORT_BIND, port, h, (long)key, signals);
+}
+
+int port_unbind(int32 port, uint64 key) {
+    return __syscall2(SYS_PORT_UNBIND, port, (long)key);
+}
+
+int port_set_timer(int32 port, uint64 key, uint64 timeout_ms) {
+    return __syscall3(SYS_PORT_SET_TIMER, port, (long)key, (long)timeout_ms);
+}
+
+int port_wait(int32 port, port_packet_t *packets, uint32 max, int64 timeout_ms) {
+    return __syscall4(SYS_PORT_WAIT, port, (long)packets, max, (long)timeout_ms);
+}
@@ -0,0 +1,157 @@
+#include <system.h>
+#include <string.h>
+#include <sys/syscall.h>
+
+int ring_create(uint32 slot_size, uint32 slot_count, uint32 flags,
+                int32 *vmo_out, int32 *bell_out) {
+    return __syscall5(SYS_RING_CREATE, slot_size, slot_count, flags,
+                      (long)vmo_out, (long)bell_out);
+}
+
+int32 doorbell_create(void) {
+    return __syscall0(SYS_DOORBELL_CREATE);
+}
+
+int doorbell_ring(int32 bell) {
+    return __syscall1(SYS_DOORBELL_RING, bell);
+}
+
+int doorbell_wait(int32 bell, const volatile uint32 *word, uint32 expected) {
+    return __syscall3(SYS_DOORBELL_WAIT, bell, (long)word, expected);
+}
+
+int ring_attach(ring_t *ring, int32 vmo, int32 bell) {
+    if (!ring) return -1;
+
+    ring_header_t *hdr = vmo_map(vmo, NULL, 0, 0, RIGHT_READ | RIGHT_WRITE);
+    if (!hdr) return -1;
+    if (hdr->magic != RING_MAGIC) {
+        vmo_unmap(hdr, RING_HEADER_SIZE);
+        return -2;
+    }
+
+    ring->hdr = hdr;
+    ring->slots = (char *)hdr + RING_HEADER_SIZE;
+    ring->vmo = vmo;
+    ring->bell = bell;
+    ring->map_len = RING_HEADER_SIZE + (uint64)hdr->slot_stride * hdr->slot_count;
+    return 0;
+}
+
+void ring_detach(ring_t *ring) {
+    if (!ring || !ring->hdr) return;
+    vmo_unmap(ring->hdr, ring->map_len);
+    ring->hdr = NULL;
+    ring->slots = NULL;
+}
+
+static inline ring_slot_t *ring_slot(ring_t *ring, uint64 pos) {
+    ring_header_t *hdr = ring->hdr;
+    return (ring_slot_t *)(ring->slots + (pos & (hdr->slot_count - 1)) * hdr->slot_stride);
+}
+
+//wake the other side only if it said it is going to sleep
+static inline void ring_kick(ring_t *ring, volatile uint32 *waiting) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST)) {
+        doorbell_ring(ring->bell);
+    }
+}
+
+static int ring_try_send(ring_t *ring, const void *data, uint32 len) {
+    ring_header_t *hdr = ring->hdr;
+    uint64 pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+    ring_slot_t *slot;
+
+    for (;;) {
+        slot = ring_slot(ring, pos);
+        uint64 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64 diff = (int64)(seq - pos);
+
+        if (diff < 0) return -3;  //full, the consumer is a lap behind
+        if (diff > 0) {
+            //another producer took this position
+            pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (!(hdr->flags & RING_FLAG_MPSC)) {
+            __atomic_store_n(&hdr->head, pos + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if (__atomic_compare_exchange_n(&hdr->head, &pos, pos + 1, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    memcpy((char *)slot + sizeof(ring_slot_t), data, len);
+    slot->len = len;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    ring_kick(ring, &hdr->consumer_waiting);
+    return 0;
+}
+
+static int ring_try_recv(ring_t *ring, void *buf, uint32 buflen) {
+    ring_header_t *hdr = ring->hdr;
+    uint64 pos = hdr->tail;
+    ring_slot_t *slot = ring_slot(ring, pos);
+
+    uint64 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != pos + 1) return -3;  //empty
+
+    uint32 len = slot->len;
+    memcpy(buf, (char *)slot + sizeof(ring_slot_t), len < buflen ? len : buflen);
+
+    __atomic_store_n(&hdr->tail, pos + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, pos + hdr->slot_count, __ATOMIC_RELEASE);
+
+    ring_kick(ring, &hdr->producer_waiting);
+    return (int)len;
+}
+
+int ring_send(ring_t *ring, const void *data, uint32 len, uint32 flags) {
+    if (!ring || !ring->hdr) return -1;
+    if (len > ring->hdr->slot_size) return -2;
+
+    volatile uint32 *waiting = &ring->hdr->producer_waiting;
+    for (;;) {
+        int r = ring_try_send(ring, data, len);
+        if (r != -3 || (flags & RING_NONBLOCK)) return r;
+
+        //announce the sleep then look once more so a consumer that
+        //freed a slot in between either sees the flag or we see the slot
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+        r = ring_try_send(ring, data, len);
+        if (r != -3) {
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return r;
+        }
+
+        r = doorbell_wait(ring->bell, waiting, 1);
+        if (r < 0) return r;
+    }
+}
+
+int ring_recv(ring_t *ring, void *buf, uint32 buflen, uint32 flags) {
+    if (!ring || !ring->hdr) return -1;
+    if (!buf && buflen > 0) return -1;
+
+    volatile uint32 *waiting = &ring->hdr->consumer_waiting;
+    for (;;) {
+        int r = ring_try_recv(ring, buf, buflen);
+        if (r != -3 || (flags & RING_NONBLOCK)) return r;
+
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+        r = ring_try_recv(ring, buf, buflen);
+        if (r != -3) {
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return r;
+        }
+
+        r = doorbell_wait(ring->bell, waiting, 1);
+        if (r < 0) return r;
+    }
+}
@@ -0,0 +1,6 @@
+#include <system.h>
+#include <sys/syscall.h>
+
+int sync(void) {
+    return (int)__syscall0(SYS_SYNC);
+}
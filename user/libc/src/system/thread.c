@@ -0,0 +1,23 @@
+#include <system.h>
+#include <sys/syscall.h>
+
+int thread_create(uintptr entry, void *stack_top, void *arg, void *tls) {
+    return (int)__syscall4(SYS_THREAD_CREATE, (long)entry, (long)stack_top, (long)arg, (long)tls);
+}
+
+__attribute__((noreturn)) void thread_exit(volatile uint32 *clear_word) {
+    __syscall1(SYS_THREAD_EXIT, (long)clear_word);
+    __builtin_unreachable();
+}
+
+int thread_set_tls(void *tls) {
+    return (int)__syscall1(SYS_SET_TLS, (long)tls);
+}
+
+int futex_wait(volatile uint32 *word, uint32 expected, int64 timeout_ms) {
+    return (int)__syscall3(SYS_FUTEX_WAIT, (long)word, (long)expected, (long)timeout_ms);
+}
+
+int futex_wake(volatile uint32 *word, uint32 count) {
+    return (int)__syscall2(SYS_FUTEX_WAKE, (long)word, (long)count);
+}
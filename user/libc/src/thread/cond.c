@@ -0,0 +1,35 @@
+#include <thread.h>
+
+void cond_init(cond_t *c) {
+    c->seq = 0;
+}
+
+//relock after sleeping, other sleepers may still be queued on the mutex
+static void cond_relock(mutex_t *m) {
+    while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex_wait(&m->state, 2, -1);
+    }
+}
+
+int cond_timedwait(cond_t *c, mutex_t *m, int64 timeout_ms) {
+    //a signal between the unlock and the wait bumps seq so the wait returns at once
+    uint32 seq = __atomic_load_n(&c->seq, __ATOMIC_RELAXED);
+    mutex_unlock(m);
+    int r = futex_wait(&c->seq, seq, timeout_ms);
+    cond_relock(m);
+    return r == -2 ? -2 : 0;
+}
+
+void cond_wait(cond_t *c, mutex_t *m) {
+    cond_timedwait(c, m, -1);
+}
+
+void cond_signal(cond_t *c) {
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+    futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t *c) {
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+    futex_wake(&c->seq, FUTEX_WAKE_ALL);
+}
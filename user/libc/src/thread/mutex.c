@@ -0,0 +1,33 @@
+#include <thread.h>
+
+void mutex_init(mutex_t *m) {
+    m->state = 0;
+}
+
+bool mutex_trylock(mutex_t *m) {
+    uint32 expected = 0;
+    return __atomic_compare_exchange_n(&m->state, &expected, 1, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void mutex_lock(mutex_t *m) {
+    uint32 c = 0;
+    if (__atomic_compare_exchange_n(&m->state, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    //mark the lock contended so the holder knows to wake us, then sleep until it is free
+    if (c != 2) c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        futex_wait(&m->state, 2, -1);
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void mutex_unlock(mutex_t *m) {
+    //only a lock that saw contention needs a syscall
+    if (__atomic_fetch_sub(&m->state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&m->state, 0, __ATOMIC_RELEASE);
+        futex_wake(&m->state, 1);
+    }
+}
@@ -0,0 +1,69 @@
+#include <thread.h>
+#include <mem.h>
+
+static thread_t main_thread;
+
+void _thread_init(void) {
+    main_thread.self = &main_thread;
+    main_thread.alive = 1;
+    thread_set_tls(&main_thread);
+}
+
+thread_t *thread_self(void) {
+    thread_t *self;
+    __asm__ volatile("mov %%fs:0, %0" : "=r"(self));
+    return self;
+}
+
+static __attribute__((noreturn)) void thread_entry(thread_t *t) {
+    t->result = t->fn(t->arg);
+    thread_exit(&t->alive);
+}
+
+thread_t *thread_spawn(void *(*fn)(void *), void *arg) {
+    if (!fn) return NULL;
+
+    thread_t *t = malloc(sizeof(thread_t));
+    if (!t) return NULL;
+
+    t->stack = malloc(THREAD_STACK_SIZE);
+    if (!t->stack) {
+        free(t);
+        return NULL;
+    }
+
+    t->self = t;
+    t->alive = 1;
+    t->fn = fn;
+    t->arg = arg;
+    t->result = NULL;
+
+    //entry sees rsp + 8 16 byte aligned as if it had been called, with a null return address
+    uintptr top = ((uintptr)t->stack + THREAD_STACK_SIZE) & ~(uintptr)15;
+    top -= 8;
+    *(uint64 *)top = 0;
+
+    t->tid = thread_create((uintptr)thread_entry, (void *)top, t, t);
+    if (t->tid < 0) {
+        free(t->stack);
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+int thread_join(thread_t *t, void **result) {
+    if (!t || t == &main_thread || t == thread_self()) return -1;
+
+    uint32 alive;
+    while ((alive = __atomic_load_n(&t->alive, __ATOMIC_ACQUIRE)) != 0) {
+        futex_wait(&t->alive, alive, -1);
+    }
+
+    //the kernel clears alive once the thread is off its user stack for good
+    if (result) *result = t->result;
+    free(t->stack);
+    free(t);
+    return 0;
+}
@@ -23,6 +23,32 @@ int recv_msg(handle_t ch, comp_msg_t *msg, uint32 *sender_pid) {
     return rc;
 }
 
+void watch_channel(handle_t ch) {
+    if (comp.port == INVALID_HANDLE || ch == INVALID_HANDLE) return;
+    int rc = port_bind(comp.port, ch, (uint64)ch, PORT_SIGNAL_READABLE | PORT_SIGNAL_PEER_CLOSED);
+    //a channel we cannot watch would never wake us, fall back to polling
+    if (rc < 0 && rc != -4) {
+        WARN("port_bind failed rc=%d, polling instead\n", rc);
+        handle_close(comp.port);
+        comp.port = INVALID_HANDLE;
+    }
+}
+
+void unwatch_channel(handle_t ch) {
+    if (comp.port == INVALID_HANDLE || ch == INVALID_HANDLE) return;
+    port_unbind(comp.port, (uint64)ch);
+}
+
+//sleep until a watched channel has something or the timeout passes
+static void wait_for_work(void) {
+    if (comp.port == INVALID_HANDLE) { yield(); return; }
+
+    //without a WM the raw keyboard is drained here and it is not watched
+    int64 timeout = comp.wm_present ? -1 : 50;
+    port_packet_t packets[16];
+    port_wait(comp.port, packets, 16, timeout);
+}
+
 static void fb_setup(void) {
     comp.fb_handle = get_obj(INVALID_HANDLE, "$devices/fb0", RIGHT_READ | RIGHT_WRITE);
     ASSERT(comp.fb_handle == INVALID_HANDLE, "Failed to get framebuffer\n");
@@ -65,6 +91,7 @@ static void server_setup(void) {
     ASSERT(ns_register("$gui/display/server", client_end, RIGHT_READ | RIGHT_WRITE) != 0,
            "Failed to register server channel\n");
     handle_close(client_end);
+    watch_channel(comp.server_handle);
     INFO("Server channel at $gui/display/server\n");
 }
 
@@ -80,6 +107,7 @@ int main(void) {
     comp.mouse_h = INVALID_HANDLE;
     comp.vt_handle = INVALID_HANDLE;
     comp.next_id = 1;
+    comp.port = port_create();
 
     fb_setup();
     comp.vt_handle = get_obj(INVALID_HANDLE, "$devices/vt0", RIGHT_WRITE);
@@ -92,8 +120,9 @@ int main(void) {
     damage_add_rect(0, 0, comp.screen_w, comp.screen_h);
 
     while (1) {
-        server_listen();
-        handle_input();
+        //each pass takes at most one message per channel, so only sleep after an empty pass
+        bool busy = server_listen();
+        busy |= handle_input();
 
         if (comp.has_damage) {
             comp.has_damage = false;
@@ -109,7 +138,8 @@ int main(void) {
             handle_seek(comp.fb_handle, 0, HANDLE_SEEK_SET);
             handle_write(comp.fb_handle, comp.backbuffer, comp.fb_size);
         }
-        yield();
+        if (busy) yield();
+        else wait_for_work();
     }
 
     return 0;
@@ -16,6 +16,8 @@
 #define MAX_SURFACES 16
 #define TITLEBAR_H  22
 #define BORDER_W     2
+#define MOUSE_QUEUE_DEPTH 128
+#define MOUSE_BATCH 32
 
 #define DECO_TB_FOCUSED    FB_RGB( 22,  24,  40)
 #define DECO_TB_UNFOCUSED  FB_RGB( 14,  15,  24)
@@ -86,6 +88,8 @@ typedef struct {
 struct compositor_state {
     handle_t fb_handle;
     handle_t server_handle;
+    //every channel we read is bound here keyed by its handle so idle frames block
+    handle_t port;
     uint32 *backbuffer;
     size fb_size;
     uint16 screen_w, screen_h;
@@ -139,5 +143,8 @@ extern struct compositor_state comp;
 
 void send_msg(handle_t ch, comp_msg_t *msg);
 int recv_msg(handle_t ch, comp_msg_t *msg, uint32 *sender_pid);
+//bind or unbind a channel on the wakeup port, unwatch before closing the handle
+void watch_channel(handle_t ch);
+void unwatch_channel(handle_t ch);
 
 #endif
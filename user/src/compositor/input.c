@@ -36,7 +36,9 @@ int hit_test(int mx, int my, surface_id_t *out_sid) {
     return 0;
 }
 
-void handle_input(void) {
+bool handle_input(void) {
+    bool busy = false;
+
     //only read raw keyboard when no WM is active; when a WM is present it owns
     //the keyboard channel and forwards key events to us via MSG_KEY_EVENT
     if (!comp.wm_present) {
@@ -44,16 +46,33 @@ void handle_input(void) {
         if (kbd_try_read(&ev) == 0) {
             //no WM to forward to in fallback mode - drop the event
             (void)ev;
+            busy = true;
         }
     }
 
     //lazy init the mouse channel
-    if (comp.mouse_h == INVALID_HANDLE)
+    if (comp.mouse_h == INVALID_HANDLE) {
         comp.mouse_h = get_obj(INVALID_HANDLE, "$devices/mouse/channel", RIGHT_READ);
+        //motion arrives in bursts between frames, leave room so none is dropped
+        if (comp.mouse_h != INVALID_HANDLE) channel_set_queue_depth(comp.mouse_h, MOUSE_QUEUE_DEPTH);
+        watch_channel(comp.mouse_h);
+    }
+
+    //drain a whole burst of motion packets with one syscall
+    mouse_event_t mbuf[MOUSE_BATCH];
+    channel_recv_slot_t slots[MOUSE_BATCH];
+    int count = 0;
+    if (comp.mouse_h != INVALID_HANDLE) {
+        for (int i = 0; i < MOUSE_BATCH; i++) {
+            slots[i] = (channel_recv_slot_t){ .buf = &mbuf[i], .buf_len = sizeof(mouse_event_t) };
+        }
+        count = channel_recv_batch(comp.mouse_h, slots, MOUSE_BATCH, CHANNEL_RECV_NONBLOCK);
+    }
 
-    mouse_event_t m;
-    while (comp.mouse_h != INVALID_HANDLE &&
-           channel_try_recv(comp.mouse_h, &m, sizeof(m)) == (ssize)sizeof(m)) {
+    for (int k = 0; k < count; k++) {
+        if (slots[k].data_len != sizeof(mouse_event_t)) continue;
+        mouse_event_t m = mbuf[k];
+        busy = true;
         //mouse packets are relative so the compositor owns the absolute cursor state
         int32 old_mx = comp.mouse_x;
         int32 old_my = comp.mouse_y;
@@ -171,4 +190,5 @@ void handle_input(void) {
         }
         comp.mprev = m;
     }
+    return busy;
 }
@@ -138,6 +138,7 @@ void handle_wm_message(comp_msg_t *msg) {
     switch (msg->type) {
         case MSG_UNCLAIM_WM:
             INFO("WM unclaimed\n");
+            unwatch_channel(comp.wm_ch);
             handle_close(comp.wm_ch);
             comp.wm_present = false;
             comp.wm_ch = INVALID_HANDLE;
@@ -237,15 +238,17 @@ void handle_wm_message(comp_msg_t *msg) {
     }
 }
 
-void server_listen(void) {
+bool server_listen(void) {
     comp_msg_t msg;
     uint32 pid = 0;
+    bool busy = false;
 
     //read the server channel for new connections surface creation and WM claims
     int rc = recv_msg(comp.server_handle, &msg, &pid);
     //minus 3 means no data nonblocking and not an error
     if (rc == -3) goto check_clients;
     if (rc < 0) { WARN("Server recv error %d\n", rc); goto check_clients; }
+    busy = true;
 
     switch (msg.type) {
         case MSG_CLIENT_CONNECT:
@@ -282,6 +285,7 @@ void server_listen(void) {
                     handle_close(client_end);
                     comp.wm_ch = wm_end;
                     comp.wm_present = true;
+                    watch_channel(comp.wm_ch);
                     kbd_close();  //WM owns keyboard now; compositor reads via MSG_KEY_EVENT
                     INFO("WM claimed\n");
 
@@ -326,6 +330,7 @@ check_clients:
 
         rc = recv_msg(s->ch, &msg, &pid);
         if (rc == -3) continue;
+        busy = true;
         if (rc < 0) {
             WARN("Client pid=%u surface id=%u disconnected (rc=%d)\n", s->owner_pid, s->id, rc);
             surface_remove_at(i--);
@@ -345,9 +350,12 @@ check_clients:
         if (wm_surf_idx < 0) {
             rc = recv_msg(comp.wm_ch, &msg, &pid);
             if (rc == 0) {
+                busy = true;
                 handle_wm_message(&msg);
             } else if (rc < 0 && rc != -3) {
                 WARN("WM channel error rc=%d\n", rc);
+                busy = true;
+                unwatch_channel(comp.wm_ch);
                 handle_close(comp.wm_ch);
                 comp.wm_present = false;
                 comp.wm_ch = INVALID_HANDLE;
@@ -356,4 +364,5 @@ check_clients:
             }
         }
     }
+    return busy;
 }
@@ -10,6 +10,7 @@ void handle_client_message(surface_t *s, comp_msg_t *msg);
 //wm channel carries policy and layout decisions
 void handle_wm_message(comp_msg_t *msg);
 //poll the server channel then each live surface channel
-void server_listen(void);
+//returns true if any message was handled
+bool server_listen(void);
 
 #endif
@@ -29,8 +29,10 @@ void surface_remove_at(int idx) {
         vmo_unmap(s->pixels, s->vmo_size);
     if (s->vmo != INVALID_HANDLE)
         handle_close(s->vmo);
-    if (s->ch != INVALID_HANDLE)
+    if (s->ch != INVALID_HANDLE) {
+        unwatch_channel(s->ch);
         handle_close(s->ch);
+    }
 
     //notify the WM so it can update its client list
     if (comp.wm_present && comp.wm_ch != INVALID_HANDLE) {
@@ -119,4 +121,5 @@ void surface_create_common(surface_t *s, uint32 pid, uint16 w, uint16 h, handle_
 
     comp.surfaces[comp.num_surfaces++] = *s;
     comp.stack[comp.stack_count++] = s->id;
+    watch_channel(ch);
 }
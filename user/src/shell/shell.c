@@ -5,6 +5,7 @@
 
 #define HIST_MAX 16
 #define LINE_MAX 128
+#define PIPELINE_MAX 4
 
 static char history[HIST_MAX][LINE_MAX];
 static int hist_count = 0;
@@ -125,7 +126,92 @@ static void cmd_pwd(void) {
     }
 }
 
+//run "a | b | c" with each stage's stdout piped into the next stage's stdin
+static void run_pipeline(char *line) {
+    char *stages[PIPELINE_MAX];
+    int nstages = 0;
+    char *s = line;
+    while (s && nstages < PIPELINE_MAX) {
+        stages[nstages++] = s;
+        s = strchr(s, '|');
+        if (s) *s++ = '\0';
+    }
+    if (s) {
+        printf("pipeline: at most %d commands\n", PIPELINE_MAX);
+        return;
+    }
+
+    int pids[PIPELINE_MAX];
+    int started = 0;
+    handle_t prev_read = INVALID_HANDLE;
+    for (int i = 0; i < nstages; i++) {
+        char *args_list[16];
+        int argc = 0;
+        char *token = strtok(stages[i], " \t\n");
+        while (token && argc < 15) {
+            args_list[argc++] = token;
+            token = strtok(NULL, " \t\n");
+        }
+        args_list[argc] = NULL;
+        if (argc == 0 || strlen(args_list[0]) >= 64) {
+            puts("pipeline: bad command\n");
+            break;
+        }
+
+        handle_t rd = INVALID_HANDLE;
+        handle_t wr = INVALID_HANDLE;
+        if (i < nstages - 1 && pipe_create(&rd, &wr) < 0) {
+            puts("pipeline: cannot create pipe\n");
+            break;
+        }
+
+        context_spawn_entry_t ctx[2];
+        int nctx = 0;
+        if (prev_read != INVALID_HANDLE) {
+            ctx[nctx++] = (context_spawn_entry_t){
+                .key = "stdin", .type = CONTEXT_VALUE_OBJECT, .value.handle = prev_read,
+            };
+        }
+        if (wr != INVALID_HANDLE) {
+            ctx[nctx++] = (context_spawn_entry_t){
+                .key = "stdout", .type = CONTEXT_VALUE_OBJECT, .value.handle = wr,
+            };
+        }
+
+        char path[128];
+        snprintf(path, sizeof(path), "$files/system/binaries/%s", args_list[0]);
+        int pid = spawn_ctx(path, argc, args_list, ctx, nctx);
+
+        //the child holds its own references, ours would keep end of file from arriving
+        if (prev_read != INVALID_HANDLE) handle_close(prev_read);
+        if (wr != INVALID_HANDLE) handle_close(wr);
+        prev_read = rd;
+
+        if (pid < 0) {
+            printf("Unknown command: %s\n", args_list[0]);
+            break;
+        }
+        pids[started++] = pid;
+    }
+    if (prev_read != INVALID_HANDLE) handle_close(prev_read);
+    if (started == 0) return;
+
+    proc_set_console_foreground((uintptr)pids[started - 1]);
+    //a stage's pipe end is released when it is reaped, so reap front to back
+    for (int i = 0; i < started; i++) {
+        int code = wait(pids[i]);
+        if (code != 0) printf("pipeline: command %d died with error code %d\n", i + 1, code);
+    }
+    proc_set_console_foreground(0);
+    shell_reset_terminal();
+}
+
 static void process_command(char *line) {
+    if (strchr(line, '|')) {
+        run_pipeline(line);
+        return;
+    }
+
     char *cmd = strtok(line, " \t\n");
     if (!cmd) return;
 